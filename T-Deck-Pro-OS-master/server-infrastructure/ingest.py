@@ -0,0 +1,345 @@
+#!/usr/bin/env python3
+"""
+T-Deck-Pro ingestion pipeline
+Batches MQTT telemetry, status and mesh writes through a bounded queue into one SQLite writer
+"""
+
+import json
+import logging
+import queue
+import sqlite3
+import threading
+import time
+from datetime import datetime, timedelta
+from typing import Any, Callable, Dict, List, Optional, Tuple
+
+QUEUE_SIZE = 10000          # Items held before producers block, then drop
+ENQUEUE_TIMEOUT = 0.5       # Seconds an MQTT callback waits on a full queue
+BATCH_SIZE = 500            # Items written per transaction
+FLUSH_INTERVAL = 0.25       # Seconds a partial batch waits for more items
+BUSY_TIMEOUT = 5.0          # Seconds a write waits for a dashboard reader
+
+RAW_RETENTION = timedelta(days=7)       # Raw telemetry older than this is rolled up per hour
+ROLLUP_RETENTION = timedelta(days=365)
+MESH_RETENTION_DAYS = 30
+MAINTENANCE_INTERVAL = 3600             # Seconds between retention passes
+ROLLUP_CHUNK = 2000                     # Raw rows rolled up per device and transaction
+
+logger = logging.getLogger(__name__)
+
+class Ingestor:
+    """Single writer for everything devices report
+
+    MQTT callbacks only parse and enqueue; one thread owns the write connection
+    and commits up to BATCH_SIZE items per transaction, so a fleet reconnecting
+    at once costs a few commits instead of one connect and commit per message.
+    Per-device last_seen updates are coalesced within a batch.
+    """
+
+    def __init__(self, db_path: str):
+        self.db_path = db_path
+        self.queue = queue.Queue(maxsize=QUEUE_SIZE)
+        self.thread = None
+        self.running = False
+        self.batch_seqs = {}  # Last stored telemetry batch per device, to drop resends
+        self.last_maintenance = None  # First pass right after start
+        self.stats = {
+            'enqueued': 0,
+            'dropped': 0,
+            'written': 0,
+            'transactions': 0,
+            'failed': 0,
+            'last_batch': 0,
+            'last_commit_ms': 0.0,
+            'rolled_up': 0,
+            'expired': 0
+        }
+
+    @staticmethod
+    def setup_schema(cursor: sqlite3.Cursor):
+        """WAL mode, the time-series indexes and the hourly rollup table"""
+        # Persistent per database file: readers no longer block the writer
+        cursor.execute('PRAGMA journal_mode=WAL')
+
+        cursor.execute('''
+            CREATE INDEX IF NOT EXISTS idx_telemetry_device_time
+            ON telemetry (device_id, timestamp)
+        ''')
+
+        cursor.execute('''
+            CREATE TABLE IF NOT EXISTS telemetry_hourly (
+                device_id TEXT,
+                timestamp TIMESTAMP,  -- Start of the hour
+                samples INTEGER,
+                data TEXT,  -- JSON: mean, _min and _max per metric
+                PRIMARY KEY (device_id, timestamp)
+            ) WITHOUT ROWID
+        ''')
+
+        cursor.execute('''
+            CREATE INDEX IF NOT EXISTS idx_mesh_messages_time
+            ON mesh_messages (timestamp)
+        ''')
+
+    def start(self):
+        """Start the writer thread"""
+        if self.thread:
+            return
+        self.running = True
+        self.thread = threading.Thread(target=self.run, name="ingest", daemon=True)
+        self.thread.start()
+        logger.info("Ingestion writer started")
+
+    def stop(self):
+        """Write what is queued and stop the writer"""
+        if not self.thread:
+            return
+        self.running = False
+        self.thread.join()
+        self.thread = None
+        logger.info(f"Ingestion writer stopped: {self.stats['written']} items written, "
+                    f"{self.stats['dropped']} dropped")
+
+    def submit(self, kind: str, *args, on_commit: Optional[Callable[[], None]] = None) -> bool:
+        """Queue one write; on_commit runs on the writer thread once it is durable
+
+        Blocks for at most ENQUEUE_TIMEOUT, which pushes back on the broker
+        connection, then drops the item.
+        """
+        try:
+            self.queue.put((kind, args, on_commit), timeout=ENQUEUE_TIMEOUT)
+        except queue.Full:
+            self.stats['dropped'] += 1
+            if self.stats['dropped'] % 100 == 1:
+                logger.warning(f"Ingest queue full, {self.stats['dropped']} items dropped so far")
+            return False
+        self.stats['enqueued'] += 1
+        return True
+
+    def get_stats(self) -> Dict[str, Any]:
+        """Counters for the dashboard"""
+        return dict(self.stats, queued=self.queue.qsize(), capacity=QUEUE_SIZE)
+
+    # ===== WRITER =====
+
+    def run(self):
+        conn = sqlite3.connect(self.db_path, timeout=BUSY_TIMEOUT)
+        # WAL makes NORMAL durable across application crashes; only a power cut can lose the last commits
+        conn.execute('PRAGMA synchronous=NORMAL')
+
+        while self.running or not self.queue.empty():
+            batch = self.collect()
+            if batch:
+                self.write(conn, batch)
+            if self.last_maintenance is None or time.monotonic() - self.last_maintenance > MAINTENANCE_INTERVAL:
+                self.maintain(conn)
+
+        conn.close()
+
+    def collect(self) -> List[Tuple[str, tuple, Optional[Callable[[], None]]]]:
+        """Wait for a first item, then take whatever arrives within FLUSH_INTERVAL"""
+        try:
+            batch = [self.queue.get(timeout=FLUSH_INTERVAL)]
+        except queue.Empty:
+            return []
+
+        deadline = time.monotonic() + FLUSH_INTERVAL
+        while len(batch) < BATCH_SIZE:
+            remaining = deadline - time.monotonic()
+            try:
+                batch.append(self.queue.get(timeout=max(remaining, 0)) if remaining > 0
+                             else self.queue.get_nowait())
+            except queue.Empty:
+                break
+        return batch
+
+    def write(self, conn: sqlite3.Connection, batch: list):
+        """Apply a batch in one transaction; on failure nothing is acknowledged and devices resend"""
+        telemetry = []
+        registrations = []
+        mesh = []
+        last_seen = {}  # device_id -> (time, status), latest wins
+        seqs = {}
+        callbacks = []
+
+        for kind, args, on_commit in batch:
+            if kind == 'telemetry':
+                device_id, timestamp, data = args
+                telemetry.append((device_id, timestamp, json.dumps(data)))
+                last_seen[device_id] = (timestamp, 'online')
+            elif kind == 'telemetry_batch':
+                device_id, seq, timestamp, rows = args
+                # A resend after a lost ack only needs the ack again
+                if seqs.get(device_id, self.batch_seqs.get(device_id)) != seq:
+                    telemetry.extend(rows)
+                    seqs[device_id] = seq
+                last_seen[device_id] = (timestamp, 'online')
+            elif kind == 'status':
+                device_id, timestamp, status = args
+                last_seen[device_id] = (timestamp, status)
+            elif kind == 'register':
+                registrations.append(args)
+                last_seen.pop(args[0], None)
+            elif kind == 'mesh':
+                mesh.append(args)
+            if on_commit:
+                callbacks.append(on_commit)
+
+        start = time.monotonic()
+        try:
+            with conn:
+                cursor = conn.cursor()
+                cursor.executemany('''
+                    INSERT OR REPLACE INTO devices
+                    (device_id, device_type, firmware_version, last_seen, status, config)
+                    VALUES (?, ?, ?, ?, ?, ?)
+                ''', registrations)
+                cursor.executemany('''
+                    INSERT INTO telemetry (device_id, timestamp, data)
+                    VALUES (?, ?, ?)
+                ''', telemetry)
+                cursor.executemany('''
+                    UPDATE devices SET last_seen = ?, status = ?
+                    WHERE device_id = ?
+                ''', [(seen, status, device_id) for device_id, (seen, status) in last_seen.items()])
+                cursor.executemany('''
+                    INSERT INTO mesh_messages (from_node, to_node, message_type, payload)
+                    VALUES (?, ?, ?, ?)
+                ''', mesh)
+        except sqlite3.Error as e:
+            self.stats['failed'] += len(batch)
+            logger.error(f"Ingest batch of {len(batch)} items failed: {e}")
+            return
+
+        self.batch_seqs.update(seqs)
+        self.stats['written'] += len(batch)
+        self.stats['transactions'] += 1
+        self.stats['last_batch'] = len(batch)
+        self.stats['last_commit_ms'] = round((time.monotonic() - start) * 1000, 2)
+
+        for callback in callbacks:
+            try:
+                callback()
+            except Exception as e:
+                logger.error(f"Ingest commit callback failed: {e}")
+
+    # ===== RETENTION =====
+
+    def maintain(self, conn: sqlite3.Connection):
+        """Roll old raw telemetry up per hour and expire what is past retention
+
+        Runs in short transactions between batches and gives way as soon as a
+        full batch is queued; the pass then resumes after that batch.
+        """
+        now = datetime.now()
+        cutoff = (now - RAW_RETENTION).replace(minute=0, second=0, microsecond=0)
+
+        try:
+            devices = [row[0] for row in conn.execute(
+                'SELECT DISTINCT device_id FROM telemetry WHERE timestamp < ?', (cutoff,))]
+            for device_id in devices:
+                more = True
+                while more:
+                    if self.queue.qsize() >= BATCH_SIZE:
+                        return
+                    more = self.rollup(conn, device_id, cutoff)
+
+            with conn:
+                expired = conn.execute('DELETE FROM telemetry_hourly WHERE timestamp < ?',
+                                       (now - ROLLUP_RETENTION,)).rowcount
+                # mesh_messages is stamped by SQLite in UTC
+                expired += conn.execute("DELETE FROM mesh_messages WHERE timestamp < datetime('now', ?)",
+                                        (f'-{MESH_RETENTION_DAYS} days',)).rowcount
+            self.stats['expired'] += expired
+        except sqlite3.Error as e:
+            logger.error(f"Telemetry retention failed: {e}")
+            self.last_maintenance = time.monotonic()
+            return
+
+        self.last_maintenance = time.monotonic()
+        logger.info(f"Telemetry retention: {self.stats['rolled_up']} rows rolled up, "
+                    f"{self.stats['expired']} expired so far")
+
+    def rollup(self, conn: sqlite3.Connection, device_id: str, cutoff: datetime) -> bool:
+        """Fold one chunk of a device's raw rows before cutoff into hourly rows
+
+        Returns True while more rows remain.
+        """
+        rows = conn.execute('''
+            SELECT id, timestamp, data FROM telemetry
+            WHERE device_id = ? AND timestamp < ?
+            ORDER BY timestamp LIMIT ?
+        ''', (device_id, cutoff, ROLLUP_CHUNK)).fetchall()
+        if not rows:
+            return False
+
+        hours = {}
+        for row_id, timestamp, data in rows:
+            hour = str(timestamp)[:13] + ':00:00'
+            hours.setdefault(hour, []).append((row_id, json.loads(data)))
+
+        # A full chunk may end part way through an hour; leave that hour for the next chunk
+        more = len(rows) == ROLLUP_CHUNK
+        if more and len(hours) > 1:
+            hours.pop(max(hours))
+
+        with conn:
+            for hour, rolled in hours.items():
+                entries = [entry for _, entry in rolled]
+                existing = conn.execute('''
+                    SELECT data FROM telemetry_hourly WHERE device_id = ? AND timestamp = ?
+                ''', (device_id, hour)).fetchone()
+                if existing:
+                    entries.append(json.loads(existing[0]))
+                summary = summarize(entries)
+                conn.execute('''
+                    INSERT OR REPLACE INTO telemetry_hourly (device_id, timestamp, samples, data)
+                    VALUES (?, ?, ?, ?)
+                ''', (device_id, hour, summary['samples'], json.dumps(summary)))
+
+            ids = [(row_id,) for rolled in hours.values() for row_id, _ in rolled]
+            conn.executemany('DELETE FROM telemetry WHERE id = ?', ids)
+
+        self.stats['rolled_up'] += len(ids)
+        return more
+
+def summarize(entries: List[Dict[str, Any]]) -> Dict[str, Any]:
+    """Sample-weighted mean, min and max of every numeric metric
+
+    Takes raw telemetry, batch windows and earlier summaries alike: an entry
+    with 'samples' stands for that many readings, and existing _min/_max
+    fields are kept rather than recomputed from the mean.
+    """
+    total = 0
+    sums = {}
+    weights = {}
+    mins = {}
+    maxs = {}
+
+    for entry in entries:
+        samples = entry.get('samples', 1)
+        if not isinstance(samples, (int, float)) or samples <= 0:
+            samples = 1
+        total += samples
+
+        for key, value in entry.items():
+            if key == 'samples' or isinstance(value, bool) or not isinstance(value, (int, float)):
+                continue
+            if key.endswith('_min'):
+                name = key[:-4]
+                mins[name] = min(mins.get(name, value), value)
+            elif key.endswith('_max'):
+                name = key[:-4]
+                maxs[name] = max(maxs.get(name, value), value)
+            else:
+                sums[key] = sums.get(key, 0.0) + value * samples
+                weights[key] = weights.get(key, 0) + samples
+                mins[key] = min(mins.get(key, value), value)
+                maxs[key] = max(maxs.get(key, value), value)
+
+    summary = {'samples': total}
+    for key in sums:
+        summary[key] = round(sums[key] / weights[key], 3)
+        summary[f'{key}_min'] = mins[key]
+        summary[f'{key}_max'] = maxs[key]
+    return summary
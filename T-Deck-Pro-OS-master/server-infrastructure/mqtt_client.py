@@ -9,6 +9,7 @@ import time
 import hashlib
 from datetime import datetime
 from typing import Dict, Any, Optional, Callable
+import msgpack
 import paho.mqtt.client as mqtt
 
 class TDeckProMQTTClient:
@@ -17,10 +18,12 @@ class TDeckProMQTTClient:
     Handles all server communication via MQTT topics
     """
     
-    def __init__(self, device_id: str, broker_host: str = "localhost", broker_port: int = 1883):
+    def __init__(self, device_id: str, broker_host: str = "localhost", broker_port: int = 1883,
+                 payload_format: str = "json"):
         self.device_id = device_id
         self.broker_host = broker_host
         self.broker_port = broker_port
+        self.payload_format = payload_format  # "json" or "msgpack", may be changed by server config
         self.client = mqtt.Client()
         self.connected = False
         
@@ -64,6 +67,12 @@ class TDeckProMQTTClient:
         else:
             print(f"MQTT connection failed with code {rc}")
             
+    def _encode(self, data: Dict[str, Any]) -> bytes:
+        """Encode a payload in the current format"""
+        if self.payload_format == "msgpack":
+            return msgpack.packb(data, use_bin_type=True)
+        return json.dumps(data).encode()
+        
     def _on_disconnect(self, client, userdata, rc):
         """MQTT disconnection callback"""
         self.connected = False
@@ -77,8 +86,14 @@ class TDeckProMQTTClient:
                 return
                 
             message_type = topic_parts[2]
-            payload = json.loads(msg.payload.decode())
+            if msg.payload[:1] == b'{':
+                payload = json.loads(msg.payload.decode())
+            else:
+                payload = msgpack.unpackb(msg.payload, raw=False)
             
+            if message_type == "config" and 'payload_format' in payload:
+                self.payload_format = payload['payload_format']
+                
             if message_type == "config" and self.config_handler:
                 self.config_handler(payload)
             elif message_type == "ota" and self.ota_handler:
@@ -95,7 +110,7 @@ class TDeckProMQTTClient:
             return False
             
         topic = f"tdeckpro/{self.device_id}/register"
-        payload = json.dumps(device_info)
+        payload = self._encode(device_info)
         
         result = self.client.publish(topic, payload)
         return result.rc == mqtt.MQTT_ERR_SUCCESS
@@ -109,7 +124,7 @@ class TDeckProMQTTClient:
         telemetry_data['timestamp'] = datetime.now().isoformat()
         
         topic = f"tdeckpro/{self.device_id}/telemetry"
-        payload = json.dumps(telemetry_data)
+        payload = self._encode(telemetry_data)
         
         result = self.client.publish(topic, payload)
         return result.rc == mqtt.MQTT_ERR_SUCCESS
@@ -128,7 +143,7 @@ class TDeckProMQTTClient:
             status_data.update(additional_data)
             
         topic = f"tdeckpro/{self.device_id}/status"
-        payload = json.dumps(status_data)
+        payload = self._encode(status_data)
         
         result = self.client.publish(topic, payload)
         return result.rc == mqtt.MQTT_ERR_SUCCESS
@@ -147,7 +162,7 @@ class TDeckProMQTTClient:
         }
         
         topic = f"tdeckpro/mesh/{message_type}"
-        message = json.dumps(mesh_data)
+        message = self._encode(mesh_data)
         
         result = self.client.publish(topic, message)
         return result.rc == mqtt.MQTT_ERR_SUCCESS
@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""
+T-Deck-Pro delta firmware images
+Builds bsdiff-style patches in the streaming "TDD1" layout applied by src/services/ota_delta.cpp
+"""
+
+import struct
+from typing import Dict, List, Tuple
+
+MAGIC = b'TDD1'
+BLOCK = 32          # Match seed length; shorter matches do not pay for a 12 byte record
+INDEX_STEP = 16     # Base positions sampled into the seed index
+TOKEN_RUN = 128     # Longest run one diff token covers
+
+def _encode_diff(diff: bytes) -> bytes:
+    """Tokenize a diff run: 0x00-0x7F copies n+1 base bytes, 0x80-0xFF prefixes n-127 literal deltas
+
+    Matched code gives long zero runs, which is what bsdiff leaves to its compressor;
+    the tokens get most of that gain while keeping the stream decodable in place.
+    """
+    out = bytearray()
+    pos = 0
+    while pos < len(diff):
+        end = pos
+        while end < len(diff) and end - pos < TOKEN_RUN and diff[end] == 0:
+            end += 1
+        if end > pos:
+            out.append(end - pos - 1)
+            pos = end
+            continue
+        # Literal run up to the next pair of zeros; a lone zero is cheaper kept inline
+        while end < len(diff) and end - pos < TOKEN_RUN and not (diff[end] == 0 and diff[end + 1:end + 2] == b'\0'):
+            end += 1
+        out.append(0x80 + end - pos - 1)
+        out += diff[pos:end]
+        pos = end
+    return bytes(out)
+
+def _build_index(base: bytes) -> Dict[bytes, int]:
+    """Map sampled base blocks to their first position"""
+    index: Dict[bytes, int] = {}
+    for pos in range(0, len(base) - BLOCK + 1, INDEX_STEP):
+        index.setdefault(base[pos:pos + BLOCK], pos)
+    return index
+
+def _extend(base: bytes, target: bytes, old: int, new: int, new_floor: int) -> Tuple[int, int, int]:
+    """Grow an exact seed backwards to new_floor, then forwards while bsdiff's score improves"""
+    while old > 0 and new > new_floor and base[old - 1] == target[new - 1]:
+        old -= 1
+        new -= 1
+
+    # Forward, tolerating mismatches as long as at least half the bytes still agree;
+    # small code moves change a few bytes per instruction and those stay in the diff
+    length = best = score = best_score = 0
+    limit = min(len(base) - old, len(target) - new)
+    while length < limit:
+        score += 1 if base[old + length] == target[new + length] else -1
+        length += 1
+        if score > best_score:
+            best_score, best = score, length
+        elif score < best_score - BLOCK:
+            break
+    return old, new, best
+
+def _matches(base: bytes, target: bytes) -> List[Tuple[int, int, int]]:
+    """Greedy (old, new, length) matches in target order"""
+    index = _build_index(base)
+    found = []
+    new = 0
+    floor = 0
+    while new + BLOCK <= len(target):
+        old = index.get(target[new:new + BLOCK])
+        if old is None:
+            new += 1
+            continue
+        old, start, length = _extend(base, target, old, new, floor)
+        found.append((old, start, length))
+        new = floor = start + length
+    return found
+
+def make_delta(base: bytes, target: bytes) -> bytes:
+    """Build a patch turning base into target"""
+    out = bytearray(MAGIC)
+    out += struct.pack('<III', len(target), len(base), 0)
+
+    # Each record is the diff of one match followed by the literal bytes up to the next one
+    pending_old, pending_new, pending_len = 0, 0, 0
+    for old, new, length in _matches(base, target) + [(0, len(target), 0)]:
+        diff = bytes((target[pending_new + i] - base[pending_old + i]) & 0xFF for i in range(pending_len))
+        extra = target[pending_new + pending_len:new]
+        seek = old - (pending_old + pending_len)
+        if length == 0 and new == len(target):
+            seek = 0
+        out += struct.pack('<IIi', len(diff), len(extra), seek)
+        out += _encode_diff(diff)
+        out += extra
+        pending_old, pending_new, pending_len = old, new, length
+    return bytes(out)
+
+def apply_delta(base: bytes, patch: bytes) -> bytes:
+    """Reference decoder, used to check a patch before it is offered"""
+    if patch[:4] != MAGIC:
+        raise ValueError("bad magic")
+    target_size, _, _ = struct.unpack_from('<III', patch, 4)
+    pos = 16
+    old = 0
+    out = bytearray()
+    while len(out) < target_size:
+        diff_len, extra_len, seek = struct.unpack_from('<IIi', patch, pos)
+        pos += 12
+        done = 0
+        while done < diff_len:
+            token = patch[pos]
+            pos += 1
+            run = (token & 0x7F) + 1
+            if done + run > diff_len:
+                raise ValueError("diff token exceeds run")
+            for i in range(done, done + run):
+                ref = base[old + i] if 0 <= old + i < len(base) else 0
+                delta = 0
+                if token & 0x80:
+                    delta = patch[pos]
+                    pos += 1
+                out.append((delta + ref) & 0xFF)
+            done += run
+        old += diff_len
+        out += patch[pos:pos + extra_len]
+        pos += extra_len
+        old += seek
+    return bytes(out)
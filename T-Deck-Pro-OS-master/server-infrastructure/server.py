@@ -5,20 +5,25 @@ Simple MQTT-based server for T-Deck-Pro device management
 """
 
 import asyncio
+import hashlib
 import json
 import logging
 import sqlite3
 import time
-from datetime import datetime
+from datetime import datetime, timedelta
 from pathlib import Path
 from typing import Dict, Any, Optional
 
+import msgpack
 import paho.mqtt.client as mqtt
-from fastapi import FastAPI, HTTPException, UploadFile, File
+from fastapi import FastAPI, HTTPException, UploadFile, File, Request
 from fastapi.staticfiles import StaticFiles
-from fastapi.responses import HTMLResponse, FileResponse
+from fastapi.responses import HTMLResponse, FileResponse, Response
 import uvicorn
 
+from ota_delta import make_delta, apply_delta
+from ingest import Ingestor
+
 # Configuration
 MQTT_BROKER = "localhost"
 MQTT_PORT = 1883
@@ -26,6 +31,10 @@ WEB_PORT = 8000
 DB_PATH = "data/tdeckpro.db"
 OTA_PATH = "data/ota-updates"
 LOG_PATH = "data/logs"
+PAYLOAD_FORMAT = "msgpack"  # Encoding devices are asked to use: "json" or "msgpack"
+
+# Metric order of the min/max/mean columns in a telemetry batch window
+BATCH_METRICS = ['battery_percentage', 'temperature', 'cpu_usage', 'memory_usage', 'signal_strength']
 
 # Setup logging
 logging.basicConfig(
@@ -38,11 +47,18 @@ logging.basicConfig(
 )
 logger = logging.getLogger(__name__)
 
+def decode_payload(raw: bytes) -> Dict[str, Any]:
+    """Decode a device payload; JSON objects start with '{', anything else is MessagePack"""
+    if raw[:1] == b'{':
+        return json.loads(raw.decode())
+    return msgpack.unpackb(raw, raw=False)
+
 class TDeckProServer:
     def __init__(self):
         self.mqtt_client = None
         self.db_path = DB_PATH
         self.devices = {}  # In-memory device cache
+        self.ingestor = Ingestor(self.db_path)  # Single writer for device traffic
         self.setup_directories()
         self.setup_database()
         
@@ -94,6 +110,18 @@ class TDeckProServer:
             )
         ''')
         
+        # Delta images, one per firmware version and the version it patches
+        cursor.execute('''
+            CREATE TABLE IF NOT EXISTS ota_deltas (
+                id INTEGER PRIMARY KEY AUTOINCREMENT,
+                version TEXT,
+                base_version TEXT,
+                filename TEXT,
+                base_digest TEXT,
+                created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+            )
+        ''')
+        
         # Apps table
         cursor.execute('''
             CREATE TABLE IF NOT EXISTS apps (
@@ -119,6 +147,8 @@ class TDeckProServer:
             )
         ''')
         
+        Ingestor.setup_schema(cursor)
+        
         conn.commit()
         conn.close()
         logger.info("Database initialized")
@@ -142,6 +172,7 @@ class TDeckProServer:
             logger.info("MQTT connected successfully")
             # Subscribe to all T-Deck-Pro topics
             client.subscribe("tdeckpro/+/telemetry")
+            client.subscribe("tdeckpro/+/telemetry_batch")
             client.subscribe("tdeckpro/+/status")
             client.subscribe("tdeckpro/+/register")
             client.subscribe("tdeckpro/mesh/+")
@@ -161,12 +192,14 @@ class TDeckProServer:
             device_id = topic_parts[1]
             message_type = topic_parts[2]
             
-            payload = json.loads(msg.payload.decode())
+            payload = decode_payload(msg.payload)
             
             if message_type == "register":
                 self.handle_device_registration(device_id, payload)
             elif message_type == "telemetry":
                 self.handle_telemetry(device_id, payload)
+            elif message_type == "telemetry_batch":
+                self.handle_telemetry_batch(device_id, payload)
             elif message_type == "status":
                 self.handle_status_update(device_id, payload)
             elif topic_parts[1] == "mesh":
@@ -179,47 +212,24 @@ class TDeckProServer:
         """Handle device registration"""
         logger.info(f"Device registration: {device_id}")
         
-        conn = sqlite3.connect(self.db_path)
-        cursor = conn.cursor()
-        
-        cursor.execute('''
-            INSERT OR REPLACE INTO devices 
-            (device_id, device_type, firmware_version, last_seen, status, config)
-            VALUES (?, ?, ?, ?, ?, ?)
-        ''', (
+        self.ingestor.submit(
+            'register',
             device_id,
             data.get('device_type', 'unknown'),
             data.get('firmware_version', '0.0.0'),
             datetime.now(),
             'online',
             json.dumps(data.get('config', {}))
-        ))
-        
-        conn.commit()
-        conn.close()
+        )
         
         # Send welcome configuration
         self.send_device_config(device_id)
+        self.offer_update(device_id, data.get('firmware_version', '0.0.0'))
         
     def handle_telemetry(self, device_id: str, data: Dict[str, Any]):
         """Handle device telemetry data"""
-        conn = sqlite3.connect(self.db_path)
-        cursor = conn.cursor()
-        
-        # Update device last seen
-        cursor.execute('''
-            UPDATE devices SET last_seen = ?, status = 'online' 
-            WHERE device_id = ?
-        ''', (datetime.now(), device_id))
-        
-        # Store telemetry
-        cursor.execute('''
-            INSERT INTO telemetry (device_id, timestamp, data)
-            VALUES (?, ?, ?)
-        ''', (device_id, datetime.now(), json.dumps(data)))
-        
-        conn.commit()
-        conn.close()
+        # Stored with the device's last_seen by the ingest writer
+        self.ingestor.submit('telemetry', device_id, datetime.now(), data)
         
         # Update in-memory cache
         self.devices[device_id] = {
@@ -227,47 +237,76 @@ class TDeckProServer:
             'telemetry': data
         }
         
+    def handle_telemetry_batch(self, device_id: str, data: Dict[str, Any]):
+        """Store a batch of aggregated telemetry windows and acknowledge it once committed"""
+        seq = data.get('seq')
+        windows = data.get('windows', [])
+        now = datetime.now()
+        boot = data.get('boot')
+        uptime = data.get('uptime', 0)
+        rows = []
+        
+        for window in windows:
+            epoch, window_boot, uptime_end, samples = window[:4]
+            values = window[4:]
+            count = len(BATCH_METRICS)
+            
+            # Without a set clock, only windows from the current boot can be placed in time
+            if epoch:
+                timestamp = datetime.fromtimestamp(epoch)
+            elif window_boot == boot:
+                timestamp = now - timedelta(milliseconds=uptime - uptime_end)
+            else:
+                timestamp = now
+                
+            entry = {'samples': samples}
+            for i, name in enumerate(BATCH_METRICS):
+                entry[name] = values[2 * count + i]
+                entry[f'{name}_min'] = values[i]
+                entry[f'{name}_max'] = values[count + i]
+            rows.append((device_id, timestamp, json.dumps(entry)))
+            
+        def acknowledge():
+            # The device drops the windows from its spool on this ack, so only send it once they are stored
+            topic = f"tdeckpro/{device_id}/ack"
+            self.mqtt_client.publish(topic, json.dumps({'seq': seq, 'count': len(windows)}), qos=1)
+            
+        # A full queue sends no ack; the device resends the batch later
+        if not self.ingestor.submit('telemetry_batch', device_id, seq, now, rows, on_commit=acknowledge):
+            return
+            
+        if rows:
+            self.devices[device_id] = {
+                'last_seen': now,
+                'telemetry': json.loads(rows[-1][2])
+            }
+        logger.info(f"Telemetry batch {seq} from {device_id}: {len(rows)} windows")
+        
     def handle_status_update(self, device_id: str, data: Dict[str, Any]):
         """Handle device status updates"""
         logger.info(f"Status update from {device_id}: {data.get('status')}")
         
-        conn = sqlite3.connect(self.db_path)
-        cursor = conn.cursor()
-        
-        cursor.execute('''
-            UPDATE devices SET status = ?, last_seen = ? 
-            WHERE device_id = ?
-        ''', (data.get('status', 'unknown'), datetime.now(), device_id))
-        
-        conn.commit()
-        conn.close()
+        self.ingestor.submit('status', device_id, datetime.now(), data.get('status', 'unknown'))
         
     def handle_mesh_message(self, message_type: str, data: Dict[str, Any]):
         """Handle mesh network messages"""
         logger.info(f"Mesh message: {message_type}")
         
-        conn = sqlite3.connect(self.db_path)
-        cursor = conn.cursor()
-        
-        cursor.execute('''
-            INSERT INTO mesh_messages (from_node, to_node, message_type, payload)
-            VALUES (?, ?, ?, ?)
-        ''', (
+        self.ingestor.submit(
+            'mesh',
             data.get('from_node'),
             data.get('to_node'),
             message_type,
             json.dumps(data.get('payload', {}))
-        ))
-        
-        conn.commit()
-        conn.close()
+        )
         
     def send_device_config(self, device_id: str):
         """Send configuration to device"""
         config = {
             'server_time': datetime.now().isoformat(),
             'update_interval': 300,  # 5 minutes
-            'auto_update': True
+            'auto_update': True,
+            'payload_format': PAYLOAD_FORMAT
         }
         
         topic = f"tdeckpro/{device_id}/config"
@@ -286,18 +325,82 @@ class TDeckProServer:
         ''', (current_version,))
         
         result = cursor.fetchone()
+        
+        delta = None
+        if result:
+            cursor.execute('''
+                SELECT filename, base_digest FROM ota_deltas
+                WHERE version = ? AND base_version = ?
+                ORDER BY created_at DESC LIMIT 1
+            ''', (result[0], current_version))
+            delta = cursor.fetchone()
         conn.close()
         
         if result:
-            return {
+            update = {
                 'available': True,
                 'version': result[0],
                 'filename': result[1],
                 'checksum': result[2],
+                'size': (Path(OTA_PATH) / result[1]).stat().st_size,
                 'download_url': f'/ota/download/{result[1]}'
             }
+            # Devices on the patch's base version download the delta instead
+            if delta:
+                update['delta'] = {
+                    'download_url': f'/ota/download/{delta[0]}',
+                    'size': (Path(OTA_PATH) / delta[0]).stat().st_size,
+                    'base_digest': delta[1]
+                }
+            return update
         return {'available': False}
         
+    def offer_update(self, device_id: str, current_version: str):
+        """Push an available update to the device's OTA topic"""
+        update = self.check_for_updates(device_id, current_version)
+        if not update.get('available'):
+            return
+        
+        topic = f"tdeckpro/{device_id}/ota"
+        self.mqtt_client.publish(topic, json.dumps(update))
+        logger.info(f"Offered firmware {update['version']} to {device_id}"
+                    f"{' as delta' if 'delta' in update else ''}")
+        
+    def create_delta(self, version: str, content: bytes, base_version: str) -> Optional[str]:
+        """Build a patch from a stored firmware version to a new one"""
+        conn = sqlite3.connect(self.db_path)
+        cursor = conn.cursor()
+        cursor.execute('''
+            SELECT filename FROM ota_updates
+            WHERE type = 'firmware' AND version = ?
+            ORDER BY created_at DESC LIMIT 1
+        ''', (base_version,))
+        row = cursor.fetchone()
+        if not row:
+            conn.close()
+            return None
+        
+        base = (Path(OTA_PATH) / row[0]).read_bytes()
+        patch = make_delta(base, content)
+        if apply_delta(base, patch) != content:
+            conn.close()
+            raise ValueError("delta does not reproduce the image")
+        
+        # Devices compare this with the image digest ESP-IDF appends to the running app
+        base_digest = base[-32:].hex()
+        filename = f"firmware-{version}-from-{base_version}.tdd"
+        (Path(OTA_PATH) / filename).write_bytes(patch)
+        
+        cursor.execute('''
+            INSERT INTO ota_deltas (version, base_version, filename, base_digest)
+            VALUES (?, ?, ?, ?)
+        ''', (version, base_version, filename, base_digest))
+        conn.commit()
+        conn.close()
+        
+        logger.info(f"Delta {filename}: {len(patch)} bytes for a {len(content)} byte image")
+        return filename
+        
     def get_device_list(self) -> list:
         """Get list of all devices"""
         conn = sqlite3.connect(self.db_path)
@@ -321,13 +424,15 @@ class TDeckProServer:
         conn.close()
         return devices
         
-    def get_device_telemetry(self, device_id: str, limit: int = 100) -> list:
-        """Get recent telemetry for device"""
+    def get_device_telemetry(self, device_id: str, limit: int = 100, resolution: str = "raw") -> list:
+        """Get recent telemetry for device; "hour" reads the rollups kept past raw retention"""
+        table = 'telemetry_hourly' if resolution == 'hour' else 'telemetry'
         conn = sqlite3.connect(self.db_path)
         cursor = conn.cursor()
         
-        cursor.execute('''
-            SELECT timestamp, data FROM telemetry 
+        # Served by the (device_id, timestamp) index, newest first
+        cursor.execute(f'''
+            SELECT timestamp, data FROM {table}
             WHERE device_id = ? 
             ORDER BY timestamp DESC LIMIT ?
         ''', (device_id, limit))
@@ -351,8 +456,17 @@ app = FastAPI(title="T-Deck-Pro Server", description="Lightweight T-Deck-Pro man
 @app.on_event("startup")
 async def startup_event():
     """Initialize server on startup"""
+    server.ingestor.start()
     server.setup_mqtt()
 
+@app.on_event("shutdown")
+async def shutdown_event():
+    """Stop taking device traffic and write out what is queued"""
+    if server.mqtt_client:
+        server.mqtt_client.loop_stop()
+        server.mqtt_client.disconnect()
+    server.ingestor.stop()
+
 @app.get("/", response_class=HTMLResponse)
 async def dashboard():
     """Simple web dashboard"""
@@ -450,9 +564,14 @@ async def api_devices():
     return server.get_device_list()
 
 @app.get("/api/device/{device_id}/telemetry")
-async def api_device_telemetry(device_id: str, limit: int = 100):
-    """API endpoint for device telemetry"""
-    return server.get_device_telemetry(device_id, limit)
+async def api_device_telemetry(device_id: str, limit: int = 100, resolution: str = "raw"):
+    """API endpoint for device telemetry at "raw" or "hour" resolution"""
+    return server.get_device_telemetry(device_id, limit, resolution)
+
+@app.get("/api/ingest/stats")
+async def api_ingest_stats():
+    """API endpoint for ingestion queue depth, throughput and drops"""
+    return server.ingestor.get_stats()
 
 @app.get("/api/device/{device_id}/updates")
 async def api_check_updates(device_id: str, current_version: str):
@@ -460,8 +579,9 @@ async def api_check_updates(device_id: str, current_version: str):
     return server.check_for_updates(device_id, current_version)
 
 @app.post("/api/ota/upload")
-async def upload_ota(file: UploadFile = File(...), version: str = "", type: str = "firmware"):
-    """Upload OTA update file"""
+async def upload_ota(file: UploadFile = File(...), version: str = "", type: str = "firmware",
+                     base_version: str = ""):
+    """Upload OTA update file, optionally with a delta against an earlier firmware version"""
     if not file.filename:
         raise HTTPException(status_code=400, detail="No file provided")
     
@@ -471,8 +591,6 @@ async def upload_ota(file: UploadFile = File(...), version: str = "", type: str
         content = await file.read()
         f.write(content)
     
-    # Calculate checksum (simple)
-    import hashlib
     checksum = hashlib.sha256(content).hexdigest()
     
     # Store in database
@@ -487,17 +605,45 @@ async def upload_ota(file: UploadFile = File(...), version: str = "", type: str
     conn.commit()
     conn.close()
     
+    delta = None
+    if base_version and type == "firmware":
+        delta = server.create_delta(version, content, base_version)
+        if not delta:
+            logger.warning(f"No firmware {base_version} stored, no delta for v{version}")
+    
     logger.info(f"OTA update uploaded: {file.filename} v{version}")
-    return {"message": "Upload successful", "filename": file.filename, "checksum": checksum}
+    return {"message": "Upload successful", "filename": file.filename, "checksum": checksum, "delta": delta}
 
 @app.get("/ota/download/{filename}")
-async def download_ota(filename: str):
-    """Download OTA update file"""
+async def download_ota(filename: str, request: Request):
+    """Download OTA update file; devices fetch it in byte ranges and resume where they stopped"""
     file_path = Path(OTA_PATH) / filename
     if not file_path.exists():
         raise HTTPException(status_code=404, detail="File not found")
     
-    return FileResponse(file_path, filename=filename)
+    range_header = request.headers.get('range')
+    if not range_header:
+        return FileResponse(file_path, filename=filename, headers={'Accept-Ranges': 'bytes'})
+    
+    size = file_path.stat().st_size
+    try:
+        unit, _, spec = range_header.partition('=')
+        first, _, last = spec.partition('-')
+        start = int(first)
+        end = min(int(last) if last else size - 1, size - 1)
+        if unit.strip() != 'bytes' or start > end:
+            raise ValueError
+    except ValueError:
+        return Response(status_code=416, headers={'Content-Range': f'bytes */{size}'})
+    
+    with open(file_path, 'rb') as f:
+        f.seek(start)
+        body = f.read(end - start + 1)
+    
+    return Response(content=body, status_code=206, media_type='application/octet-stream', headers={
+        'Content-Range': f'bytes {start}-{end}/{size}',
+        'Accept-Ranges': 'bytes'
+    })
 
 if __name__ == "__main__":
     logger.info("Starting T-Deck-Pro Server")
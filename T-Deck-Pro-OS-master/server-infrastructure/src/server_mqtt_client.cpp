@@ -1,6 +1,103 @@
 // server_mqtt_client.cpp
 // T-Deck-Pro OS MQTT Client Implementation
 #include "server_mqtt_client.h"
+#include "core/utils/trace.h"
+#include "core/hal/board_config.h"
+
+namespace {
+
+// Streams an oversized payload to the broker in buffer-sized writes between
+// beginPublish() and endPublish(), so nothing has to hold it in full
+class ChunkedPublishWriter : public Print {
+public:
+    ChunkedPublishWriter(PubSubClient& client, uint8_t* buffer, size_t capacity)
+        : client(client), buffer(buffer), capacity(capacity), used(0), failed(false) {}
+    
+    size_t write(uint8_t byte) override {
+        if (used == capacity && !drain()) {
+            return 0;
+        }
+        buffer[used++] = byte;
+        return 1;
+    }
+    
+    size_t write(const uint8_t* data, size_t length) override {
+        size_t written = 0;
+        while (written < length) {
+            if (used == capacity && !drain()) {
+                break;
+            }
+            size_t chunk = capacity - used;
+            if (chunk > length - written) {
+                chunk = length - written;
+            }
+            memcpy(buffer + used, data + written, chunk);
+            used += chunk;
+            written += chunk;
+        }
+        return written;
+    }
+    
+    bool drain() {
+        if (used > 0 && !failed) {
+            failed = client.write(buffer, used) != used;
+        }
+        used = 0;
+        return !failed;
+    }
+    
+private:
+    PubSubClient& client;
+    uint8_t* buffer;
+    size_t capacity;
+    size_t used;
+    bool failed;
+};
+
+} // namespace
+
+// MqttTopicRouter Implementation
+MqttTopicRouter::MqttTopicRouter() : routes{}, routeCount(0) {
+}
+
+void MqttTopicRouter::setPrefix(const String& prefix) {
+    this->prefix = prefix;
+}
+
+bool MqttTopicRouter::addRoute(const char* pattern, uint8_t route) {
+    if (routeCount >= MQTT_MAX_ROUTES) {
+        return false;
+    }
+    
+    size_t length = strlen(pattern);
+    bool subtree = length > 0 && pattern[length - 1] == '#';
+    routes[routeCount++] = { pattern, (uint8_t)(subtree ? length - 1 : length), subtree, route };
+    return true;
+}
+
+uint8_t MqttTopicRouter::match(const char* topic) const {
+    if (strncmp(topic, prefix.c_str(), prefix.length()) != 0) {
+        return NO_ROUTE;
+    }
+    
+    const char* rest = topic + prefix.length();
+    for (uint8_t i = 0; i < routeCount; i++) {
+        const Route& entry = routes[i];
+        if (strncmp(rest, entry.pattern, entry.length) == 0 &&
+            (entry.subtree || rest[entry.length] == '\0')) {
+            return entry.route;
+        }
+    }
+    return NO_ROUTE;
+}
+
+String MqttTopicRouter::filter(uint8_t index) const {
+    return index < routeCount ? prefix + routes[index].pattern : String();
+}
+
+uint8_t MqttTopicRouter::getRouteCount() const {
+    return routeCount;
+}
 
 // Static instance pointers for callbacks
 ServerMQTTClient* ServerMQTTClient::instance = nullptr;
@@ -11,14 +108,30 @@ ServerMQTTClient::ServerMQTTClient(const String& deviceId, const String& brokerH
     : deviceId(deviceId), brokerHost(brokerHost), brokerPort(brokerPort), 
       connected(false), lastTelemetryTime(0), telemetryInterval(300000), // 5 minutes
       lastHeartbeatTime(0), heartbeatInterval(60000), // 1 minute
-      configHandler(nullptr), otaHandler(nullptr), appHandler(nullptr) {
+      payloadFormat(MqttPayloadFormat::JSON), streamedPublishes(0), failedPublishes(0),
+      ingressHead(0), ingressCount(0), droppedInbound(0),
+      configHandler(nullptr), otaHandler(nullptr), appHandler(nullptr), ackHandler(nullptr) {
     
     mqttClient.setClient(wifiClient);
     mqttClient.setServer(brokerHost.c_str(), brokerPort);
     mqttClient.setCallback(mqttCallback);
+    // Sized once for incoming messages; outgoing ones never go through this buffer
+    mqttClient.setBufferSize(MQTT_TX_BUFFER_SIZE);
     instance = this;
     
-    Logger::info("ServerMQTTClient", "Initialized for device: " + deviceId);
+    // Per-device topics are built once rather than on every publish
+    telemetryTopic = "tdeckpro/" + deviceId + "/telemetry";
+    heartbeatTopic = "tdeckpro/" + deviceId + "/heartbeat";
+    statusTopic = "tdeckpro/" + deviceId + "/status";
+    
+    // Device topics from MQTT_TOPICS.md; subscriptions are derived from the same table
+    router.setPrefix("tdeckpro/" + deviceId + "/");
+    router.addRoute("config", ROUTE_CONFIG);
+    router.addRoute("ota", ROUTE_OTA);
+    router.addRoute("apps", ROUTE_APPS);
+    router.addRoute("ack", ROUTE_ACK);
+    
+    LOG_INFO_TAG("ServerMQTTClient", "Initialized for device: %s", deviceId.c_str());
 }
 
 ServerMQTTClient::~ServerMQTTClient() {
@@ -28,24 +141,27 @@ ServerMQTTClient::~ServerMQTTClient() {
 
 bool ServerMQTTClient::initialize() {
     if (!WiFi.isConnected()) {
-        Logger::error("ServerMQTTClient", "WiFi not connected");
+        LOG_ERROR_TAG("ServerMQTTClient", "WiFi not connected");
         return false;
     }
     
-    Logger::info("ServerMQTTClient", "Connecting to MQTT broker: " + brokerHost + ":" + String(brokerPort));
+    LOG_INFO_TAG("ServerMQTTClient", "Connecting to MQTT broker: %s:%d", brokerHost.c_str(), brokerPort);
     
     if (mqttClient.connect(deviceId.c_str())) {
         connected = true;
         onMqttConnect();
-        Logger::info("ServerMQTTClient", "Connected to MQTT broker");
+        LOG_INFO_TAG("ServerMQTTClient", "Connected to MQTT broker");
         return true;
     } else {
-        Logger::error("ServerMQTTClient", "Failed to connect to MQTT broker, state: " + String(mqttClient.state()));
+        LOG_ERROR_TAG("ServerMQTTClient", "Failed to connect to MQTT broker, state: %d", mqttClient.state());
         return false;
     }
 }
 
 void ServerMQTTClient::update() {
+    // Queued messages are handled even if the connection dropped after they arrived
+    processInbound(MQTT_INGRESS_PER_UPDATE);
+    
     if (!mqttClient.connected()) {
         connected = false;
         if (WiFi.isConnected()) {
@@ -70,7 +186,7 @@ void ServerMQTTClient::disconnect() {
         sendStatus("offline", JsonObject());
         mqttClient.disconnect();
         connected = false;
-        Logger::info("ServerMQTTClient", "Disconnected from MQTT broker");
+        LOG_INFO_TAG("ServerMQTTClient", "Disconnected from MQTT broker");
     }
 }
 
@@ -79,30 +195,26 @@ bool ServerMQTTClient::reconnect() {
         return true;
     }
     
-    Logger::info("ServerMQTTClient", "Attempting to reconnect to MQTT broker");
+    LOG_INFO_TAG("ServerMQTTClient", "Attempting to reconnect to MQTT broker");
     
     if (mqttClient.connect(deviceId.c_str())) {
         connected = true;
         onMqttConnect();
-        Logger::info("ServerMQTTClient", "Reconnected to MQTT broker");
+        LOG_INFO_TAG("ServerMQTTClient", "Reconnected to MQTT broker");
         return true;
     } else {
-        Logger::error("ServerMQTTClient", "Reconnection failed, state: " + String(mqttClient.state()));
+        LOG_ERROR_TAG("ServerMQTTClient", "Reconnection failed, state: %d", mqttClient.state());
         return false;
     }
 }
 
 void ServerMQTTClient::onMqttConnect() {
     // Subscribe to device-specific topics
-    String configTopic = "tdeckpro/" + deviceId + "/config";
-    String otaTopic = "tdeckpro/" + deviceId + "/ota";
-    String appTopic = "tdeckpro/" + deviceId + "/apps";
-    
-    mqttClient.subscribe(configTopic.c_str());
-    mqttClient.subscribe(otaTopic.c_str());
-    mqttClient.subscribe(appTopic.c_str());
+    for (uint8_t i = 0; i < router.getRouteCount(); i++) {
+        mqttClient.subscribe(router.filter(i).c_str());
+    }
     
-    Logger::info("ServerMQTTClient", "Subscribed to device topics");
+    LOG_INFO_TAG("ServerMQTTClient", "Subscribed to device topics");
     
     // Send online status
     sendStatus("online", JsonObject());
@@ -115,36 +227,83 @@ void ServerMQTTClient::mqttCallback(char* topic, byte* payload, unsigned int len
 }
 
 void ServerMQTTClient::onMqttMessage(char* topic, byte* payload, unsigned int length) {
-    // Parse payload as JSON
-    DynamicJsonDocument doc(1024);
-    DeserializationError error = deserializeJson(doc, payload, length);
+    // Runs inside mqttClient.loop(): route and copy only, the handlers run from processInbound()
+    uint8_t route = router.match(topic);
+    if (route == MqttTopicRouter::NO_ROUTE) {
+        LOG_DEBUG_TAG("ServerMQTTClient", "No route for topic: %s", topic);
+        return;
+    }
     
-    if (error) {
-        Logger::error("ServerMQTTClient", "Failed to parse MQTT message: " + String(error.c_str()));
+    if (length > MQTT_INGRESS_SLOT_SIZE || ingressCount == MQTT_INGRESS_SLOTS) {
+        droppedInbound++;
+        LOG_WARN_TAG("ServerMQTTClient", "Dropped %u byte message on %s (%s)", length, topic,
+                     length > MQTT_INGRESS_SLOT_SIZE ? "too large" : "queue full");
         return;
     }
     
-    String topicStr = String(topic);
-    Logger::debug("ServerMQTTClient", "Received message on topic: " + topicStr);
+    InboundMessage& message = ingress[(ingressHead + ingressCount) % MQTT_INGRESS_SLOTS];
+    message.route = route;
+    message.length = length;
+    memcpy(message.data, payload, length);
+    ingressCount++;
+}
+
+void ServerMQTTClient::processInbound(uint8_t maxMessages) {
+    while (maxMessages-- > 0 && ingressCount > 0) {
+        // The slot stays reserved until its handler returns, the parsed strings point into it
+        dispatchInbound(ingress[ingressHead]);
+        ingressHead = (ingressHead + 1) % MQTT_INGRESS_SLOTS;
+        ingressCount--;
+    }
+}
+
+void ServerMQTTClient::dispatchInbound(InboundMessage& message) {
+    // Parsing a mutable buffer is zero-copy: strings are terminated in place, not duplicated.
+    // JSON objects start with '{'; anything else is taken as MessagePack.
+    char* data = reinterpret_cast<char*>(message.data);
+    DeserializationError error = (message.length > 0 && data[0] == '{')
+        ? deserializeJson(rxDoc, data, message.length)
+        : deserializeMsgPack(rxDoc, data, message.length);
+    
+    if (error) {
+        LOG_ERROR_TAG("ServerMQTTClient", "Failed to parse MQTT message: %s", error.c_str());
+        return;
+    }
     
-    // Route message based on topic
-    if (topicStr.endsWith("/config")) {
-        handleConfigMessage(doc.as<JsonObject>());
-    } else if (topicStr.endsWith("/ota")) {
-        handleOtaMessage(doc.as<JsonObject>());
-    } else if (topicStr.endsWith("/apps")) {
-        handleAppMessage(doc.as<JsonObject>());
+    JsonObject payload = rxDoc.as<JsonObject>();
+    switch (message.route) {
+        case ROUTE_CONFIG:
+            handleConfigMessage(payload);
+            break;
+        case ROUTE_OTA:
+            handleOtaMessage(payload);
+            break;
+        case ROUTE_APPS:
+            handleAppMessage(payload);
+            break;
+        case ROUTE_ACK:
+            if (ackHandler) {
+                ackHandler(payload);
+            }
+            break;
     }
 }
 
 void ServerMQTTClient::handleConfigMessage(const JsonObject& config) {
-    Logger::info("ServerMQTTClient", "Received configuration update");
+    LOG_INFO_TAG("ServerMQTTClient", "Received configuration update");
     
     // Update telemetry interval if specified
     if (config.containsKey("update_interval")) {
         telemetryInterval = config["update_interval"].as<unsigned long>() * 1000; // Convert to ms
     }
     
+    // Only servers that can decode MessagePack ask for it
+    if (config.containsKey("payload_format")) {
+        const char* format = config["payload_format"];
+        setPayloadFormat(format && strcmp(format, "msgpack") == 0 ? MqttPayloadFormat::MSGPACK
+                                                                  : MqttPayloadFormat::JSON);
+    }
+    
     // Call user handler if set
     if (configHandler) {
         configHandler(config);
@@ -152,7 +311,7 @@ void ServerMQTTClient::handleConfigMessage(const JsonObject& config) {
 }
 
 void ServerMQTTClient::handleOtaMessage(const JsonObject& ota) {
-    Logger::info("ServerMQTTClient", "Received OTA update notification");
+    LOG_INFO_TAG("ServerMQTTClient", "Received OTA update notification");
     
     if (otaHandler) {
         otaHandler(ota);
@@ -160,7 +319,7 @@ void ServerMQTTClient::handleOtaMessage(const JsonObject& ota) {
 }
 
 void ServerMQTTClient::handleAppMessage(const JsonObject& app) {
-    Logger::info("ServerMQTTClient", "Received app management message");
+    LOG_INFO_TAG("ServerMQTTClient", "Received app management message");
     
     if (appHandler) {
         appHandler(app);
@@ -168,13 +327,12 @@ void ServerMQTTClient::handleAppMessage(const JsonObject& app) {
 }
 
 void ServerMQTTClient::sendHeartbeat() {
-    DynamicJsonDocument doc(256);
+    JsonDocument& doc = beginMessage();
     doc["status"] = "online";
     doc["timestamp"] = millis();
     doc["uptime"] = millis() / 1000;
     
-    String topic = "tdeckpro/" + deviceId + "/heartbeat";
-    publishMessage(topic, doc.as<JsonObject>());
+    publishMessage(heartbeatTopic, doc.as<JsonObject>());
 }
 
 bool ServerMQTTClient::registerDevice(const JsonObject& deviceInfo) {
@@ -183,12 +341,11 @@ bool ServerMQTTClient::registerDevice(const JsonObject& deviceInfo) {
 }
 
 bool ServerMQTTClient::sendTelemetryData(const JsonObject& telemetry) {
-    String topic = "tdeckpro/" + deviceId + "/telemetry";
-    return publishMessage(topic, telemetry);
+    return publishMessage(telemetryTopic, telemetry);
 }
 
 bool ServerMQTTClient::sendStatus(const String& status, const JsonObject& additionalData) {
-    DynamicJsonDocument doc(512);
+    JsonDocument& doc = beginMessage();
     doc["status"] = status;
     doc["timestamp"] = millis();
     
@@ -197,12 +354,11 @@ bool ServerMQTTClient::sendStatus(const String& status, const JsonObject& additi
         doc[kv.key()] = kv.value();
     }
     
-    String topic = "tdeckpro/" + deviceId + "/status";
-    return publishMessage(topic, doc.as<JsonObject>(), true); // Retain status
+    return publishMessage(statusTopic, doc.as<JsonObject>(), true); // Retain status
 }
 
 bool ServerMQTTClient::sendMeshMessage(const String& fromNode, const String& toNode, const String& messageType, const JsonObject& payload) {
-    DynamicJsonDocument doc(1024);
+    JsonDocument& doc = beginMessage();
     doc["from_node"] = fromNode;
     doc["to_node"] = toNode;
     doc["message_type"] = messageType;
@@ -218,10 +374,65 @@ bool ServerMQTTClient::publishMessage(const String& topic, const JsonObject& pay
         return false;
     }
     
-    String jsonString;
-    serializeJson(payload, jsonString);
+    TRACE_SCOPE(TRACE_MQTT_PUBLISH);
+    
+    // Encoded straight into the preallocated buffer; no String or document per message
+    size_t length = encodePayload(payload, txBuffer, sizeof(txBuffer));
+    bool success;
+    if (length > 0) {
+        success = mqttClient.beginPublish(topic.c_str(), length, retain) &&
+                  mqttClient.write(txBuffer, length) == length &&
+                  mqttClient.endPublish();
+    } else {
+        success = publishStreamed(topic.c_str(), payload, retain);
+    }
+    
+    if (!success) {
+        failedPublishes++;
+        LOG_WARN_TAG("ServerMQTTClient", "Publish to %s failed, state: %d", topic.c_str(), mqttClient.state());
+    }
+    return success;
+}
+
+size_t ServerMQTTClient::measurePayload(const JsonObject& payload) {
+    return payloadFormat == MqttPayloadFormat::MSGPACK ? measureMsgPack(payload) : measureJson(payload);
+}
+
+size_t ServerMQTTClient::encodePayload(const JsonObject& payload, uint8_t* buffer, size_t capacity) {
+    // Returns 0 when the payload does not fit, leaving the caller to stream it
+    size_t length = measurePayload(payload);
+    if (length == 0 || length >= capacity) {
+        return 0;
+    }
+    
+    if (payloadFormat == MqttPayloadFormat::MSGPACK) {
+        return serializeMsgPack(payload, buffer, capacity);
+    }
+    return serializeJson(payload, reinterpret_cast<char*>(buffer), capacity);
+}
+
+bool ServerMQTTClient::publishStreamed(const char* topic, const JsonObject& payload, bool retain) {
+    size_t length = measurePayload(payload);
+    if (length == 0 || !mqttClient.beginPublish(topic, length, retain)) {
+        return false;
+    }
+    
+    ChunkedPublishWriter writer(mqttClient, txBuffer, sizeof(txBuffer));
+    size_t written = payloadFormat == MqttPayloadFormat::MSGPACK ? serializeMsgPack(payload, writer)
+                                                                 : serializeJson(payload, writer);
+    bool success = writer.drain() && written == length;
+    mqttClient.endPublish();
+    
+    if (!success) {
+        // The broker still expects the announced length, so the session cannot be reused
+        mqttClient.disconnect();
+        connected = false;
+        return false;
+    }
     
-    return mqttClient.publish(topic.c_str(), jsonString.c_str(), retain);
+    streamedPublishes++;
+    LOG_DEBUG_TAG("ServerMQTTClient", "Streamed %u byte payload to %s", (unsigned)length, topic);
+    return true;
 }
 
 bool ServerMQTTClient::publishMessage(const String& topic, const String& payload, bool retain) {
@@ -229,7 +440,45 @@ bool ServerMQTTClient::publishMessage(const String& topic, const String& payload
         return false;
     }
     
-    return mqttClient.publish(topic.c_str(), payload.c_str(), retain);
+    TRACE_SCOPE(TRACE_MQTT_PUBLISH);
+    
+    // Written straight from the String like the encoded path, so the length is not capped
+    // by the client buffer
+    size_t length = payload.length();
+    bool success = mqttClient.beginPublish(topic.c_str(), length, retain) &&
+                   mqttClient.write(reinterpret_cast<const uint8_t*>(payload.c_str()), length) == length &&
+                   mqttClient.endPublish();
+    
+    if (!success) {
+        failedPublishes++;
+        LOG_WARN_TAG("ServerMQTTClient", "Publish to %s failed, state: %d", topic.c_str(), mqttClient.state());
+    }
+    return success;
+}
+
+bool ServerMQTTClient::beginStreamedPublish(const String& topic, size_t length, bool retain) {
+    if (!connected) {
+        return false;
+    }
+    return mqttClient.beginPublish(topic.c_str(), length, retain);
+}
+
+bool ServerMQTTClient::writeStreamed(const uint8_t* data, size_t length) {
+    return mqttClient.write(data, length) == length;
+}
+
+bool ServerMQTTClient::endStreamedPublish(bool complete) {
+    mqttClient.endPublish();
+    
+    if (!complete) {
+        failedPublishes++;
+        mqttClient.disconnect();
+        connected = false;
+        return false;
+    }
+    
+    streamedPublishes++;
+    return true;
 }
 
 void ServerMQTTClient::setConfigHandler(void (*handler)(const JsonObject& config)) {
@@ -244,10 +493,35 @@ void ServerMQTTClient::setAppHandler(void (*handler)(const JsonObject& app)) {
     appHandler = handler;
 }
 
+void ServerMQTTClient::setAckHandler(void (*handler)(const JsonObject& ack)) {
+    ackHandler = handler;
+}
+
 void ServerMQTTClient::setTelemetryInterval(unsigned long interval) {
     telemetryInterval = interval * 1000; // Convert to ms
 }
 
+unsigned long ServerMQTTClient::getTelemetryInterval() const {
+    return telemetryInterval;
+}
+
+void ServerMQTTClient::setPayloadFormat(MqttPayloadFormat format) {
+    if (format != payloadFormat) {
+        payloadFormat = format;
+        LOG_INFO_TAG("ServerMQTTClient", "Payload format: %s",
+                     format == MqttPayloadFormat::MSGPACK ? "msgpack" : "json");
+    }
+}
+
+MqttPayloadFormat ServerMQTTClient::getPayloadFormat() const {
+    return payloadFormat;
+}
+
+JsonDocument& ServerMQTTClient::beginMessage() {
+    txDoc.clear();
+    return txDoc;
+}
+
 bool ServerMQTTClient::isConnected() const {
     return connected && mqttClient.connected();
 }
@@ -260,9 +534,22 @@ String ServerMQTTClient::getBrokerHost() const {
     return brokerHost;
 }
 
+uint32_t ServerMQTTClient::getStreamedPublishCount() const {
+    return streamedPublishes;
+}
+
+uint32_t ServerMQTTClient::getFailedPublishCount() const {
+    return failedPublishes;
+}
+
+uint32_t ServerMQTTClient::getDroppedInboundCount() const {
+    return droppedInbound;
+}
+
 // TDeckProServerIntegration Implementation
 TDeckProServerIntegration::TDeckProServerIntegration(const String& deviceId, const String& brokerHost)
-    : deviceId(deviceId), initialized(false) {
+    : deviceId(deviceId), batchTopic("tdeckpro/" + deviceId + "/telemetry_batch"),
+      initialized(false), registered(false), lastSampleTime(0), lastOtaState(OtaState::IDLE) {
     
     mqttClient = new ServerMQTTClient(deviceId, brokerHost);
     instance = this;
@@ -271,6 +558,7 @@ TDeckProServerIntegration::TDeckProServerIntegration(const String& deviceId, con
     mqttClient->setConfigHandler(configHandler);
     mqttClient->setOtaHandler(otaHandler);
     mqttClient->setAppHandler(appHandler);
+    mqttClient->setAckHandler(ackHandler);
 }
 
 TDeckProServerIntegration::~TDeckProServerIntegration() {
@@ -280,18 +568,26 @@ TDeckProServerIntegration::~TDeckProServerIntegration() {
 }
 
 bool TDeckProServerIntegration::initialize() {
-    if (!mqttClient->initialize()) {
+    // Telemetry is recorded whether or not the server is reachable
+    if (!telemetrySpool.begin()) {
+        LOG_ERROR_TAG("ServerIntegration", "Telemetry spool unavailable");
         return false;
     }
     
+    initialized = true;
+    
+    if (!mqttClient->initialize()) {
+        LOG_WARN_TAG("ServerIntegration", "Server unreachable, spooling telemetry until it is");
+        return true;
+    }
+    
     // Register device with server
-    if (!registerWithServer()) {
-        Logger::error("ServerIntegration", "Failed to register with server");
-        return false;
+    registered = registerWithServer();
+    if (!registered) {
+        LOG_ERROR_TAG("ServerIntegration", "Failed to register with server");
     }
     
-    initialized = true;
-    Logger::info("ServerIntegration", "Server integration initialized");
+    LOG_INFO_TAG("ServerIntegration", "Server integration initialized");
     return true;
 }
 
@@ -302,16 +598,28 @@ void TDeckProServerIntegration::update() {
     
     mqttClient->update();
     
-    // Send periodic telemetry
-    static unsigned long lastTelemetry = 0;
-    if (millis() - lastTelemetry > 300000) { // 5 minutes
-        sendCurrentTelemetry();
-        lastTelemetry = millis();
+    if (!registered && mqttClient->isConnected()) {
+        registered = registerWithServer();
     }
+    
+    unsigned long now = millis();
+    if (now - lastSampleTime >= TELEMETRY_SAMPLE_INTERVAL_MS) {
+        TelemetrySample sample;
+        sampleTelemetry(sample);
+        telemetrySpool.addSample(sample, now);
+        lastSampleTime = now;
+    }
+    
+    // Spooled windows go out in batches at the server's update interval, a backlog at once
+    telemetrySpool.service(*mqttClient, batchTopic, mqttClient->getTelemetryInterval(), now);
+    
+    reportOtaState();
 }
 
 void TDeckProServerIntegration::shutdown() {
     if (initialized) {
+        // The partial window is kept for the next connection
+        telemetrySpool.closeWindow(millis());
         reportStatus("offline", "shutdown");
         mqttClient->disconnect();
         initialized = false;
@@ -319,9 +627,9 @@ void TDeckProServerIntegration::shutdown() {
 }
 
 bool TDeckProServerIntegration::registerWithServer() {
-    DynamicJsonDocument doc(1024);
+    JsonDocument& doc = mqttClient->beginMessage();
     doc["device_type"] = "t-deck-pro";
-    doc["firmware_version"] = "1.0.0"; // TODO: Get from system
+    doc["firmware_version"] = OtaManager::getRunningVersion();
     doc["hardware_version"] = "1.0";
     
     JsonObject capabilities = doc.createNestedObject("capabilities");
@@ -340,13 +648,15 @@ bool TDeckProServerIntegration::registerWithServer() {
 }
 
 bool TDeckProServerIntegration::sendCurrentTelemetry() {
-    DynamicJsonDocument doc(1024);
-    collectTelemetryData(doc.as<JsonObject>());
-    return mqttClient->sendTelemetryData(doc.as<JsonObject>());
+    JsonDocument& doc = mqttClient->beginMessage();
+    JsonObject telemetry = doc.to<JsonObject>();
+    collectTelemetryData(telemetry);
+    return mqttClient->sendTelemetryData(telemetry);
 }
 
 bool TDeckProServerIntegration::reportStatus(const String& status, const String& reason) {
-    DynamicJsonDocument doc(256);
+    // sendStatus() builds its message in the client document, so the extra fields live here
+    StaticJsonDocument<128> doc;
     if (!reason.isEmpty()) {
         doc["reason"] = reason;
     }
@@ -354,13 +664,24 @@ bool TDeckProServerIntegration::reportStatus(const String& status, const String&
     return mqttClient->sendStatus(status, doc.as<JsonObject>());
 }
 
+void TDeckProServerIntegration::sampleTelemetry(TelemetrySample& sample) {
+    uint16_t batteryMv = board_get_battery_voltage();
+    float battery = (float)((int)batteryMv - BOARD_BAT_CRIT_MV) * 100.0f / (BOARD_BAT_FULL_MV - BOARD_BAT_CRIT_MV);
+    sample.values[TELEMETRY_BATTERY] = battery < 0.0f ? 0.0f : (battery > 100.0f ? 100.0f : battery);
+    sample.values[TELEMETRY_TEMPERATURE] = temperatureRead();
+    sample.values[TELEMETRY_CPU] = trace_get_cpu_usage();
+    sample.values[TELEMETRY_MEMORY] = 100.0f - (float)ESP.getFreeHeap() * 100.0f / ESP.getHeapSize();
+    sample.values[TELEMETRY_SIGNAL] = WiFi.isConnected() ? WiFi.RSSI() : 0;
+}
+
 void TDeckProServerIntegration::collectTelemetryData(JsonObject& telemetry) {
-    // TODO: Integrate with actual system components
-    telemetry["battery_percentage"] = 85;
-    telemetry["temperature"] = 23.5;
-    telemetry["cpu_usage"] = 45.2;
-    telemetry["memory_usage"] = 67.8;
-    telemetry["signal_strength"] = -65;
+    TelemetrySample sample;
+    sampleTelemetry(sample);
+    telemetry["battery_percentage"] = sample.values[TELEMETRY_BATTERY];
+    telemetry["temperature"] = sample.values[TELEMETRY_TEMPERATURE];
+    telemetry["cpu_usage"] = sample.values[TELEMETRY_CPU];
+    telemetry["memory_usage"] = sample.values[TELEMETRY_MEMORY];
+    telemetry["signal_strength"] = sample.values[TELEMETRY_SIGNAL];
     telemetry["wifi_connected"] = WiFi.isConnected();
     telemetry["lora_active"] = true;
     telemetry["cellular_connected"] = false;
@@ -371,7 +692,7 @@ void TDeckProServerIntegration::collectTelemetryData(JsonObject& telemetry) {
 }
 
 void TDeckProServerIntegration::applyConfiguration(const JsonObject& config) {
-    Logger::info("ServerIntegration", "Applying configuration");
+    LOG_INFO_TAG("ServerIntegration", "Applying configuration");
     
     // TODO: Integrate with system configuration
     if (config.containsKey("timezone")) {
@@ -388,20 +709,57 @@ void TDeckProServerIntegration::applyConfiguration(const JsonObject& config) {
 }
 
 void TDeckProServerIntegration::handleOtaUpdate(const JsonObject& ota) {
-    Logger::info("ServerIntegration", "Processing OTA update");
+    if (!ota["available"].as<bool>()) {
+        return;
+    }
+    
+    OtaOffer offer;
+    offer.version = ota["version"].as<String>();
+    offer.url = resolveServerUrl(ota["download_url"].as<String>());
+    offer.sha256 = ota["checksum"].as<String>();
+    offer.size = ota["size"] | 0;
+    
+    JsonObject delta = ota["delta"];
+    offer.deltaSize = 0;
+    if (!delta.isNull()) {
+        offer.deltaUrl = resolveServerUrl(delta["download_url"].as<String>());
+        offer.deltaSize = delta["size"] | 0;
+        offer.baseDigest = delta["base_digest"].as<String>();
+    }
+    
+    LOG_INFO_TAG("ServerIntegration", "OTA update available: %s%s", offer.version.c_str(),
+                 delta.isNull() ? "" : " (delta offered)");
+    OtaManager::getInstance().start(offer);
+}
+
+void TDeckProServerIntegration::reportOtaState() {
+    // Polled rather than called back, as the download runs on its own task and the client is not thread safe
+    OtaState state = OtaManager::getInstance().getState();
+    if (state == lastOtaState || !mqttClient->isConnected()) {
+        return;
+    }
+    lastOtaState = state;
     
-    if (ota["available"].as<bool>()) {
-        // TODO: Integrate with OTA system
-        String version = ota["version"];
-        String downloadUrl = ota["download_url"];
-        
-        Logger::info("ServerIntegration", "OTA update available: " + version);
-        // Start OTA download and installation
+    const char* status = nullptr;
+    switch (state) {
+        case OtaState::DOWNLOADING: status = "updating"; break;
+        case OtaState::PAUSED:      status = "update_paused"; break;
+        case OtaState::READY:       status = "update_ready"; break;
+        case OtaState::FAILED:      status = "update_failed"; break;
+        case OtaState::IDLE:        status = "online"; break;
     }
+    reportStatus(status, OtaManager::getInstance().getProgress().version);
+}
+
+String TDeckProServerIntegration::resolveServerUrl(const String& url) const {
+    if (!url.startsWith("/")) {
+        return url;
+    }
+    return "http://" + mqttClient->getBrokerHost() + ":" + String(SERVER_HTTP_PORT) + url;
 }
 
 void TDeckProServerIntegration::handleAppManagement(const JsonObject& app) {
-    Logger::info("ServerIntegration", "Processing app management");
+    LOG_INFO_TAG("ServerIntegration", "Processing app management");
     
     String action = app["action"];
     String appId = app["app_id"];
@@ -420,6 +778,10 @@ bool TDeckProServerIntegration::forwardMeshMessage(const String& fromNode, const
     return mqttClient->sendMeshMessage(fromNode, toNode, messageType, payload);
 }
 
+uint32_t TDeckProServerIntegration::getPendingTelemetryWindows() const {
+    return telemetrySpool.getPendingCount();
+}
+
 bool TDeckProServerIntegration::isServerConnected() const {
     return mqttClient->isConnected();
 }
@@ -451,4 +813,10 @@ void TDeckProServerIntegration::appHandler(const JsonObject& app) {
     if (instance) {
         instance->handleAppManagement(app);
     }
+}
+
+void TDeckProServerIntegration::ackHandler(const JsonObject& ack) {
+    if (instance && ack.containsKey("seq")) {
+        instance->telemetrySpool.handleAck(ack["seq"].as<uint32_t>());
+    }
 }
\ No newline at end of file
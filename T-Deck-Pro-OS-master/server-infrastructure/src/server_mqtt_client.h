@@ -6,6 +6,80 @@
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
 #include "core/utils/logger.h"
+#include "telemetry_spool.h"
+#include "services/ota_manager.h"
+
+// Telemetry is sampled this often and aggregated into spooled windows
+#ifndef TELEMETRY_SAMPLE_INTERVAL_MS
+#define TELEMETRY_SAMPLE_INTERVAL_MS 10000
+#endif
+
+// Encoded payloads up to this size go out in a single publish; larger ones are streamed
+#ifndef MQTT_TX_BUFFER_SIZE
+#define MQTT_TX_BUFFER_SIZE 1024
+#endif
+
+// Capacity of the reusable documents outgoing and incoming messages are built in
+#ifndef MQTT_DOC_CAPACITY
+#define MQTT_DOC_CAPACITY 1024
+#endif
+
+// Inbound messages wait in this many fixed slots until update() handles them
+#ifndef MQTT_INGRESS_SLOTS
+#define MQTT_INGRESS_SLOTS 4
+#endif
+
+#ifndef MQTT_INGRESS_SLOT_SIZE
+#define MQTT_INGRESS_SLOT_SIZE 768
+#endif
+
+// Inbound messages handled per update(), so a burst of pushes is spread out
+#ifndef MQTT_INGRESS_PER_UPDATE
+#define MQTT_INGRESS_PER_UPDATE 1
+#endif
+
+#define MQTT_MAX_ROUTES 8
+
+// Port of the server's HTTP API; relative OTA download URLs are resolved against the broker host
+#ifndef SERVER_HTTP_PORT
+#define SERVER_HTTP_PORT 8000
+#endif
+
+// Wire encoding of device payloads; the server tells JSON ('{') from MessagePack by the first byte
+enum class MqttPayloadFormat {
+    JSON,
+    MSGPACK
+};
+
+// Routes inbound topics by comparing them in place against a fixed table.
+// Patterns are relative to the device prefix ("tdeckpro/<id>/"); a trailing
+// '#' matches the whole subtree. A handful of routes is faster to scan than a trie.
+class MqttTopicRouter {
+public:
+    static const uint8_t NO_ROUTE = 0xff;
+    
+    MqttTopicRouter();
+    
+    void setPrefix(const String& prefix);
+    bool addRoute(const char* pattern, uint8_t route);
+    uint8_t match(const char* topic) const;
+    
+    // Full topic filter of a route for subscribing
+    String filter(uint8_t index) const;
+    uint8_t getRouteCount() const;
+    
+private:
+    struct Route {
+        const char* pattern;
+        uint8_t length;         // Without the trailing '#'
+        bool subtree;
+        uint8_t route;
+    };
+    
+    String prefix;
+    Route routes[MQTT_MAX_ROUTES];
+    uint8_t routeCount;
+};
 
 class ServerMQTTClient {
 private:
@@ -15,24 +89,60 @@ private:
     String brokerHost;
     int brokerPort;
     bool connected;
+    String telemetryTopic;
+    String heartbeatTopic;
+    String statusTopic;
     
     unsigned long lastTelemetryTime;
     unsigned long telemetryInterval;
     unsigned long lastHeartbeatTime;
     unsigned long heartbeatInterval;
     
+    // Encoding state, allocated once with the client
+    MqttPayloadFormat payloadFormat;
+    StaticJsonDocument<MQTT_DOC_CAPACITY> txDoc;
+    StaticJsonDocument<MQTT_DOC_CAPACITY> rxDoc;
+    uint8_t txBuffer[MQTT_TX_BUFFER_SIZE];
+    uint32_t streamedPublishes;
+    uint32_t failedPublishes;
+    
+    // Inbound routing and the queue between the network callback and the handlers
+    enum InboundRoute : uint8_t {
+        ROUTE_CONFIG,
+        ROUTE_OTA,
+        ROUTE_APPS,
+        ROUTE_ACK
+    };
+    
+    struct InboundMessage {
+        uint8_t route;
+        uint16_t length;
+        uint8_t data[MQTT_INGRESS_SLOT_SIZE];
+    };
+    
+    MqttTopicRouter router;
+    InboundMessage ingress[MQTT_INGRESS_SLOTS];
+    uint8_t ingressHead;
+    uint8_t ingressCount;
+    uint32_t droppedInbound;
+    
     // Message handlers
     void (*configHandler)(const JsonObject& config);
     void (*otaHandler)(const JsonObject& ota);
     void (*appHandler)(const JsonObject& app);
+    void (*ackHandler)(const JsonObject& ack);
     
     // Internal methods
     void onMqttConnect();
     void onMqttMessage(char* topic, byte* payload, unsigned int length);
+    void dispatchInbound(InboundMessage& message);
     void sendHeartbeat();
     void handleConfigMessage(const JsonObject& config);
     void handleOtaMessage(const JsonObject& ota);
     void handleAppMessage(const JsonObject& app);
+    size_t encodePayload(const JsonObject& payload, uint8_t* buffer, size_t capacity);
+    size_t measurePayload(const JsonObject& payload);
+    bool publishStreamed(const char* topic, const JsonObject& payload, bool retain);
     
     // Static callback wrapper
     static void mqttCallback(char* topic, byte* payload, unsigned int length);
@@ -58,35 +168,65 @@ public:
     void setConfigHandler(void (*handler)(const JsonObject& config));
     void setOtaHandler(void (*handler)(const JsonObject& ota));
     void setAppHandler(void (*handler)(const JsonObject& app));
+    void setAckHandler(void (*handler)(const JsonObject& ack));
     void setTelemetryInterval(unsigned long interval);
+    unsigned long getTelemetryInterval() const;
+    void setPayloadFormat(MqttPayloadFormat format);
+    MqttPayloadFormat getPayloadFormat() const;
+    
+    // Cleared document for building a message for registerDevice(), sendTelemetryData()
+    // or publishMessage() without allocating. sendStatus() and sendMeshMessage()
+    // build their own message in it, so it is only valid until the next send.
+    JsonDocument& beginMessage();
     
     // Status
     bool isConnected() const;
     String getDeviceId() const;
     String getBrokerHost() const;
+    uint32_t getStreamedPublishCount() const;
+    uint32_t getFailedPublishCount() const;
+    uint32_t getDroppedInboundCount() const;
+    
+    // Handles queued inbound messages; update() calls it for MQTT_INGRESS_PER_UPDATE of them
+    void processInbound(uint8_t maxMessages);
     
     // Utility methods
     bool publishMessage(const String& topic, const JsonObject& payload, bool retain = false);
     bool publishMessage(const String& topic, const String& payload, bool retain = false);
+    
+    // Pre-encoded payload of a known length written in pieces. endStreamedPublish(false)
+    // abandons a short payload and drops the connection, which the broker cannot recover.
+    bool beginStreamedPublish(const String& topic, size_t length, bool retain = false);
+    bool writeStreamed(const uint8_t* data, size_t length);
+    bool endStreamedPublish(bool complete = true);
 };
 
 // Integration class for easy T-Deck-Pro OS integration
 class TDeckProServerIntegration {
 private:
     ServerMQTTClient* mqttClient;
+    TelemetrySpool telemetrySpool;
     String deviceId;
+    String batchTopic;
     bool initialized;
+    bool registered;
+    unsigned long lastSampleTime;
+    OtaState lastOtaState;
     
     // System integration
+    void sampleTelemetry(TelemetrySample& sample);
     void collectTelemetryData(JsonObject& telemetry);
     void applyConfiguration(const JsonObject& config);
     void handleOtaUpdate(const JsonObject& ota);
+    void reportOtaState();
+    String resolveServerUrl(const String& url) const;
     void handleAppManagement(const JsonObject& app);
     
     // Static handlers for MQTT client
     static void configHandler(const JsonObject& config);
     static void otaHandler(const JsonObject& ota);
     static void appHandler(const JsonObject& app);
+    static void ackHandler(const JsonObject& ack);
     static TDeckProServerIntegration* instance;
     
 public:
@@ -102,6 +242,7 @@ public:
     bool registerWithServer();
     bool sendCurrentTelemetry();
     bool reportStatus(const String& status, const String& reason = "");
+    uint32_t getPendingTelemetryWindows() const;
     
     // Mesh integration
     bool forwardMeshMessage(const String& fromNode, const String& toNode, const String& messageType, const JsonObject& payload);
@@ -0,0 +1,379 @@
+// telemetry_spool.cpp
+// T-Deck-Pro OS store-and-forward telemetry implementation
+#include "telemetry_spool.h"
+#include "server_mqtt_client.h"
+#include "core/communication/link_scorer.h"
+#include "core/utils/logger.h"
+#include <time.h>
+#include <float.h>
+
+#define SPOOL_MAGIC 0x4C505354  // "TSPL"
+#define SPOOL_VERSION 1
+
+using namespace TDeckOS::Communication;
+
+// Clocks before 2020 have not been set from the network
+#define EPOCH_VALID_AFTER 1577836800UL
+
+// Batches are MessagePack with fixed-width fields, so their length is known
+// before the first byte goes out and records can be streamed straight from flash:
+//   {"seq": u32, "boot": u16, "uptime": u32,
+//    "windows": [[epoch u32, boot u16, uptime_end u32, samples u16,
+//                 min..., max..., mean... (float32 per metric)], ...]}
+#define WINDOW_FIELDS (4 + 3 * TELEMETRY_METRIC_COUNT)
+#define WINDOW_ENCODED_SIZE (3 + 5 + 3 + 5 + 3 + 3 * TELEMETRY_METRIC_COUNT * 5)
+#define BATCH_HEADER_SIZE (1 + (4 + 5) + (5 + 3) + (7 + 5) + (8 + 3))
+
+namespace {
+
+uint8_t* putU16(uint8_t* out, uint16_t value) {
+    *out++ = 0xcd;
+    *out++ = value >> 8;
+    *out++ = value & 0xff;
+    return out;
+}
+
+uint8_t* putU32(uint8_t* out, uint32_t value) {
+    *out++ = 0xce;
+    *out++ = value >> 24;
+    *out++ = (value >> 16) & 0xff;
+    *out++ = (value >> 8) & 0xff;
+    *out++ = value & 0xff;
+    return out;
+}
+
+uint8_t* putFloat(uint8_t* out, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    *out++ = 0xca;
+    *out++ = bits >> 24;
+    *out++ = (bits >> 16) & 0xff;
+    *out++ = (bits >> 8) & 0xff;
+    *out++ = bits & 0xff;
+    return out;
+}
+
+uint8_t* putArray16(uint8_t* out, uint16_t length) {
+    *out++ = 0xdc;
+    *out++ = length >> 8;
+    *out++ = length & 0xff;
+    return out;
+}
+
+uint8_t* putKey(uint8_t* out, const char* key) {
+    size_t length = strlen(key);
+    *out++ = 0xa0 | length;
+    memcpy(out, key, length);
+    return out + length;
+}
+
+size_t encodeWindow(const TelemetryWindow& window, uint8_t* out) {
+    uint8_t* start = out;
+    out = putArray16(out, WINDOW_FIELDS);
+    out = putU32(out, window.epoch);
+    out = putU16(out, window.boot);
+    out = putU32(out, window.uptimeEnd);
+    out = putU16(out, window.samples);
+    for (int i = 0; i < TELEMETRY_METRIC_COUNT; i++) {
+        out = putFloat(out, window.min[i]);
+    }
+    for (int i = 0; i < TELEMETRY_METRIC_COUNT; i++) {
+        out = putFloat(out, window.max[i]);
+    }
+    for (int i = 0; i < TELEMETRY_METRIC_COUNT; i++) {
+        out = putFloat(out, window.mean[i]);
+    }
+    return out - start;
+}
+
+} // namespace
+
+TelemetrySpool::TelemetrySpool(const String& path)
+    : path(path), header{}, ready(false), current{}, sums{}, windowStart(0),
+      inflight(false), inflightSeq(0), inflightSentAt(0), inflightBytes(0),
+      lastUploadTime(0),
+      overwrittenCount(0), retryCount(0) {
+}
+
+bool TelemetrySpool::begin() {
+    bool valid = false;
+
+    if (SPIFFS.exists(path)) {
+        File file = SPIFFS.open(path, "r");
+        if (file && file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) == sizeof(header)) {
+            valid = header.magic == SPOOL_MAGIC && header.version == SPOOL_VERSION &&
+                    header.recordSize == sizeof(TelemetryWindow) &&
+                    header.capacity == TELEMETRY_SPOOL_CAPACITY &&
+                    header.count <= header.written && header.written <= header.capacity &&
+                    header.sentCount <= header.count;
+        }
+        file.close();
+
+        if (!valid) {
+            LOG_WARN_TAG("TelemetrySpool", "Spool %s has an unexpected layout, recreating", path.c_str());
+            SPIFFS.remove(path);
+        }
+    }
+
+    if (!valid && !createFile()) {
+        LOG_ERROR_TAG("TelemetrySpool", "Failed to create spool %s", path.c_str());
+        return false;
+    }
+
+    header.bootCount++;
+    ready = writeHeader();
+    resetWindow(millis());
+
+    LOG_INFO_TAG("TelemetrySpool", "Spool ready: %u windows pending, boot %u",
+                 (unsigned)header.count, (unsigned)header.bootCount);
+    return ready;
+}
+
+bool TelemetrySpool::createFile() {
+    header = Header{};
+    header.magic = SPOOL_MAGIC;
+    header.version = SPOOL_VERSION;
+    header.recordSize = sizeof(TelemetryWindow);
+    header.capacity = TELEMETRY_SPOOL_CAPACITY;
+
+    File file = SPIFFS.open(path, "w");
+    if (!file) {
+        return false;
+    }
+    bool success = file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header);
+    file.close();
+    return success;
+}
+
+bool TelemetrySpool::writeHeader() {
+    File file = SPIFFS.open(path, "r+");
+    if (!file) {
+        return false;
+    }
+    bool success = file.seek(0) &&
+                   file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header);
+    file.close();
+    return success;
+}
+
+bool TelemetrySpool::appendWindow(const TelemetryWindow& window) {
+    if (!ready) {
+        return false;
+    }
+
+    if (header.count == header.capacity) {
+        // Full: the oldest window gives way, including one that is part of an unacknowledged batch
+        header.head = (header.head + 1) % header.capacity;
+        header.count--;
+        overwrittenCount++;
+        if (header.sentCount > 0 && --header.sentCount == 0) {
+            // Every window of the sent batch is gone; whatever the server kept, the sequence number is used
+            header.nextSeq++;
+            inflight = false;
+        }
+    }
+
+    // Slots fill in order, so the tail is either an existing slot or the end of the file
+    uint32_t slot = (header.head + header.count) % header.capacity;
+    File file = SPIFFS.open(path, "r+");
+    if (!file) {
+        LOG_ERROR_TAG("TelemetrySpool", "Failed to open spool for writing");
+        return false;
+    }
+    bool success = file.seek(sizeof(Header) + slot * sizeof(TelemetryWindow)) &&
+                   file.write(reinterpret_cast<const uint8_t*>(&window), sizeof(window)) == sizeof(window);
+    file.close();
+
+    if (!success) {
+        LOG_ERROR_TAG("TelemetrySpool", "Failed to write spool slot %u", (unsigned)slot);
+        return false;
+    }
+
+    header.count++;
+    if (slot >= header.written) {
+        header.written = slot + 1;
+    }
+    return writeHeader();
+}
+
+bool TelemetrySpool::readWindow(File& file, uint32_t slot, TelemetryWindow& window) {
+    return file.seek(sizeof(Header) + slot * sizeof(TelemetryWindow)) &&
+           file.read(reinterpret_cast<uint8_t*>(&window), sizeof(window)) == sizeof(window);
+}
+
+void TelemetrySpool::resetWindow(uint32_t now) {
+    current = TelemetryWindow{};
+    for (int i = 0; i < TELEMETRY_METRIC_COUNT; i++) {
+        current.min[i] = FLT_MAX;
+        current.max[i] = -FLT_MAX;
+        sums[i] = 0.0f;
+    }
+    windowStart = now;
+}
+
+void TelemetrySpool::addSample(const TelemetrySample& sample, uint32_t now) {
+    for (int i = 0; i < TELEMETRY_METRIC_COUNT; i++) {
+        float value = sample.values[i];
+        if (value < current.min[i]) {
+            current.min[i] = value;
+        }
+        if (value > current.max[i]) {
+            current.max[i] = value;
+        }
+        sums[i] += value;
+    }
+    current.samples++;
+
+    if (now - windowStart >= TELEMETRY_WINDOW_MS) {
+        closeWindow(now);
+    }
+}
+
+void TelemetrySpool::closeWindow(uint32_t now) {
+    if (current.samples == 0) {
+        windowStart = now;
+        return;
+    }
+
+    for (int i = 0; i < TELEMETRY_METRIC_COUNT; i++) {
+        current.mean[i] = sums[i] / current.samples;
+    }
+    time_t epoch = time(nullptr);
+    current.epoch = epoch >= (time_t)EPOCH_VALID_AFTER ? (uint32_t)epoch : 0;
+    current.uptimeEnd = now;
+    current.boot = header.bootCount;
+
+    appendWindow(current);
+    resetWindow(now);
+}
+
+void TelemetrySpool::service(ServerMQTTClient& client, const String& topic, uint32_t uploadIntervalMs, uint32_t now) {
+    if (!ready) {
+        return;
+    }
+
+    if (inflight) {
+        if (now - inflightSentAt < TELEMETRY_ACK_TIMEOUT_MS) {
+            return;
+        }
+        // The records are still at the head of the spool; the next batch resends them
+        inflight = false;
+        retryCount++;
+        LinkScorer::getInstance().recordSend(CommInterface::WIFI, false, inflightBytes);
+        LOG_WARN_TAG("TelemetrySpool", "Batch %u not acknowledged, retrying", (unsigned)inflightSeq);
+    }
+
+    if (header.count == 0 || !client.isConnected()) {
+        return;
+    }
+
+    // A backlog goes out in full batches; otherwise windows are held so the radio wakes once per interval
+    bool due = header.count >= TELEMETRY_BATCH_WINDOWS ||
+               lastUploadTime == 0 || now - lastUploadTime >= uploadIntervalMs;
+    if (due) {
+        sendBatch(client, topic, now);
+    }
+}
+
+bool TelemetrySpool::sendBatch(ServerMQTTClient& client, const String& topic, uint32_t now) {
+    // The server keeps the first batch it sees under a sequence number, so a resend
+    // must carry the same windows; sentCount survives reboots in the header
+    uint32_t batchCount = header.count < TELEMETRY_BATCH_WINDOWS ? header.count : TELEMETRY_BATCH_WINDOWS;
+    if (header.sentCount > 0) {
+        batchCount = header.sentCount;
+    }
+    uint32_t seq = header.nextSeq;
+    size_t length = BATCH_HEADER_SIZE + batchCount * WINDOW_ENCODED_SIZE;
+
+    File file = SPIFFS.open(path, "r");
+    if (!file) {
+        LOG_ERROR_TAG("TelemetrySpool", "Failed to open spool for reading");
+        return false;
+    }
+
+    if (!client.beginStreamedPublish(topic, length)) {
+        file.close();
+        return false;
+    }
+
+    uint8_t buffer[WINDOW_ENCODED_SIZE > BATCH_HEADER_SIZE ? WINDOW_ENCODED_SIZE : BATCH_HEADER_SIZE];
+    uint8_t* out = buffer;
+    *out++ = 0x84;                          // fixmap, 4 entries
+    out = putKey(out, "seq");
+    out = putU32(out, seq);
+    out = putKey(out, "boot");
+    out = putU16(out, header.bootCount);
+    out = putKey(out, "uptime");
+    out = putU32(out, now);
+    out = putKey(out, "windows");
+    out = putArray16(out, batchCount);
+    bool success = client.writeStreamed(buffer, out - buffer);
+
+    for (uint32_t i = 0; success && i < batchCount; i++) {
+        TelemetryWindow window;
+        success = readWindow(file, (header.head + i) % header.capacity, window) &&
+                  client.writeStreamed(buffer, encodeWindow(window, buffer));
+    }
+    file.close();
+
+    if (!client.endStreamedPublish(success)) {
+        LOG_WARN_TAG("TelemetrySpool", "Failed to publish batch %u", (unsigned)seq);
+        return false;
+    }
+
+    if (header.sentCount != batchCount) {
+        header.sentCount = (uint16_t)batchCount;
+        writeHeader();
+    }
+    inflight = true;
+    inflightSeq = seq;
+    inflightSentAt = now;
+    inflightBytes = length;
+    lastUploadTime = now;
+    LOG_DEBUG_TAG("TelemetrySpool", "Sent batch %u: %u windows, %u bytes",
+                  (unsigned)seq, (unsigned)batchCount, (unsigned)length);
+    return true;
+}
+
+void TelemetrySpool::handleAck(uint32_t seq) {
+    if (!inflight || seq != inflightSeq) {
+        LOG_DEBUG_TAG("TelemetrySpool", "Ignoring acknowledgement for batch %u", (unsigned)seq);
+        return;
+    }
+
+    // Publish to ack is a true round trip through the broker and the server's commit
+    uint32_t rtt = millis() - inflightSentAt;
+    LinkScorer& scorer = LinkScorer::getInstance();
+    scorer.sampleRoundTrip(CommInterface::WIFI, rtt);
+    scorer.recordSend(CommInterface::WIFI, true, inflightBytes, rtt > 0 ? rtt : 1);
+
+    header.head = (header.head + header.sentCount) % header.capacity;
+    header.count -= header.sentCount;
+    header.sentCount = 0;
+    header.nextSeq++;
+    inflight = false;
+    writeHeader();
+
+    LOG_DEBUG_TAG("TelemetrySpool", "Batch %u acknowledged, %u windows pending",
+                  (unsigned)seq, (unsigned)header.count);
+}
+
+bool TelemetrySpool::isReady() const {
+    return ready;
+}
+
+uint32_t TelemetrySpool::getPendingCount() const {
+    return header.count;
+}
+
+uint32_t TelemetrySpool::getOverwrittenCount() const {
+    return overwrittenCount;
+}
+
+uint32_t TelemetrySpool::getRetryCount() const {
+    return retryCount;
+}
+
+uint16_t TelemetrySpool::getBootCount() const {
+    return header.bootCount;
+}
@@ -0,0 +1,122 @@
+// telemetry_spool.h
+// T-Deck-Pro OS store-and-forward telemetry: windowed aggregation and a flash ring spool
+#pragma once
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+
+class ServerMQTTClient;
+
+// Aggregation window; every closed window becomes one spool record
+#ifndef TELEMETRY_WINDOW_MS
+#define TELEMETRY_WINDOW_MS 60000
+#endif
+
+// Ring capacity in windows; the oldest record is overwritten when full (24 h of 1 min windows)
+#ifndef TELEMETRY_SPOOL_CAPACITY
+#define TELEMETRY_SPOOL_CAPACITY 1440
+#endif
+
+// Windows per batched publish
+#ifndef TELEMETRY_BATCH_WINDOWS
+#define TELEMETRY_BATCH_WINDOWS 32
+#endif
+
+// A batch that is not acknowledged in this time is sent again
+#ifndef TELEMETRY_ACK_TIMEOUT_MS
+#define TELEMETRY_ACK_TIMEOUT_MS 30000
+#endif
+
+#define TELEMETRY_SPOOL_PATH "/spool/telemetry.bin"
+
+// Aggregated metrics, in the order they are encoded
+enum TelemetryMetric {
+    TELEMETRY_BATTERY = 0,      // Percent
+    TELEMETRY_TEMPERATURE,      // Degrees C
+    TELEMETRY_CPU,              // Percent
+    TELEMETRY_MEMORY,           // Percent of heap in use
+    TELEMETRY_SIGNAL,           // dBm
+    TELEMETRY_METRIC_COUNT
+};
+
+struct TelemetrySample {
+    float values[TELEMETRY_METRIC_COUNT];
+};
+
+// One spool record, written to flash as is
+struct TelemetryWindow {
+    uint32_t epoch;             // Wall clock at window end, 0 if the clock was not set
+    uint32_t uptimeEnd;         // millis() at window end
+    uint16_t boot;              // Boot count the window was recorded in
+    uint16_t samples;
+    float min[TELEMETRY_METRIC_COUNT];
+    float max[TELEMETRY_METRIC_COUNT];
+    float mean[TELEMETRY_METRIC_COUNT];
+};
+
+class TelemetrySpool {
+private:
+    // On-flash ring header, rewritten after every append and acknowledgement
+    struct Header {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t recordSize;
+        uint32_t capacity;
+        uint32_t head;          // Oldest unacknowledged record
+        uint32_t count;
+        uint32_t written;       // Slots that exist in the file so far
+        uint32_t nextSeq;
+        uint16_t bootCount;
+        uint16_t sentCount;     // Windows last sent under nextSeq, 0 if nothing was sent yet
+    };
+
+    String path;
+    Header header;
+    bool ready;
+
+    // Window being aggregated
+    TelemetryWindow current;
+    float sums[TELEMETRY_METRIC_COUNT];
+    uint32_t windowStart;
+
+    // Batch awaiting acknowledgement
+    bool inflight;
+    uint32_t inflightSeq;
+    uint32_t inflightSentAt;
+    uint32_t inflightBytes;
+    uint32_t lastUploadTime;
+
+    // Statistics
+    uint32_t overwrittenCount;
+    uint32_t retryCount;
+
+    bool createFile();
+    bool writeHeader();
+    bool appendWindow(const TelemetryWindow& window);
+    bool readWindow(File& file, uint32_t slot, TelemetryWindow& window);
+    void resetWindow(uint32_t now);
+    bool sendBatch(ServerMQTTClient& client, const String& topic, uint32_t now);
+
+public:
+    TelemetrySpool(const String& path = TELEMETRY_SPOOL_PATH);
+
+    // Opens or creates the spool file and counts a new boot
+    bool begin();
+
+    // Folds a sample into the current window and closes it once TELEMETRY_WINDOW_MS has passed
+    void addSample(const TelemetrySample& sample, uint32_t now);
+    void closeWindow(uint32_t now);
+
+    // Uploads spooled windows when connected: a full batch at once, otherwise every uploadIntervalMs
+    void service(ServerMQTTClient& client, const String& topic, uint32_t uploadIntervalMs, uint32_t now);
+
+    // Drops the acknowledged batch from the spool
+    void handleAck(uint32_t seq);
+
+    // Status
+    bool isReady() const;
+    uint32_t getPendingCount() const;
+    uint32_t getOverwrittenCount() const;
+    uint32_t getRetryCount() const;
+    uint16_t getBootCount() const;
+};
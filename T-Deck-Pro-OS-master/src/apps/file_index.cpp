@@ -0,0 +1,646 @@
+#include "file_index.h"
+#include "../core/system/scheduler.h"
+#include "../core/utils/logger.h"
+#include <algorithm>
+#include <string.h>
+#include <strings.h>
+
+#define CACHE_MAGIC 0x58444946  // "FIDX"
+#define CACHE_VERSION 1
+
+namespace {
+
+// Sort keys, each with an ascending (even) and descending (odd) SortMode
+enum SortKey : uint8_t {
+    KEY_NAME = 0,
+    KEY_SIZE,
+    KEY_DATE,
+    KEY_TYPE,
+    KEY_COUNT
+};
+
+uint32_t hashPath(const char* path) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    while (*path) {
+        hash ^= (uint8_t)*path++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void copyPath(char* out, const String& path) {
+    strncpy(out, path.c_str(), FILE_INDEX_PATH_SIZE - 1);
+    out[FILE_INDEX_PATH_SIZE - 1] = '\0';
+
+    // "/logs/" and "/logs" are the same directory
+    size_t length = strlen(out);
+    while (length > 1 && out[length - 1] == '/') {
+        out[--length] = '\0';
+    }
+}
+
+} // namespace
+
+FileIndexer& FileIndexer::getInstance() {
+    static FileIndexer instance;
+    return instance;
+}
+
+FileIndexer::FileIndexer()
+    : fs(nullptr)
+    , detector(nullptr)
+    , taskHandle(nullptr)
+    , requestQueue(nullptr)
+    , mutex(nullptr)
+    , snapshot{}
+    , state(State::IDLE)
+    , generation(0)
+    , view(nullptr)
+    , viewCapacity(0)
+    , viewCount(0)
+    , viewGeneration(0)
+    , viewQuery{}
+    , viewValid(false)
+{
+}
+
+bool FileIndexer::begin(fs::FS& fileSystem, FileTypeDetector typeDetector) {
+    if (taskHandle) {
+        return true;
+    }
+
+    fs = &fileSystem;
+    detector = typeDetector;
+
+    mutex = xSemaphoreCreateMutex();
+    requestQueue = xQueueCreate(FILE_INDEX_QUEUE_LENGTH, sizeof(Request));
+    if (!mutex || !requestQueue) {
+        LOG_ERROR_TAG("FileIndexer", "Failed to create queue or mutex");
+        return false;
+    }
+
+    BaseType_t result = xTaskCreate(indexTask, "FileIndex", FILE_INDEX_TASK_STACK_SIZE, this,
+                                    FILE_INDEX_TASK_PRIORITY, &taskHandle);
+    if (result != pdPASS) {
+        LOG_ERROR_TAG("FileIndexer", "Failed to create index task");
+        taskHandle = nullptr;
+        return false;
+    }
+
+    LOG_INFO_TAG("FileIndexer", "File indexer started");
+    return true;
+}
+
+bool FileIndexer::queueRequest(RequestType type, const String& path, TickType_t wait) {
+    if (!requestQueue) {
+        return false;
+    }
+
+    Request request;
+    request.type = type;
+    copyPath(request.path, path);
+    if (xQueueSend(requestQueue, &request, wait) != pdTRUE) {
+        LOG_WARN_TAG("FileIndexer", "Request queue full, dropping %s", request.path);
+        return false;
+    }
+    return true;
+}
+
+bool FileIndexer::open(const String& path, bool rescan) {
+    return queueRequest(rescan ? RequestType::RESCAN : RequestType::OPEN, path, 0);
+}
+
+bool FileIndexer::invalidate(const String& path, TickType_t wait) {
+    return queueRequest(RequestType::INVALIDATE, path, wait);
+}
+
+void FileIndexer::indexTask(void* parameter) {
+    FileIndexer* indexer = static_cast<FileIndexer*>(parameter);
+    Request request;
+    while (true) {
+        if (xQueueReceive(indexer->requestQueue, &request, portMAX_DELAY) == pdTRUE) {
+            // Not a scheduler source; keep the chip out of light sleep until
+            // the request ends in READY or FAILED, cache writes included
+            sched_wake_lock();
+            indexer->handleRequest(request);
+            sched_wake_unlock();
+        }
+    }
+}
+
+bool FileIndexer::superseded() const {
+    // A newer open, or an invalidation of the directory being read, makes the current work moot
+    Request next;
+    if (xQueuePeek(requestQueue, &next, 0) != pdTRUE) {
+        return false;
+    }
+    return next.type != RequestType::INVALIDATE || strcmp(next.path, snapshot.path) == 0;
+}
+
+void FileIndexer::handleRequest(const Request& request) {
+    RequestType type = request.type;
+    if (type == RequestType::INVALIDATE) {
+        fs->remove(cachePath(request.path));
+        if (strcmp(request.path, snapshot.path) != 0) {
+            return;
+        }
+        type = RequestType::RESCAN;
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    resetSnapshot(request.path);
+    state = State::LOADING;
+    generation++;
+    xSemaphoreGive(mutex);
+
+    File dir = fs->open(request.path);
+    if (!dir || !dir.isDirectory()) {
+        LOG_WARN_TAG("FileIndexer", "%s is not a directory", request.path);
+        state = State::FAILED;
+        generation++;
+        return;
+    }
+    uint32_t dirMtime = (uint32_t)dir.getLastWrite();
+    dir.close();
+
+    if (type == RequestType::OPEN && loadCache(dirMtime)) {
+        state = State::READY;
+        generation++;
+
+        // The cached listing is up at once; a rescan replaces it only if the directory changed behind its mtime
+        if (!cacheStale()) {
+            return;
+        }
+        LOG_DEBUG_TAG("FileIndexer", "Cached index of %s is stale, rescanning", request.path);
+        xSemaphoreTake(mutex, portMAX_DELAY);
+        resetSnapshot(request.path);
+        state = State::LOADING;
+        generation++;
+        xSemaphoreGive(mutex);
+    }
+
+    uint32_t started = millis();
+    state = State::SCANNING;
+    if (!scan(dirMtime)) {
+        if (!superseded()) {
+            state = State::FAILED;
+            generation++;
+        }
+        return;
+    }
+
+    if (!buildOrders()) {
+        LOG_WARN_TAG("FileIndexer", "No memory to sort %u entries, listing in scan order",
+                     (unsigned)snapshot.count);
+    }
+    state = State::READY;
+    generation++;
+
+    LOG_INFO_TAG("FileIndexer", "Indexed %s: %u entries in %u ms", request.path,
+                 (unsigned)snapshot.count, (unsigned)(millis() - started));
+    if (snapshot.orders && !saveCache()) {
+        LOG_WARN_TAG("FileIndexer", "Failed to cache index of %s", request.path);
+    }
+}
+
+bool FileIndexer::cacheStale() {
+    File dir = fs->open(snapshot.path);
+    if (!dir) {
+        return false;
+    }
+
+    // Counts only; no names are copied and nothing is published
+    uint32_t count = 0;
+    uint64_t totalSize = 0;
+    while (File entry = dir.openNextFile()) {
+        if (superseded()) {
+            // The next request replaces this listing anyway
+            entry.close();
+            dir.close();
+            return false;
+        }
+        if (count == FILE_INDEX_MAX_ENTRIES) {
+            entry.close();
+            break;
+        }
+        count++;
+        if (!entry.isDirectory()) {
+            totalSize += (uint32_t)entry.size();
+        }
+        entry.close();
+    }
+    dir.close();
+    return count != snapshot.count || totalSize != snapshot.totalSize;
+}
+
+void FileIndexer::releaseSnapshot(Snapshot& target) {
+    free(target.entries);
+    free(target.names);
+    free(target.orders);
+    target.entries = nullptr;
+    target.names = nullptr;
+    target.orders = nullptr;
+    target.entryCapacity = 0;
+    target.namesCapacity = 0;
+}
+
+void FileIndexer::resetSnapshot(const char* path) {
+    releaseSnapshot(snapshot);
+    snapshot = Snapshot{};
+    strncpy(snapshot.path, path, FILE_INDEX_PATH_SIZE - 1);
+    viewValid = false;
+}
+
+bool FileIndexer::scan(uint32_t dirMtime) {
+    File dir = fs->open(snapshot.path);
+    if (!dir) {
+        return false;
+    }
+
+    // Entries are collected locally and published a batch at a time, so the UI waits on the lock only briefly
+    Entry batch[FILE_INDEX_BATCH_SIZE];
+    char* batchNames = (char*)ps_malloc(FILE_INDEX_BATCH_SIZE * FILE_INDEX_NAME_SIZE);
+    if (!batchNames) {
+        dir.close();
+        return false;
+    }
+
+    uint32_t batchCount = 0;
+    uint32_t batchNamesSize = 0;
+    bool success = true;
+    bool truncated = false;
+
+    while (File entry = dir.openNextFile()) {
+        if (superseded()) {
+            entry.close();
+            success = false;
+            break;
+        }
+        if (snapshot.count + batchCount >= FILE_INDEX_MAX_ENTRIES) {
+            entry.close();
+            truncated = true;
+            break;
+        }
+
+        const char* name = entry.name();
+        const char* slash = strrchr(name, '/');
+        if (slash) {
+            name = slash + 1;
+        }
+        size_t nameLength = strnlen(name, FILE_INDEX_NAME_SIZE - 1);
+
+        Entry& item = batch[batchCount++];
+        item.flags = entry.isDirectory() ? FILE_INDEX_FLAG_DIRECTORY : 0;
+        if (name[0] == '.') {
+            item.flags |= FILE_INDEX_FLAG_HIDDEN;
+        }
+        item.size = item.flags & FILE_INDEX_FLAG_DIRECTORY ? 0 : (uint32_t)entry.size();
+        item.lastModified = (uint32_t)entry.getLastWrite();
+        item.nameOffset = batchNamesSize;
+        item.nameLength = nameLength;
+        memcpy(batchNames + batchNamesSize, name, nameLength);
+        batchNames[batchNamesSize + nameLength] = '\0';
+        batchNamesSize += nameLength + 1;
+        entry.close();
+
+        item.type = detector ? detector(batchNames + item.nameOffset, item.flags & FILE_INDEX_FLAG_DIRECTORY) : 0;
+
+        if (batchCount == FILE_INDEX_BATCH_SIZE) {
+            if (!appendBatch(batch, batchNames, batchCount, batchNamesSize)) {
+                success = false;
+                break;
+            }
+            batchCount = 0;
+            batchNamesSize = 0;
+        }
+    }
+    dir.close();
+
+    if (success && batchCount > 0) {
+        success = appendBatch(batch, batchNames, batchCount, batchNamesSize);
+    }
+    free(batchNames);
+
+    if (truncated) {
+        LOG_WARN_TAG("FileIndexer", "%s has more than %u entries, index truncated",
+                     snapshot.path, FILE_INDEX_MAX_ENTRIES);
+    }
+    snapshot.truncated = truncated;
+    snapshot.dirMtime = dirMtime;
+    return success;
+}
+
+bool FileIndexer::appendBatch(const Entry* batch, const char* batchNames, uint32_t count, uint32_t namesSize) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    if (snapshot.count + count > snapshot.entryCapacity) {
+        uint32_t capacity = snapshot.entryCapacity ? snapshot.entryCapacity * 2 : 256;
+        while (capacity < snapshot.count + count) capacity *= 2;
+        Entry* grown = (Entry*)ps_realloc(snapshot.entries, capacity * sizeof(Entry));
+        if (!grown) {
+            xSemaphoreGive(mutex);
+            LOG_ERROR_TAG("FileIndexer", "Out of memory at %u entries", (unsigned)snapshot.count);
+            return false;
+        }
+        snapshot.entries = grown;
+        snapshot.entryCapacity = capacity;
+    }
+    if (snapshot.namesSize + namesSize > snapshot.namesCapacity) {
+        uint32_t capacity = snapshot.namesCapacity ? snapshot.namesCapacity * 2 : 4096;
+        while (capacity < snapshot.namesSize + namesSize) capacity *= 2;
+        char* grown = (char*)ps_realloc(snapshot.names, capacity);
+        if (!grown) {
+            xSemaphoreGive(mutex);
+            LOG_ERROR_TAG("FileIndexer", "Out of memory for names at %u entries", (unsigned)snapshot.count);
+            return false;
+        }
+        snapshot.names = grown;
+        snapshot.namesCapacity = capacity;
+    }
+
+    memcpy(snapshot.names + snapshot.namesSize, batchNames, namesSize);
+    for (uint32_t i = 0; i < count; i++) {
+        Entry& entry = snapshot.entries[snapshot.count + i];
+        entry = batch[i];
+        entry.nameOffset += snapshot.namesSize;
+        if (entry.flags & FILE_INDEX_FLAG_DIRECTORY) {
+            snapshot.directories++;
+        } else {
+            snapshot.totalSize += entry.size;
+        }
+    }
+    snapshot.count += count;
+    snapshot.namesSize += namesSize;
+    generation++;
+
+    xSemaphoreGive(mutex);
+    return true;
+}
+
+bool FileIndexer::buildOrders() {
+    uint32_t count = snapshot.count;
+    if (count == 0) {
+        return true;
+    }
+
+    uint16_t* orders = (uint16_t*)ps_malloc((size_t)count * FILE_INDEX_SORT_COUNT * sizeof(uint16_t));
+    if (!orders) {
+        return false;
+    }
+
+    // The scan is over, so entries are only read from here on and need no lock
+    const Entry* entries = snapshot.entries;
+    const char* names = snapshot.names;
+    uint32_t directories = snapshot.directories;
+
+    for (uint8_t key = 0; key < KEY_COUNT; key++) {
+        uint16_t* ascending = orders + (size_t)(key * 2) * count;
+        uint16_t* descending = ascending + count;
+        for (uint32_t i = 0; i < count; i++) {
+            ascending[i] = i;
+        }
+
+        std::sort(ascending, ascending + count, [&](uint16_t a, uint16_t b) {
+            const Entry& x = entries[a];
+            const Entry& y = entries[b];
+            bool xDir = x.flags & FILE_INDEX_FLAG_DIRECTORY;
+            bool yDir = y.flags & FILE_INDEX_FLAG_DIRECTORY;
+            if (xDir != yDir) {
+                return xDir;
+            }
+            switch (key) {
+                case KEY_SIZE:
+                    if (x.size != y.size) return x.size < y.size;
+                    break;
+                case KEY_DATE:
+                    if (x.lastModified != y.lastModified) return x.lastModified < y.lastModified;
+                    break;
+                case KEY_TYPE:
+                    if (x.type != y.type) return x.type < y.type;
+                    break;
+                default:
+                    break;
+            }
+            int byName = strcasecmp(names + x.nameOffset, names + y.nameOffset);
+            return byName != 0 ? byName < 0 : a < b;
+        });
+
+        // Descending keeps directories first: each group is reversed on its own
+        for (uint32_t i = 0; i < directories; i++) {
+            descending[i] = ascending[directories - 1 - i];
+        }
+        for (uint32_t i = directories; i < count; i++) {
+            descending[i] = ascending[count - 1 - (i - directories)];
+        }
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    snapshot.orders = orders;
+    viewValid = false;
+    xSemaphoreGive(mutex);
+    return true;
+}
+
+String FileIndexer::cachePath(const char* path) const {
+    char name[48];
+    snprintf(name, sizeof(name), FILE_INDEX_DIR "/%08x.idx", (unsigned)hashPath(path));
+    return String(name);
+}
+
+bool FileIndexer::loadCache(uint32_t dirMtime) {
+    String path = cachePath(snapshot.path);
+    if (!fs->exists(path)) {
+        return false;
+    }
+
+    File file = fs->open(path, "r");
+    CacheHeader header;
+    if (!file || file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) != sizeof(header)) {
+        file.close();
+        return false;
+    }
+
+    size_t expected = sizeof(header) + (size_t)header.count * sizeof(Entry) + header.namesSize +
+                      (size_t)header.count * FILE_INDEX_SORT_COUNT * sizeof(uint16_t);
+    bool valid = header.magic == CACHE_MAGIC && header.version == CACHE_VERSION &&
+                 header.entrySize == sizeof(Entry) && header.count <= FILE_INDEX_MAX_ENTRIES &&
+                 header.dirMtime == dirMtime && strncmp(header.path, snapshot.path, FILE_INDEX_PATH_SIZE) == 0 &&
+                 file.size() == expected;
+    if (!valid) {
+        file.close();
+        return false;
+    }
+
+    Snapshot loaded = {};
+    size_t entryBytes = (size_t)header.count * sizeof(Entry);
+    size_t orderBytes = (size_t)header.count * FILE_INDEX_SORT_COUNT * sizeof(uint16_t);
+    loaded.entries = (Entry*)ps_malloc(entryBytes ? entryBytes : 1);
+    loaded.names = (char*)ps_malloc(header.namesSize ? header.namesSize : 1);
+    loaded.orders = (uint16_t*)ps_malloc(orderBytes ? orderBytes : 1);
+    bool success = loaded.entries && loaded.names && loaded.orders &&
+                   file.read(reinterpret_cast<uint8_t*>(loaded.entries), entryBytes) == entryBytes &&
+                   file.read(reinterpret_cast<uint8_t*>(loaded.names), header.namesSize) == header.namesSize &&
+                   file.read(reinterpret_cast<uint8_t*>(loaded.orders), orderBytes) == orderBytes;
+    file.close();
+    if (!success) {
+        releaseSnapshot(loaded);
+        return false;
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    releaseSnapshot(snapshot);
+    snapshot.entries = loaded.entries;
+    snapshot.entryCapacity = header.count;
+    snapshot.names = loaded.names;
+    snapshot.namesSize = header.namesSize;
+    snapshot.namesCapacity = header.namesSize;
+    snapshot.orders = loaded.orders;
+    snapshot.count = header.count;
+    snapshot.directories = header.directories;
+    snapshot.totalSize = header.totalSize;
+    snapshot.dirMtime = dirMtime;
+    snapshot.fromCache = true;
+    viewValid = false;
+    xSemaphoreGive(mutex);
+
+    LOG_DEBUG_TAG("FileIndexer", "Loaded cached index of %s: %u entries", snapshot.path, (unsigned)header.count);
+    return true;
+}
+
+bool FileIndexer::saveCache() {
+    fs->mkdir("/.tdeck");
+    fs->mkdir(FILE_INDEX_DIR);
+
+    CacheHeader header = {};
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.entrySize = sizeof(Entry);
+    header.count = snapshot.count;
+    header.namesSize = snapshot.namesSize;
+    header.dirMtime = snapshot.dirMtime;
+    header.directories = snapshot.directories;
+    header.totalSize = snapshot.totalSize;
+    memcpy(header.path, snapshot.path, FILE_INDEX_PATH_SIZE);
+
+    // A truncated write fails the size check on load and the directory is scanned again
+    File file = fs->open(cachePath(snapshot.path), "w");
+    if (!file) {
+        return false;
+    }
+    size_t entryBytes = (size_t)snapshot.count * sizeof(Entry);
+    size_t orderBytes = (size_t)snapshot.count * FILE_INDEX_SORT_COUNT * sizeof(uint16_t);
+    bool success = file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header) &&
+                   file.write(reinterpret_cast<const uint8_t*>(snapshot.entries), entryBytes) == entryBytes &&
+                   file.write(reinterpret_cast<const uint8_t*>(snapshot.names), snapshot.namesSize) == snapshot.namesSize &&
+                   file.write(reinterpret_cast<const uint8_t*>(snapshot.orders), orderBytes) == orderBytes;
+    file.close();
+    return success;
+}
+
+bool FileIndexer::matches(const Entry& entry, const FileIndexQuery& query) const {
+    if (!query.showHidden && (entry.flags & FILE_INDEX_FLAG_HIDDEN)) {
+        return false;
+    }
+    return query.filter[0] == '\0' || strcasestr(snapshot.names + entry.nameOffset, query.filter) != nullptr;
+}
+
+bool FileIndexer::refreshView(const FileIndexQuery& query) {
+    if (viewValid && viewGeneration == generation && viewQuery.sortMode == query.sortMode &&
+        viewQuery.showHidden == query.showHidden && strcmp(viewQuery.filter, query.filter) == 0) {
+        return true;
+    }
+
+    if (snapshot.count > viewCapacity) {
+        uint16_t* grown = (uint16_t*)ps_realloc(view, snapshot.count * sizeof(uint16_t));
+        if (!grown) {
+            viewCount = 0;
+            viewValid = false;
+            return false;
+        }
+        view = grown;
+        viewCapacity = snapshot.count;
+    }
+
+    // Until the scan has been sorted, entries are listed in the order they were read
+    const uint16_t* order = nullptr;
+    if (snapshot.orders && query.sortMode < FILE_INDEX_SORT_COUNT) {
+        order = snapshot.orders + (size_t)query.sortMode * snapshot.count;
+    }
+
+    viewCount = 0;
+    for (uint32_t i = 0; i < snapshot.count; i++) {
+        uint16_t index = order ? order[i] : i;
+        if (matches(snapshot.entries[index], query)) {
+            view[viewCount++] = index;
+        }
+    }
+
+    viewQuery = query;
+    viewQuery.filter[FILE_INDEX_FILTER_SIZE - 1] = '\0';
+    viewGeneration = generation;
+    viewValid = true;
+    return true;
+}
+
+uint32_t FileIndexer::getCount(const FileIndexQuery& query) {
+    if (!mutex) {
+        return 0;
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    uint32_t count = refreshView(query) ? viewCount : 0;
+    xSemaphoreGive(mutex);
+    return count;
+}
+
+size_t FileIndexer::getPage(const FileIndexQuery& query, uint32_t offset, FileIndexItem* out, size_t maxCount) {
+    if (!mutex) {
+        return 0;
+    }
+
+    size_t copied = 0;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    if (refreshView(query)) {
+        while (copied < maxCount && offset + copied < viewCount) {
+            const Entry& entry = snapshot.entries[view[offset + copied]];
+            FileIndexItem& item = out[copied++];
+            memcpy(item.name, snapshot.names + entry.nameOffset, entry.nameLength + 1);
+            item.size = entry.size;
+            item.lastModified = entry.lastModified;
+            item.type = entry.type;
+            item.flags = entry.flags;
+        }
+    }
+    xSemaphoreGive(mutex);
+    return copied;
+}
+
+String FileIndexer::getPath() {
+    if (!mutex) {
+        return String();
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    String path(snapshot.path);
+    xSemaphoreGive(mutex);
+    return path;
+}
+
+FileIndexer::Summary FileIndexer::getSummary() {
+    Summary summary = {};
+    summary.state = state;
+    if (!mutex) {
+        return summary;
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    summary.entries = snapshot.count;
+    summary.directories = snapshot.directories;
+    summary.totalSize = snapshot.totalSize;
+    summary.sorted = snapshot.orders != nullptr;
+    summary.fromCache = snapshot.fromCache;
+    summary.truncated = snapshot.truncated;
+    xSemaphoreGive(mutex);
+    return summary;
+}
@@ -0,0 +1,220 @@
+#ifndef FILE_INDEX_H
+#define FILE_INDEX_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#ifndef FILE_INDEX_MAX_ENTRIES
+#define FILE_INDEX_MAX_ENTRIES 16384    // Entries beyond this are left out of the index
+#endif
+
+#define FILE_INDEX_DIR "/.tdeck/index"  // Cached indexes, one file per directory
+#define FILE_INDEX_PATH_SIZE 128
+#define FILE_INDEX_NAME_SIZE 256
+#define FILE_INDEX_FILTER_SIZE 32
+#define FILE_INDEX_SORT_COUNT 8         // One precomputed order per FileManagerApp::SortMode
+#define FILE_INDEX_BATCH_SIZE 64        // Entries published to the UI at a time while scanning
+#define FILE_INDEX_TASK_STACK_SIZE 6144
+#define FILE_INDEX_TASK_PRIORITY 1
+#define FILE_INDEX_QUEUE_LENGTH 4
+
+#define FILE_INDEX_FLAG_DIRECTORY 0x01
+#define FILE_INDEX_FLAG_HIDDEN 0x02
+
+// Classifies a name into a FileManagerApp::FileType value
+typedef uint8_t (*FileTypeDetector)(const char* name, bool isDirectory);
+
+/**
+ * @brief One directory entry as handed to the UI
+ */
+struct FileIndexItem {
+    char name[FILE_INDEX_NAME_SIZE];
+    uint32_t size;
+    uint32_t lastModified;
+    uint8_t type;
+    uint8_t flags;
+};
+
+/**
+ * @brief Which entries to list and in what order
+ */
+struct FileIndexQuery {
+    uint8_t sortMode;                   // FileManagerApp::SortMode value
+    bool showHidden;
+    char filter[FILE_INDEX_FILTER_SIZE];    // Case-insensitive substring, empty for all
+};
+
+/**
+ * @brief Background directory indexer
+ *
+ * Directories are read on a worker task, never on the UI task. Each scanned
+ * directory is cached on the card as a compact index: fixed-size entries,
+ * a name blob and one precomputed order per sort mode. The cache is keyed by
+ * the directory's mtime, so reopening an unchanged directory shows its
+ * listing after one file read; invalidate() drops a single directory's cache
+ * after a change made through the file manager. FAT does not always update a
+ * directory's mtime when other writers add files, so a cached listing is
+ * checked afterwards against the directory's entry count and total size and
+ * rescanned if either moved; an explicit refresh rescans regardless.
+ *
+ * While a directory is scanned, entries become visible in batches in scan
+ * order; once the scan completes, pages come back in the requested order.
+ * Filtering and hiding work on the in-memory index. The result is cached
+ * until the query or the directory changes.
+ */
+class FileIndexer {
+public:
+    enum class State : uint8_t {
+        IDLE,
+        LOADING,                        // Checking or reading the cached index
+        SCANNING,                       // Entries arrive in batches, not yet sorted
+        READY,
+        FAILED
+    };
+
+    struct Summary {
+        State state;
+        uint32_t entries;
+        uint32_t directories;
+        uint64_t totalSize;
+        bool sorted;
+        bool fromCache;
+        bool truncated;
+    };
+
+    static FileIndexer& getInstance();
+
+    /**
+     * @brief Start the worker task
+     * @param fs Mounted file system to index
+     * @param detector Classifies entries; nullptr stores type 0
+     * @return true if successful, false otherwise
+     */
+    bool begin(fs::FS& fs, FileTypeDetector detector);
+
+    /**
+     * @brief Make path the current directory and index it in the background
+     * @param rescan Ignore the cached index even if the mtime matches
+     * @return false if the request could not be queued
+     */
+    bool open(const String& path, bool rescan = false);
+
+    /**
+     * @brief Drop the cached index of a directory, rescanning it if it is current
+     * @param wait Ticks to wait for room in the request queue
+     */
+    bool invalidate(const String& path, TickType_t wait = 0);
+
+    // Bumped whenever the current directory's entries or order change
+    uint32_t getGeneration() const { return generation; }
+    String getPath();
+    Summary getSummary();
+    fs::FS* getFileSystem() const { return fs; }
+
+    /**
+     * @brief Number of entries the query lists in the current directory
+     */
+    uint32_t getCount(const FileIndexQuery& query);
+
+    /**
+     * @brief Copy up to maxCount entries starting at offset in the query's order
+     * @return Number of entries copied
+     */
+    size_t getPage(const FileIndexQuery& query, uint32_t offset, FileIndexItem* out, size_t maxCount);
+
+private:
+    struct Entry {
+        uint32_t size;
+        uint32_t lastModified;
+        uint32_t nameOffset;
+        uint16_t nameLength;
+        uint8_t type;
+        uint8_t flags;
+    };
+
+    // The current directory's index; grows in place while a scan runs
+    struct Snapshot {
+        char path[FILE_INDEX_PATH_SIZE];
+        Entry* entries;
+        uint32_t entryCapacity;
+        char* names;
+        uint32_t namesSize;
+        uint32_t namesCapacity;
+        uint16_t* orders;               // FILE_INDEX_SORT_COUNT permutations of count entries
+        uint32_t count;
+        uint32_t directories;
+        uint64_t totalSize;
+        uint32_t dirMtime;
+        bool fromCache;
+        bool truncated;
+    };
+
+    // On-card cache header, followed by entries, names and orders
+    struct CacheHeader {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t entrySize;
+        uint32_t count;
+        uint32_t namesSize;
+        uint32_t dirMtime;
+        uint32_t directories;
+        uint64_t totalSize;
+        char path[FILE_INDEX_PATH_SIZE];
+    };
+
+    enum class RequestType : uint8_t {
+        OPEN,
+        RESCAN,
+        INVALIDATE
+    };
+
+    struct Request {
+        RequestType type;
+        char path[FILE_INDEX_PATH_SIZE];
+    };
+
+    FileIndexer();
+
+    fs::FS* fs;
+    FileTypeDetector detector;
+    TaskHandle_t taskHandle;
+    QueueHandle_t requestQueue;
+    SemaphoreHandle_t mutex;
+
+    Snapshot snapshot;
+    volatile State state;
+    volatile uint32_t generation;
+
+    // Filtered view of the snapshot for the last query
+    uint16_t* view;
+    uint32_t viewCapacity;
+    uint32_t viewCount;
+    uint32_t viewGeneration;
+    FileIndexQuery viewQuery;
+    bool viewValid;
+
+    static void indexTask(void* parameter);
+    void handleRequest(const Request& request);
+    bool queueRequest(RequestType type, const String& path, TickType_t wait);
+    bool superseded() const;
+
+    void resetSnapshot(const char* path);
+    void releaseSnapshot(Snapshot& target);
+    bool scan(uint32_t dirMtime);
+    bool appendBatch(const Entry* batch, const char* batchNames, uint32_t count, uint32_t namesSize);
+    bool buildOrders();
+
+    String cachePath(const char* path) const;
+    bool loadCache(uint32_t dirMtime);
+    bool cacheStale();
+    bool saveCache();
+
+    bool refreshView(const FileIndexQuery& query);
+    bool matches(const Entry& entry, const FileIndexQuery& query) const;
+};
+
+#endif // FILE_INDEX_H
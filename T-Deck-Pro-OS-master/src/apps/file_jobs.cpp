@@ -0,0 +1,630 @@
+#include "file_jobs.h"
+#include "file_index.h"
+#include "../core/system/scheduler.h"
+#include "../core/utils/logger.h"
+#include <string.h>
+
+namespace {
+
+bool joinPath(char* out, const char* directory, const char* name) {
+    const char* separator = directory[strlen(directory) - 1] == '/' ? "" : "/";
+    int length = snprintf(out, FILE_JOB_PATH_SIZE, "%s%s%s", directory, separator, name);
+    return length > 0 && length < FILE_JOB_PATH_SIZE;
+}
+
+void parentOf(char* out, const char* path) {
+    strncpy(out, path, FILE_JOB_PATH_SIZE - 1);
+    out[FILE_JOB_PATH_SIZE - 1] = '\0';
+    char* slash = strrchr(out, '/');
+    if (!slash || slash == out) {
+        strcpy(out, "/");
+    } else {
+        *slash = '\0';
+    }
+}
+
+const char* baseName(const char* path) {
+    const char* slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+// True if path is inside directory, which would make a copy of directory recurse into itself
+bool isWithin(const char* path, const char* directory) {
+    size_t length = strlen(directory);
+    return strncmp(path, directory, length) == 0 && (path[length] == '/' || path[length] == '\0');
+}
+
+} // namespace
+
+FileJobEngine& FileJobEngine::getInstance() {
+    static FileJobEngine instance;
+    return instance;
+}
+
+FileJobEngine::FileJobEngine()
+    : taskHandle(nullptr)
+    , writerHandle(nullptr)
+    , jobQueue(nullptr)
+    , freeBuffers(nullptr)
+    , fullBuffers(nullptr)
+    , mutex(nullptr)
+    , jobs{}
+    , nextId(FILE_JOB_INVALID_ID)
+    , buffers{}
+    , writeFailed(false)
+{
+}
+
+bool FileJobEngine::begin() {
+    if (taskHandle) {
+        return true;
+    }
+
+    mutex = xSemaphoreCreateMutex();
+    jobQueue = xQueueCreate(FILE_JOB_MAX_JOBS, sizeof(FileJobId));
+    freeBuffers = xQueueCreate(2, sizeof(uint8_t));
+    fullBuffers = xQueueCreate(2, sizeof(Chunk));
+    if (!mutex || !jobQueue || !freeBuffers || !fullBuffers) {
+        LOG_ERROR_TAG("FileJobs", "Failed to create queues or mutex");
+        return false;
+    }
+
+    if (xTaskCreate(writerTask, "FileJobWrite", FILE_JOB_WRITER_STACK_SIZE, this,
+                    FILE_JOB_TASK_PRIORITY, &writerHandle) != pdPASS ||
+        xTaskCreate(jobTask, "FileJobs", FILE_JOB_TASK_STACK_SIZE, this,
+                    FILE_JOB_TASK_PRIORITY, &taskHandle) != pdPASS) {
+        LOG_ERROR_TAG("FileJobs", "Failed to create job tasks");
+        taskHandle = nullptr;
+        return false;
+    }
+
+    LOG_INFO_TAG("FileJobs", "File job engine started");
+    return true;
+}
+
+FileJobId FileJobEngine::submit(const FileJobItem* items, size_t count, fs::FS& source, fs::FS& destination,
+                                FileJobCallback callback, void* context) {
+    if (!jobQueue || count == 0 || count > FILE_JOB_MAX_ITEMS) {
+        return FILE_JOB_INVALID_ID;
+    }
+
+    Job* job = (Job*)ps_malloc(sizeof(Job));
+    if (!job) {
+        LOG_ERROR_TAG("FileJobs", "No memory for a job");
+        return FILE_JOB_INVALID_ID;
+    }
+    memset(job, 0, sizeof(Job));
+    memcpy(job->items, items, count * sizeof(FileJobItem));
+    job->source = &source;
+    job->destination = &destination;
+    job->callback = callback;
+    job->context = context;
+    job->progress.itemCount = count;
+    job->progress.state = FileJobState::QUEUED;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    int slot = freeSlot();
+    if (slot < 0) {
+        xSemaphoreGive(mutex);
+        free(job);
+        LOG_WARN_TAG("FileJobs", "Too many jobs in flight");
+        return FILE_JOB_INVALID_ID;
+    }
+    if (++nextId == FILE_JOB_INVALID_ID) nextId++;
+    job->progress.id = nextId;
+    jobs[slot] = job;
+    xSemaphoreGive(mutex);
+
+    FileJobId id = job->progress.id;
+    if (xQueueSend(jobQueue, &id, 0) != pdTRUE) {
+        // The queue is as long as the job table, so this only happens if the job task is gone
+        xSemaphoreTake(mutex, portMAX_DELAY);
+        jobs[slot] = nullptr;
+        xSemaphoreGive(mutex);
+        free(job);
+        return FILE_JOB_INVALID_ID;
+    }
+    return id;
+}
+
+int FileJobEngine::freeSlot() {
+    int oldest = -1;
+    for (int i = 0; i < FILE_JOB_MAX_JOBS; i++) {
+        if (!jobs[i]) {
+            return i;
+        }
+        FileJobState state = jobs[i]->progress.state;
+        bool finished = state == FileJobState::DONE || state == FileJobState::FAILED || state == FileJobState::CANCELLED;
+        if (finished && (oldest < 0 || jobs[i]->progress.id < jobs[oldest]->progress.id)) {
+            oldest = i;
+        }
+    }
+
+    // Finished jobs nobody released make room for new ones, oldest first
+    if (oldest >= 0) {
+        free(jobs[oldest]);
+        jobs[oldest] = nullptr;
+    }
+    return oldest;
+}
+
+FileJobEngine::Job* FileJobEngine::findJob(FileJobId id) {
+    for (int i = 0; i < FILE_JOB_MAX_JOBS; i++) {
+        if (jobs[i] && jobs[i]->progress.id == id) {
+            return jobs[i];
+        }
+    }
+    return nullptr;
+}
+
+bool FileJobEngine::cancel(FileJobId id) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    Job* job = findJob(id);
+    if (job) {
+        job->cancelRequested = true;
+    }
+    xSemaphoreGive(mutex);
+    return job != nullptr;
+}
+
+bool FileJobEngine::getProgress(FileJobId id, FileJobProgress& out) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    Job* job = findJob(id);
+    if (job) {
+        out = job->progress;
+    }
+    xSemaphoreGive(mutex);
+    return job != nullptr;
+}
+
+void FileJobEngine::release(FileJobId id) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    for (int i = 0; i < FILE_JOB_MAX_JOBS; i++) {
+        if (!jobs[i] || jobs[i]->progress.id != id) {
+            continue;
+        }
+        // Unfinished jobs stay; freeSlot() reclaims them once they are done
+        FileJobState state = jobs[i]->progress.state;
+        if (state == FileJobState::DONE || state == FileJobState::FAILED || state == FileJobState::CANCELLED) {
+            free(jobs[i]);
+            jobs[i] = nullptr;
+        }
+        break;
+    }
+    xSemaphoreGive(mutex);
+}
+
+bool FileJobEngine::isBusy() {
+    bool busy = false;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    for (int i = 0; i < FILE_JOB_MAX_JOBS && !busy; i++) {
+        if (jobs[i]) {
+            FileJobState state = jobs[i]->progress.state;
+            busy = state == FileJobState::QUEUED || state == FileJobState::PLANNING || state == FileJobState::RUNNING;
+        }
+    }
+    xSemaphoreGive(mutex);
+    return busy;
+}
+
+void FileJobEngine::jobTask(void* parameter) {
+    FileJobEngine* engine = static_cast<FileJobEngine*>(parameter);
+    FileJobId id;
+
+    while (true) {
+        if (xQueueReceive(engine->jobQueue, &id, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        xSemaphoreTake(engine->mutex, portMAX_DELAY);
+        Job* job = engine->findJob(id);
+        if (job) {
+            // From here on release() leaves the job alone until it has finished
+            job->progress.state = FileJobState::PLANNING;
+        }
+        xSemaphoreGive(engine->mutex);
+
+        if (job) {
+            engine->runJob(*job);
+        }
+    }
+}
+
+void FileJobEngine::writerTask(void* parameter) {
+    FileJobEngine* engine = static_cast<FileJobEngine*>(parameter);
+    Chunk chunk;
+
+    while (true) {
+        if (xQueueReceive(engine->fullBuffers, &chunk, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        // After a failed write the rest of the file is drained without writing
+        if (!engine->writeFailed &&
+            engine->writeTarget.write(engine->buffers[chunk.buffer], chunk.length) != chunk.length) {
+            engine->writeFailed = true;
+        }
+        xQueueSend(engine->freeBuffers, &chunk.buffer, portMAX_DELAY);
+    }
+}
+
+void FileJobEngine::runJob(Job& job) {
+    uint32_t started = millis();
+    FileJobState result = FileJobState::DONE;
+
+    // The job and writer tasks are not scheduler sources; without this the loop
+    // task would light-sleep mid-copy, possibly in the middle of an SD transfer
+    sched_wake_lock();
+
+    if (job.cancelRequested) {
+        result = FileJobState::CANCELLED;
+    } else if (!plan(job)) {
+        result = job.cancelRequested ? FileJobState::CANCELLED : FileJobState::FAILED;
+    } else if (!allocateBuffers()) {
+        LOG_ERROR_TAG("FileJobs", "No memory for copy buffers");
+        result = FileJobState::FAILED;
+    } else {
+        setState(job, FileJobState::RUNNING);
+        for (uint32_t i = 0; i < job.progress.itemCount; i++) {
+            if (job.cancelRequested) {
+                result = FileJobState::CANCELLED;
+                break;
+            }
+            bool success = runItem(job, job.items[i]);
+            xSemaphoreTake(mutex, portMAX_DELAY);
+            job.progress.itemsDone++;
+            if (!success) job.progress.itemsFailed++;
+            xSemaphoreGive(mutex);
+        }
+        releaseBuffers();
+        if (result == FileJobState::DONE && job.cancelRequested) {
+            result = FileJobState::CANCELLED;
+        } else if (result == FileJobState::DONE && job.progress.itemsFailed > 0) {
+            result = FileJobState::FAILED;
+        }
+    }
+
+    flushDirty(job);
+
+    LOG_INFO_TAG("FileJobs", "Job %u finished (%u), %u of %u items failed, %llu bytes in %u ms",
+                 (unsigned)job.progress.id, (unsigned)result, (unsigned)job.progress.itemsFailed,
+                 (unsigned)job.progress.itemCount, (unsigned long long)job.progress.bytesDone,
+                 (unsigned)(millis() - started));
+
+    // The callback sees the final state before the job becomes releasable; after setState it may be freed
+    if (job.callback) {
+        FileJobProgress progress = job.progress;
+        progress.state = result;
+        job.callback(progress, job.context);
+    }
+    setState(job, result);
+    sched_wake_unlock();
+}
+
+bool FileJobEngine::plan(Job& job) {
+    for (uint32_t i = 0; i < job.progress.itemCount; i++) {
+        FileJobItem& item = job.items[i];
+        item.source[FILE_JOB_PATH_SIZE - 1] = '\0';
+        item.destination[FILE_JOB_PATH_SIZE - 1] = '\0';
+
+        if (isWithin(item.destination, item.source)) {
+            LOG_WARN_TAG("FileJobs", "Cannot copy %s into itself", item.source);
+            return false;
+        }
+
+        // A rename moves everything at once and copies no data
+        if (item.move && job.source == job.destination) {
+            xSemaphoreTake(mutex, portMAX_DELAY);
+            job.progress.fileCount++;
+            xSemaphoreGive(mutex);
+            continue;
+        }
+        if (!planPath(job, item.source, 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FileJobEngine::planPath(Job& job, const char* path, uint8_t depth) {
+    if (job.cancelRequested) {
+        return false;
+    }
+
+    File file = job.source->open(path);
+    if (!file) {
+        LOG_WARN_TAG("FileJobs", "%s does not exist", path);
+        return false;
+    }
+    if (!file.isDirectory()) {
+        xSemaphoreTake(mutex, portMAX_DELAY);
+        job.progress.fileCount++;
+        job.progress.bytesTotal += file.size();
+        xSemaphoreGive(mutex);
+        file.close();
+        return true;
+    }
+    if (depth >= FILE_JOB_MAX_DEPTH) {
+        file.close();
+        LOG_WARN_TAG("FileJobs", "%s is nested too deeply", path);
+        return false;
+    }
+
+    bool success = true;
+    char child[FILE_JOB_PATH_SIZE];
+    while (File entry = file.openNextFile()) {
+        bool joined = joinPath(child, path, baseName(entry.name()));
+        entry.close();
+        if (!joined || !planPath(job, child, depth + 1)) {
+            success = false;
+            break;
+        }
+    }
+    file.close();
+    return success;
+}
+
+bool FileJobEngine::runItem(Job& job, const FileJobItem& item) {
+    if (job.destination->exists(item.destination)) {
+        LOG_WARN_TAG("FileJobs", "%s already exists", item.destination);
+        return false;
+    }
+
+    char parent[FILE_JOB_PATH_SIZE];
+    parentOf(parent, item.destination);
+    markDirty(job, parent);
+
+    if (item.move && job.source == job.destination) {
+        xSemaphoreTake(mutex, portMAX_DELAY);
+        strncpy(job.progress.currentPath, item.source, FILE_JOB_PATH_SIZE - 1);
+        xSemaphoreGive(mutex);
+
+        parentOf(parent, item.source);
+        markDirty(job, parent);
+        markDirty(job, item.source);
+        if (!job.source->rename(item.source, item.destination)) {
+            LOG_WARN_TAG("FileJobs", "Failed to rename %s to %s", item.source, item.destination);
+            return false;
+        }
+        xSemaphoreTake(mutex, portMAX_DELAY);
+        job.progress.filesDone++;
+        xSemaphoreGive(mutex);
+        report(job);
+        return true;
+    }
+
+    if (!copyTree(job, item.source, item.destination, 0)) {
+        return false;
+    }
+    if (item.move) {
+        // Only a complete copy lets the source go
+        parentOf(parent, item.source);
+        markDirty(job, parent);
+        markDirty(job, item.source);
+        if (!removeTree(*job.source, item.source, 0)) {
+            LOG_WARN_TAG("FileJobs", "Copied %s but could not remove it", item.source);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FileJobEngine::copyTree(Job& job, const char* source, const char* destination, uint8_t depth) {
+    File file = job.source->open(source);
+    if (!file) {
+        return false;
+    }
+    if (!file.isDirectory()) {
+        file.close();
+        return copyFile(job, source, destination);
+    }
+
+    if (!job.destination->mkdir(destination)) {
+        file.close();
+        LOG_WARN_TAG("FileJobs", "Failed to create %s", destination);
+        return false;
+    }
+
+    bool success = true;
+    char childSource[FILE_JOB_PATH_SIZE];
+    char childDestination[FILE_JOB_PATH_SIZE];
+    while (File entry = file.openNextFile()) {
+        const char* name = baseName(entry.name());
+        bool joined = joinPath(childSource, source, name) && joinPath(childDestination, destination, name);
+        entry.close();
+        if (!joined || !copyTree(job, childSource, childDestination, depth + 1)) {
+            success = false;
+            break;
+        }
+        if (job.cancelRequested) {
+            success = false;
+            break;
+        }
+    }
+    file.close();
+    return success;
+}
+
+bool FileJobEngine::copyFile(Job& job, const char* source, const char* destination) {
+    char partPath[FILE_JOB_PATH_SIZE];
+    if (snprintf(partPath, sizeof(partPath), "%s" FILE_JOB_PART_SUFFIX, destination) >= (int)sizeof(partPath)) {
+        return false;
+    }
+
+    File input = job.source->open(source, FILE_READ);
+    if (!input) {
+        LOG_WARN_TAG("FileJobs", "Failed to open %s", source);
+        return false;
+    }
+    uint32_t expected = input.size();
+
+    writeTarget = job.destination->open(partPath, FILE_WRITE);
+    if (!writeTarget) {
+        input.close();
+        LOG_WARN_TAG("FileJobs", "Failed to create %s", partPath);
+        return false;
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    strncpy(job.progress.currentPath, source, FILE_JOB_PATH_SIZE - 1);
+    xSemaphoreGive(mutex);
+
+    // Each read goes into whichever buffer the writer handed back; the other may still be on its way out
+    writeFailed = false;
+    uint32_t copied = 0;
+    bool stopped = false;
+    while (!writeFailed) {
+        if (job.cancelRequested) {
+            stopped = true;
+            break;
+        }
+        uint8_t index;
+        xQueueReceive(freeBuffers, &index, portMAX_DELAY);
+        size_t length = input.read(buffers[index], FILE_JOB_BUFFER_SIZE);
+        if (length == 0) {
+            xQueueSend(freeBuffers, &index, portMAX_DELAY);
+            break;
+        }
+        Chunk chunk = {index, (uint32_t)length};
+        xQueueSend(fullBuffers, &chunk, portMAX_DELAY);
+        copied += length;
+
+        xSemaphoreTake(mutex, portMAX_DELAY);
+        job.progress.bytesDone += length;
+        xSemaphoreGive(mutex);
+        report(job);
+    }
+
+    // Wait for the writer to hand both buffers back before touching the file
+    uint8_t index;
+    xQueueReceive(freeBuffers, &index, portMAX_DELAY);
+    xQueueReceive(freeBuffers, &index, portMAX_DELAY);
+    for (uint8_t i = 0; i < 2; i++) {
+        xQueueSend(freeBuffers, &i, portMAX_DELAY);
+    }
+
+    input.close();
+    writeTarget.close();
+
+    bool success = !stopped && !writeFailed && copied == expected;
+    if (success && !job.destination->rename(partPath, destination)) {
+        success = false;
+    }
+    if (!success) {
+        job.destination->remove(partPath);
+        if (!stopped) {
+            LOG_WARN_TAG("FileJobs", "Failed to copy %s (%u of %u bytes)", source, (unsigned)copied, (unsigned)expected);
+        }
+        return false;
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    job.progress.filesDone++;
+    xSemaphoreGive(mutex);
+    return true;
+}
+
+bool FileJobEngine::removeTree(fs::FS& fs, const char* path, uint8_t depth) {
+    File file = fs.open(path);
+    if (!file) {
+        return false;
+    }
+    if (!file.isDirectory()) {
+        file.close();
+        return fs.remove(path);
+    }
+    if (depth >= FILE_JOB_MAX_DEPTH) {
+        file.close();
+        return false;
+    }
+
+    bool success = true;
+    char child[FILE_JOB_PATH_SIZE];
+    while (File entry = file.openNextFile()) {
+        bool joined = joinPath(child, path, baseName(entry.name()));
+        entry.close();
+        if (!joined || !removeTree(fs, child, depth + 1)) {
+            success = false;
+            break;
+        }
+    }
+    file.close();
+    return success && fs.rmdir(path);
+}
+
+bool FileJobEngine::allocateBuffers() {
+    // Held only while a job runs; PSRAM first, the copy is bound by the card anyway
+    for (uint8_t i = 0; i < 2; i++) {
+        buffers[i] = (uint8_t*)ps_malloc(FILE_JOB_BUFFER_SIZE);
+        if (!buffers[i]) {
+            buffers[i] = (uint8_t*)malloc(FILE_JOB_BUFFER_SIZE);
+        }
+        if (!buffers[i]) {
+            releaseBuffers();
+            return false;
+        }
+    }
+
+    xQueueReset(freeBuffers);
+    xQueueReset(fullBuffers);
+    for (uint8_t i = 0; i < 2; i++) {
+        xQueueSend(freeBuffers, &i, 0);
+    }
+    return true;
+}
+
+void FileJobEngine::releaseBuffers() {
+    for (uint8_t i = 0; i < 2; i++) {
+        free(buffers[i]);
+        buffers[i] = nullptr;
+    }
+}
+
+void FileJobEngine::setState(Job& job, FileJobState state) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    job.progress.state = state;
+    xSemaphoreGive(mutex);
+}
+
+void FileJobEngine::report(Job& job) {
+    if (!job.callback) {
+        return;
+    }
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    FileJobProgress progress = job.progress;
+    xSemaphoreGive(mutex);
+    if (!job.callback(progress, job.context)) {
+        job.cancelRequested = true;
+    }
+}
+
+void FileJobEngine::markDirty(Job& job, const char* path) {
+    for (uint8_t i = 0; i < job.dirtyCount; i++) {
+        if (strcmp(job.dirty[i], path) == 0) {
+            return;
+        }
+    }
+    if (job.dirtyCount == FILE_JOB_MAX_DIRTY) {
+        job.dirtyOverflow = true;
+        return;
+    }
+    strncpy(job.dirty[job.dirtyCount], path, FILE_JOB_PATH_SIZE - 1);
+    job.dirtyCount++;
+}
+
+void FileJobEngine::flushDirty(Job& job) {
+    // Only the file system the indexer reads has cached listings to drop
+    FileIndexer& indexer = FileIndexer::getInstance();
+    fs::FS* indexed = indexer.getFileSystem();
+    if (!indexed || (indexed != job.source && indexed != job.destination) || job.dirtyCount == 0) {
+        return;
+    }
+
+    // The indexer's queue is short; its worker drains it while this task waits
+    for (uint8_t i = 0; i < job.dirtyCount; i++) {
+        indexer.invalidate(job.dirty[i], portMAX_DELAY);
+    }
+    if (job.dirtyOverflow) {
+        LOG_WARN_TAG("FileJobs", "Job %u touched more than %u directories", (unsigned)job.progress.id, FILE_JOB_MAX_DIRTY);
+        indexer.invalidate(indexer.getPath(), portMAX_DELAY);
+    }
+}
@@ -0,0 +1,183 @@
+#ifndef FILE_JOBS_H
+#define FILE_JOBS_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#ifndef FILE_JOB_BUFFER_SIZE
+#define FILE_JOB_BUFFER_SIZE 32768      // Per buffer; two are in flight while copying
+#endif
+
+#define FILE_JOB_PATH_SIZE 128
+#define FILE_JOB_MAX_ITEMS 32           // Sources per job
+#define FILE_JOB_MAX_JOBS 4             // Queued, running and finished jobs kept for polling
+#define FILE_JOB_MAX_DEPTH 8            // Directory nesting copied recursively
+#define FILE_JOB_MAX_DIRTY 16           // Directories invalidated individually after a job
+#define FILE_JOB_TASK_STACK_SIZE 6144
+#define FILE_JOB_WRITER_STACK_SIZE 3072
+#define FILE_JOB_TASK_PRIORITY 1
+#define FILE_JOB_PART_SUFFIX ".part"    // Files are written under this name and renamed when complete
+
+typedef uint32_t FileJobId;
+#define FILE_JOB_INVALID_ID 0
+
+enum class FileJobState : uint8_t {
+    QUEUED,
+    PLANNING,                           // Walking the sources to total up the work
+    RUNNING,
+    DONE,
+    FAILED,
+    CANCELLED
+};
+
+/**
+ * @brief Snapshot of a job's progress
+ */
+struct FileJobProgress {
+    FileJobId id;
+    FileJobState state;
+    uint32_t itemsDone;                 // Sources finished, including failed ones
+    uint32_t itemsFailed;
+    uint32_t itemCount;
+    uint32_t filesDone;                 // Files copied or moved, counting directory contents
+    uint32_t fileCount;
+    uint64_t bytesDone;
+    uint64_t bytesTotal;                // Bytes that have to be copied; renamed files count as none
+    char currentPath[FILE_JOB_PATH_SIZE];
+};
+
+// Called on the job task after every chunk and once the job ends; return false to cancel
+typedef bool (*FileJobCallback)(const FileJobProgress& progress, void* context);
+
+/**
+ * @brief One source to copy or move
+ */
+struct FileJobItem {
+    char source[FILE_JOB_PATH_SIZE];
+    char destination[FILE_JOB_PATH_SIZE];   // Full target path, not its directory
+    bool move;
+};
+
+/**
+ * @brief Background copy and move engine
+ *
+ * Jobs run one at a time on a worker task so the UI stays live for the
+ * length of a large transfer. File data is copied in FILE_JOB_BUFFER_SIZE
+ * chunks through two buffers: the job task reads the next chunk while a
+ * writer task writes the previous one. Moves within one file system are
+ * a rename and copy no data; otherwise the source is deleted only after
+ * its copy completed.
+ *
+ * A file is written under FILE_JOB_PART_SUFFIX and renamed into place at
+ * the end, so a cancelled or failed job never leaves a truncated file
+ * under the real name. The directories a job changed are passed to the
+ * FileIndexer once, when the job ends, rather than after every file.
+ */
+class FileJobEngine {
+public:
+    static FileJobEngine& getInstance();
+
+    /**
+     * @brief Start the job and writer tasks
+     * @return true if successful, false otherwise
+     */
+    bool begin();
+
+    /**
+     * @brief Queue a job
+     * @param items Sources and their targets, copied into the job
+     * @param source File system the sources are on
+     * @param destination File system the targets go to; moves between two
+     *        different file systems copy and delete
+     * @param callback Optional, runs on the job task
+     * @return Job id, or FILE_JOB_INVALID_ID if the job could not be queued
+     */
+    FileJobId submit(const FileJobItem* items, size_t count, fs::FS& source, fs::FS& destination,
+                     FileJobCallback callback = nullptr, void* context = nullptr);
+
+    /**
+     * @brief Stop a queued or running job after the current chunk
+     */
+    bool cancel(FileJobId id);
+
+    /**
+     * @brief Copy a job's progress
+     * @return false if the job is unknown or was released
+     */
+    bool getProgress(FileJobId id, FileJobProgress& out);
+
+    /**
+     * @brief Forget a job once it has finished
+     *
+     * A job that is still queued or running keeps going; a later submit
+     * reclaims its slot once it has finished.
+     */
+    void release(FileJobId id);
+
+    // True while any job is queued or running
+    bool isBusy();
+
+private:
+    struct Job {
+        FileJobProgress progress;
+        FileJobItem items[FILE_JOB_MAX_ITEMS];
+        fs::FS* source;
+        fs::FS* destination;
+        FileJobCallback callback;
+        void* context;
+        volatile bool cancelRequested;
+        char dirty[FILE_JOB_MAX_DIRTY][FILE_JOB_PATH_SIZE];
+        uint8_t dirtyCount;
+        bool dirtyOverflow;
+    };
+
+    // A filled buffer on its way to the writer
+    struct Chunk {
+        uint8_t buffer;
+        uint32_t length;
+    };
+
+    FileJobEngine();
+
+    TaskHandle_t taskHandle;
+    TaskHandle_t writerHandle;
+    QueueHandle_t jobQueue;
+    QueueHandle_t freeBuffers;
+    QueueHandle_t fullBuffers;
+    SemaphoreHandle_t mutex;
+
+    Job* jobs[FILE_JOB_MAX_JOBS];
+    FileJobId nextId;
+
+    uint8_t* buffers[2];
+    File writeTarget;
+    volatile bool writeFailed;
+
+    static void jobTask(void* parameter);
+    static void writerTask(void* parameter);
+    void runJob(Job& job);
+
+    bool plan(Job& job);
+    bool planPath(Job& job, const char* path, uint8_t depth);
+    bool runItem(Job& job, const FileJobItem& item);
+    bool copyTree(Job& job, const char* source, const char* destination, uint8_t depth);
+    bool copyFile(Job& job, const char* source, const char* destination);
+    bool removeTree(fs::FS& fs, const char* path, uint8_t depth);
+
+    bool allocateBuffers();
+    void releaseBuffers();
+
+    void setState(Job& job, FileJobState state);
+    void report(Job& job);
+    void markDirty(Job& job, const char* path);
+    void flushDirty(Job& job);
+
+    Job* findJob(FileJobId id);
+    int freeSlot();
+};
+
+#endif // FILE_JOBS_H
@@ -0,0 +1,359 @@
+#include "file_manager_app.h"
+#include "../core/utils/logger.h"
+#include <SD.h>
+#include <string.h>
+#include <strings.h>
+
+// Directory listing. Scanning, sorting and filtering are done by the
+// background FileIndexer; the app only keeps the current query.
+
+namespace {
+
+struct ExtensionType {
+    const char* extension;
+    FileManagerApp::FileType type;
+};
+
+const ExtensionType EXTENSION_TYPES[] = {
+    {"txt", FileManagerApp::FileType::TEXT_FILE},
+    {"md", FileManagerApp::FileType::TEXT_FILE},
+    {"csv", FileManagerApp::FileType::TEXT_FILE},
+    {"log", FileManagerApp::FileType::LOG_FILE},
+    {"json", FileManagerApp::FileType::CONFIG_FILE},
+    {"ini", FileManagerApp::FileType::CONFIG_FILE},
+    {"cfg", FileManagerApp::FileType::CONFIG_FILE},
+    {"conf", FileManagerApp::FileType::CONFIG_FILE},
+    {"yaml", FileManagerApp::FileType::CONFIG_FILE},
+    {"yml", FileManagerApp::FileType::CONFIG_FILE},
+    {"xml", FileManagerApp::FileType::CONFIG_FILE},
+    {"jpg", FileManagerApp::FileType::IMAGE_FILE},
+    {"jpeg", FileManagerApp::FileType::IMAGE_FILE},
+    {"png", FileManagerApp::FileType::IMAGE_FILE},
+    {"bmp", FileManagerApp::FileType::IMAGE_FILE},
+    {"gif", FileManagerApp::FileType::IMAGE_FILE},
+    {"mp3", FileManagerApp::FileType::AUDIO_FILE},
+    {"wav", FileManagerApp::FileType::AUDIO_FILE},
+    {"ogg", FileManagerApp::FileType::AUDIO_FILE},
+    {"flac", FileManagerApp::FileType::AUDIO_FILE},
+    {"mp4", FileManagerApp::FileType::VIDEO_FILE},
+    {"avi", FileManagerApp::FileType::VIDEO_FILE},
+    {"mkv", FileManagerApp::FileType::VIDEO_FILE},
+    {"zip", FileManagerApp::FileType::ARCHIVE_FILE},
+    {"tar", FileManagerApp::FileType::ARCHIVE_FILE},
+    {"gz", FileManagerApp::FileType::ARCHIVE_FILE},
+    {"7z", FileManagerApp::FileType::ARCHIVE_FILE},
+    {"bin", FileManagerApp::FileType::EXECUTABLE_FILE},
+    {"elf", FileManagerApp::FileType::EXECUTABLE_FILE},
+};
+
+} // namespace
+
+uint8_t FileManagerApp::classifyEntry(const char* name, bool isDirectory) {
+    if (isDirectory) {
+        return (uint8_t)FileType::DIRECTORY;
+    }
+
+    const char* dot = strrchr(name, '.');
+    if (!dot || dot == name) {
+        return (uint8_t)FileType::UNKNOWN;
+    }
+    for (const ExtensionType& entry : EXTENSION_TYPES) {
+        if (strcasecmp(dot + 1, entry.extension) == 0) {
+            return (uint8_t)entry.type;
+        }
+    }
+    return (uint8_t)FileType::UNKNOWN;
+}
+
+FileManagerApp::FileType FileManagerApp::detectFileType(const String& filename) {
+    return (FileType)classifyEntry(filename.c_str(), false);
+}
+
+bool FileManagerApp::navigateToDirectory(const String& path) {
+    FileIndexer& indexer = FileIndexer::getInstance();
+    if (!indexer.begin(SD, classifyEntry)) {
+        return false;
+    }
+
+    // Returns at once; updateUI picks up entries as the indexer publishes them
+    if (!indexer.open(path)) {
+        return false;
+    }
+    if (path != currentPath) {
+        addToHistory(path);
+    }
+    currentPath = path;
+    indexGeneration = 0;
+    return true;
+}
+
+bool FileManagerApp::refreshCurrentDirectory() {
+    return FileIndexer::getInstance().open(currentPath, true);
+}
+
+FileIndexQuery FileManagerApp::buildQuery() const {
+    FileIndexQuery query = {};
+    query.sortMode = (uint8_t)currentSortMode;
+    query.showHidden = showHidden;
+    strncpy(query.filter, currentFilter.c_str(), FILE_INDEX_FILTER_SIZE - 1);
+    return query;
+}
+
+uint32_t FileManagerApp::getFileCount() {
+    return FileIndexer::getInstance().getCount(buildQuery());
+}
+
+size_t FileManagerApp::getFiles(uint32_t offset, FileIndexItem* out, size_t maxCount) {
+    return FileIndexer::getInstance().getPage(buildQuery(), offset, out, maxCount);
+}
+
+FileManagerApp::DirectoryInfo FileManagerApp::getCurrentDirectoryInfo() {
+    FileIndexer::Summary summary = FileIndexer::getInstance().getSummary();
+
+    DirectoryInfo info;
+    info.path = currentPath;
+    info.totalSize = summary.totalSize;
+    info.dirCount = summary.directories;
+    info.fileCount = summary.entries - summary.directories;
+    info.complete = summary.state == FileIndexer::State::READY;
+    return info;
+}
+
+void FileManagerApp::setSortMode(SortMode mode) {
+    // Every order is precomputed by the indexer, so this only changes which one is read
+    currentSortMode = mode;
+    indexGeneration = 0;
+}
+
+void FileManagerApp::toggleShowHidden() {
+    showHidden = !showHidden;
+    indexGeneration = 0;
+}
+
+void FileManagerApp::setFilter(const String& filter) {
+    currentFilter = filter;
+    indexGeneration = 0;
+}
+
+// Copy and move. The FileJobEngine does the work on its own task and tells the
+// indexer which directories changed once the job is done.
+
+bool FileManagerApp::submitTransfer(const FileJobItem* items, size_t count) {
+    FileJobEngine& engine = FileJobEngine::getInstance();
+    if (!engine.begin()) {
+        return false;
+    }
+
+    FileJobId id = engine.submit(items, count, SD, SD);
+    if (id == FILE_JOB_INVALID_ID) {
+        return false;
+    }
+
+    // Only the newest transfer is shown; an older one keeps running and is reclaimed once finished
+    if (transferJob != FILE_JOB_INVALID_ID) {
+        settleCuts(false);
+        engine.release(transferJob);
+    }
+    transferJob = id;
+    return true;
+}
+
+bool FileManagerApp::copyFile(const String& sourcePath, const String& destPath) {
+    FileJobItem item = {};
+    strncpy(item.source, sourcePath.c_str(), FILE_JOB_PATH_SIZE - 1);
+    strncpy(item.destination, destPath.c_str(), FILE_JOB_PATH_SIZE - 1);
+    item.move = false;
+    return submitTransfer(&item, 1);
+}
+
+bool FileManagerApp::moveFile(const String& sourcePath, const String& destPath) {
+    FileJobItem item = {};
+    strncpy(item.source, sourcePath.c_str(), FILE_JOB_PATH_SIZE - 1);
+    strncpy(item.destination, destPath.c_str(), FILE_JOB_PATH_SIZE - 1);
+    item.move = true;
+    return submitTransfer(&item, 1);
+}
+
+bool FileManagerApp::validateClipboardOperation(const String& destPath) {
+    for (const ClipboardItem& item : clipboard) {
+        // Pasting a directory into itself or its own subtree never ends
+        if (destPath == item.sourcePath || destPath.startsWith(item.sourcePath + "/")) {
+            LOG_WARN_TAG("FileManager", "Cannot paste %s into itself", item.sourcePath.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FileManagerApp::pasteFromClipboard() {
+    if (clipboard.empty() || !validateClipboardOperation(currentPath)) {
+        return false;
+    }
+    if (clipboard.size() > FILE_JOB_MAX_ITEMS) {
+        LOG_WARN_TAG("FileManager", "Clipboard holds %u items, pasting the first %u",
+                     (unsigned)clipboard.size(), FILE_JOB_MAX_ITEMS);
+    }
+
+    // One job for the whole clipboard, so the indexer is told about each directory once.
+    // The items are staged in the app arena; 32 of them would not fit on the UI task's stack.
+    size_t limit = clipboard.size() < FILE_JOB_MAX_ITEMS ? clipboard.size() : FILE_JOB_MAX_ITEMS;
+    FileJobItem* items = (FileJobItem*)allocateMemory(limit * sizeof(FileJobItem));
+    if (!items) {
+        return false;
+    }
+
+    size_t count = 0;
+    for (const ClipboardItem& entry : clipboard) {
+        if (count == limit) {
+            break;
+        }
+        const char* name = strrchr(entry.sourcePath.c_str(), '/');
+        name = name ? name + 1 : entry.sourcePath.c_str();
+        String destination = currentPath.endsWith("/") ? currentPath + name : currentPath + "/" + name;
+
+        FileJobItem& item = items[count++];
+        memset(&item, 0, sizeof(item));
+        strncpy(item.source, entry.sourcePath.c_str(), FILE_JOB_PATH_SIZE - 1);
+        strncpy(item.destination, destination.c_str(), FILE_JOB_PATH_SIZE - 1);
+        item.move = entry.isCut;
+    }
+
+    // submit() copies the items into the job
+    bool submitted = submitTransfer(items, count);
+    freeMemory(items);
+    if (!submitted) {
+        return false;
+    }
+
+    // A cut is consumed once its move has happened, see settleCuts(); copies stay for pasting again
+    for (size_t i = 0; i < count; i++) {
+        if (clipboard[i].isCut) {
+            pendingCuts.push_back(clipboard[i].sourcePath);
+        }
+    }
+    return true;
+}
+
+void FileManagerApp::settleCuts(bool moved) {
+    // A failed or cancelled job may still have moved some sources; only those leave the clipboard
+    for (const String& source : pendingCuts) {
+        if (!moved && SD.exists(source)) {
+            continue;
+        }
+        for (size_t i = 0; i < clipboard.size(); i++) {
+            if (clipboard[i].isCut && clipboard[i].sourcePath == source) {
+                clipboard.erase(clipboard.begin() + i);
+                break;
+            }
+        }
+    }
+    pendingCuts.clear();
+}
+
+bool FileManagerApp::getTransferProgress(FileJobProgress& out) {
+    if (transferJob == FILE_JOB_INVALID_ID) {
+        return false;
+    }
+    if (!FileJobEngine::getInstance().getProgress(transferJob, out)) {
+        return false;
+    }
+
+    // DONE, FAILED and CANCELLED are final
+    if (out.state >= FileJobState::DONE && !pendingCuts.empty()) {
+        settleCuts(out.state == FileJobState::DONE);
+    }
+    return true;
+}
+
+bool FileManagerApp::cancelTransfer() {
+    if (transferJob == FILE_JOB_INVALID_ID) {
+        return false;
+    }
+    return FileJobEngine::getInstance().cancel(transferJob);
+}
+
+void FileManagerApp::destroyUI() {
+    // Deleting the container takes every widget with it
+    AppBase::destroyUI();
+    toolbarPanel = pathPanel = contentPanel = statusPanel = sidePanel = nullptr;
+    backButton = upButton = homeButton = refreshButton = nullptr;
+    newFolderButton = deleteButton = copyButton = cutButton = pasteButton = nullptr;
+    viewModeButton = sortButton = nullptr;
+    pathLabel = pathInput = breadcrumbContainer = nullptr;
+    fileList = fileGrid = detailsTable = scrollContainer = nullptr;
+    statusLabel = selectionLabel = progressBar = nullptr;
+    bookmarksList = recentList = propertiesPanel = nullptr;
+}
+
+// Hibernation. The directory listing is rebuilt from the indexer's on-card
+// cache, and a running transfer keeps going in the job engine; only where the
+// user was and what is on the clipboard needs saving.
+
+bool FileManagerApp::saveState(JsonObject state) {
+    state["path"] = currentPath;
+    state["filter"] = currentFilter;
+    state["view"] = (int)currentViewMode;
+    state["sort"] = (int)currentSortMode;
+    state["hidden"] = showHidden;
+    state["transfer"] = transferJob;
+
+    JsonArray cuts = state.createNestedArray("pendingCuts");
+    for (const String& source : pendingCuts) {
+        cuts.add(source);
+    }
+
+    JsonArray history = state.createNestedArray("history");
+    for (const String& path : navigationHistory) {
+        history.add(path);
+    }
+    state["historyIndex"] = historyIndex;
+
+    JsonArray items = state.createNestedArray("clipboard");
+    for (const ClipboardItem& entry : clipboard) {
+        JsonObject item = items.createNestedObject();
+        item["path"] = entry.sourcePath;
+        item["cut"] = entry.isCut;
+        item["time"] = entry.timestamp;
+    }
+    return true;
+}
+
+bool FileManagerApp::restoreState(JsonObjectConst state) {
+    const char* path = state["path"] | "";
+    if (!path[0]) {
+        return false;
+    }
+
+    currentFilter = state["filter"] | "";
+    currentViewMode = (ViewMode)(state["view"] | (int)currentViewMode);
+    currentSortMode = (SortMode)(state["sort"] | (int)currentSortMode);
+    showHidden = state["hidden"] | showHidden;
+    transferJob = state["transfer"] | (FileJobId)FILE_JOB_INVALID_ID;
+
+    pendingCuts.clear();
+    for (JsonVariantConst source : state["pendingCuts"].as<JsonArrayConst>()) {
+        pendingCuts.push_back(source.as<const char*>());
+    }
+
+    navigationHistory.clear();
+    for (JsonVariantConst entry : state["history"].as<JsonArrayConst>()) {
+        navigationHistory.push_back(entry.as<const char*>());
+    }
+    historyIndex = state["historyIndex"] | -1;
+    if (historyIndex >= (int32_t)navigationHistory.size()) {
+        historyIndex = (int32_t)navigationHistory.size() - 1;
+    }
+
+    clipboard.clear();
+    for (JsonObjectConst item : state["clipboard"].as<JsonArrayConst>()) {
+        ClipboardItem entry;
+        entry.sourcePath = item["path"] | "";
+        entry.isCut = item["cut"] | false;
+        entry.timestamp = item["time"] | 0u;
+        clipboard.push_back(entry);
+    }
+
+    // Already in the restored history; reopening it must not add it again
+    currentPath = path;
+    return navigateToDirectory(currentPath);
+}
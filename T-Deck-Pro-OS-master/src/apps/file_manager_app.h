@@ -2,6 +2,8 @@
 #define FILE_MANAGER_APP_H
 
 #include "../core/apps/app_base.h"
+#include "file_index.h"
+#include "file_jobs.h"
 #include <vector>
 #include <functional>
 
@@ -54,12 +56,13 @@ public:
         bool isSelected;
     };
 
+    // Totals for the current directory; the entries themselves are paged from the index
     struct DirectoryInfo {
         String path;
-        std::vector<FileInfo> files;
         size_t totalSize;
         uint32_t fileCount;
         uint32_t dirCount;
+        bool complete;          // Index finished; totals are final
     };
 
     struct ClipboardItem {
@@ -86,6 +89,11 @@ public:
     // UI management
     lv_obj_t* createUI(lv_obj_t* parent) override;
     void updateUI() override;
+    void destroyUI() override;
+
+    // Hibernation
+    bool saveState(JsonObject state) override;
+    bool restoreState(JsonObjectConst state) override;
 
     // Static app info
     static AppInfo getAppInfo();
@@ -102,6 +110,7 @@ public:
     bool deleteFile(const String& path);
     bool deleteDirectory(const String& path);
     bool renameFile(const String& oldPath, const String& newName);
+    // Copies and moves are queued on the FileJobEngine and return once queued
     bool copyFile(const String& sourcePath, const String& destPath);
     bool moveFile(const String& sourcePath, const String& destPath);
 
@@ -112,6 +121,10 @@ public:
     void clearClipboard();
     bool hasClipboardContent() const;
 
+    // The last paste, copy or move; updateUI polls it for the progress bar
+    bool getTransferProgress(FileJobProgress& out);
+    bool cancelTransfer();
+
     // Selection operations
     void selectFile(const String& path);
     void deselectFile(const String& path);
@@ -129,6 +142,10 @@ public:
     // File information
     FileInfo getFileInfo(const String& path);
     DirectoryInfo getCurrentDirectoryInfo();
+
+    // Entries of the current directory in the current sort, filter and hidden-file setting
+    uint32_t getFileCount();
+    size_t getFiles(uint32_t offset, FileIndexItem* out, size_t maxCount);
     size_t getDirectorySize(const String& path);
     bool fileExists(const String& path);
     bool isDirectory(const String& path);
@@ -140,7 +157,6 @@ public:
 
 private:
     // UI components
-    lv_obj_t* mainContainer;
     lv_obj_t* toolbarPanel;
     lv_obj_t* pathPanel;
     lv_obj_t* contentPanel;
@@ -183,10 +199,12 @@ private:
 
     // Data
     String currentPath;
-    DirectoryInfo currentDirectory;
+    uint32_t indexGeneration;               // Last index generation the UI showed
     std::vector<String> navigationHistory;
     int32_t historyIndex;
     std::vector<ClipboardItem> clipboard;
+    FileJobId transferJob;
+    std::vector<String> pendingCuts;        // Cut sources in transferJob, kept on the clipboard until moved
     ViewMode currentViewMode;
     SortMode currentSortMode;
     String currentFilter;
@@ -238,10 +256,9 @@ private:
     static void onSortModeChanged(lv_event_t* e);
 
     // File operations helpers
-    bool scanDirectory(const String& path, DirectoryInfo& dirInfo);
-    void sortFiles(std::vector<FileInfo>& files, SortMode mode);
-    void filterFiles(std::vector<FileInfo>& files, const String& filter);
+    FileIndexQuery buildQuery() const;
     FileType detectFileType(const String& filename);
+    static uint8_t classifyEntry(const char* name, bool isDirectory);
     String getFileIcon(FileType type);
     String formatFileSize(size_t size);
     String formatTimestamp(uint32_t timestamp);
@@ -256,6 +273,8 @@ private:
     // Clipboard helpers
     void cleanupClipboard();
     bool validateClipboardOperation(const String& destPath);
+    bool submitTransfer(const FileJobItem* items, size_t count);
+    void settleCuts(bool moved);
 
     // Bookmark helpers
     void addBookmark(const String& path);
@@ -0,0 +1,300 @@
+#include "mesh_message_store.h"
+#include "../core/utils/logger.h"
+#include <stddef.h>
+#include <string.h>
+
+#define STORE_MAGIC 0x4753534D  // "MSSG"
+#define STORE_VERSION 1
+#define NO_CHANNEL 0xFF
+
+MeshMessageStore::MeshMessageStore(const String& path)
+    : path(path), header{}, ready(false), firstSeq(0), channelIndex{}, channelCounts{},
+      pending{}, pendingCount(0), acks{}, ackNext(0), overwrittenCount(0), revision(0) {
+}
+
+bool MeshMessageStore::begin() {
+    bool valid = false;
+
+    if (SPIFFS.exists(path)) {
+        File file = SPIFFS.open(path, "r");
+        if (file && file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) == sizeof(header)) {
+            uint32_t written = header.nextSeq < MESH_MESSAGE_CAPACITY ? header.nextSeq : MESH_MESSAGE_CAPACITY;
+            valid = header.magic == STORE_MAGIC && header.version == STORE_VERSION &&
+                    header.recordSize == sizeof(MeshMessage) &&
+                    header.capacity == MESH_MESSAGE_CAPACITY &&
+                    header.nextSeq - header.firstSeq <= MESH_MESSAGE_CAPACITY &&
+                    file.size() >= recordOffset(written) &&
+                    file.read(channelIndex, sizeof(channelIndex)) == sizeof(channelIndex);
+        }
+        file.close();
+
+        if (!valid) {
+            LOG_WARN_TAG("MeshMessageStore", "Store %s has an unexpected layout, recreating", path.c_str());
+            SPIFFS.remove(path);
+        }
+    }
+
+    if (!valid && !createFile()) {
+        LOG_ERROR_TAG("MeshMessageStore", "Failed to create store %s", path.c_str());
+        return false;
+    }
+
+    firstSeq = header.firstSeq;
+    pendingCount = 0;
+    rebuildCounts();
+    ready = true;
+
+    LOG_INFO_TAG("MeshMessageStore", "Message store ready: %u messages", (unsigned)size());
+    return true;
+}
+
+bool MeshMessageStore::createFile() {
+    header = Header{};
+    header.magic = STORE_MAGIC;
+    header.version = STORE_VERSION;
+    header.recordSize = sizeof(MeshMessage);
+    header.capacity = MESH_MESSAGE_CAPACITY;
+    memset(channelIndex, NO_CHANNEL, sizeof(channelIndex));
+
+    // Records are appended as slots fill, so only the header and index exist up front
+    File file = SPIFFS.open(path, "w");
+    if (!file) {
+        return false;
+    }
+    bool success = file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header) &&
+                   file.write(channelIndex, sizeof(channelIndex)) == sizeof(channelIndex);
+    file.close();
+    return success;
+}
+
+bool MeshMessageStore::writeHeader(File& file) {
+    return file.seek(0) &&
+           file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header);
+}
+
+bool MeshMessageStore::writeRun(File& file, uint32_t slot, const MeshMessage* messages, uint32_t count) {
+    return file.seek(recordOffset(slot)) &&
+           file.write(reinterpret_cast<const uint8_t*>(messages), count * sizeof(MeshMessage)) == count * sizeof(MeshMessage) &&
+           file.seek(indexOffset() + slot) &&
+           file.write(channelIndex + slot, count) == count;
+}
+
+void MeshMessageStore::rebuildCounts() {
+    memset(channelCounts, 0, sizeof(channelCounts));
+    for (uint32_t seq = firstSeq; seq != nextSeq(); seq++) {
+        uint8_t channel = channelOf(seq);
+        if (channel < MESH_CHANNEL_COUNT) {
+            channelCounts[channel]++;
+        }
+    }
+}
+
+uint8_t MeshMessageStore::channelOf(uint32_t seq) const {
+    if (seq >= header.nextSeq) {
+        return pending[seq - header.nextSeq].channel;
+    }
+    return channelIndex[seq % MESH_MESSAGE_CAPACITY];
+}
+
+void MeshMessageStore::dropOldest() {
+    uint8_t channel = channelOf(firstSeq);
+    if (channel < MESH_CHANNEL_COUNT && channelCounts[channel] > 0) {
+        channelCounts[channel]--;
+    }
+    firstSeq++;
+    overwrittenCount++;
+}
+
+bool MeshMessageStore::append(const MeshMessage& message) {
+    if (!ready) {
+        return false;
+    }
+
+    if (pendingCount == MESH_MESSAGE_RAM_SLOTS && !flush()) {
+        return false;
+    }
+
+    // Full: the oldest message gives way; its slot is reused when the buffer is written out
+    if (size() == MESH_MESSAGE_CAPACITY) {
+        dropOldest();
+    }
+
+    uint32_t seq = nextSeq();
+    MeshMessage& stored = pending[pendingCount++];
+    stored = message;
+    stored.text[MESH_MESSAGE_TEXT_SIZE - 1] = '\0';
+    if (stored.channel >= MESH_CHANNEL_COUNT) {
+        stored.channel = 0;
+    }
+    channelCounts[stored.channel]++;
+    revision++;
+
+    if (!stored.isDelivered && stored.messageId != 0) {
+        acks[ackNext] = {stored.messageId, seq};
+        ackNext = (ackNext + 1) % MESH_MESSAGE_ACK_SLOTS;
+    }
+    return true;
+}
+
+bool MeshMessageStore::flush() {
+    if (!ready) {
+        return false;
+    }
+    if (pendingCount == 0) {
+        return true;
+    }
+
+    uint32_t slot = header.nextSeq % MESH_MESSAGE_CAPACITY;
+    for (uint8_t i = 0; i < pendingCount; i++) {
+        channelIndex[(slot + i) % MESH_MESSAGE_CAPACITY] = pending[i].channel;
+    }
+
+    File file = SPIFFS.open(path, "r+");
+    if (!file) {
+        LOG_ERROR_TAG("MeshMessageStore", "Failed to open store for writing");
+        return false;
+    }
+
+    // The buffered messages have consecutive slots, split in two at most where the ring wraps
+    uint32_t firstRun = MESH_MESSAGE_CAPACITY - slot;
+    if (firstRun > pendingCount) {
+        firstRun = pendingCount;
+    }
+    bool success = writeRun(file, slot, pending, firstRun) &&
+                   (firstRun == pendingCount || writeRun(file, 0, pending + firstRun, pendingCount - firstRun));
+    if (success) {
+        header.nextSeq += pendingCount;
+        header.firstSeq = firstSeq;
+        pendingCount = 0;
+        success = writeHeader(file);
+    }
+    file.close();
+
+    if (!success) {
+        LOG_ERROR_TAG("MeshMessageStore", "Failed to write messages at slot %u", (unsigned)slot);
+    }
+    return success;
+}
+
+bool MeshMessageStore::readMessage(File& file, uint32_t seq, MeshMessage& message) {
+    if (seq >= header.nextSeq) {
+        message = pending[seq - header.nextSeq];
+        return true;
+    }
+
+    if (!file) {
+        file = SPIFFS.open(path, "r");
+    }
+    return file && file.seek(recordOffset(seq % MESH_MESSAGE_CAPACITY)) &&
+           file.read(reinterpret_cast<uint8_t*>(&message), sizeof(message)) == sizeof(message);
+}
+
+uint32_t MeshMessageStore::findSeq(uint8_t channel, uint32_t index) const {
+    if (channel == MESH_CHANNEL_ANY) {
+        return index < size() ? nextSeq() - 1 - index : UINT32_MAX;
+    }
+    if (index >= getChannelCount(channel)) {
+        return UINT32_MAX;
+    }
+
+    for (uint32_t seq = nextSeq(); seq > firstSeq;) {
+        seq--;
+        if (channelOf(seq) == channel && index-- == 0) {
+            return seq;
+        }
+    }
+    return UINT32_MAX;
+}
+
+size_t MeshMessageStore::readPage(uint8_t channel, uint32_t peer, uint32_t beforeSeq,
+                                  MeshMessage* out, size_t maxCount, uint32_t* nextBefore,
+                                  uint32_t* seqs) {
+    uint32_t seq = beforeSeq < nextSeq() ? beforeSeq : nextSeq();
+    size_t count = 0;
+    File file;
+
+    while (ready && count < maxCount && seq > firstSeq) {
+        seq--;
+
+        // The index rules out other channels without touching flash
+        if (channel != MESH_CHANNEL_ANY && channelOf(seq) != channel) {
+            continue;
+        }
+        if (!readMessage(file, seq, out[count])) {
+            LOG_WARN_TAG("MeshMessageStore", "Failed to read message %u", (unsigned)seq);
+            break;
+        }
+        if (peer != 0 && out[count].fromNode != peer && out[count].toNode != peer) {
+            continue;
+        }
+        if (seqs) {
+            seqs[count] = seq;
+        }
+        count++;
+    }
+
+    if (file) {
+        file.close();
+    }
+    if (nextBefore) {
+        *nextBefore = seq;
+    }
+    return count;
+}
+
+bool MeshMessageStore::markDelivered(uint32_t messageId) {
+    if (!ready || messageId == 0) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < MESH_MESSAGE_ACK_SLOTS; i++) {
+        if (acks[i].messageId != messageId) {
+            continue;
+        }
+
+        uint32_t seq = acks[i].seq;
+        acks[i] = AckEntry{};
+        if (seq < firstSeq) {
+            return false;
+        }
+        revision++;
+        if (seq >= header.nextSeq) {
+            pending[seq - header.nextSeq].isDelivered = true;
+            return true;
+        }
+
+        // Already on flash: rewrite just the flag byte
+        static const bool delivered = true;
+        File file = SPIFFS.open(path, "r+");
+        bool success = file &&
+                       file.seek(recordOffset(seq % MESH_MESSAGE_CAPACITY) + offsetof(MeshMessage, isDelivered)) &&
+                       file.write(reinterpret_cast<const uint8_t*>(&delivered), 1) == 1;
+        file.close();
+        return success;
+    }
+    return false;
+}
+
+void MeshMessageStore::clear() {
+    // Sequence numbers keep counting so slots go on filling in order
+    flush();
+    firstSeq = nextSeq();
+    memset(channelCounts, 0, sizeof(channelCounts));
+    memset(acks, 0, sizeof(acks));
+    revision++;
+
+    if (!ready) {
+        return;
+    }
+
+    header.firstSeq = firstSeq;
+    File file = SPIFFS.open(path, "r+");
+    if (!file || !writeHeader(file)) {
+        LOG_ERROR_TAG("MeshMessageStore", "Failed to clear store");
+    }
+    file.close();
+}
+
+uint32_t MeshMessageStore::getChannelCount(uint8_t channel) const {
+    return channel < MESH_CHANNEL_COUNT ? channelCounts[channel] : 0;
+}
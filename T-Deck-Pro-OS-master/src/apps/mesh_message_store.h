@@ -0,0 +1,145 @@
+#ifndef MESH_MESSAGE_STORE_H
+#define MESH_MESSAGE_STORE_H
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+
+#ifndef MESH_MESSAGE_CAPACITY
+#define MESH_MESSAGE_CAPACITY 1000      // Messages kept on flash; the oldest is overwritten when full
+#endif
+
+#ifndef MESH_MESSAGE_RAM_SLOTS
+#define MESH_MESSAGE_RAM_SLOTS 16       // New messages held in RAM before they are written out together
+#endif
+
+#define MESH_MESSAGE_ACK_SLOTS 16       // Undelivered messages that can still be marked delivered
+#define MESH_MESSAGE_TEXT_SIZE 238      // Meshtastic text payloads are up to 237 bytes
+#define MESH_CHANNEL_COUNT 8
+#define MESH_CHANNEL_ANY 0xFF
+#define MESH_MESSAGE_STORE_PATH "/mesh/messages.bin"
+
+/**
+ * @brief One stored mesh message, written to flash as is
+ */
+struct MeshMessage {
+    uint32_t messageId;
+    uint32_t fromNode;
+    uint32_t toNode;
+    uint32_t timestamp;
+    int16_t rssi;
+    int8_t snr;
+    uint8_t hopCount;
+    uint8_t channel;
+    bool isAck;
+    bool isDelivered;
+    char text[MESH_MESSAGE_TEXT_SIZE];
+};
+
+/**
+ * @brief Bounded message history in a fixed-record ring file
+ *
+ * Every message gets a sequence number. Records live in slot seq % capacity of
+ * the ring file; the newest few stay in RAM and are written out in one go when
+ * that buffer fills or flush() is called. A one-byte channel index per slot is
+ * kept in RAM and on flash, so paging through one channel skips other channels
+ * without reading their records. Only the RAM buffer and the index are resident,
+ * whatever the history length.
+ */
+class MeshMessageStore {
+public:
+    MeshMessageStore(const String& path = MESH_MESSAGE_STORE_PATH);
+
+    // Opens or creates the ring file and loads its channel index
+    bool begin();
+
+    // Adds a message; it reaches flash on the next flush
+    bool append(const MeshMessage& message);
+    bool flush();
+
+    /**
+     * @brief Read history newest first
+     * @param channel Channel to return, or MESH_CHANNEL_ANY
+     * @param peer Only messages from or to this node, 0 for all
+     * @param beforeSeq Start below this sequence number; UINT32_MAX for the newest
+     * @param nextBefore Receives the value to pass as beforeSeq for the next page
+     * @param seqs Receives each returned message's sequence number, may be nullptr
+     * @return Number of messages written to out
+     */
+    size_t readPage(uint8_t channel, uint32_t peer, uint32_t beforeSeq,
+                    MeshMessage* out, size_t maxCount, uint32_t* nextBefore = nullptr,
+                    uint32_t* seqs = nullptr);
+
+    /**
+     * @brief Sequence number of the index-th newest message on a channel
+     *
+     * Uses only the in-RAM index. Returns UINT32_MAX if there are not that many.
+     */
+    uint32_t findSeq(uint8_t channel, uint32_t index) const;
+
+    // Sets isDelivered on a recent undelivered message, in place on flash if already written
+    bool markDelivered(uint32_t messageId);
+
+    void clear();
+
+    bool isReady() const { return ready; }
+    uint32_t size() const { return nextSeq() - firstSeq; }
+    uint32_t getChannelCount(uint8_t channel) const;
+    uint32_t getFirstSeq() const { return firstSeq; }
+    uint32_t getNextSeq() const { return nextSeq(); }
+    uint32_t getOverwrittenCount() const { return overwrittenCount; }
+
+    // Changes on every append, delivery update and clear
+    uint32_t getRevision() const { return revision; }
+
+private:
+    // On-flash header, followed by the channel index and then the records
+    struct Header {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t recordSize;
+        uint32_t capacity;
+        uint32_t firstSeq;      // Oldest message still visible
+        uint32_t nextSeq;       // One past the newest message on flash
+    };
+
+    struct AckEntry {
+        uint32_t messageId;
+        uint32_t seq;
+    };
+
+    String path;
+    Header header;
+    bool ready;
+
+    uint32_t firstSeq;
+    uint8_t channelIndex[MESH_MESSAGE_CAPACITY];    // Channel of each slot, mirrors the on-flash index
+    uint32_t channelCounts[MESH_CHANNEL_COUNT];
+
+    MeshMessage pending[MESH_MESSAGE_RAM_SLOTS];
+    uint8_t pendingCount;
+
+    AckEntry acks[MESH_MESSAGE_ACK_SLOTS];
+    uint8_t ackNext;
+
+    uint32_t overwrittenCount;
+    uint32_t revision;
+
+    uint32_t nextSeq() const { return header.nextSeq + pendingCount; }
+    uint8_t channelOf(uint32_t seq) const;
+    bool readMessage(File& file, uint32_t seq, MeshMessage& message);
+    void dropOldest();
+    void rebuildCounts();
+
+    bool createFile();
+    bool writeHeader(File& file);
+    bool writeRun(File& file, uint32_t slot, const MeshMessage* messages, uint32_t count);
+
+    static_assert(MESH_MESSAGE_CAPACITY > MESH_MESSAGE_RAM_SLOTS, "message ring must exceed the RAM buffer");
+
+    static size_t indexOffset() { return sizeof(Header); }
+    static size_t recordOffset(uint32_t slot) {
+        return sizeof(Header) + MESH_MESSAGE_CAPACITY + (size_t)slot * sizeof(MeshMessage);
+    }
+};
+
+#endif // MESH_MESSAGE_STORE_H
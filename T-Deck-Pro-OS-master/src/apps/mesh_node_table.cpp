@@ -0,0 +1,279 @@
+#include "mesh_node_table.h"
+#include "../core/apps/app_arena.h"
+#include "../core/utils/logger.h"
+#include <string.h>
+
+MeshNodeTable::MeshNodeTable()
+    : arena(nullptr)
+    , nodes(nullptr)
+    , slots(nullptr)
+    , slotOf(nullptr)
+    , heap(nullptr)
+    , heapPos(nullptr)
+    , nodeCapacity(0)
+    , slotMask(0)
+    , count(0)
+    , evictions(0)
+    , revisionCounter(0)
+    , membershipVersion(0)
+    , nameVersion(0)
+    , allocationSize(0)
+{
+}
+
+MeshNodeTable::~MeshNodeTable() {
+    end();
+}
+
+bool MeshNodeTable::begin(uint16_t capacity, AppArena* owner) {
+    end();
+    if (capacity == 0 || capacity > 0x4000) {
+        return false;
+    }
+
+    // At most half the hash slots are in use, so probe sequences stay short
+    uint32_t slotCount = 1;
+    while (slotCount < 2u * capacity) {
+        slotCount <<= 1;
+    }
+
+    size_t nodeBytes = sizeof(MeshNode) * capacity;
+    size_t indexBytes = sizeof(uint16_t) * (slotCount + 3u * capacity);
+    allocationSize = nodeBytes + indexBytes;
+
+    // Nodes are written once per packet heard; PSRAM is fast enough and spares internal RAM
+    uint8_t* block;
+    if (owner) {
+        // Counts against the app's quota and shows up in its resident size
+        block = (uint8_t*)owner->allocate(allocationSize);
+    } else {
+        block = (uint8_t*)ps_malloc(allocationSize);
+        if (!block) {
+            block = (uint8_t*)malloc(allocationSize);
+        }
+    }
+    if (!block) {
+        LOG_ERROR_TAG("MeshNodeTable", "Failed to allocate %u nodes (%u bytes)", capacity, (unsigned)allocationSize);
+        allocationSize = 0;
+        return false;
+    }
+
+    arena = owner;
+    nodes = (MeshNode*)block;
+    slots = (uint16_t*)(block + nodeBytes);
+    slotOf = slots + slotCount;
+    heap = slotOf + capacity;
+    heapPos = heap + capacity;
+    nodeCapacity = capacity;
+    slotMask = (uint16_t)(slotCount - 1);
+    clear();
+    return true;
+}
+
+void MeshNodeTable::end() {
+    // One block holds all arrays, starting with the nodes
+    if (arena) {
+        arena->release(nodes);
+    } else {
+        free(nodes);
+    }
+    arena = nullptr;
+    nodes = nullptr;
+    slots = slotOf = heap = heapPos = nullptr;
+    nodeCapacity = 0;
+    count = 0;
+    allocationSize = 0;
+}
+
+void MeshNodeTable::clear() {
+    if (slots) {
+        memset(slots, 0xFF, sizeof(uint16_t) * (slotMask + 1u));
+    }
+    count = 0;
+    membershipVersion++;
+}
+
+uint16_t MeshNodeTable::hashSlot(uint32_t nodeId) const {
+    // Node IDs are derived from MAC addresses, so the low bits alone cluster
+    return (uint16_t)((nodeId * 2654435761u) >> 16) & slotMask;
+}
+
+int32_t MeshNodeTable::findIndex(uint32_t nodeId) const {
+    if (!nodes) {
+        return -1;
+    }
+
+    for (uint16_t slot = hashSlot(nodeId); slots[slot] != EMPTY_SLOT; slot = (slot + 1) & slotMask) {
+        if (nodes[slots[slot]].nodeId == nodeId) {
+            return slots[slot];
+        }
+    }
+    return -1;
+}
+
+MeshNode* MeshNodeTable::find(uint32_t nodeId) {
+    int32_t index = findIndex(nodeId);
+    return index < 0 ? nullptr : &nodes[index];
+}
+
+const MeshNode* MeshNodeTable::find(uint32_t nodeId) const {
+    int32_t index = findIndex(nodeId);
+    return index < 0 ? nullptr : &nodes[index];
+}
+
+MeshNode* MeshNodeTable::upsert(const MeshNode& node) {
+    if (!nodes) {
+        return nullptr;
+    }
+
+    int32_t existing = findIndex(node.nodeId);
+    if (existing >= 0) {
+        if (strcmp(nodes[existing].longName, node.longName) != 0) {
+            nameVersion++;
+        }
+        nodes[existing] = node;
+        nodes[existing].revision = ++revisionCounter;
+        siftUp(heapPos[existing]);
+        siftDown(heapPos[existing]);
+        return &nodes[existing];
+    }
+
+    if (count == nodeCapacity) {
+        removeAt(heap[0]);
+        evictions++;
+    }
+
+    uint16_t index = count++;
+    nodes[index] = node;
+    nodes[index].revision = ++revisionCounter;
+    membershipVersion++;
+
+    uint16_t slot = hashSlot(node.nodeId);
+    while (slots[slot] != EMPTY_SLOT) {
+        slot = (slot + 1) & slotMask;
+    }
+    slots[slot] = index;
+    slotOf[index] = slot;
+
+    heap[index] = index;
+    heapPos[index] = index;
+    siftUp(index);
+    return &nodes[index];
+}
+
+bool MeshNodeTable::touch(uint32_t nodeId, uint32_t lastSeen) {
+    int32_t index = findIndex(nodeId);
+    if (index < 0) {
+        return false;
+    }
+
+    nodes[index].lastSeen = lastSeen;
+    siftUp(heapPos[index]);
+    siftDown(heapPos[index]);
+    return true;
+}
+
+bool MeshNodeTable::remove(uint32_t nodeId) {
+    int32_t index = findIndex(nodeId);
+    if (index < 0) {
+        return false;
+    }
+
+    removeAt((uint16_t)index);
+    return true;
+}
+
+size_t MeshNodeTable::expire(uint32_t now, uint32_t timeout) {
+    size_t removed = 0;
+    while (count && (int32_t)(now - nodes[heap[0]].lastSeen) > (int32_t)timeout) {
+        removeAt(heap[0]);
+        removed++;
+    }
+    return removed;
+}
+
+const MeshNode* MeshNodeTable::oldest() const {
+    return count ? &nodes[heap[0]] : nullptr;
+}
+
+void MeshNodeTable::removeAt(uint16_t index) {
+    uint16_t last = count - 1;
+    unlinkSlot(slotOf[index]);
+
+    // Fill the heap hole with the last heap entry
+    uint16_t hole = heapPos[index];
+    if (hole != last) {
+        heap[hole] = heap[last];
+        heapPos[heap[hole]] = hole;
+    }
+
+    // Keep the node array dense by moving the last node into the gap
+    if (index != last) {
+        nodes[index] = nodes[last];
+        slotOf[index] = slotOf[last];
+        slots[slotOf[index]] = index;
+        heapPos[index] = heapPos[last];
+        heap[heapPos[index]] = index;
+    }
+
+    count--;
+    membershipVersion++;
+    if (hole < count) {
+        siftUp(hole);
+        siftDown(hole);
+    }
+}
+
+void MeshNodeTable::unlinkSlot(uint16_t slot) {
+    // Backward-shift deletion: later entries of the probe run move into the gap, so no tombstones
+    slots[slot] = EMPTY_SLOT;
+    for (uint16_t next = (slot + 1) & slotMask; slots[next] != EMPTY_SLOT; next = (next + 1) & slotMask) {
+        uint16_t index = slots[next];
+        uint16_t home = hashSlot(nodes[index].nodeId);
+        if (((next - home) & slotMask) >= ((next - slot) & slotMask)) {
+            slots[slot] = index;
+            slotOf[index] = slot;
+            slots[next] = EMPTY_SLOT;
+            slot = next;
+        }
+    }
+}
+
+bool MeshNodeTable::older(uint16_t a, uint16_t b) const {
+    // Wrap-safe comparison of millis() timestamps
+    return (int32_t)(nodes[a].lastSeen - nodes[b].lastSeen) < 0;
+}
+
+void MeshNodeTable::heapSwap(uint16_t a, uint16_t b) {
+    uint16_t node = heap[a];
+    heap[a] = heap[b];
+    heap[b] = node;
+    heapPos[heap[a]] = a;
+    heapPos[heap[b]] = b;
+}
+
+void MeshNodeTable::siftUp(uint16_t pos) {
+    while (pos > 0) {
+        uint16_t parent = (pos - 1) / 2;
+        if (!older(heap[pos], heap[parent])) {
+            break;
+        }
+        heapSwap(pos, parent);
+        pos = parent;
+    }
+}
+
+void MeshNodeTable::siftDown(uint16_t pos) {
+    for (;;) {
+        uint32_t smallest = pos;
+        uint32_t left = 2u * pos + 1;
+        uint32_t right = left + 1;
+        if (left < count && older(heap[left], heap[smallest])) smallest = left;
+        if (right < count && older(heap[right], heap[smallest])) smallest = right;
+        if (smallest == pos) {
+            break;
+        }
+        heapSwap(pos, (uint16_t)smallest);
+        pos = (uint16_t)smallest;
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef MESH_NODE_TABLE_H
+#define MESH_NODE_TABLE_H
+
+#include <Arduino.h>
+
+class AppArena;
+
+#ifndef MESH_NODE_CAPACITY
+#define MESH_NODE_CAPACITY 512
+#endif
+
+#define MESH_NODE_SHORT_NAME_SIZE 5     // Meshtastic short names are up to 4 characters
+#define MESH_NODE_LONG_NAME_SIZE 40     // Meshtastic long names are up to 39 bytes
+#define MESH_NODE_FIRMWARE_SIZE 16
+
+/**
+ * @brief One mesh neighbour, stored inline in the node table
+ */
+struct MeshNode {
+    uint32_t nodeId;
+    uint32_t lastSeen;                  // millis() when last heard
+    uint32_t revision;                  // Set by the table on every upsert; lastSeen alone does not change it
+    float latitude;
+    float longitude;
+    float voltage;
+    int16_t rssi;
+    int8_t snr;
+    uint8_t batteryLevel;
+    uint8_t hopLimit;
+    uint8_t hardwareModel;              // Meshtastic HardwareModel value
+    bool isOnline;
+    char shortName[MESH_NODE_SHORT_NAME_SIZE];
+    char longName[MESH_NODE_LONG_NAME_SIZE];
+    char firmwareVersion[MESH_NODE_FIRMWARE_SIZE];
+};
+
+/**
+ * @brief Bounded table of mesh nodes indexed by node ID
+ *
+ * Nodes live in a dense array so iteration touches only live entries. An
+ * open-addressed hash with linear probing maps node IDs to array indices, and a
+ * min-heap on lastSeen orders nodes for expiry: dropping every node older than a
+ * cutoff costs O(log n) per expired node instead of a scan. When the table is
+ * full the least recently heard node makes room for a new one. All storage is
+ * one PSRAM allocation sized at begin(), taken from the owning app's arena when
+ * one is given. An arena-backed table must be ended before the arena is reset.
+ */
+class MeshNodeTable {
+public:
+    MeshNodeTable();
+    ~MeshNodeTable();
+
+    bool begin(uint16_t capacity = MESH_NODE_CAPACITY, AppArena* arena = nullptr);
+    void end();
+
+    // Lookup; the pointer is valid until the next insert or removal
+    MeshNode* find(uint32_t nodeId);
+    const MeshNode* find(uint32_t nodeId) const;
+
+    // Inserts or replaces a node, evicting the least recently heard one when full
+    MeshNode* upsert(const MeshNode& node);
+
+    // Records that a node was heard; keeps the expiry order
+    bool touch(uint32_t nodeId, uint32_t lastSeen);
+
+    bool remove(uint32_t nodeId);
+    void clear();
+
+    // Removes nodes not heard for timeout ms; returns the number removed
+    size_t expire(uint32_t now, uint32_t timeout);
+
+    // Dense iteration, in no particular order
+    uint16_t size() const { return count; }
+    uint16_t capacity() const { return nodeCapacity; }
+    const MeshNode& at(uint16_t index) const { return nodes[index]; }
+
+    // Least recently heard node, nullptr when empty
+    const MeshNode* oldest() const;
+
+    // Changes whenever a node is added or removed, i.e. when iteration order may have changed
+    uint32_t getMembershipVersion() const { return membershipVersion; }
+
+    // Changes whenever an existing node's long name changes
+    uint32_t getNameVersion() const { return nameVersion; }
+
+    uint32_t getEvictionCount() const { return evictions; }
+    size_t getMemoryUsage() const { return allocationSize; }
+
+private:
+    static constexpr uint16_t EMPTY_SLOT = 0xFFFF;
+
+    AppArena* arena;                    // Owner of the block, nullptr for the system heap
+    MeshNode* nodes;
+    uint16_t* slots;                    // Hash slot -> node index
+    uint16_t* slotOf;                   // Node index -> hash slot
+    uint16_t* heap;                     // Node indices, oldest lastSeen first
+    uint16_t* heapPos;                  // Node index -> heap position
+    uint16_t nodeCapacity;
+    uint16_t slotMask;
+    uint16_t count;
+    uint32_t evictions;
+    uint32_t revisionCounter;
+    uint32_t membershipVersion;
+    uint32_t nameVersion;
+    size_t allocationSize;
+
+    uint16_t hashSlot(uint32_t nodeId) const;
+    int32_t findIndex(uint32_t nodeId) const;
+    void removeAt(uint16_t index);
+    void unlinkSlot(uint16_t slot);
+
+    bool older(uint16_t a, uint16_t b) const;
+    void heapSwap(uint16_t a, uint16_t b);
+    void siftUp(uint16_t pos);
+    void siftDown(uint16_t pos);
+};
+
+#endif // MESH_NODE_TABLE_H
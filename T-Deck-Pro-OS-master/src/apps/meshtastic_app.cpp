@@ -0,0 +1,402 @@
+#include "meshtastic_app.h"
+#include "../core/utils/logger.h"
+#include <algorithm>
+#include <string.h>
+#include <time.h>
+
+// Node and message bookkeeping. All of it is bounded: the node table is sized
+// once, in the app arena, and the message history lives on flash.
+
+bool MeshtasticApp::initializeStorage() {
+    if (!meshNodes.begin(MAX_NODES, &memoryArena)) {
+        return false;
+    }
+    if (!meshMessages.begin()) {
+        // History is lost but the mesh still works
+        LOG_WARN_TAG("MeshtasticApp", "Message history unavailable");
+    }
+
+    LOG_INFO_TAG("MeshtasticApp", "Node table: %u nodes in %u bytes",
+                 meshNodes.capacity(), (unsigned)meshNodes.getMemoryUsage());
+    return true;
+}
+
+bool MeshtasticApp::initialize() {
+    // Packets can arrive before the UI is first shown, so storage comes up with the app
+    return initializeStorage();
+}
+
+void MeshtasticApp::cleanup() {
+    // The arena is reset when the app stops; hand the node table back before that
+    meshMessages.flush();
+    meshNodes.end();
+}
+
+void MeshtasticApp::addNode(const MeshNode& node) {
+    MeshNode entry = node;
+    if (entry.lastSeen == 0) {
+        entry.lastSeen = millis();
+    }
+    if (!meshNodes.upsert(entry)) {
+        LOG_WARN_TAG("MeshtasticApp", "Node table not initialized, dropping node %08X", node.nodeId);
+    }
+}
+
+void MeshtasticApp::updateNode(uint32_t nodeId, const MeshNode& node) {
+    MeshNode entry = node;
+    entry.nodeId = nodeId;
+    addNode(entry);
+}
+
+void MeshtasticApp::removeNode(uint32_t nodeId) {
+    meshNodes.remove(nodeId);
+}
+
+MeshtasticApp::MeshNode* MeshtasticApp::getNode(uint32_t nodeId) {
+    return meshNodes.find(nodeId);
+}
+
+size_t MeshtasticApp::getOnlineNodeCount() const {
+    size_t online = 0;
+    for (uint16_t i = 0; i < meshNodes.size(); i++) {
+        if (meshNodes.at(i).isOnline) {
+            online++;
+        }
+    }
+    return online;
+}
+
+void MeshtasticApp::addMessage(const MeshMessage& message) {
+    if (!meshMessages.append(message)) {
+        LOG_WARN_TAG("MeshtasticApp", "Failed to store message %08X", message.messageId);
+    }
+
+    // A message is as good as a heartbeat from its sender
+    if (message.fromNode != myNodeId) {
+        meshNodes.touch(message.fromNode, millis());
+    }
+}
+
+size_t MeshtasticApp::getMessages(MeshMessage* out, size_t maxCount, uint32_t nodeId,
+                                  uint8_t channel, uint32_t before, uint32_t* nextBefore) {
+    return meshMessages.readPage(channel, nodeId, before, out, maxCount, nextBefore);
+}
+
+void MeshtasticApp::markMessageDelivered(uint32_t messageId) {
+    meshMessages.markDelivered(messageId);
+}
+
+void MeshtasticApp::clearMessages() {
+    meshMessages.clear();
+}
+
+void MeshtasticApp::cleanupOldNodes() {
+    uint32_t timeout = settings.nodeTimeout ? settings.nodeTimeout : NODE_TIMEOUT;
+    size_t expired = meshNodes.expire(millis(), timeout);
+    if (expired > 0) {
+        LOG_DEBUG_TAG("MeshtasticApp", "Expired %u nodes, %u remain", (unsigned)expired, meshNodes.size());
+    }
+}
+
+void MeshtasticApp::cleanupOldMessages() {
+    // The store overwrites its oldest messages itself; only the RAM buffer needs writing out
+    meshMessages.flush();
+}
+
+// ===== Node list =====
+
+MeshtasticApp::NodeListAdapter::NodeListAdapter(MeshtasticApp* app)
+    : app(app), orderVersion(0), orderNameVersion(0), orderValid(false) {
+}
+
+void MeshtasticApp::NodeListAdapter::updateOrder() {
+    const MeshNodeTable& table = app->meshNodes;
+    if (orderValid && orderVersion == table.getMembershipVersion() &&
+        orderNameVersion == table.getNameVersion()) {
+        return;
+    }
+
+    // Removal moves nodes inside the table and a rename moves a node in the sort,
+    // so positions are only stable between those
+    for (uint16_t i = 0; i < table.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order, order + table.size(), [&table](uint16_t a, uint16_t b) {
+        int byName = strcmp(table.at(a).longName, table.at(b).longName);
+        return byName != 0 ? byName < 0 : table.at(a).nodeId < table.at(b).nodeId;
+    });
+    orderVersion = table.getMembershipVersion();
+    orderNameVersion = table.getNameVersion();
+    orderValid = true;
+}
+
+const MeshtasticApp::MeshNode& MeshtasticApp::NodeListAdapter::nodeAt(uint32_t index) {
+    return app->meshNodes.at(order[index]);
+}
+
+uint32_t MeshtasticApp::NodeListAdapter::getItemCount() {
+    updateOrder();
+    return app->meshNodes.size();
+}
+
+uint32_t MeshtasticApp::NodeListAdapter::getItemKey(uint32_t index) {
+    return nodeAt(index).nodeId;
+}
+
+uint32_t MeshtasticApp::NodeListAdapter::getItemVersion(uint32_t index) {
+    return nodeAt(index).revision;
+}
+
+void MeshtasticApp::NodeListAdapter::createRow(lv_obj_t* row) {
+    lv_obj_t* name = lv_label_create(row);
+    lv_label_set_long_mode(name, LV_LABEL_LONG_DOT);
+    lv_obj_set_width(name, LV_PCT(70));
+    lv_obj_align(name, LV_ALIGN_TOP_LEFT, 0, 0);
+
+    lv_obj_t* signal = lv_label_create(row);
+    lv_obj_align(signal, LV_ALIGN_BOTTOM_LEFT, 0, 0);
+
+    lv_obj_t* status = lv_label_create(row);
+    lv_obj_align(status, LV_ALIGN_TOP_RIGHT, 0, 0);
+}
+
+void MeshtasticApp::NodeListAdapter::bindRow(lv_obj_t* row, uint32_t index) {
+    const MeshNode& node = nodeAt(index);
+    char text[64];
+
+    if (node.longName[0]) {
+        snprintf(text, sizeof(text), "%s (%s)", node.longName, node.shortName);
+    } else {
+        snprintf(text, sizeof(text), "!%08x", (unsigned)node.nodeId);
+    }
+    VirtualList::setLabelText(lv_obj_get_child(row, 0), text);
+
+    snprintf(text, sizeof(text), "SNR %d dB  RSSI %d dBm  %u hops",
+             node.snr, node.rssi, node.hopLimit);
+    VirtualList::setLabelText(lv_obj_get_child(row, 1), text);
+
+    snprintf(text, sizeof(text), "%s %u%%", node.isOnline ? "*" : "-", node.batteryLevel);
+    VirtualList::setLabelText(lv_obj_get_child(row, 2), text);
+}
+
+// ===== Message list =====
+
+MeshtasticApp::MessageListAdapter::MessageListAdapter(MeshtasticApp* app)
+    : app(app), channel(0), page{}, pageSeqs{}, pageFirst(0), pageCount(0), pageRevision(0), pageValid(false) {
+}
+
+void MeshtasticApp::MessageListAdapter::setChannel(uint8_t newChannel) {
+    if (newChannel != channel) {
+        channel = newChannel;
+        pageValid = false;
+    }
+}
+
+uint32_t MeshtasticApp::MessageListAdapter::getItemCount() {
+    const MeshMessageStore& store = app->meshMessages;
+    return channel == MESH_CHANNEL_ANY ? store.size() : store.getChannelCount(channel);
+}
+
+void MeshtasticApp::MessageListAdapter::prepare(uint32_t first, uint32_t count) {
+    MeshMessageStore& store = app->meshMessages;
+    if (pageValid && pageFirst == first && pageCount == count && pageRevision == store.getRevision()) {
+        return;
+    }
+
+    // Only the visible window is read; the index finds where it starts without touching flash
+    pageFirst = first;
+    pageCount = 0;
+    uint32_t seq = store.findSeq(channel, first);
+    if (seq != UINT32_MAX) {
+        pageCount = store.readPage(channel, 0, seq + 1, page, count, nullptr, pageSeqs);
+    }
+    pageRevision = store.getRevision();
+    pageValid = true;
+}
+
+const MeshtasticApp::MeshMessage* MeshtasticApp::MessageListAdapter::messageAt(uint32_t index) const {
+    if (index < pageFirst || index - pageFirst >= pageCount) {
+        return nullptr;
+    }
+    return &page[index - pageFirst];
+}
+
+uint32_t MeshtasticApp::MessageListAdapter::getItemKey(uint32_t index) {
+    // Message IDs can be 0 or repeat across senders; the store sequence number is unique
+    if (index < pageFirst || index - pageFirst >= pageCount) {
+        return UINT32_MAX;
+    }
+    return pageSeqs[index - pageFirst];
+}
+
+uint32_t MeshtasticApp::MessageListAdapter::getItemVersion(uint32_t index) {
+    const MeshMessage* message = messageAt(index);
+    return message ? message->isDelivered : 0;
+}
+
+void MeshtasticApp::MessageListAdapter::createRow(lv_obj_t* row) {
+    lv_obj_t* header = lv_label_create(row);
+    lv_obj_align(header, LV_ALIGN_TOP_LEFT, 0, 0);
+
+    lv_obj_t* body = lv_label_create(row);
+    lv_label_set_long_mode(body, LV_LABEL_LONG_DOT);
+    lv_obj_set_width(body, LV_PCT(100));
+    lv_obj_align(body, LV_ALIGN_BOTTOM_LEFT, 0, 0);
+
+    lv_obj_t* status = lv_label_create(row);
+    lv_obj_align(status, LV_ALIGN_TOP_RIGHT, 0, 0);
+}
+
+void MeshtasticApp::MessageListAdapter::bindRow(lv_obj_t* row, uint32_t index) {
+    const MeshMessage* message = messageAt(index);
+    if (!message) {
+        VirtualList::setLabelText(lv_obj_get_child(row, 0), "");
+        VirtualList::setLabelText(lv_obj_get_child(row, 1), "");
+        VirtualList::setLabelText(lv_obj_get_child(row, 2), "");
+        return;
+    }
+
+    char sender[MESH_NODE_LONG_NAME_SIZE];
+    const MeshNode* node = app->meshNodes.find(message->fromNode);
+    if (message->fromNode == app->myNodeId) {
+        snprintf(sender, sizeof(sender), "Me");
+    } else if (node && node->shortName[0]) {
+        snprintf(sender, sizeof(sender), "%s", node->shortName);
+    } else {
+        snprintf(sender, sizeof(sender), "!%08x", (unsigned)message->fromNode);
+    }
+
+    char header[64];
+    time_t timestamp = message->timestamp;
+    struct tm local;
+    localtime_r(&timestamp, &local);
+    snprintf(header, sizeof(header), "%s  %02d:%02d", sender, local.tm_hour, local.tm_min);
+    VirtualList::setLabelText(lv_obj_get_child(row, 0), header);
+    VirtualList::setLabelText(lv_obj_get_child(row, 1), message->text);
+
+    const char* status = "";
+    if (message->fromNode == app->myNodeId) {
+        status = message->isDelivered ? "delivered" : "sending";
+    }
+    VirtualList::setLabelText(lv_obj_get_child(row, 2), status);
+}
+
+// ===== Screens =====
+
+void MeshtasticApp::createNodesScreen() {
+    if (!nodesList.create(nodesScreen, &nodeAdapter, NODE_ROW_HEIGHT)) {
+        LOG_ERROR_TAG("MeshtasticApp", "Failed to create node list");
+    }
+}
+
+void MeshtasticApp::createMessagesScreen() {
+    messageAdapter.setChannel(activeChannelIndex);
+    if (!messagesList.create(messagesScreen, &messageAdapter, MESSAGE_ROW_HEIGHT)) {
+        LOG_ERROR_TAG("MeshtasticApp", "Failed to create message list");
+    }
+}
+
+void MeshtasticApp::updateNodesScreen() {
+    // Rows whose node did not change are left alone, so they are not redrawn
+    nodesList.refresh();
+
+    if (nodeCountLabel) {
+        char text[32];
+        snprintf(text, sizeof(text), "%u/%u online", (unsigned)getOnlineNodeCount(), meshNodes.size());
+        VirtualList::setLabelText(nodeCountLabel, text);
+    }
+}
+
+void MeshtasticApp::updateMessagesScreen() {
+    if (messageAdapter.getChannel() != activeChannelIndex) {
+        messageAdapter.setChannel(activeChannelIndex);
+        messagesList.invalidateAll();
+        messagesList.scrollTo(0);
+        return;
+    }
+    messagesList.refresh();
+}
+
+void MeshtasticApp::destroyUI() {
+    // Deleting the container takes every widget with it, the list rows included
+    AppBase::destroyUI();
+    headerPanel = contentPanel = statusBar = tabView = nullptr;
+    nodesScreen = messagesScreen = mapScreen = nullptr;
+    channelsScreen = settingsScreen = telemetryScreen = nullptr;
+    messageInput = sendButton = channelSelector = nullptr;
+    statusLabel = nodeCountLabel = signalStrengthBar = nullptr;
+}
+
+// ===== Hibernation =====
+
+// Messages are already on flash; the node table goes to a file of raw records
+static const char* NODE_DATA_PATH = "/mesh/nodes.bin";
+
+bool MeshtasticApp::saveNodeData() {
+    File file = SPIFFS.open(NODE_DATA_PATH, "w");
+    if (!file) {
+        return false;
+    }
+
+    bool written = true;
+    for (uint16_t i = 0; written && i < meshNodes.size(); i++) {
+        written = file.write((const uint8_t*)&meshNodes.at(i), sizeof(MeshNode)) == sizeof(MeshNode);
+    }
+    file.close();
+
+    if (!written) {
+        SPIFFS.remove(NODE_DATA_PATH);
+    }
+    return written;
+}
+
+bool MeshtasticApp::loadNodeData() {
+    File file = SPIFFS.open(NODE_DATA_PATH, "r");
+    if (!file) {
+        return false;
+    }
+
+    // lastSeen is millis(), so records are only valid within the boot that wrote them
+    MeshNode node;
+    while (file.read((uint8_t*)&node, sizeof(node)) == sizeof(node)) {
+        meshNodes.upsert(node);
+    }
+    file.close();
+    SPIFFS.remove(NODE_DATA_PATH);
+    return true;
+}
+
+bool MeshtasticApp::saveState(JsonObject state) {
+    // Pending messages reach flash when cleanup() flushes the store
+    if (!saveNodeData()) {
+        return false;
+    }
+
+    state["screen"] = (int)currentScreen;
+    state["channel"] = activeChannelIndex;
+    state["nodes"] = meshNodes.size();
+    state["lastHeartbeat"] = lastHeartbeat;
+    return true;
+}
+
+bool MeshtasticApp::restoreState(JsonObjectConst state) {
+    int screen = state["screen"] | (int)MeshScreen::NODES;
+    uint8_t channel = state["channel"] | 0;
+    if (screen < (int)MeshScreen::NODES || screen > (int)MeshScreen::TELEMETRY || channel >= MAX_CHANNELS) {
+        return false;
+    }
+
+    currentScreen = (MeshScreen)screen;
+    activeChannelIndex = channel;
+    messageAdapter.setChannel(channel);
+    lastHeartbeat = state["lastHeartbeat"] | 0u;
+
+    if (!loadNodeData()) {
+        return false;
+    }
+    uint16_t expected = state["nodes"] | 0;
+    if (meshNodes.size() != expected) {
+        LOG_WARN_TAG("MeshtasticApp", "Restored %u of %u nodes", meshNodes.size(), expected);
+    }
+    return true;
+}
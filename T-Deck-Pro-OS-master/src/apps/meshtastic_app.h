@@ -3,8 +3,10 @@
 
 #include "../core/apps/app_base.h"
 #include "../core/communication/communication_manager.h"
+#include "mesh_node_table.h"
+#include "mesh_message_store.h"
+#include "../core/ui/virtual_list.h"
 #include <vector>
-#include <map>
 
 /**
  * @brief Meshtastic Fancy UI Application
@@ -14,35 +16,9 @@
  */
 class MeshtasticApp : public AppBase {
 public:
-    struct MeshNode {
-        uint32_t nodeId;
-        String shortName;
-        String longName;
-        float latitude;
-        float longitude;
-        uint32_t lastSeen;
-        uint8_t batteryLevel;
-        float voltage;
-        int8_t snr;
-        int16_t rssi;
-        uint8_t hopLimit;
-        bool isOnline;
-        String firmwareVersion;
-        String hardwareModel;
-    };
-
-    struct MeshMessage {
-        uint32_t messageId;
-        uint32_t fromNode;
-        uint32_t toNode;
-        String message;
-        uint32_t timestamp;
-        bool isAck;
-        bool isDelivered;
-        int8_t snr;
-        int16_t rssi;
-        uint8_t hopCount;
-    };
+    // Stored inline in the node table and message store
+    using MeshNode = ::MeshNode;
+    using MeshMessage = ::MeshMessage;
 
     struct ChannelConfig {
         uint8_t channelIndex;
@@ -82,6 +58,11 @@ public:
     // UI management
     lv_obj_t* createUI(lv_obj_t* parent) override;
     void updateUI() override;
+    void destroyUI() override;
+
+    // Hibernation
+    bool saveState(JsonObject state) override;
+    bool restoreState(JsonObjectConst state) override;
 
     // Static app info
     static AppInfo getAppInfo();
@@ -97,12 +78,15 @@ public:
     void updateNode(uint32_t nodeId, const MeshNode& node);
     void removeNode(uint32_t nodeId);
     MeshNode* getNode(uint32_t nodeId);
-    std::vector<MeshNode> getOnlineNodes() const;
-    std::vector<MeshNode> getAllNodes() const;
+    const MeshNodeTable& getNodes() const { return meshNodes; }
+    size_t getOnlineNodeCount() const;
 
     // Message management
     void addMessage(const MeshMessage& message);
-    std::vector<MeshMessage> getMessages(uint32_t nodeId = 0) const;
+    // Newest first; pass the returned nextBefore back in to page further into history
+    size_t getMessages(MeshMessage* out, size_t maxCount, uint32_t nodeId = 0,
+                       uint8_t channel = MESH_CHANNEL_ANY, uint32_t before = UINT32_MAX,
+                       uint32_t* nextBefore = nullptr);
     void markMessageDelivered(uint32_t messageId);
     void clearMessages();
 
@@ -119,8 +103,59 @@ public:
     void resetConfig() override;
 
 private:
+    /**
+     * @brief Node rows, sorted by name; the order is rebuilt only when nodes come or go
+     */
+    class NodeListAdapter : public VirtualListAdapter {
+    public:
+        explicit NodeListAdapter(MeshtasticApp* app);
+        uint32_t getItemCount() override;
+        uint32_t getItemKey(uint32_t index) override;
+        uint32_t getItemVersion(uint32_t index) override;
+        void createRow(lv_obj_t* row) override;
+        void bindRow(lv_obj_t* row, uint32_t index) override;
+
+    private:
+        MeshtasticApp* app;
+        uint16_t order[MESH_NODE_CAPACITY];     // Display position -> node table index
+        uint32_t orderVersion;
+        uint32_t orderNameVersion;
+        bool orderValid;
+
+        void updateOrder();
+        const MeshNode& nodeAt(uint32_t index);
+    };
+
+    /**
+     * @brief Message rows for one channel, newest first, read from the store a page at a time
+     */
+    class MessageListAdapter : public VirtualListAdapter {
+    public:
+        explicit MessageListAdapter(MeshtasticApp* app);
+        void setChannel(uint8_t channel);
+        uint8_t getChannel() const { return channel; }
+
+        uint32_t getItemCount() override;
+        void prepare(uint32_t first, uint32_t count) override;
+        uint32_t getItemKey(uint32_t index) override;
+        uint32_t getItemVersion(uint32_t index) override;
+        void createRow(lv_obj_t* row) override;
+        void bindRow(lv_obj_t* row, uint32_t index) override;
+
+    private:
+        MeshtasticApp* app;
+        uint8_t channel;
+        MeshMessage page[VirtualList::MAX_ROWS];
+        uint32_t pageSeqs[VirtualList::MAX_ROWS];   // Store sequence numbers, the row keys
+        uint32_t pageFirst;
+        uint32_t pageCount;
+        uint32_t pageRevision;
+        bool pageValid;
+
+        const MeshMessage* messageAt(uint32_t index) const;
+    };
+
     // UI components
-    lv_obj_t* mainContainer;
     lv_obj_t* headerPanel;
     lv_obj_t* contentPanel;
     lv_obj_t* statusBar;
@@ -135,8 +170,10 @@ private:
     lv_obj_t* telemetryScreen;
 
     // UI elements
-    lv_obj_t* nodesList;
-    lv_obj_t* messagesList;
+    VirtualList nodesList;
+    VirtualList messagesList;
+    NodeListAdapter nodeAdapter{this};
+    MessageListAdapter messageAdapter{this};
     lv_obj_t* messageInput;
     lv_obj_t* sendButton;
     lv_obj_t* channelSelector;
@@ -145,8 +182,8 @@ private:
     lv_obj_t* signalStrengthBar;
 
     // Data
-    std::map<uint32_t, MeshNode> meshNodes;
-    std::vector<MeshMessage> meshMessages;
+    MeshNodeTable meshNodes;
+    MeshMessageStore meshMessages;
     std::vector<ChannelConfig> channels;
     uint8_t activeChannelIndex;
     MeshScreen currentScreen;
@@ -208,6 +245,7 @@ private:
     String formatDistance(float distance);
     String formatSignalStrength(int16_t rssi, int8_t snr);
     float calculateDistance(float lat1, float lon1, float lat2, float lon2);
+    bool initializeStorage();
     void cleanupOldNodes();
     void cleanupOldMessages();
     bool isValidNodeId(uint32_t nodeId);
@@ -224,9 +262,11 @@ private:
     static const uint32_t HEARTBEAT_INTERVAL = 30000; // 30 seconds
     static const uint32_t NODE_TIMEOUT = 300000; // 5 minutes
     static const uint32_t MESSAGE_CLEANUP_INTERVAL = 3600000; // 1 hour
-    static const size_t MAX_MESSAGES = 1000;
-    static const size_t MAX_NODES = 100;
-    static const uint8_t MAX_CHANNELS = 8;
+    static const size_t MAX_MESSAGES = MESH_MESSAGE_CAPACITY;
+    static const size_t MAX_NODES = MESH_NODE_CAPACITY;
+    static const uint8_t MAX_CHANNELS = MESH_CHANNEL_COUNT;
+    static const lv_coord_t NODE_ROW_HEIGHT = 36;
+    static const lv_coord_t MESSAGE_ROW_HEIGHT = 52;
 };
 
 #endif // MESHTASTIC_APP_H
\ No newline at end of file
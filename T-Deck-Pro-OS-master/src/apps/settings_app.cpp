@@ -0,0 +1,50 @@
+#include "settings_app.h"
+#include "../core/utils/logger.h"
+
+void SettingsApp::destroyUI() {
+    // Deleting the container takes every widget with it
+    AppBase::destroyUI();
+    sidebarPanel = contentPanel = headerPanel = footerPanel = nullptr;
+    categoryList = searchBox = advancedToggle = nullptr;
+    settingsContainer = scrollContainer = titleLabel = descriptionLabel = nullptr;
+    saveButton = resetButton = importButton = exportButton = nullptr;
+}
+
+// Hibernation. Saved settings are reloaded from the config file on start, so
+// only the view and any edits not yet saved are kept.
+
+bool SettingsApp::saveState(JsonObject state) {
+    state["category"] = (int)activeCategory;
+    state["search"] = searchFilter;
+    state["advanced"] = showAdvanced;
+
+    if (hasUnsavedChanges) {
+        JsonObject values = state.createNestedObject("values");
+        for (const auto& entry : settings) {
+            values[entry.first] = entry.second.value;
+        }
+    }
+    return true;
+}
+
+bool SettingsApp::restoreState(JsonObjectConst state) {
+    int category = state["category"] | (int)SettingCategory::SYSTEM;
+    if (category < (int)SettingCategory::SYSTEM || category > (int)SettingCategory::ABOUT) {
+        return false;
+    }
+
+    activeCategory = (SettingCategory)category;
+    searchFilter = state["search"] | "";
+    showAdvanced = state["advanced"] | false;
+
+    // Edits were validated and applied when they were made; put them back as they were
+    JsonObjectConst values = state["values"];
+    for (JsonPairConst value : values) {
+        auto it = settings.find(value.key().c_str());
+        if (it != settings.end()) {
+            it->second.value = value.value().as<const char*>();
+            hasUnsavedChanges = true;
+        }
+    }
+    return true;
+}
@@ -78,6 +78,11 @@ public:
     // UI management
     lv_obj_t* createUI(lv_obj_t* parent) override;
     void updateUI() override;
+    void destroyUI() override;
+
+    // Hibernation
+    bool saveState(JsonObject state) override;
+    bool restoreState(JsonObjectConst state) override;
 
     // Static app info
     static AppInfo getAppInfo();
@@ -124,7 +129,6 @@ public:
 
 private:
     // UI components
-    lv_obj_t* mainContainer;
     lv_obj_t* sidebarPanel;
     lv_obj_t* contentPanel;
     lv_obj_t* headerPanel;
@@ -0,0 +1,172 @@
+#include "app_arena.h"
+#include "../utils/logger.h"
+#include <string.h>
+
+AppArena::AppArena(size_t quota)
+    : quota(quota)
+    , used(0)
+    , peakUsed(0)
+    , reserved(0)
+    , failedAllocations(0)
+    , chunks(nullptr)
+    , largeFree(nullptr)
+{
+    memset(freeLists, 0, sizeof(freeLists));
+}
+
+AppArena::~AppArena() {
+    releaseAll();
+}
+
+uint8_t AppArena::sizeClassFor(size_t size) {
+    if (size <= (1u << MIN_CLASS_SHIFT)) {
+        return 0;
+    }
+    // Index of the next power of two at or above size, relative to the smallest class
+    return (uint8_t)(32 - __builtin_clz((uint32_t)(size - 1)) - MIN_CLASS_SHIFT);
+}
+
+bool AppArena::addChunk(size_t minimum) {
+    size_t size = minimum > CHUNK_SIZE ? minimum : CHUNK_SIZE;
+
+    // Never reserve much more than the quota; whatever is left goes into the last chunk
+    if (reserved + size > quota + CHUNK_SIZE) {
+        return false;
+    }
+
+    Chunk* chunk = (Chunk*)ps_malloc(sizeof(Chunk) + size);
+    if (!chunk) {
+        chunk = (Chunk*)malloc(sizeof(Chunk) + size);
+        if (!chunk) {
+            return false;
+        }
+    }
+
+    chunk->next = chunks;
+    chunk->size = size;
+    chunk->offset = 0;
+    chunks = chunk;
+    reserved += size;
+    return true;
+}
+
+void* AppArena::bump(size_t blockSize) {
+    if (!chunks || chunks->size - chunks->offset < blockSize) {
+        // The tail of the old chunk is abandoned until reset()
+        if (!addChunk(blockSize)) {
+            return nullptr;
+        }
+    }
+
+    uint8_t* base = reinterpret_cast<uint8_t*>(chunks + 1);
+    void* block = base + chunks->offset;
+    chunks->offset += blockSize;
+    return block;
+}
+
+void* AppArena::allocate(size_t size) {
+    if (size == 0) {
+        return nullptr;
+    }
+
+    uint32_t sizeClass;
+    size_t blockSize;
+    if (size <= MAX_CLASS_SIZE) {
+        sizeClass = sizeClassFor(size);
+        blockSize = (size_t)1 << (sizeClass + MIN_CLASS_SHIFT);
+    } else {
+        sizeClass = LARGE_CLASS;
+        blockSize = (size + 7) & ~(size_t)7;
+    }
+
+    // Quota accounting is a single comparison
+    if (used + blockSize > quota) {
+        failedAllocations++;
+        return nullptr;
+    }
+
+    BlockHeader* header = nullptr;
+    if (sizeClass != LARGE_CLASS) {
+        FreeBlock* block = freeLists[sizeClass];
+        if (block) {
+            freeLists[sizeClass] = block->next;
+            header = reinterpret_cast<BlockHeader*>(block) - 1;
+        }
+    } else {
+        // Large blocks are rare; first fit, no splitting
+        FreeBlock** link = &largeFree;
+        while (*link) {
+            BlockHeader* candidate = reinterpret_cast<BlockHeader*>(*link) - 1;
+            if (candidate->size >= blockSize) {
+                header = candidate;
+                blockSize = candidate->size;
+                *link = (*link)->next;
+                break;
+            }
+            link = &(*link)->next;
+        }
+    }
+
+    if (!header) {
+        header = (BlockHeader*)bump(sizeof(BlockHeader) + blockSize);
+        if (!header) {
+            failedAllocations++;
+            return nullptr;
+        }
+        header->size = blockSize;
+        header->sizeClass = sizeClass;
+    }
+
+    used += header->size;
+    if (used > peakUsed) {
+        peakUsed = used;
+    }
+    return header + 1;
+}
+
+void AppArena::release(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    BlockHeader* header = reinterpret_cast<BlockHeader*>(ptr) - 1;
+    FreeBlock* block = reinterpret_cast<FreeBlock*>(ptr);
+    FreeBlock** list = header->sizeClass == LARGE_CLASS ? &largeFree : &freeLists[header->sizeClass];
+
+    block->next = *list;
+    *list = block;
+    used -= header->size;
+}
+
+void AppArena::reset() {
+    // Keep the oldest chunk so a restarted app does not go back to the allocator
+    Chunk* keep = chunks;
+    while (keep && keep->next) {
+        Chunk* chunk = keep;
+        keep = keep->next;
+        reserved -= chunk->size;
+        free(chunk);
+    }
+
+    chunks = keep;
+    if (chunks) {
+        chunks->offset = 0;
+    }
+
+    memset(freeLists, 0, sizeof(freeLists));
+    largeFree = nullptr;
+    used = 0;
+}
+
+void AppArena::releaseAll() {
+    while (chunks) {
+        Chunk* chunk = chunks;
+        chunks = chunks->next;
+        free(chunk);
+    }
+
+    reserved = 0;
+    memset(freeLists, 0, sizeof(freeLists));
+    largeFree = nullptr;
+    used = 0;
+}
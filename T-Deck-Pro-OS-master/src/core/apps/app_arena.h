@@ -0,0 +1,98 @@
+#ifndef APP_ARENA_H
+#define APP_ARENA_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Per-application memory arena
+ *
+ * Memory comes from PSRAM chunks that are bump-allocated. Freed blocks go to
+ * power-of-two size class free lists (16 B - 2 KB) and are reused by the next
+ * allocation of the same class, so a long running app recycles its own blocks
+ * instead of fragmenting the shared heap. Larger blocks are kept on a
+ * first-fit list. Allocation, release and quota checks are O(1) for class
+ * sized blocks.
+ *
+ * An arena belongs to one app and takes no locks; use it only from the tasks
+ * that run that app.
+ */
+class AppArena {
+public:
+    /**
+     * @brief Constructor
+     * @param quota Maximum bytes handed out at once
+     */
+    explicit AppArena(size_t quota);
+    ~AppArena();
+
+    AppArena(const AppArena&) = delete;
+    AppArena& operator=(const AppArena&) = delete;
+
+    /**
+     * @brief Allocate a block
+     * @param size Requested size in bytes
+     * @return 8-byte aligned block, nullptr if the quota or PSRAM is exhausted
+     */
+    void* allocate(size_t size);
+
+    /**
+     * @brief Return a block to its free list
+     * @param ptr Block from allocate(), nullptr is ignored
+     */
+    void release(void* ptr);
+
+    /**
+     * @brief Drop every allocation at once, keeping the first chunk for reuse
+     */
+    void reset();
+
+    /**
+     * @brief Drop every allocation and return all chunks to the system
+     */
+    void releaseAll();
+
+    size_t getUsed() const { return used; }
+    size_t getPeakUsed() const { return peakUsed; }
+    size_t getReserved() const { return reserved; }
+    size_t getQuota() const { return quota; }
+    uint32_t getFailedAllocations() const { return failedAllocations; }
+
+private:
+    static const size_t CHUNK_SIZE = 32 * 1024;
+    static const uint8_t SIZE_CLASS_COUNT = 8;
+    static const uint8_t MIN_CLASS_SHIFT = 4;           // Smallest class is 16 bytes
+    static const size_t MAX_CLASS_SIZE = 1 << (MIN_CLASS_SHIFT + SIZE_CLASS_COUNT - 1);
+    static const uint32_t LARGE_CLASS = 0xFF;
+
+    // Precedes every block; 8 bytes keeps payloads 8-byte aligned
+    struct BlockHeader {
+        uint32_t size;          // Usable bytes
+        uint32_t sizeClass;     // Free list index or LARGE_CLASS
+    };
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct Chunk {
+        Chunk* next;
+        size_t size;            // Usable bytes after the header
+        size_t offset;          // Bump pointer
+        uint32_t padding;
+    };
+
+    size_t quota;
+    size_t used;
+    size_t peakUsed;
+    size_t reserved;
+    uint32_t failedAllocations;
+    Chunk* chunks;              // Head is the chunk being bumped
+    FreeBlock* freeLists[SIZE_CLASS_COUNT];
+    FreeBlock* largeFree;
+
+    static uint8_t sizeClassFor(size_t size);
+    void* bump(size_t blockSize);
+    bool addChunk(size_t minimum);
+};
+
+#endif // APP_ARENA_H
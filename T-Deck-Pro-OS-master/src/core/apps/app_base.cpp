@@ -9,36 +9,24 @@ AppBase::AppBase(const AppInfo& info)
     , previousState(AppState::STOPPED)
     , startTime(0)
     , pauseTime(0)
+    , lastActiveTime(0)
+    , handle(INVALID_APP_HANDLE)
     , mainContainer(nullptr)
-    , totalAllocatedMemory(0)
+    , memoryArena(MAX_MEMORY_PER_APP)
 {
-    memoryMutex = xSemaphoreCreateMutex();
-    if (!memoryMutex) {
-        Logger::error("AppBase", "Failed to create memory mutex for app: " + appInfo.name);
-    }
 }
 
 AppBase::~AppBase() {
     cleanup();
     destroyUI();
     
-    // Free all allocated memory
-    if (memoryMutex) {
-        xSemaphoreTake(memoryMutex, portMAX_DELAY);
-        for (auto& block : allocatedMemory) {
-            free(block.ptr);
-        }
-        allocatedMemory.clear();
-        totalAllocatedMemory = 0;
-        xSemaphoreGive(memoryMutex);
-        vSemaphoreDelete(memoryMutex);
-    }
+    // Arena chunks are released by the arena destructor
 }
 
 bool AppBase::setState(AppState newState) {
     if (!validateStateTransition(currentState, newState)) {
-        Logger::error("AppBase", "Invalid state transition for " + appInfo.name + 
-                     " from " + String((int)currentState) + " to " + String((int)newState));
+        LOG_ERROR_TAG("AppBase", "Invalid state transition for %s from %d to %d",
+                      appInfo.name.c_str(), (int)currentState, (int)newState);
         return false;
     }
 
@@ -49,10 +37,17 @@ bool AppBase::setState(AppState newState) {
     logStateChange(oldState, newState);
 
     // Update timing
-    if (newState == AppState::RUNNING && oldState != AppState::RESUMING) {
-        startTime = millis();
+    if (newState == AppState::RUNNING) {
+        if (oldState != AppState::RESUMING) {
+            startTime = millis();
+        }
+        lastActiveTime = millis();
     } else if (newState == AppState::PAUSED) {
         pauseTime = millis();
+    } else if (newState == AppState::STOPPED) {
+        // Everything the app allocated goes at once; no per-block frees on teardown
+        memoryArena.reset();
+        appInfo.memoryUsage = 0;
     }
 
     // Notify callback
@@ -68,68 +63,23 @@ void AppBase::setStateChangeCallback(std::function<void(AppBase*, AppState, AppS
 }
 
 void* AppBase::allocateMemory(size_t size) {
-    if (!memoryMutex) return nullptr;
-
-    xSemaphoreTake(memoryMutex, portMAX_DELAY);
-
-    // Check memory limit
-    if (totalAllocatedMemory + size > MAX_MEMORY_PER_APP) {
-        Logger::warning("AppBase", "Memory limit exceeded for app: " + appInfo.name);
-        xSemaphoreGive(memoryMutex);
-        return nullptr;
+    void* ptr = memoryArena.allocate(size);
+    if (!ptr) {
+        LOG_WARN_TAG("AppBase", "Memory limit exceeded for app: %s", appInfo.name.c_str());
     }
-
-    void* ptr = malloc(size);
-    if (ptr) {
-        MemoryBlock block = {ptr, size, millis()};
-        allocatedMemory.push_back(block);
-        totalAllocatedMemory += size;
-        
-        Logger::debug("AppBase", "Allocated " + String(size) + " bytes for " + appInfo.name + 
-                     " (total: " + String(totalAllocatedMemory) + ")");
-    }
-
-    xSemaphoreGive(memoryMutex);
     return ptr;
 }
 
 void AppBase::freeMemory(void* ptr) {
-    if (!ptr || !memoryMutex) return;
-
-    xSemaphoreTake(memoryMutex, portMAX_DELAY);
-
-    for (auto it = allocatedMemory.begin(); it != allocatedMemory.end(); ++it) {
-        if (it->ptr == ptr) {
-            totalAllocatedMemory -= it->size;
-            allocatedMemory.erase(it);
-            free(ptr);
-            Logger::debug("AppBase", "Freed memory for " + appInfo.name + 
-                         " (total: " + String(totalAllocatedMemory) + ")");
-            break;
-        }
-    }
-
-    xSemaphoreGive(memoryMutex);
+    memoryArena.release(ptr);
 }
 
 bool AppBase::checkMemoryLimit() {
-    if (!memoryMutex) return false;
-
-    xSemaphoreTake(memoryMutex, portMAX_DELAY);
-    bool withinLimit = totalAllocatedMemory < MAX_MEMORY_PER_APP;
-    xSemaphoreGive(memoryMutex);
-
-    return withinLimit;
+    return memoryArena.getUsed() < MAX_MEMORY_PER_APP;
 }
 
 size_t AppBase::getCurrentMemoryUsage() const {
-    if (!memoryMutex) return 0;
-
-    xSemaphoreTake(memoryMutex, portMAX_DELAY);
-    size_t usage = totalAllocatedMemory;
-    xSemaphoreGive(memoryMutex);
-
-    return usage;
+    return memoryArena.getUsed();
 }
 
 void AppBase::destroyUI() {
@@ -139,15 +89,22 @@ void AppBase::destroyUI() {
     }
 }
 
+void AppBase::ensureUI(lv_obj_t* parent) {
+    // Rebuilds a UI dropped under memory pressure; apps without a UI return nullptr
+    if (!mainContainer) {
+        mainContainer = createUI(parent);
+    }
+}
+
 bool AppBase::saveConfig() {
     String configPath = getConfigPath();
     if (configPath.isEmpty()) {
-        Logger::error("AppBase", "Invalid config path for app: " + appInfo.name);
+        LOG_ERROR_TAG("AppBase", "Invalid config path for app: %s", appInfo.name.c_str());
         return false;
     }
 
     if (!createConfigDirectory()) {
-        Logger::error("AppBase", "Failed to create config directory for app: " + appInfo.name);
+        LOG_ERROR_TAG("AppBase", "Failed to create config directory for app: %s", appInfo.name.c_str());
         return false;
     }
 
@@ -161,36 +118,36 @@ bool AppBase::saveConfig() {
 
     File configFile = SPIFFS.open(configPath, "w");
     if (!configFile) {
-        Logger::error("AppBase", "Failed to open config file for writing: " + configPath);
+        LOG_ERROR_TAG("AppBase", "Failed to open config file for writing: %s", configPath.c_str());
         return false;
     }
 
     if (serializeJson(doc, configFile) == 0) {
-        Logger::error("AppBase", "Failed to write config for app: " + appInfo.name);
+        LOG_ERROR_TAG("AppBase", "Failed to write config for app: %s", appInfo.name.c_str());
         configFile.close();
         return false;
     }
 
     configFile.close();
-    Logger::info("AppBase", "Config saved for app: " + appInfo.name);
+    LOG_INFO_TAG("AppBase", "Config saved for app: %s", appInfo.name.c_str());
     return true;
 }
 
 bool AppBase::loadConfig() {
     String configPath = getConfigPath();
     if (configPath.isEmpty()) {
-        Logger::warning("AppBase", "No config path for app: " + appInfo.name);
+        LOG_WARN_TAG("AppBase", "No config path for app: %s", appInfo.name.c_str());
         return false;
     }
 
     if (!SPIFFS.exists(configPath)) {
-        Logger::info("AppBase", "No existing config for app: " + appInfo.name);
+        LOG_INFO_TAG("AppBase", "No existing config for app: %s", appInfo.name.c_str());
         return true; // Not an error - first run
     }
 
     File configFile = SPIFFS.open(configPath, "r");
     if (!configFile) {
-        Logger::error("AppBase", "Failed to open config file: " + configPath);
+        LOG_ERROR_TAG("AppBase", "Failed to open config file: %s", configPath.c_str());
         return false;
     }
 
@@ -199,18 +156,18 @@ bool AppBase::loadConfig() {
     configFile.close();
 
     if (error) {
-        Logger::error("AppBase", "Failed to parse config for app: " + appInfo.name + 
-                     " - " + String(error.c_str()));
+        LOG_ERROR_TAG("AppBase", "Failed to parse config for app: %s - %s",
+                      appInfo.name.c_str(), error.c_str());
         return false;
     }
 
     // Validate config
     if (doc["app_name"] != appInfo.name) {
-        Logger::warning("AppBase", "Config app name mismatch for: " + appInfo.name);
+        LOG_WARN_TAG("AppBase", "Config app name mismatch for: %s", appInfo.name.c_str());
         return false;
     }
 
-    Logger::info("AppBase", "Config loaded for app: " + appInfo.name);
+    LOG_INFO_TAG("AppBase", "Config loaded for app: %s", appInfo.name.c_str());
     return true;
 }
 
@@ -218,12 +175,13 @@ void AppBase::resetConfig() {
     String configPath = getConfigPath();
     if (!configPath.isEmpty() && SPIFFS.exists(configPath)) {
         SPIFFS.remove(configPath);
-        Logger::info("AppBase", "Config reset for app: " + appInfo.name);
+        LOG_INFO_TAG("AppBase", "Config reset for app: %s", appInfo.name.c_str());
     }
 }
 
 void AppBase::logStateChange(AppState from, AppState to) {
-    String fromStr, toStr;
+    const char* fromStr = "?";
+    const char* toStr = "?";
     
     switch (from) {
         case AppState::STOPPED: fromStr = "STOPPED"; break;
@@ -245,7 +203,7 @@ void AppBase::logStateChange(AppState from, AppState to) {
         case AppState::STOPPING: toStr = "STOPPING"; break;
     }
 
-    Logger::info("AppBase", appInfo.name + " state: " + fromStr + " -> " + toStr);
+    LOG_INFO_TAG("AppBase", "%s state: %s -> %s", appInfo.name.c_str(), fromStr, toStr);
 }
 
 bool AppBase::validateStateTransition(AppState from, AppState to) {
@@ -277,6 +235,10 @@ String AppBase::getConfigPath() const {
     return "/config/apps/" + appInfo.name + ".json";
 }
 
+String AppBase::getStatePath() const {
+    return "/state/apps/" + appInfo.name + ".json";
+}
+
 bool AppBase::createConfigDirectory() {
     // SPIFFS doesn't have directories, but we can simulate them
     return true;
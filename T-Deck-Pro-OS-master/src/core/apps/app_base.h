@@ -3,7 +3,15 @@
 
 #include <Arduino.h>
 #include <lvgl.h>
+#include <ArduinoJson.h>
 #include <functional>
+#include "app_arena.h"
+
+/**
+ * @brief Interned application ID, an index into the app manager's slot table
+ */
+typedef uint8_t AppHandle;
+static const AppHandle INVALID_APP_HANDLE = 0xFF;
 
 /**
  * @brief Base class for all applications in the T-Deck-Pro OS
@@ -69,12 +77,23 @@ public:
     virtual lv_obj_t* createUI(lv_obj_t* parent) { return nullptr; }
     virtual void updateUI() {}
     virtual void destroyUI();
+    void ensureUI(lv_obj_t* parent);
+
+    // Hibernation (virtual - override to survive memory pressure without a cold start)
+    virtual bool saveState(JsonObject state) { return false; }
+    virtual bool restoreState(JsonObjectConst state) { return false; }
 
     // Getters
     const AppInfo& getInfo() const { return appInfo; }
     AppState getState() const { return currentState; }
     uint32_t getRunTime() const { return millis() - startTime; }
     size_t getCurrentMemoryUsage() const;
+    size_t getResidentMemory() const { return memoryArena.getUsed(); }
+    uint32_t getLastActiveTime() const { return lastActiveTime; }
+    void markActive() { lastActiveTime = millis(); }
+    String getStatePath() const;
+    AppHandle getHandle() const { return handle; }
+    void setHandle(AppHandle appHandle) { handle = appHandle; }
     bool isRunning() const { return currentState == AppState::RUNNING; }
     bool isPaused() const { return currentState == AppState::PAUSED; }
     lv_obj_t* getMainContainer() const { return mainContainer; }
@@ -83,7 +102,7 @@ public:
     bool setState(AppState newState);
     void setStateChangeCallback(std::function<void(AppBase*, AppState, AppState)> callback);
 
-    // Memory management
+    // Memory management (app arena; use from the app's own task)
     void* allocateMemory(size_t size);
     void freeMemory(void* ptr);
     bool checkMemoryLimit();
@@ -99,17 +118,13 @@ protected:
     AppState previousState;
     uint32_t startTime;
     uint32_t pauseTime;
+    uint32_t lastActiveTime;
+    AppHandle handle;
     lv_obj_t* mainContainer;
     std::function<void(AppBase*, AppState, AppState)> stateChangeCallback;
 
-    // Memory tracking
-    struct MemoryBlock {
-        void* ptr;
-        size_t size;
-        uint32_t timestamp;
-    };
-    std::vector<MemoryBlock> allocatedMemory;
-    size_t totalAllocatedMemory;
+    // Memory tracking; the arena is reset in one step when the app stops
+    AppArena memoryArena;
 
     // Helper methods
     void logStateChange(AppState from, AppState to);
@@ -122,7 +137,6 @@ protected:
 
 private:
     static const size_t MAX_MEMORY_PER_APP = 512 * 1024; // 512KB per app
-    mutable SemaphoreHandle_t memoryMutex;
 };
 
 /**
@@ -1,7 +1,11 @@
 #include "app_manager.h"
 #include "../utils/logger.h"
+#include "../utils/trace.h"
+#include "../../services/power_manager.h"
 #include <SPIFFS.h>
 #include <ArduinoJson.h>
+#include <esp_heap_caps.h>
+#include <algorithm>
 
 AppManager& AppManager::getInstance() {
     static AppManager instance;
@@ -17,21 +21,24 @@ AppManager::~AppManager() {
 
 void AppManager::initialize() {
     if (initialized) {
-        Logger::warning("AppManager", "Already initialized");
+        LOG_WARN_TAG("AppManager", "Already initialized");
         return;
     }
 
-    managerMutex = xSemaphoreCreateMutex();
+    managerMutex = xSemaphoreCreateRecursiveMutex();
     if (!managerMutex) {
-        Logger::error("AppManager", "Failed to create manager mutex");
+        LOG_ERROR_TAG("AppManager", "Failed to create manager mutex");
         return;
     }
 
-    activeAppId = "";
+    registeredCount = 0;
+    runningCount = 0;
+    activeApp = INVALID_APP_HANDLE;
     appSwitcherContainer = nullptr;
     appSwitcherVisible = false;
     lastMemoryCheck = 0;
     lastUpdate = 0;
+    deferredStarts = 0;
 
     // Load system configuration
     loadSystemConfig();
@@ -40,121 +47,185 @@ void AppManager::initialize() {
     createAppSwitcherUI();
 
     initialized = true;
-    Logger::info("AppManager", "Application manager initialized");
+    LOG_INFO_TAG("AppManager", "Application manager initialized");
 }
 
-bool AppManager::registerApp(const String& appId, AppFactory* factory, 
+bool AppManager::isRegistered(AppHandle handle) const {
+    return handle < MAX_REGISTERED_APPS && slots[handle].registration.factory != nullptr;
+}
+
+AppHandle AppManager::findApp(const String& appId) const {
+    // The only String compare on any path; everything after works on the handle
+    for (AppHandle i = 0; i < MAX_REGISTERED_APPS; i++) {
+        if (slots[i].registration.factory && slots[i].registration.appId == appId) {
+            return i;
+        }
+    }
+    return INVALID_APP_HANDLE;
+}
+
+const String& AppManager::getAppId(AppHandle handle) const {
+    static const String empty;
+    return isRegistered(handle) ? slots[handle].registration.appId : empty;
+}
+
+bool AppManager::registerApp(const String& appId, AppFactory* factory,
                            bool autoStart, const std::vector<String>& dependencies) {
     if (!factory) {
-        Logger::error("AppManager", "Cannot register app with null factory: " + appId);
+        LOG_ERROR_TAG("AppManager", "Cannot register app with null factory: %s", appId.c_str());
         return false;
     }
 
     if (!managerMutex) {
-        Logger::error("AppManager", "Manager not initialized");
+        LOG_ERROR_TAG("AppManager", "Manager not initialized");
         return false;
     }
 
-    xSemaphoreTake(managerMutex, portMAX_DELAY);
+    xSemaphoreTakeRecursive(managerMutex, portMAX_DELAY);
 
     // Check if already registered
-    if (registeredApps.find(appId) != registeredApps.end()) {
-        Logger::warning("AppManager", "App already registered: " + appId);
-        xSemaphoreGive(managerMutex);
+    if (findApp(appId) != INVALID_APP_HANDLE) {
+        LOG_WARN_TAG("AppManager", "App already registered: %s", appId.c_str());
+        xSemaphoreGiveRecursive(managerMutex);
         return false;
     }
 
-    // Check for circular dependencies
+    // Dependencies must not lead back to this app
     std::vector<String> visited;
-    if (hasCircularDependency(appId, visited)) {
-        Logger::error("AppManager", "Circular dependency detected for app: " + appId);
-        xSemaphoreGive(managerMutex);
-        return false;
+    visited.push_back(appId);
+    for (const String& dep : dependencies) {
+        if (hasCircularDependency(dep, visited)) {
+            LOG_ERROR_TAG("AppManager", "Circular dependency detected for app: %s", appId.c_str());
+            xSemaphoreGiveRecursive(managerMutex);
+            return false;
+        }
     }
 
-    // Register the app
-    AppRegistration registration;
-    registration.appId = appId;
-    registration.factory = factory;
-    registration.autoStart = autoStart;
-    registration.dependencies = dependencies;
-    registration.registrationTime = millis();
-
-    registeredApps[appId] = registration;
+    AppHandle handle = INVALID_APP_HANDLE;
+    for (AppHandle i = 0; i < MAX_REGISTERED_APPS; i++) {
+        if (!slots[i].registration.factory) {
+            handle = i;
+            break;
+        }
+    }
 
-    Logger::info("AppManager", "Registered app: " + appId + 
-                (autoStart ? " (auto-start)" : ""));
+    if (handle == INVALID_APP_HANDLE) {
+        LOG_ERROR_TAG("AppManager", "App table full, cannot register: %s", appId.c_str());
+        xSemaphoreGiveRecursive(managerMutex);
+        return false;
+    }
 
-    xSemaphoreGive(managerMutex);
+    // Register the app
+    AppSlot& slot = slots[handle];
+    slot.registration.appId = appId;
+    slot.registration.factory = factory;
+    slot.registration.autoStart = autoStart;
+    slot.registration.dependencies = dependencies;
+    slot.registration.registrationTime = millis();
+    slot.instance = nullptr;
+    slot.messageHandler = nullptr;
+    slot.hibernatedState = "";
+    registeredCount++;
+
+    LOG_INFO_TAG("AppManager", "Registered app: %s%s", appId.c_str(), autoStart ? " (auto-start)" : "");
+
+    xSemaphoreGiveRecursive(managerMutex);
     return true;
 }
 
 bool AppManager::unregisterApp(const String& appId) {
     if (!managerMutex) return false;
 
-    xSemaphoreTake(managerMutex, portMAX_DELAY);
+    xSemaphoreTakeRecursive(managerMutex, portMAX_DELAY);
+
+    AppHandle handle = findApp(appId);
+    if (handle == INVALID_APP_HANDLE) {
+        xSemaphoreGiveRecursive(managerMutex);
+        return false;
+    }
 
     // Stop app if running
-    if (runningApps.find(appId) != runningApps.end()) {
-        stopApp(appId);
+    if (slots[handle].instance) {
+        stopApp(handle);
     }
 
     // Remove registration
-    auto it = registeredApps.find(appId);
-    if (it != registeredApps.end()) {
-        delete it->second.factory;
-        registeredApps.erase(it);
-        Logger::info("AppManager", "Unregistered app: " + appId);
-        xSemaphoreGive(managerMutex);
-        return true;
-    }
+    AppSlot& slot = slots[handle];
+    delete slot.registration.factory;
+    slot.registration.factory = nullptr;
+    slot.registration.appId = "";
+    slot.registration.dependencies.clear();
+    slot.messageHandler = nullptr;
+    slot.hibernatedState = "";
+    registeredCount--;
+    LOG_INFO_TAG("AppManager", "Unregistered app: %s", appId.c_str());
+
+    xSemaphoreGiveRecursive(managerMutex);
+    return true;
+}
 
-    xSemaphoreGive(managerMutex);
-    return false;
+bool AppManager::isAppRegistered(const String& appId) const {
+    return findApp(appId) != INVALID_APP_HANDLE;
 }
 
 AppManager::LaunchResult AppManager::launchApp(const String& appId) {
+    AppHandle handle = findApp(appId);
+    if (handle == INVALID_APP_HANDLE) {
+        LOG_ERROR_TAG("AppManager", "App not registered: %s", appId.c_str());
+        return LaunchResult::APP_NOT_FOUND;
+    }
+    return launchApp(handle);
+}
+
+AppManager::LaunchResult AppManager::launchApp(AppHandle handle) {
+    return launchInstance(handle, false);
+}
+
+AppManager::LaunchResult AppManager::launchInstance(AppHandle handle, bool rehydrating) {
     if (!managerMutex) return LaunchResult::LAUNCH_FAILED;
 
-    xSemaphoreTake(managerMutex, portMAX_DELAY);
+    xSemaphoreTakeRecursive(managerMutex, portMAX_DELAY);
 
     // Check if app is registered
-    auto regIt = registeredApps.find(appId);
-    if (regIt == registeredApps.end()) {
-        Logger::error("AppManager", "App not registered: " + appId);
-        xSemaphoreGive(managerMutex);
+    if (!isRegistered(handle)) {
+        xSemaphoreGiveRecursive(managerMutex);
         return LaunchResult::APP_NOT_FOUND;
     }
 
+    AppSlot& slot = slots[handle];
+    const String& appId = slot.registration.appId;
+
     // Check if already running
-    if (runningApps.find(appId) != runningApps.end()) {
-        Logger::warning("AppManager", "App already running: " + appId);
-        xSemaphoreGive(managerMutex);
+    if (slot.instance) {
+        LOG_WARN_TAG("AppManager", "App already running: %s", appId.c_str());
+        xSemaphoreGiveRecursive(managerMutex);
         return LaunchResult::APP_ALREADY_RUNNING;
     }
 
     // Check dependencies
-    if (!checkDependencies(appId)) {
-        Logger::error("AppManager", "Dependencies not met for app: " + appId);
-        xSemaphoreGive(managerMutex);
+    if (!checkDependencies(handle)) {
+        LOG_ERROR_TAG("AppManager", "Dependencies not met for app: %s", appId.c_str());
+        xSemaphoreGiveRecursive(managerMutex);
         return LaunchResult::DEPENDENCY_MISSING;
     }
 
     // Check if we can launch (memory, app limits)
-    if (!canLaunchApp(appId)) {
-        Logger::error("AppManager", "Cannot launch app due to system limits: " + appId);
-        xSemaphoreGive(managerMutex);
+    if (!canLaunchApp(handle, rehydrating)) {
+        LOG_ERROR_TAG("AppManager", "Cannot launch app due to system limits: %s", appId.c_str());
+        xSemaphoreGiveRecursive(managerMutex);
         return LaunchResult::INSUFFICIENT_MEMORY;
     }
 
     // Create app instance
-    AppBase* app = regIt->second.factory->createApp();
+    AppBase* app = slot.registration.factory->createApp();
     if (!app) {
-        Logger::error("AppManager", "Failed to create app instance: " + appId);
-        xSemaphoreGive(managerMutex);
+        LOG_ERROR_TAG("AppManager", "Failed to create app instance: %s", appId.c_str());
+        xSemaphoreGiveRecursive(managerMutex);
         return LaunchResult::LAUNCH_FAILED;
     }
 
+    app->setHandle(handle);
+
     // Set state change callback
     app->setStateChangeCallback([this](AppBase* app, AppBase::AppState oldState, AppBase::AppState newState) {
         onAppStateChange(app, oldState, newState);
@@ -162,78 +233,364 @@ AppManager::LaunchResult AppManager::launchApp(const String& appId) {
 
     // Initialize and start app
     app->setState(AppBase::AppState::STARTING);
-    
+
     if (!app->initialize()) {
-        Logger::error("AppManager", "Failed to initialize app: " + appId);
+        LOG_ERROR_TAG("AppManager", "Failed to initialize app: %s", appId.c_str());
         delete app;
-        xSemaphoreGive(managerMutex);
+        xSemaphoreGiveRecursive(managerMutex);
         return LaunchResult::LAUNCH_FAILED;
     }
 
     if (!app->start()) {
-        Logger::error("AppManager", "Failed to start app: " + appId);
+        LOG_ERROR_TAG("AppManager", "Failed to start app: %s", appId.c_str());
         app->cleanup();
         delete app;
-        xSemaphoreGive(managerMutex);
+        xSemaphoreGiveRecursive(managerMutex);
         return LaunchResult::LAUNCH_FAILED;
     }
 
     // Add to running apps
-    runningApps[appId] = app;
+    slot.instance = app;
+    runningCount++;
     app->setState(AppBase::AppState::RUNNING);
 
-    Logger::info("AppManager", "Successfully launched app: " + appId);
+    LOG_INFO_TAG("AppManager", "Successfully launched app: %s", appId.c_str());
 
     // Set as active if no active app
-    if (activeAppId.isEmpty()) {
+    if (activeApp == INVALID_APP_HANDLE) {
         setActiveApp(appId);
     }
 
-    xSemaphoreGive(managerMutex);
+    xSemaphoreGiveRecursive(managerMutex);
     return LaunchResult::SUCCESS;
 }
 
 bool AppManager::stopApp(const String& appId) {
+    AppHandle handle = findApp(appId);
+    if (handle == INVALID_APP_HANDLE) {
+        LOG_WARN_TAG("AppManager", "App not running: %s", appId.c_str());
+        return false;
+    }
+    return stopApp(handle);
+}
+
+bool AppManager::stopApp(AppHandle handle) {
+    if (!managerMutex || !isRegistered(handle)) return false;
+
+    xSemaphoreTakeRecursive(managerMutex, portMAX_DELAY);
+
+    AppSlot& slot = slots[handle];
+    if (!slot.instance) {
+        // An explicit stop discards hibernated state
+        if (!slot.hibernatedState.isEmpty()) {
+            SPIFFS.remove(slot.hibernatedState);
+            slot.hibernatedState = "";
+            LOG_INFO_TAG("AppManager", "Discarded hibernated app: %s", slot.registration.appId.c_str());
+            xSemaphoreGiveRecursive(managerMutex);
+            return true;
+        }
+        LOG_WARN_TAG("AppManager", "App not running: %s", slot.registration.appId.c_str());
+        xSemaphoreGiveRecursive(managerMutex);
+        return false;
+    }
+
+    slot.instance->setState(AppBase::AppState::STOPPING);
+    teardownApp(handle);
+
+    LOG_INFO_TAG("AppManager", "Stopped app: %s", slot.registration.appId.c_str());
+
+    // Switch active app if this was active
+    if (activeApp == INVALID_APP_HANDLE) {
+        for (AppHandle i = 0; i < MAX_REGISTERED_APPS; i++) {
+            if (slots[i].instance) {
+                setActiveApp(slots[i].registration.appId);
+                break;
+            }
+        }
+    }
+
+    xSemaphoreGiveRecursive(managerMutex);
+    return true;
+}
+
+bool AppManager::restartApp(const String& appId) {
+    AppHandle handle = findApp(appId);
+    if (handle == INVALID_APP_HANDLE) {
+        return false;
+    }
+
+    xSemaphoreTakeRecursive(managerMutex, portMAX_DELAY);
+    if (slots[handle].instance) {
+        stopApp(handle);
+    }
+    bool restarted = launchApp(handle) == LaunchResult::SUCCESS;
+    xSemaphoreGiveRecursive(managerMutex);
+    return restarted;
+}
+
+bool AppManager::pauseApp(const String& appId) {
+    if (!managerMutex) return false;
+
+    xSemaphoreTakeRecursive(managerMutex, portMAX_DELAY);
+
+    AppHandle handle = findApp(appId);
+    AppBase* app = getApp(handle);
+    if (!app || !app->isRunning()) {
+        xSemaphoreGiveRecursive(managerMutex);
+        return false;
+    }
+
+    app->setState(AppBase::AppState::PAUSING);
+    bool paused = app->pause();
+    app->setState(paused ? AppBase::AppState::PAUSED : AppBase::AppState::STOPPING);
+    if (!paused) {
+        LOG_ERROR_TAG("AppManager", "Failed to pause app: %s", appId.c_str());
+        teardownApp(handle);
+    }
+
+    xSemaphoreGiveRecursive(managerMutex);
+    return paused;
+}
+
+bool AppManager::resumeApp(const String& appId) {
     if (!managerMutex) return false;
 
-    xSemaphoreTake(managerMutex, portMAX_DELAY);
+    xSemaphoreTakeRecursive(managerMutex, portMAX_DELAY);
 
-    auto it = runningApps.find(appId);
-    if (it == runningApps.end()) {
-        Logger::warning("AppManager", "App not running: " + appId);
-        xSemaphoreGive(managerMutex);
+    AppHandle handle = findApp(appId);
+    if (handle == INVALID_APP_HANDLE) {
+        xSemaphoreGiveRecursive(managerMutex);
+        return false;
+    }
+
+    // Hibernated apps come back through a start plus state restore, not a resume
+    if (!slots[handle].hibernatedState.isEmpty()) {
+        bool rehydrated = rehydrateApp(handle);
+        xSemaphoreGiveRecursive(managerMutex);
+        return rehydrated;
+    }
+
+    AppBase* app = slots[handle].instance;
+    if (!app || !app->isPaused()) {
+        xSemaphoreGiveRecursive(managerMutex);
+        return false;
+    }
+
+    app->setState(AppBase::AppState::RESUMING);
+
+    // The UI may have been dropped under memory pressure; rebuild it only now
+    app->ensureUI(lv_scr_act());
+
+    if (!app->resume()) {
+        LOG_ERROR_TAG("AppManager", "Failed to resume app: %s", appId.c_str());
+        app->setState(AppBase::AppState::STOPPING);
+        teardownApp(handle);
+        xSemaphoreGiveRecursive(managerMutex);
+        return false;
+    }
+
+    app->setState(AppBase::AppState::RUNNING);
+    xSemaphoreGiveRecursive(managerMutex);
+    return true;
+}
+
+bool AppManager::hibernateApp(AppHandle handle) {
+    // Caller holds managerMutex
+    AppBase* app = getApp(handle);
+    if (!app) {
+        return false;
+    }
+
+    DynamicJsonDocument doc(HIBERNATE_DOC_SIZE);
+    if (!app->saveState(doc.to<JsonObject>())) {
+        return false;   // App does not support hibernation
+    }
+    if (doc.overflowed()) {
+        // A truncated state would restore wrongly; let the app be killed instead
+        LOG_WARN_TAG("AppManager", "State too large to hibernate: %s", slots[handle].registration.appId.c_str());
+        return false;
+    }
+
+    String path = app->getStatePath();
+    File stateFile = SPIFFS.open(path, "w");
+    if (!stateFile) {
+        LOG_ERROR_TAG("AppManager", "Failed to open state file: %s", path.c_str());
+        return false;
+    }
+    bool written = serializeJson(doc, stateFile) > 0;
+    stateFile.close();
+    if (!written) {
+        SPIFFS.remove(path);
         return false;
     }
 
-    AppBase* app = it->second;
     app->setState(AppBase::AppState::STOPPING);
+    teardownApp(handle);
+    slots[handle].hibernatedState = path;
+
+    LOG_INFO_TAG("AppManager", "Hibernated app: %s", slots[handle].registration.appId.c_str());
+    return true;
+}
+
+bool AppManager::rehydrateApp(AppHandle handle) {
+    // Caller holds managerMutex. The user asked for this app back, so memory
+    // pressure does not block it; the next memory check evicts something else.
+    if (launchInstance(handle, true) != LaunchResult::SUCCESS) {
+        return false;
+    }
+
+    AppSlot& slot = slots[handle];
+    File stateFile = SPIFFS.open(slot.hibernatedState, "r");
+    if (stateFile) {
+        DynamicJsonDocument doc(HIBERNATE_DOC_SIZE);
+        DeserializationError error = deserializeJson(doc, stateFile);
+        stateFile.close();
+
+        if (error || !slot.instance->restoreState(doc.as<JsonObjectConst>())) {
+            LOG_WARN_TAG("AppManager", "State restore failed, app cold started: %s", slot.registration.appId.c_str());
+        }
+    }
+
+    SPIFFS.remove(slot.hibernatedState);
+    slot.hibernatedState = "";
+    LOG_INFO_TAG("AppManager", "Rehydrated app: %s", slot.registration.appId.c_str());
+    return true;
+}
+
+void AppManager::teardownApp(AppHandle handle) {
+    // Caller holds managerMutex and has moved the app to STOPPING
+    AppBase* app = getApp(handle);
+    if (!app) {
+        return;
+    }
 
-    // Stop the app
     app->stop();
     app->cleanup();
+    app->destroyUI();
     app->setState(AppBase::AppState::STOPPED);
 
-    // Remove from running apps
-    runningApps.erase(it);
+    slots[handle].instance = nullptr;
+    runningCount--;
+    slots[handle].registration.factory->destroyApp(app);
 
-    // Clean up app instance
-    auto regIt = registeredApps.find(appId);
-    if (regIt != registeredApps.end()) {
-        regIt->second.factory->destroyApp(app);
+    if (activeApp == handle) {
+        activeApp = INVALID_APP_HANDLE;
     }
+}
 
-    Logger::info("AppManager", "Stopped app: " + appId);
+AppHandle AppManager::selectEvictionCandidate(bool pausedOnly, bool requireUI, uint32_t skipMask) const {
+    // Lowest priority first, then least recently used, then largest resident footprint
+    AppHandle bestHandle = INVALID_APP_HANDLE;
+    const AppBase* best = nullptr;
+
+    for (AppHandle i = 0; i < MAX_REGISTERED_APPS; i++) {
+        const AppBase* app = slots[i].instance;
+        if (!app || i == activeApp || (skipMask & (1UL << i)) ||
+            app->getInfo().priority == AppBase::AppPriority::CRITICAL ||
+            (pausedOnly && !app->isPaused()) ||
+            (requireUI && !app->getMainContainer())) {
+            continue;
+        }
 
-    // Switch active app if this was active
-    if (activeAppId == appId) {
-        activeAppId = "";
-        if (!runningApps.empty()) {
-            setActiveApp(runningApps.begin()->first);
+        bool better = !best;
+        if (best) {
+            int priority = (int)app->getInfo().priority;
+            int bestPriority = (int)best->getInfo().priority;
+            if (priority != bestPriority) {
+                better = priority < bestPriority;
+            } else if (app->getLastActiveTime() != best->getLastActiveTime()) {
+                better = app->getLastActiveTime() < best->getLastActiveTime();
+            } else {
+                better = app->getResidentMemory() > best->getResidentMemory();
+            }
+        }
+
+        if (better) {
+            best = app;
+            bestHandle = i;
         }
     }
 
-    xSemaphoreGive(managerMutex);
-    return true;
+    return bestHandle;
+}
+
+String AppManager::findBestAppToKill() const {
+    return getAppId(selectEvictionCandidate(false, false, 0));
+}
+
+void AppManager::killAppForMemory() {
+    AppHandle victim = selectEvictionCandidate(false, false, 0);
+    if (victim == INVALID_APP_HANDLE) {
+        return;
+    }
+
+    AppBase* app = slots[victim].instance;
+    LOG_WARN_TAG("AppManager", "Killing app for memory: %s (%u bytes resident)",
+                 slots[victim].registration.appId.c_str(), (unsigned)app->getResidentMemory());
+    app->setState(AppBase::AppState::STOPPING);
+    teardownApp(victim);
+}
+
+bool AppManager::checkMemoryLimits() {
+    MemoryPressure pressure = getMemoryPressure();
+    if (pressure == MemoryPressure::NONE) {
+        return true;
+    }
+
+    if (!managerMutex) return false;
+    xSemaphoreTakeRecursive(managerMutex, portMAX_DELAY);
+
+    // Tier 1: paused apps give up their LVGL trees, rebuilt on resume
+    while (pressure >= MemoryPressure::MODERATE) {
+        AppHandle handle = selectEvictionCandidate(true, true, 0);
+        if (handle == INVALID_APP_HANDLE) break;
+        slots[handle].instance->destroyUI();
+        LOG_INFO_TAG("AppManager", "Dropped UI of paused app: %s", slots[handle].registration.appId.c_str());
+        pressure = getMemoryPressure();
+    }
+
+    // Tier 2: paused apps are saved to flash and unloaded
+    uint32_t skipMask = 0;
+    while (pressure >= MemoryPressure::HIGH) {
+        AppHandle handle = selectEvictionCandidate(true, false, skipMask);
+        if (handle == INVALID_APP_HANDLE) break;
+        if (!hibernateApp(handle)) {
+            skipMask |= 1UL << handle;
+            continue;
+        }
+        pressure = getMemoryPressure();
+    }
+
+    // Tier 3: kill, paused or not
+    while (pressure >= MemoryPressure::CRITICAL) {
+        uint8_t before = runningCount;
+        killAppForMemory();
+        if (runningCount == before) break;
+        pressure = getMemoryPressure();
+    }
+
+    if (pressure >= MemoryPressure::HIGH && memoryWarningCallback) {
+        memoryWarningCallback(getTotalMemoryUsage(), heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+    }
+
+    xSemaphoreGiveRecursive(managerMutex);
+    return pressure < MemoryPressure::HIGH;
+}
+
+void AppManager::handleMemoryWarning() {
+    if (!managerMutex) return;
+
+    xSemaphoreTakeRecursive(managerMutex, portMAX_DELAY);
+
+    // Let apps trim caches before anything is evicted
+    for (AppHandle i = 0; i < MAX_REGISTERED_APPS; i++) {
+        if (slots[i].instance) {
+            slots[i].instance->onMemoryWarning();
+        }
+    }
+    checkMemoryLimits();
+
+    xSemaphoreGiveRecursive(managerMutex);
 }
 
 void AppManager::update() {
@@ -247,12 +604,13 @@ void AppManager::update() {
     }
     lastUpdate = now;
 
-    xSemaphoreTake(managerMutex, portMAX_DELAY);
+    xSemaphoreTakeRecursive(managerMutex, portMAX_DELAY);
 
-    // Update all running apps
-    for (auto& pair : runningApps) {
-        if (pair.second->isRunning()) {
-            pair.second->updateUI();
+    // Update all running apps; a straight walk over the slot table
+    for (AppHandle i = 0; i < MAX_REGISTERED_APPS; i++) {
+        AppBase* app = slots[i].instance;
+        if (app && app->isRunning()) {
+            app->updateUI();
         }
     }
 
@@ -265,80 +623,227 @@ void AppManager::update() {
     // Clean up stopped apps
     cleanupStoppedApps();
 
-    xSemaphoreGive(managerMutex);
+    xSemaphoreGiveRecursive(managerMutex);
 }
 
 void AppManager::handleKeyPress(uint8_t key) {
     if (!managerMutex) return;
 
-    xSemaphoreTake(managerMutex, portMAX_DELAY);
+    // Input brings the power manager back to the ACTIVE profile
+    PowerManager::getInstance().notifyUserActivity();
+
+    xSemaphoreTakeRecursive(managerMutex, portMAX_DELAY);
+
+    // First use; the input goes to the app the user expects to see
+    startDeferredApps(true);
 
     // Send to active app first
-    if (!activeAppId.isEmpty()) {
-        auto it = runningApps.find(activeAppId);
-        if (it != runningApps.end()) {
-            it->second->onKeyPress(key);
+    AppBase* app = getApp(activeApp);
+    if (app) {
+        app->markActive();
+        app->onKeyPress(key);
+    }
+
+    xSemaphoreGiveRecursive(managerMutex);
+}
+
+void AppManager::handleTouch(lv_event_t* e) {
+    if (!managerMutex) return;
+
+    PowerManager::getInstance().notifyUserActivity();
+
+    xSemaphoreTakeRecursive(managerMutex, portMAX_DELAY);
+
+    startDeferredApps(true);
+
+    AppBase* app = getApp(activeApp);
+    if (app) {
+        app->markActive();
+        app->onTouch(e);
+    }
+
+    xSemaphoreGiveRecursive(managerMutex);
+}
+
+void AppManager::handleNetworkChange(bool connected) {
+    if (!managerMutex) return;
+
+    xSemaphoreTakeRecursive(managerMutex, portMAX_DELAY);
+    for (AppHandle i = 0; i < MAX_REGISTERED_APPS; i++) {
+        if (slots[i].instance) {
+            slots[i].instance->onNetworkChange(connected);
         }
     }
+    xSemaphoreGiveRecursive(managerMutex);
+}
+
+void AppManager::handleBatteryChange(uint8_t percentage) {
+    if (!managerMutex) return;
 
-    xSemaphoreGive(managerMutex);
+    xSemaphoreTakeRecursive(managerMutex, portMAX_DELAY);
+    for (AppHandle i = 0; i < MAX_REGISTERED_APPS; i++) {
+        if (slots[i].instance) {
+            slots[i].instance->onBatteryChange(percentage);
+        }
+    }
+    xSemaphoreGiveRecursive(managerMutex);
 }
 
 void AppManager::setActiveApp(const String& appId) {
     if (!managerMutex) return;
 
-    xSemaphoreTake(managerMutex, portMAX_DELAY);
+    xSemaphoreTakeRecursive(managerMutex, portMAX_DELAY);
+
+    AppHandle handle = findApp(appId);
+    AppBase* app = getApp(handle);
+    if (!app) {
+        LOG_WARN_TAG("AppManager", "Cannot set non-running app as active: %s", appId.c_str());
+        xSemaphoreGiveRecursive(managerMutex);
+        return;
+    }
+
+    activeApp = handle;
+    app->markActive();
+    LOG_INFO_TAG("AppManager", "Active app set to: %s", appId.c_str());
+
+    xSemaphoreGiveRecursive(managerMutex);
+}
+
+String AppManager::getActiveApp() const {
+    return getAppId(activeApp);
+}
+
+lv_obj_t* AppManager::getActiveAppContainer() const {
+    AppBase* app = getApp(activeApp);
+    return app ? app->getMainContainer() : nullptr;
+}
+
+AppBase* AppManager::getApp(const String& appId) const {
+    return getApp(findApp(appId));
+}
+
+AppBase* AppManager::getApp(AppHandle handle) const {
+    return handle < MAX_REGISTERED_APPS ? slots[handle].instance : nullptr;
+}
+
+std::vector<String> AppManager::getRunningApps() const {
+    std::vector<String> apps;
+    apps.reserve(runningCount);
+    for (AppHandle i = 0; i < MAX_REGISTERED_APPS; i++) {
+        if (slots[i].instance) {
+            apps.push_back(slots[i].registration.appId);
+        }
+    }
+    return apps;
+}
+
+std::vector<String> AppManager::getRegisteredApps() const {
+    std::vector<String> apps;
+    apps.reserve(registeredCount);
+    for (AppHandle i = 0; i < MAX_REGISTERED_APPS; i++) {
+        if (slots[i].registration.factory) {
+            apps.push_back(slots[i].registration.appId);
+        }
+    }
+    return apps;
+}
+
+AppBase::AppInfo AppManager::getAppInfo(const String& appId) const {
+    AppHandle handle = findApp(appId);
+    if (handle == INVALID_APP_HANDLE) {
+        return AppBase::AppInfo{};
+    }
+    return slots[handle].instance ? slots[handle].instance->getInfo()
+                                  : slots[handle].registration.factory->getAppInfo();
+}
+
+bool AppManager::isAppRunning(const String& appId) const {
+    return getApp(appId) != nullptr;
+}
+
+bool AppManager::sendMessage(const String& fromApp, const String& toApp,
+                             const String& message, const String& data) {
+    return sendMessage(findApp(fromApp), findApp(toApp), message.c_str(), data.c_str());
+}
+
+bool AppManager::sendMessage(AppHandle from, AppHandle to, const char* message, const char* data) {
+    if (!managerMutex || !isRegistered(to)) return false;
+
+    xSemaphoreTakeRecursive(managerMutex, portMAX_DELAY);
+    AppMessageHandler handler = slots[to].messageHandler;
+    xSemaphoreGiveRecursive(managerMutex);
+
+    if (!handler) {
+        return false;
+    }
 
-    if (runningApps.find(appId) == runningApps.end()) {
-        Logger::warning("AppManager", "Cannot set non-running app as active: " + appId);
-        xSemaphoreGive(managerMutex);
+    // Payload pointers go straight through; nothing is copied
+    handler(from, message, data ? data : "");
+    return true;
+}
+
+void AppManager::setMessageHandler(const String& appId,
+                                   std::function<void(const String&, const String&, const String&)> handler) {
+    AppHandle handle = findApp(appId);
+    if (!handler) {
+        setMessageHandler(handle, nullptr);
         return;
     }
 
-    activeAppId = appId;
-    Logger::info("AppManager", "Active app set to: " + appId);
+    // Legacy String handlers pay for the conversions themselves
+    setMessageHandler(handle, [this, handler](AppHandle from, const char* message, const char* data) {
+        handler(getAppId(from), String(message), String(data));
+    });
+}
+
+void AppManager::setMessageHandler(AppHandle handle, AppMessageHandler handler) {
+    if (!managerMutex || !isRegistered(handle)) return;
 
-    xSemaphoreGive(managerMutex);
+    xSemaphoreTakeRecursive(managerMutex, portMAX_DELAY);
+    slots[handle].messageHandler = handler;
+    xSemaphoreGiveRecursive(managerMutex);
 }
 
 AppManager::SystemStats AppManager::getSystemStats() const {
     SystemStats stats = {};
-    
+
     if (!managerMutex) return stats;
 
-    xSemaphoreTake(managerMutex, portMAX_DELAY);
+    xSemaphoreTakeRecursive(managerMutex, portMAX_DELAY);
 
     stats.totalMemoryUsed = getTotalMemoryUsage();
-    stats.availableMemory = MAX_TOTAL_MEMORY - stats.totalMemoryUsed;
-    stats.runningApps = runningApps.size();
-    stats.totalApps = registeredApps.size();
+    stats.availableMemory = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    if (stats.availableMemory == 0) {
+        stats.availableMemory = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    }
+    stats.runningApps = runningCount;
+    stats.totalApps = registeredCount;
     stats.uptime = millis();
-    stats.cpuUsage = 0.0f; // TODO: Implement CPU usage calculation
+    stats.cpuUsage = trace_get_cpu_usage();
 
-    xSemaphoreGive(managerMutex);
+    xSemaphoreGiveRecursive(managerMutex);
     return stats;
 }
 
-bool AppManager::checkDependencies(const String& appId) const {
-    auto it = registeredApps.find(appId);
-    if (it == registeredApps.end()) return false;
+bool AppManager::checkDependencies(AppHandle handle) const {
+    if (!isRegistered(handle)) return false;
 
-    for (const String& dep : it->second.dependencies) {
-        if (runningApps.find(dep) == runningApps.end()) {
+    for (const String& dep : slots[handle].registration.dependencies) {
+        if (!getApp(findApp(dep))) {
             return false;
         }
     }
     return true;
 }
 
-bool AppManager::canLaunchApp(const String& appId) const {
+bool AppManager::canLaunchApp(AppHandle handle, bool ignorePressure) const {
     // Check app count limit
-    if (runningApps.size() >= MAX_RUNNING_APPS) {
+    if (runningCount >= MAX_RUNNING_APPS) {
         return false;
     }
 
-    // Check memory limit (rough estimate)
-    if (getTotalMemoryUsage() > MAX_TOTAL_MEMORY * 0.8) {
+    // Launching under high pressure would only trigger eviction of something else
+    if (!ignorePressure && getMemoryPressure() >= MemoryPressure::HIGH) {
         return false;
     }
 
@@ -347,41 +852,74 @@ bool AppManager::canLaunchApp(const String& appId) const {
 
 size_t AppManager::getTotalMemoryUsage() const {
     size_t total = 0;
-    for (const auto& pair : runningApps) {
-        total += pair.second->getCurrentMemoryUsage();
+    for (AppHandle i = 0; i < MAX_REGISTERED_APPS; i++) {
+        if (slots[i].instance) {
+            total += slots[i].instance->getCurrentMemoryUsage();
+        }
     }
     return total;
 }
 
+AppManager::MemoryPressure AppManager::getMemoryPressure() const {
+    MemoryPressure pressure = MemoryPressure::NONE;
+
+    // PSRAM holds app arenas and LVGL buffers; only judge it when the board has some
+    if (heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0) {
+        size_t psramFree = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+        if (psramFree < PSRAM_CRITICAL_FREE) {
+            pressure = MemoryPressure::CRITICAL;
+        } else if (psramFree < PSRAM_HIGH_FREE) {
+            pressure = MemoryPressure::HIGH;
+        } else if (psramFree < PSRAM_MODERATE_FREE) {
+            pressure = MemoryPressure::MODERATE;
+        }
+    }
+
+    size_t internalFree = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    MemoryPressure internal = MemoryPressure::NONE;
+    if (internalFree < INTERNAL_CRITICAL_FREE) {
+        internal = MemoryPressure::CRITICAL;
+    } else if (internalFree < INTERNAL_HIGH_FREE) {
+        internal = MemoryPressure::HIGH;
+    } else if (internalFree < INTERNAL_MODERATE_FREE) {
+        internal = MemoryPressure::MODERATE;
+    }
+
+    return internal > pressure ? internal : pressure;
+}
+
+bool AppManager::isAppHibernated(const String& appId) const {
+    AppHandle handle = findApp(appId);
+    return handle != INVALID_APP_HANDLE && !slots[handle].hibernatedState.isEmpty();
+}
+
 void AppManager::onAppStateChange(AppBase* app, AppBase::AppState oldState, AppBase::AppState newState) {
     if (appStateChangeCallback) {
-        String appId;
-        // Find app ID
-        for (const auto& pair : runningApps) {
-            if (pair.second == app) {
-                appId = pair.first;
-                break;
-            }
-        }
-        appStateChangeCallback(appId, oldState, newState);
+        // The handle is stored on the app, no lookup needed
+        appStateChangeCallback(getAppId(app->getHandle()), oldState, newState);
     }
 }
 
+void AppManager::setAppStateChangeCallback(std::function<void(const String&, AppBase::AppState, AppBase::AppState)> callback) {
+    appStateChangeCallback = callback;
+}
+
+void AppManager::setMemoryWarningCallback(std::function<void(size_t, size_t)> callback) {
+    memoryWarningCallback = callback;
+}
+
 void AppManager::cleanupStoppedApps() {
     // Remove apps that are in STOPPED state
-    auto it = runningApps.begin();
-    while (it != runningApps.end()) {
-        if (it->second->getState() == AppBase::AppState::STOPPED) {
-            Logger::info("AppManager", "Cleaning up stopped app: " + it->first);
-            
-            auto regIt = registeredApps.find(it->first);
-            if (regIt != registeredApps.end()) {
-                regIt->second.factory->destroyApp(it->second);
+    for (AppHandle i = 0; i < MAX_REGISTERED_APPS; i++) {
+        AppBase* app = slots[i].instance;
+        if (app && app->getState() == AppBase::AppState::STOPPED) {
+            LOG_INFO_TAG("AppManager", "Cleaning up stopped app: %s", slots[i].registration.appId.c_str());
+            slots[i].instance = nullptr;
+            runningCount--;
+            slots[i].registration.factory->destroyApp(app);
+            if (activeApp == i) {
+                activeApp = INVALID_APP_HANDLE;
             }
-            
-            it = runningApps.erase(it);
-        } else {
-            ++it;
         }
     }
 }
@@ -399,9 +937,9 @@ bool AppManager::hasCircularDependency(const String& appId, std::vector<String>&
 
     visited.push_back(appId);
 
-    auto it = registeredApps.find(appId);
-    if (it != registeredApps.end()) {
-        for (const String& dep : it->second.dependencies) {
+    AppHandle handle = findApp(appId);
+    if (handle != INVALID_APP_HANDLE) {
+        for (const String& dep : slots[handle].registration.dependencies) {
             if (hasCircularDependency(dep, visited)) {
                 return true;
             }
@@ -412,33 +950,87 @@ bool AppManager::hasCircularDependency(const String& appId, std::vector<String>&
     return false;
 }
 
+void AppManager::autoStartApps() {
+    if (!managerMutex) return;
+
+    xSemaphoreTakeRecursive(managerMutex, portMAX_DELAY);
+    uint32_t deferred = 0;
+    for (AppHandle i = 0; i < MAX_REGISTERED_APPS; i++) {
+        const AppSlot& slot = slots[i];
+        if (slot.registration.factory && slot.registration.autoStart && !slot.instance) {
+            deferred |= 1UL << i;
+        }
+    }
+    deferredStarts = deferred;
+    xSemaphoreGiveRecursive(managerMutex);
+
+    LOG_INFO_TAG("AppManager", "Deferred %d auto-start apps", __builtin_popcount(deferred));
+}
+
+bool AppManager::startDeferredApps(bool all) {
+    if (!managerMutex || !deferredStarts) return false;
+
+    xSemaphoreTakeRecursive(managerMutex, portMAX_DELAY);
+    for (AppHandle i = 0; i < MAX_REGISTERED_APPS && deferredStarts; i++) {
+        uint32_t bit = 1UL << i;
+        if (!(deferredStarts & bit)) {
+            continue;
+        }
+        deferredStarts &= ~bit;
+
+        // Launched explicitly in the meantime, or unregistered
+        if (!isRegistered(i) || slots[i].instance) {
+            continue;
+        }
+
+        uint32_t started = millis();
+        LaunchResult result = launchApp(i);
+        if (result == LaunchResult::SUCCESS) {
+            LOG_INFO_TAG("AppManager", "Auto-started %s in %lu ms",
+                         slots[i].registration.appId.c_str(), millis() - started);
+        } else {
+            LOG_ERROR_TAG("AppManager", "Failed to auto-start %s: %d",
+                          slots[i].registration.appId.c_str(), (int)result);
+        }
+        if (!all) {
+            break;
+        }
+    }
+    bool more = deferredStarts != 0;
+    xSemaphoreGiveRecursive(managerMutex);
+    return more;
+}
+
 void AppManager::shutdown() {
     if (!initialized) return;
 
-    Logger::info("AppManager", "Shutting down application manager");
+    LOG_INFO_TAG("AppManager", "Shutting down application manager");
 
     if (managerMutex) {
-        xSemaphoreTake(managerMutex, portMAX_DELAY);
-
-        // Stop all running apps
-        for (auto& pair : runningApps) {
-            pair.second->stop();
-            pair.second->cleanup();
-            
-            auto regIt = registeredApps.find(pair.first);
-            if (regIt != registeredApps.end()) {
-                regIt->second.factory->destroyApp(pair.second);
+        xSemaphoreTakeRecursive(managerMutex, portMAX_DELAY);
+
+        // Stop all running apps and drop their registrations
+        for (AppHandle i = 0; i < MAX_REGISTERED_APPS; i++) {
+            AppSlot& slot = slots[i];
+            if (slot.instance) {
+                slot.instance->stop();
+                slot.instance->cleanup();
+                slot.registration.factory->destroyApp(slot.instance);
+                slot.instance = nullptr;
+            }
+            if (slot.registration.factory) {
+                delete slot.registration.factory;
+                slot.registration.factory = nullptr;
+                slot.registration.appId = "";
+                slot.messageHandler = nullptr;
             }
         }
-        runningApps.clear();
-
-        // Clean up registered apps
-        for (auto& pair : registeredApps) {
-            delete pair.second.factory;
-        }
-        registeredApps.clear();
+        registeredCount = 0;
+        runningCount = 0;
+        activeApp = INVALID_APP_HANDLE;
+        deferredStarts = 0;
 
-        xSemaphoreGive(managerMutex);
+        xSemaphoreGiveRecursive(managerMutex);
     }
 
     initialized = false;
@@ -452,4 +1044,4 @@ bool AppManager::saveSystemConfig() {
 bool AppManager::loadSystemConfig() {
     // TODO: Implement system configuration loading
     return true;
-}
\ No newline at end of file
+}
@@ -2,7 +2,6 @@
 #define APP_MANAGER_H
 
 #include "app_base.h"
-#include <map>
 #include <vector>
 #include <functional>
 
@@ -11,6 +10,9 @@
  * 
  * Manages application lifecycle, memory allocation, and inter-app communication.
  * Implements singleton pattern for global access.
+ *
+ * Apps live in a fixed slot table indexed by AppHandle. The String based API
+ * resolves the ID to a handle once and then works on the slot.
  */
 class AppManager {
 public:
@@ -31,6 +33,15 @@ public:
         uint32_t registrationTime;
     };
 
+    enum class MemoryPressure {
+        NONE,
+        MODERATE,   // Drop UI trees of paused apps
+        HIGH,       // Hibernate paused apps to flash
+        CRITICAL    // Kill apps
+    };
+
+    typedef std::function<void(AppHandle from, const char* message, const char* data)> AppMessageHandler;
+
     struct SystemStats {
         size_t totalMemoryUsed;
         size_t availableMemory;
@@ -49,6 +60,8 @@ public:
                     const std::vector<String>& dependencies = {});
     bool unregisterApp(const String& appId);
     bool isAppRegistered(const String& appId) const;
+    AppHandle findApp(const String& appId) const;
+    const String& getAppId(AppHandle handle) const;
 
     // Application lifecycle
     LaunchResult launchApp(const String& appId);
@@ -56,9 +69,12 @@ public:
     bool resumeApp(const String& appId);
     bool stopApp(const String& appId);
     bool restartApp(const String& appId);
+    LaunchResult launchApp(AppHandle handle);
+    bool stopApp(AppHandle handle);
 
     // Application queries
     AppBase* getApp(const String& appId) const;
+    AppBase* getApp(AppHandle handle) const;
     std::vector<String> getRunningApps() const;
     std::vector<String> getRegisteredApps() const;
     AppBase::AppInfo getAppInfo(const String& appId) const;
@@ -68,13 +84,24 @@ public:
     void initialize();
     void update(); // Call from main loop
     void shutdown();
+
+    /**
+     * @brief Queue the auto-start apps instead of launching them during boot
+     *
+     * Deferred apps are launched on first use - a key press or touch - or by
+     * startDeferredApps() from the UI task once the first frame is out.
+     */
     void autoStartApps();
+    bool startDeferredApps(bool all = false);   // Launches one, or all; true while more wait
+    bool hasDeferredApps() const { return deferredStarts != 0; }
     
     // Memory management
     SystemStats getSystemStats() const;
     bool checkMemoryLimits();
     void forceGarbageCollection();
     size_t getTotalMemoryUsage() const;
+    MemoryPressure getMemoryPressure() const;
+    bool isAppHibernated(const String& appId) const;
 
     // Event handling
     void handleKeyPress(uint8_t key);
@@ -95,6 +122,8 @@ public:
                     const String& message, const String& data = "");
     void setMessageHandler(const String& appId, 
                           std::function<void(const String&, const String&, const String&)> handler);
+    bool sendMessage(AppHandle from, AppHandle to, const char* message, const char* data = "");
+    void setMessageHandler(AppHandle handle, AppMessageHandler handler);
 
     // Configuration
     bool saveSystemConfig();
@@ -113,12 +142,20 @@ private:
     AppManager(const AppManager&) = delete;
     AppManager& operator=(const AppManager&) = delete;
 
+    struct AppSlot {
+        AppRegistration registration;   // factory == nullptr marks a free slot
+        AppBase* instance;              // Non-null while running or paused
+        AppMessageHandler messageHandler;
+        String hibernatedState;         // Saved state file, empty unless hibernated
+    };
+
     // Internal data
-    std::map<String, AppRegistration> registeredApps;
-    std::map<String, AppBase*> runningApps;
-    std::map<String, std::function<void(const String&, const String&, const String&)>> messageHandlers;
+    static const uint8_t MAX_REGISTERED_APPS = 16;
+    AppSlot slots[MAX_REGISTERED_APPS];
+    uint8_t registeredCount;
+    uint8_t runningCount;
     
-    String activeAppId;
+    AppHandle activeApp;
     lv_obj_t* appSwitcherContainer;
     bool appSwitcherVisible;
     
@@ -126,8 +163,14 @@ private:
     std::function<void(const String&, AppBase::AppState, AppBase::AppState)> appStateChangeCallback;
     std::function<void(size_t, size_t)> memoryWarningCallback;
 
-    // System limits
-    static const size_t MAX_TOTAL_MEMORY = 2 * 1024 * 1024; // 2MB total
+    // System limits; memory pressure is judged from real free heap, not a fixed budget
+    static const size_t PSRAM_MODERATE_FREE = 1024 * 1024;
+    static const size_t PSRAM_HIGH_FREE = 512 * 1024;
+    static const size_t PSRAM_CRITICAL_FREE = 256 * 1024;
+    static const size_t INTERNAL_MODERATE_FREE = 64 * 1024;
+    static const size_t INTERNAL_HIGH_FREE = 40 * 1024;
+    static const size_t INTERNAL_CRITICAL_FREE = 24 * 1024;
+    static const size_t HIBERNATE_DOC_SIZE = 4096;
     static const uint8_t MAX_RUNNING_APPS = 8;
     static const uint32_t MEMORY_CHECK_INTERVAL = 5000; // 5 seconds
     static const uint32_t UPDATE_INTERVAL = 100; // 100ms
@@ -135,24 +178,31 @@ private:
     uint32_t lastMemoryCheck;
     uint32_t lastUpdate;
     bool initialized;
+    volatile uint32_t deferredStarts;   // Bit per slot, auto-start apps not launched yet
 
     // Internal methods
-    bool checkDependencies(const String& appId) const;
+    bool checkDependencies(AppHandle handle) const;
     bool hasCircularDependency(const String& appId, std::vector<String>& visited) const;
     void onAppStateChange(AppBase* app, AppBase::AppState oldState, AppBase::AppState newState);
     void updateSystemStats();
     void cleanupStoppedApps();
-    bool canLaunchApp(const String& appId) const;
+    bool canLaunchApp(AppHandle handle, bool ignorePressure = false) const;
+    LaunchResult launchInstance(AppHandle handle, bool rehydrating);
+    bool isRegistered(AppHandle handle) const;
     void createAppSwitcherUI();
     void updateAppSwitcherUI();
     String findBestAppToKill() const;
+    AppHandle selectEvictionCandidate(bool pausedOnly, bool requireUI, uint32_t skipMask) const;
     void killAppForMemory();
+    bool hibernateApp(AppHandle handle);
+    bool rehydrateApp(AppHandle handle);
+    void teardownApp(AppHandle handle);
 
     // Configuration helpers
     String getConfigPath() const;
     bool createConfigDirectory();
 
-    // Mutex for thread safety
+    // Recursive mutex for thread safety; public methods call each other
     SemaphoreHandle_t managerMutex;
 };
 
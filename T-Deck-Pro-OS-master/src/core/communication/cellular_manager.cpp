@@ -6,11 +6,17 @@
  */
 
 #include "cellular_manager.h"
+#include "core/system/scheduler.h"
+#include "core/utils/trace.h"
+#include "core/hal/board_profile.h"
 #include <Arduino.h>
 
 namespace TDeckOS {
 namespace Communication {
 
+// Modem wiring of the board being built for
+using ModemPins = Board::Active::Modem;
+
 CellularManager::CellularManager()
     : m_serial(nullptr)
     , m_initialized(false)
@@ -26,7 +32,16 @@ CellularManager::CellularManager()
     , m_taskHandle(nullptr)
     , m_commandQueue(nullptr)
     , m_mutex(nullptr)
+    , m_requestPool{}
+    , m_activeRequest(nullptr)
+    , m_rxHead(0)
+    , m_rxTail(0)
+    , m_lineLength(0)
+    , m_registration(NetworkRegistration::UNKNOWN)
+    , m_networkType(CellularNetworkType::UNKNOWN)
     , m_lastActivity(0)
+    , m_lowPower(false)
+    , m_modemAsleep(false)
 {
 }
 
@@ -36,11 +51,16 @@ CellularManager::~CellularManager() {
 
 bool CellularManager::initialize(const CellularConfig& config) {
     if (m_initialized) {
-        LOG_WARN("Cellular", "Already initialized");
+        LOG_WARN_TAG("Cellular", "Already initialized");
         return true;
     }
 
-    LOG_INFO("Cellular", "Initializing cellular manager...");
+    if constexpr (!ModemPins::FITTED) {
+        LOG_INFO_TAG("Cellular", "No modem on %s", Board::Active::NAME);
+        return false;
+    }
+
+    LOG_INFO_TAG("Cellular", "Initializing cellular manager...");
     
     m_config = config;
     m_initTime = millis();
@@ -48,29 +68,53 @@ bool CellularManager::initialize(const CellularConfig& config) {
     // Create mutex
     m_mutex = xSemaphoreCreateMutex();
     if (!m_mutex) {
-        LOG_ERROR("Cellular", "Failed to create mutex");
+        LOG_ERROR_TAG("Cellular", "Failed to create mutex");
         return false;
     }
     
-    // Create command queue
-    m_commandQueue = xQueueCreate(10, sizeof(String*));
+    // Create command queue; it carries pointers into the fixed request pool
+    m_commandQueue = xQueueCreate(AT_POOL_SIZE, sizeof(ATRequest*));
     if (!m_commandQueue) {
-        LOG_ERROR("Cellular", "Failed to create command queue");
+        LOG_ERROR_TAG("Cellular", "Failed to create command queue");
         vSemaphoreDelete(m_mutex);
         return false;
     }
     
+    for (uint8_t i = 0; i < AT_POOL_SIZE; i++) {
+        m_requestPool[i].done = xSemaphoreCreateBinary();
+        m_requestPool[i].inUse = false;
+        if (!m_requestPool[i].done) {
+            LOG_ERROR_TAG("Cellular", "Failed to create request semaphore");
+            return false;
+        }
+    }
+    m_activeRequest = nullptr;
+    m_rxHead = m_rxTail = 0;
+    m_lineLength = 0;
+    
     // Initialize serial communication
     m_serial = &Serial1;
-    m_serial->begin(m_config.baudRate, SERIAL_8N1, BOARD_A7682E_RXD, BOARD_A7682E_TXD);
+    m_serial->setRxBufferSize(UART_RX_BUFFER_SIZE);
+    m_serial->begin(m_config.baudRate, SERIAL_8N1, ModemPins::RX, ModemPins::TX);
+    
+    // The UART event task wakes the AT engine when bytes arrive, so it never polls
+    m_serial->onReceive([this]() {
+        if (m_taskHandle) {
+            xTaskNotifyGive(m_taskHandle);
+        }
+    });
     
     // Configure control pins
-    pinMode(BOARD_A7682E_PWRKEY, OUTPUT);
-    pinMode(BOARD_A7682E_RST, OUTPUT);
-    pinMode(BOARD_6609_EN, OUTPUT);
+    pinMode(ModemPins::PWRKEY, OUTPUT);
+    if constexpr (ModemPins::RST != Board::NO_PIN) {
+        pinMode(ModemPins::RST, OUTPUT);
+    }
+    pinMode(ModemPins::POWER_ENABLE, OUTPUT);
+    pinMode(ModemPins::DTR, OUTPUT);
+    digitalWrite(ModemPins::DTR, LOW);
     
     // Enable power supply
-    digitalWrite(BOARD_6609_EN, HIGH);
+    digitalWrite(ModemPins::POWER_ENABLE, HIGH);
     delay(100);
     
     // Create cellular task
@@ -84,7 +128,7 @@ bool CellularManager::initialize(const CellularConfig& config) {
     );
     
     if (result != pdPASS) {
-        LOG_ERROR("Cellular", "Failed to create cellular task");
+        LOG_ERROR_TAG("Cellular", "Failed to create cellular task");
         vQueueDelete(m_commandQueue);
         vSemaphoreDelete(m_mutex);
         return false;
@@ -96,7 +140,7 @@ bool CellularManager::initialize(const CellularConfig& config) {
     // Reset statistics
     resetStats();
     
-    LOG_INFO("Cellular", "Cellular manager initialized successfully");
+    LOG_INFO_TAG("Cellular", "Cellular manager initialized successfully");
     return true;
 }
 
@@ -105,7 +149,7 @@ void CellularManager::deinitialize() {
         return;
     }
     
-    LOG_INFO("Cellular", "Deinitializing cellular manager...");
+    LOG_INFO_TAG("Cellular", "Deinitializing cellular manager...");
     
     // Power off modem
     powerOff();
@@ -117,9 +161,21 @@ void CellularManager::deinitialize() {
     }
     
     // Disable power supply
-    digitalWrite(BOARD_6609_EN, LOW);
+    digitalWrite(ModemPins::POWER_ENABLE, LOW);
     
     // Clean up FreeRTOS objects
+    for (uint8_t i = 0; i < AT_POOL_SIZE; i++) {
+        if (m_requestPool[i].done) {
+            vSemaphoreDelete(m_requestPool[i].done);
+            m_requestPool[i].done = nullptr;
+        }
+        m_requestPool[i].inUse = false;
+    }
+    if (m_activeRequest) {
+        sched_wake_unlock();
+        m_activeRequest = nullptr;
+    }
+    
     if (m_commandQueue) {
         vQueueDelete(m_commandQueue);
         m_commandQueue = nullptr;
@@ -134,32 +190,34 @@ void CellularManager::deinitialize() {
     m_poweredOn = false;
     m_status = CellularStatus::OFF;
     
-    LOG_INFO("Cellular", "Cellular manager deinitialized");
+    LOG_INFO_TAG("Cellular", "Cellular manager deinitialized");
 }
 
 bool CellularManager::powerOn() {
     if (!m_initialized) {
-        LOG_ERROR("Cellular", "Not initialized");
+        LOG_ERROR_TAG("Cellular", "Not initialized");
         return false;
     }
     
     if (m_poweredOn) {
-        LOG_WARN("Cellular", "Already powered on");
+        LOG_WARN_TAG("Cellular", "Already powered on");
         return true;
     }
     
-    LOG_INFO("Cellular", "Powering on A7682E modem...");
+    LOG_INFO_TAG("Cellular", "Powering on A7682E modem...");
     
-    // Reset modem
-    digitalWrite(BOARD_A7682E_RST, LOW);
-    delay(100);
-    digitalWrite(BOARD_A7682E_RST, HIGH);
-    delay(100);
+    // Reset modem, where the board wires up its reset line
+    if constexpr (ModemPins::RST != Board::NO_PIN) {
+        digitalWrite(ModemPins::RST, LOW);
+        delay(100);
+        digitalWrite(ModemPins::RST, HIGH);
+        delay(100);
+    }
     
     // Power on sequence
-    digitalWrite(BOARD_A7682E_PWRKEY, LOW);
+    digitalWrite(ModemPins::PWRKEY, LOW);
     delay(1000);
-    digitalWrite(BOARD_A7682E_PWRKEY, HIGH);
+    digitalWrite(ModemPins::PWRKEY, HIGH);
     delay(2000);
     
     // Wait for modem to respond
@@ -171,13 +229,13 @@ bool CellularManager::powerOn() {
         if (sendATCommand("AT", response, 1000)) {
             if (response.indexOf("OK") >= 0) {
                 m_poweredOn = true;
-                LOG_INFO("Cellular", "Modem powered on successfully");
+                LOG_INFO_TAG("Cellular", "Modem powered on successfully");
                 
                 // Initialize modem
                 if (initializeModem()) {
                     return true;
                 } else {
-                    LOG_ERROR("Cellular", "Failed to initialize modem");
+                    LOG_ERROR_TAG("Cellular", "Failed to initialize modem");
                     powerOff();
                     return false;
                 }
@@ -186,7 +244,7 @@ bool CellularManager::powerOn() {
         delay(1000);
     }
     
-    LOG_ERROR("Cellular", "Failed to power on modem");
+    LOG_ERROR_TAG("Cellular", "Failed to power on modem");
     m_status = CellularStatus::ERROR;
     return false;
 }
@@ -196,27 +254,58 @@ bool CellularManager::powerOff() {
         return true;
     }
     
-    LOG_INFO("Cellular", "Powering off A7682E modem...");
+    LOG_INFO_TAG("Cellular", "Powering off A7682E modem...");
     
     // Send power off command
     String response;
+    // The command wakes the modem if DTR let it sleep
+    m_lowPower = false;
     sendATCommand("AT+CPOF", response, 5000);
     
     // Force power off if needed
-    digitalWrite(BOARD_A7682E_PWRKEY, LOW);
+    digitalWrite(ModemPins::PWRKEY, LOW);
     delay(3000);
-    digitalWrite(BOARD_A7682E_PWRKEY, HIGH);
+    digitalWrite(ModemPins::PWRKEY, HIGH);
     
     m_poweredOn = false;
     m_status = CellularStatus::OFF;
+    m_modemAsleep = false;
+    digitalWrite(ModemPins::DTR, LOW);
     
-    LOG_INFO("Cellular", "Modem powered off");
+    LOG_INFO_TAG("Cellular", "Modem powered off");
     return true;
 }
 
+bool CellularManager::setLowPower(bool enable) {
+    if (!m_poweredOn) {
+        return false;
+    }
+    if (enable == m_lowPower) {
+        return true;
+    }
+    
+    bool queued;
+    if (enable) {
+        // Requested timers are left to the network; eDRX asks for an 81.92 s paging cycle on LTE
+        queued = sendATCommandAsync("AT+CPSMS=1") &&
+                 sendATCommandAsync("AT+CEDRXS=1,4,\"0101\"") &&
+                 sendATCommandAsync("AT+CSCLK=1");
+        m_lowPower = queued;
+    } else {
+        // Cleared first so DTR stays low; the first command wakes the modem
+        m_lowPower = false;
+        queued = sendATCommandAsync("AT+CSCLK=0") &&
+                 sendATCommandAsync("AT+CEDRXS=0") &&
+                 sendATCommandAsync("AT+CPSMS=0");
+    }
+    
+    LOG_INFO_TAG("Cellular", "Modem sleep %s", enable ? "enabled" : "disabled");
+    return queued;
+}
+
 bool CellularManager::connect(CellularEventCallback callback) {
     if (!m_poweredOn) {
-        LOG_ERROR("Cellular", "Modem not powered on");
+        LOG_ERROR_TAG("Cellular", "Modem not powered on");
         return false;
     }
     
@@ -225,19 +314,19 @@ bool CellularManager::connect(CellularEventCallback callback) {
     m_lastConnectAttempt = millis();
     m_stats.connectAttempts++;
     
-    LOG_INFO("Cellular", "Connecting to cellular network...");
+    LOG_INFO_TAG("Cellular", "Connecting to cellular network...");
     m_status = CellularStatus::SEARCHING;
     
     // Check SIM card
     if (getSIMStatus() != SIMStatus::READY) {
-        LOG_ERROR("Cellular", "SIM card not ready");
+        LOG_ERROR_TAG("Cellular", "SIM card not ready");
         m_status = CellularStatus::ERROR;
         return false;
     }
     
     // Set up PDP context
     if (!setupPDP()) {
-        LOG_ERROR("Cellular", "Failed to setup PDP context");
+        LOG_ERROR_TAG("Cellular", "Failed to setup PDP context");
         m_status = CellularStatus::ERROR;
         return false;
     }
@@ -249,7 +338,7 @@ bool CellularManager::connect(CellularEventCallback callback) {
             info.registration == NetworkRegistration::REGISTERED_ROAMING) {
             
             m_status = CellularStatus::REGISTERED;
-            LOG_INFO("Cellular", "Registered to network: %s", info.operatorName.c_str());
+            LOG_INFO_TAG("Cellular", "Registered to network: %s", info.operatorName.c_str());
             
             // Activate PDP context
             String response;
@@ -257,7 +346,7 @@ bool CellularManager::connect(CellularEventCallback callback) {
                 if (response.indexOf("OK") >= 0) {
                     m_status = CellularStatus::CONNECTED;
                     m_stats.successfulConnections++;
-                    LOG_INFO("Cellular", "Connected to cellular network");
+                    LOG_INFO_TAG("Cellular", "Connected to cellular network");
                     
                     if (m_eventCallback) {
                         m_eventCallback(m_status, "Connected");
@@ -269,14 +358,14 @@ bool CellularManager::connect(CellularEventCallback callback) {
         delay(1000);
     }
     
-    LOG_ERROR("Cellular", "Failed to connect to network");
+    LOG_ERROR_TAG("Cellular", "Failed to connect to network");
     m_status = CellularStatus::ERROR;
     return false;
 }
 
 void CellularManager::disconnect() {
     if (m_status == CellularStatus::CONNECTED) {
-        LOG_INFO("Cellular", "Disconnecting from cellular network...");
+        LOG_INFO_TAG("Cellular", "Disconnecting from cellular network...");
         
         String response;
         sendATCommand("AT+CGACT=0,1", response, 10000);
@@ -308,10 +397,19 @@ SIMStatus CellularManager::getSIMStatus() {
 
 CellularNetworkInfo CellularManager::getNetworkInfo() {
     CellularNetworkInfo info;
+    info.rssi = m_stats.lastRssi;
+    info.signalQuality = m_stats.lastSignalQuality;
+    
+    // Queue all three queries up front; the engine sends them back to back
+    ATRequest* cops = acquireRequest("AT+COPS?", 1000, true);
+    if (cops && !submitRequest(cops)) cops = nullptr;
+    ATRequest* csq = acquireRequest("AT+CSQ", 1000, true);
+    if (csq && !submitRequest(csq)) csq = nullptr;
+    ATRequest* creg = acquireRequest("AT+CREG?", 1000, true);
+    if (creg && !submitRequest(creg)) creg = nullptr;
     
-    // Get operator name
     String response;
-    if (sendATCommand("AT+COPS?", response, 1000)) {
+    if (cops && waitRequest(cops, response)) {
         int start = response.indexOf("\"");
         if (start >= 0) {
             int end = response.indexOf("\"", start + 1);
@@ -321,18 +419,18 @@ CellularNetworkInfo CellularManager::getNetworkInfo() {
         }
     }
     
-    // Get signal quality
-    if (sendATCommand("AT+CSQ", response, 1000)) {
+    if (csq && waitRequest(csq, response)) {
         parseSignalQuality(response);
         info.rssi = m_stats.lastRssi;
         info.signalQuality = m_stats.lastSignalQuality;
     }
     
-    // Get network registration
-    if (sendATCommand("AT+CREG?", response, 1000)) {
+    if (creg && waitRequest(creg, response)) {
         parseNetworkRegistration(response);
     }
     
+    info.registration = m_registration;
+    info.networkType = m_networkType;
     return info;
 }
 
@@ -356,11 +454,11 @@ uint8_t CellularManager::getSignalQuality() {
 
 bool CellularManager::sendSMS(const String& number, const String& message) {
     if (!isConnected()) {
-        LOG_ERROR("Cellular", "Not connected to network");
+        LOG_ERROR_TAG("Cellular", "Not connected to network");
         return false;
     }
     
-    LOG_INFO("Cellular", "Sending SMS to %s", number.c_str());
+    LOG_INFO_TAG("Cellular", "Sending SMS to %s", number.c_str());
     
     // Set SMS text mode
     String response;
@@ -368,23 +466,20 @@ bool CellularManager::sendSMS(const String& number, const String& message) {
         return false;
     }
     
-    // Set recipient
-    String cmd = "AT+CMGS=\"" + number + "\"";
-    m_serial->println(cmd);
-    delay(1000);
-    
-    // Send message
-    m_serial->print(message);
-    m_serial->write(0x1A); // Ctrl+Z
+    // Set recipient; the engine sends the text once the modem prompts with '>'
+    ATRequest* request = acquireRequest("AT+CMGS=\"" + number + "\"", 30000, true);
+    if (!request) {
+        return false;
+    }
+    request->payload = message;
     
-    // Wait for response
-    if (waitForResponse("OK", 30000)) {
+    if (submitRequest(request) && waitRequest(request, response)) {
         m_stats.smsMessagesSent++;
-        LOG_INFO("Cellular", "SMS sent successfully");
+        LOG_INFO_TAG("Cellular", "SMS sent successfully");
         return true;
     }
     
-    LOG_ERROR("Cellular", "Failed to send SMS");
+    LOG_ERROR_TAG("Cellular", "Failed to send SMS");
     return false;
 }
 
@@ -423,11 +518,11 @@ bool CellularManager::deleteSMS(uint16_t index) {
 
 bool CellularManager::makeCall(const String& number) {
     if (!isConnected()) {
-        LOG_ERROR("Cellular", "Not connected to network");
+        LOG_ERROR_TAG("Cellular", "Not connected to network");
         return false;
     }
     
-    LOG_INFO("Cellular", "Making call to %s", number.c_str());
+    LOG_INFO_TAG("Cellular", "Making call to %s", number.c_str());
     
     String cmd = "ATD" + number + ";";
     String response;
@@ -445,43 +540,230 @@ bool CellularManager::hangupCall() {
 }
 
 bool CellularManager::sendATCommand(const String& command, String& response, uint32_t timeoutMs) {
-    if (!m_serial) {
+    response = "";
+    if (isCellularTask(command)) {
         return false;
     }
     
-    if (xSemaphoreTake(m_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+    ATRequest* request = acquireRequest(command, timeoutMs, true);
+    if (!request) {
+        return false;
+    }
+    return executeRequest(command, request, response);
+}
+
+bool CellularManager::sendATCommandUntil(const String& command, const char* finalPrefix, String& response,
+                                         uint32_t timeoutMs) {
+    response = "";
+    if (isCellularTask(command)) {
         return false;
     }
     
-    // Clear input buffer
-    while (m_serial->available()) {
-        m_serial->read();
+    ATRequest* request = acquireRequest(command, timeoutMs, true);
+    if (!request) {
+        return false;
+    }
+    request->finalPrefix = finalPrefix;
+    return executeRequest(command, request, response);
+}
+
+bool CellularManager::readATData(const String& command, const char* dataPrefix, const char* finalPrefix,
+                                 uint8_t* buffer, size_t capacity, size_t& received, uint32_t timeoutMs) {
+    received = 0;
+    if (isCellularTask(command)) {
+        return false;
     }
     
-    // Send command
-    m_serial->println(command);
-    m_lastActivity = millis();
+    ATRequest* request = acquireRequest(command, timeoutMs, true);
+    if (!request) {
+        return false;
+    }
+    request->dataPrefix = dataPrefix;
+    request->finalPrefix = finalPrefix;
+    request->data = buffer;
+    request->dataCapacity = capacity;
     
-    // Wait for response
-    response = "";
-    uint32_t startTime = millis();
+    String response;
+    return executeRequest(command, request, response, &received);
+}
+
+bool CellularManager::isCellularTask(const String& command) const {
+    // The engine runs on the cellular task; blocking it on itself would deadlock
+    if (xTaskGetCurrentTaskHandle() == m_taskHandle) {
+        LOG_ERROR_TAG("Cellular", "Blocking AT command from cellular task: %s", command.c_str());
+        return true;
+    }
+    return false;
+}
+
+bool CellularManager::executeRequest(const String& command, ATRequest* request, String& response,
+                                     size_t* dataLength) {
+    if (!submitRequest(request)) {
+        return false;
+    }
     
-    while (millis() - startTime < timeoutMs) {
-        if (m_serial->available()) {
-            char c = m_serial->read();
-            response += c;
-            
-            if (response.endsWith("OK\r\n") || response.endsWith("ERROR\r\n")) {
+    bool success = waitRequest(request, response, dataLength);
+    LOG_DEBUG_TAG("Cellular", "AT: %s -> %s", command.c_str(), response.c_str());
+    return success;
+}
+
+bool CellularManager::sendATCommandAsync(const String& command, ATResponseCallback callback,
+                                         void* context, uint32_t timeoutMs) {
+    ATRequest* request = acquireRequest(command, timeoutMs, false);
+    if (!request) {
+        return false;
+    }
+    
+    request->callback = callback;
+    request->context = context;
+    
+    if (!submitRequest(request)) {
+        return false;
+    }
+    return true;
+}
+
+ATRequest* CellularManager::acquireRequest(const String& command, uint32_t timeoutMs, bool waiter) {
+    if (!m_serial || !m_mutex) {
+        return nullptr;
+    }
+    
+    ATRequest* request = nullptr;
+    if (xSemaphoreTake(m_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        for (uint8_t i = 0; i < AT_POOL_SIZE; i++) {
+            if (!m_requestPool[i].inUse) {
+                request = &m_requestPool[i];
+                request->inUse = true;
                 break;
             }
         }
-        delay(1);
+        xSemaphoreGive(m_mutex);
+    }
+    
+    if (!request) {
+        LOG_WARN_TAG("Cellular", "AT request pool exhausted, dropping %s", command.c_str());
+        return nullptr;
     }
     
+    // Strings keep their capacity between uses, so steady state does not allocate
+    request->command = command;
+    request->payload = "";
+    request->response = "";
+    request->timeoutMs = timeoutMs;
+    request->startTime = 0;
+    request->finalPrefix = nullptr;
+    request->dataPrefix = nullptr;
+    request->data = nullptr;
+    request->dataCapacity = 0;
+    request->dataLength = 0;
+    request->dataRemaining = 0;
+    request->callback = nullptr;
+    request->context = nullptr;
+    request->waiter = waiter;
+    request->completed = false;
+    request->success = false;
+    request->payloadSent = false;
+    xSemaphoreTake(request->done, 0);
+    return request;
+}
+
+void CellularManager::releaseRequest(ATRequest* request) {
+    if (xSemaphoreTake(m_mutex, portMAX_DELAY) == pdTRUE) {
+        request->inUse = false;
+        xSemaphoreGive(m_mutex);
+    }
+}
+
+bool CellularManager::submitRequest(ATRequest* request) {
+    if (xQueueSend(m_commandQueue, &request, 0) != pdTRUE) {
+        LOG_WARN_TAG("Cellular", "AT command queue full");
+        releaseRequest(request);
+        return false;
+    }
+    
+    if (m_taskHandle) {
+        xTaskNotifyGive(m_taskHandle);
+    }
+    return true;
+}
+
+bool CellularManager::waitRequest(ATRequest* request, String& response, size_t* dataLength) {
+    // The engine enforces the command timeout; the slack covers commands queued ahead
+    xSemaphoreTake(request->done, pdMS_TO_TICKS(request->timeoutMs + AT_QUEUE_SLACK_MS));
+    
+    bool success = false;
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    if (request->completed) {
+        response = request->response;
+        success = request->success;
+        if (dataLength) {
+            *dataLength = request->dataLength;
+        }
+        request->inUse = false;
+    } else {
+        // Give up on it; the engine releases the slot when the command finishes and
+        // must no longer write into the caller's buffer
+        request->waiter = false;
+        request->data = nullptr;
+        request->dataCapacity = 0;
+        response = "";
+    }
     xSemaphoreGive(m_mutex);
     
-    LOG_DEBUG("Cellular", "AT: %s -> %s", command.c_str(), response.c_str());
-    return response.length() > 0;
+    return success;
+}
+
+void CellularManager::startNextRequest() {
+    if (m_activeRequest) {
+        return;
+    }
+    
+    ATRequest* request = nullptr;
+    if (xQueueReceive(m_commandQueue, &request, 0) != pdTRUE) {
+        return;
+    }
+    
+    // The response arrives on the UART; stay awake until it is complete
+    sched_wake_lock();
+    if (m_modemAsleep) {
+        // DTR low wakes the modem; its UART needs a moment before it takes input
+        digitalWrite(ModemPins::DTR, LOW);
+        m_modemAsleep = false;
+        vTaskDelay(pdMS_TO_TICKS(DTR_WAKE_MS));
+    }
+    m_activeRequest = request;
+    request->startTime = millis();
+    request->traceStart = trace_begin();
+    m_serial->print(request->command);
+    m_serial->print("\r\n");
+    m_lastActivity = request->startTime;
+}
+
+void CellularManager::completeRequest(bool success) {
+    ATRequest* request = m_activeRequest;
+    if (!request) {
+        return;
+    }
+    
+    m_activeRequest = nullptr;
+    m_lastActivity = millis();
+    request->success = success;
+    trace_end(TRACE_AT_RTT, request->traceStart);
+    sched_wake_unlock();
+    
+    // Callbacks run without the mutex held so they may queue follow-up commands
+    if (request->callback) {
+        request->callback(*request, request->context);
+    }
+    
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    request->completed = true;
+    if (request->waiter) {
+        xSemaphoreGive(request->done);
+    } else {
+        request->inUse = false;
+    }
+    xSemaphoreGive(m_mutex);
 }
 
 String CellularManager::getModemInfo() {
@@ -495,13 +777,10 @@ String CellularManager::getModemInfo() {
 String CellularManager::getIMEI() {
     String response;
     if (sendATCommand("AT+CGSN", response, 1000)) {
-        // Extract IMEI from response
-        int start = response.indexOf('\n');
-        if (start >= 0) {
-            int end = response.indexOf('\r', start);
-            if (end >= 0) {
-                return response.substring(start + 1, end);
-            }
+        // Extract IMEI from the first response line
+        int end = response.indexOf('\n');
+        if (end > 0) {
+            return response.substring(0, end);
         }
     }
     return String();
@@ -513,7 +792,7 @@ String CellularManager::getICCID() {
         // Extract ICCID from response
         int start = response.indexOf('+');
         if (start >= 0) {
-            int end = response.indexOf('\r', start);
+            int end = response.indexOf('\n', start);
             if (end >= 0) {
                 return response.substring(start, end);
             }
@@ -542,7 +821,7 @@ void CellularManager::resetStats() {
         m_stats = CellularStats{};
         m_initTime = millis();
         xSemaphoreGive(m_mutex);
-        LOG_INFO("Cellular", "Statistics reset");
+        LOG_INFO_TAG("Cellular", "Statistics reset");
     }
 }
 
@@ -553,30 +832,67 @@ void CellularManager::process() {
 void CellularManager::cellularTask(void* parameter) {
     CellularManager* manager = static_cast<CellularManager*>(parameter);
     
-    LOG_INFO("Cellular", "Cellular task started");
+    LOG_INFO_TAG("Cellular", "Cellular task started");
     
     while (true) {
-        // Handle incoming data
+        // Drain the UART and dispatch complete lines
         manager->handleIncomingData();
         
+        // Time out the command in flight, then start the next queued one
+        ATRequest* active = manager->m_activeRequest;
+        if (active && millis() - active->startTime > active->timeoutMs) {
+            LOG_WARN_TAG("Cellular", "AT timeout: %s", active->command.c_str());
+            manager->completeRequest(false);
+        }
+        manager->startNextRequest();
+        
         // Update statistics
         manager->updateStats();
         
-        // Check connection status
-        if (manager->m_status == CellularStatus::CONNECTED) {
-            // Periodic keep-alive or status check
-            if (millis() - manager->m_lastActivity > 60000) {
-                String response;
-                manager->sendATCommand("AT", response, 1000);
-            }
+        // Periodic keep-alive doubling as a signal sample for link scoring; queued,
+        // since this task must never block on itself
+        if (manager->m_status == CellularStatus::CONNECTED && !manager->m_activeRequest &&
+            millis() - manager->m_lastActivity > KEEPALIVE_MS) {
+            manager->m_lastActivity = millis();
+            manager->sendATCommandAsync("AT+CSQ", onSignalQuality, manager);
+        }
+        
+        // Let the modem sleep once the AT engine has gone quiet
+        if (manager->m_lowPower && !manager->m_modemAsleep && !manager->m_activeRequest &&
+            uxQueueMessagesWaiting(manager->m_commandQueue) == 0 &&
+            millis() - manager->m_lastActivity > SLEEP_IDLE_MS) {
+            digitalWrite(ModemPins::DTR, HIGH);
+            manager->m_modemAsleep = true;
         }
         
-        vTaskDelay(pdMS_TO_TICKS(100));
+        // Woken by received bytes and queued commands; otherwise sleep until the next timer is due
+        uint32_t waitMs = manager->nextTaskWakeMs();
+        ulTaskNotifyTake(pdTRUE, waitMs == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(waitMs) + 1);
+    }
+}
+
+uint32_t CellularManager::nextTaskWakeMs() const {
+    uint32_t now = millis();
+    uint32_t idle = now - m_lastActivity;
+    uint32_t wait = UINT32_MAX;
+    
+    if (m_activeRequest) {
+        // Command timeout
+        uint32_t elapsed = now - m_activeRequest->startTime;
+        return elapsed >= m_activeRequest->timeoutMs ? 0 : m_activeRequest->timeoutMs - elapsed;
     }
+    if (m_status == CellularStatus::CONNECTED) {
+        wait = idle >= KEEPALIVE_MS ? 0 : KEEPALIVE_MS - idle;
+    }
+    if (m_lowPower && !m_modemAsleep) {
+        uint32_t sleepIn = idle >= SLEEP_IDLE_MS ? 0 : SLEEP_IDLE_MS - idle;
+        if (sleepIn < wait) wait = sleepIn;
+    }
+    return wait;
 }
 
 bool CellularManager::initializeModem() {
-    LOG_INFO("Cellular", "Initializing modem...");
+    LOG_INFO_TAG("Cellular", "Initializing modem...");
     
     String response;
     
@@ -595,32 +911,17 @@ bool CellularManager::initializeModem() {
         return false;
     }
     
-    // Enable SMS notifications
-    if (!sendATCommand("AT+CNMI=2,2,0,0,0", response, 1000)) {
+    // Enable SMS notifications; store messages and report them with +CMTI
+    if (!sendATCommand("AT+CMGF=1", response, 1000)) {
         return false;
     }
     
-    LOG_INFO("Cellular", "Modem initialized successfully");
-    return true;
-}
-
-bool CellularManager::waitForResponse(const String& expected, uint32_t timeoutMs) {
-    uint32_t startTime = millis();
-    String response = "";
-    
-    while (millis() - startTime < timeoutMs) {
-        if (m_serial->available()) {
-            char c = m_serial->read();
-            response += c;
-            
-            if (response.indexOf(expected) >= 0) {
-                return true;
-            }
-        }
-        delay(1);
+    if (!sendATCommand("AT+CNMI=2,1,0,0,0", response, 1000)) {
+        return false;
     }
     
-    return false;
+    LOG_INFO_TAG("Cellular", "Modem initialized successfully");
+    return true;
 }
 
 bool CellularManager::setupPDP() {
@@ -644,15 +945,188 @@ bool CellularManager::setupPDP() {
 }
 
 void CellularManager::handleIncomingData() {
-    if (m_serial->available()) {
-        String data = m_serial->readString();
-        processATResponse(data);
+    // Bulk copy from the UART into the ring, one contiguous chunk at a time
+    int available;
+    while ((available = m_serial->available()) > 0 && m_rxHead - m_rxTail < RX_RING_SIZE) {
+        size_t head = m_rxHead & (RX_RING_SIZE - 1);
+        size_t space = RX_RING_SIZE - (m_rxHead - m_rxTail);
+        size_t chunk = RX_RING_SIZE - head;
+        if (chunk > space) chunk = space;
+        if (chunk > (size_t)available) chunk = available;
+        
+        m_rxHead += m_serial->read(&m_rxRing[head], chunk);
+    }
+    
+    // Split into lines
+    while (m_rxTail != m_rxHead) {
+        if (m_activeRequest && m_activeRequest->dataRemaining) {
+            consumeData();
+            continue;
+        }
+        
+        char c = (char)m_rxRing[m_rxTail & (RX_RING_SIZE - 1)];
+        m_rxTail++;
+        
+        if (c == '\r') {
+            continue;
+        }
+        
+        if (c == '\n') {
+            m_lineBuffer[m_lineLength] = '\0';
+            if (m_lineLength > 0) {
+                processLine(m_lineBuffer);
+            }
+            m_lineLength = 0;
+            continue;
+        }
+        
+        if (m_lineLength < MAX_LINE_LENGTH - 1) {
+            m_lineBuffer[m_lineLength++] = c;
+        }
+        
+        // The SMS prompt is exactly "> " with no line terminator; other lines keep their bytes
+        if (m_lineLength == 2 && m_lineBuffer[0] == '>' && m_lineBuffer[1] == ' ') {
+            if (m_activeRequest && m_activeRequest->payload.length() && !m_activeRequest->payloadSent) {
+                m_serial->print(m_activeRequest->payload);
+                m_serial->write(0x1A); // Ctrl+Z
+                m_activeRequest->payloadSent = true;
+            }
+            m_lineLength = 0;
+        }
+    }
+}
+
+void CellularManager::consumeData() {
+    // Raw bytes bypass the line splitter, one contiguous run of the ring at a time
+    ATRequest* request = m_activeRequest;
+    size_t tail = m_rxTail & (RX_RING_SIZE - 1);
+    size_t run = RX_RING_SIZE - tail;
+    if (run > m_rxHead - m_rxTail) run = m_rxHead - m_rxTail;
+    if (run > request->dataRemaining) run = request->dataRemaining;
+    
+    // The waiter may give up concurrently and take its buffer with it
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    if (request->data && request->dataLength < request->dataCapacity) {
+        size_t copy = request->dataCapacity - request->dataLength;
+        if (copy > run) copy = run;
+        memcpy(request->data + request->dataLength, &m_rxRing[tail], copy);
+        request->dataLength += copy;
+    }
+    xSemaphoreGive(m_mutex);
+    
+    request->dataRemaining -= run;
+    m_rxTail += run;
+    m_lastActivity = millis();
+}
+
+void CellularManager::processLine(const char* line) {
+    if (isURC(line)) {
+        processATResponse(String(line));
+        return;
+    }
+    
+    if (!m_activeRequest) {
+        LOG_DEBUG_TAG("Cellular", "Unhandled line: %s", line);
+        return;
+    }
+    
+    // Keep the final result code in the response, as callers look for "OK"
+    if (m_activeRequest->response.length()) {
+        m_activeRequest->response += '\n';
+    }
+    m_activeRequest->response += line;
+    
+    // An announced data block follows this line verbatim
+    const char* dataPrefix = m_activeRequest->dataPrefix;
+    const char* finalPrefix = m_activeRequest->finalPrefix;
+    bool isFinal = finalPrefix && strncmp(line, finalPrefix, strlen(finalPrefix)) == 0;
+    if (dataPrefix && !isFinal && strncmp(line, dataPrefix, strlen(dataPrefix)) == 0) {
+        m_activeRequest->dataRemaining = strtoul(line + strlen(dataPrefix), nullptr, 10);
+        return;
+    }
+    
+    bool success;
+    if (isFinal) {
+        completeRequest(true);
+    } else if (isFinalResult(line, success) && (!finalPrefix || !success)) {
+        // With a final prefix, OK only acknowledges the command
+        completeRequest(success);
+    }
+}
+
+bool CellularManager::isFinalResult(const char* line, bool& success) const {
+    if (strcmp(line, "OK") == 0 || strncmp(line, "CONNECT", 7) == 0) {
+        success = true;
+        return true;
+    }
+    
+    if (strcmp(line, "ERROR") == 0 || strncmp(line, "+CME ERROR", 10) == 0 ||
+        strncmp(line, "+CMS ERROR", 10) == 0 || strcmp(line, "NO CARRIER") == 0 ||
+        strcmp(line, "BUSY") == 0 || strcmp(line, "NO ANSWER") == 0 ||
+        strcmp(line, "NO DIALTONE") == 0) {
+        success = false;
+        return true;
     }
+    
+    return false;
+}
+
+bool CellularManager::isURC(const char* line) const {
+    if (strncmp(line, "+CMTI:", 6) == 0 || strcmp(line, "RING") == 0) {
+        return true;
+    }
+    
+    // +CREG: is also the answer to AT+CREG?, so only treat it as unsolicited otherwise
+    if (strncmp(line, "+CREG:", 6) == 0) {
+        return !m_activeRequest || !m_activeRequest->command.startsWith("AT+CREG");
+    }
+    
+    return false;
 }
 
 void CellularManager::parseNetworkRegistration(const String& response) {
-    // Parse +CREG response
-    // Implementation would extract registration status
+    // Query reply: +CREG: <n>,<stat>[,<lac>,<ci>[,<AcT>]], URC: +CREG: <stat>[,<lac>,<ci>[,<AcT>]]
+    int start = response.indexOf("+CREG: ");
+    if (start < 0) {
+        return;
+    }
+    start += 7;
+    
+    int end = response.indexOf('\n', start);
+    String fields = end >= 0 ? response.substring(start, end) : response.substring(start);
+    
+    int comma = fields.indexOf(',');
+    int statPos = 0;
+    if (comma >= 0 && comma + 1 < (int)fields.length() && fields[comma + 1] != '"') {
+        statPos = comma + 1;
+    }
+    int stat = fields.substring(statPos).toInt();
+    
+    switch (stat) {
+        case 0: m_registration = NetworkRegistration::NOT_REGISTERED; break;
+        case 1: m_registration = NetworkRegistration::REGISTERED_HOME; break;
+        case 2: m_registration = NetworkRegistration::SEARCHING; break;
+        case 3: m_registration = NetworkRegistration::REGISTRATION_DENIED; break;
+        case 5: m_registration = NetworkRegistration::REGISTERED_ROAMING; break;
+        default: m_registration = NetworkRegistration::UNKNOWN; break;
+    }
+    
+    // Access technology is the last field when location info is enabled
+    int lastComma = fields.lastIndexOf(',');
+    if (lastComma > statPos && fields[lastComma + 1] != '"') {
+        m_networkType = parseNetworkType(fields.substring(lastComma + 1));
+    }
+    
+    if (m_status == CellularStatus::CONNECTED &&
+        m_registration != NetworkRegistration::REGISTERED_HOME &&
+        m_registration != NetworkRegistration::REGISTERED_ROAMING) {
+        LOG_WARN_TAG("Cellular", "Lost network registration");
+        m_status = CellularStatus::DISCONNECTED;
+        m_stats.disconnections++;
+        if (m_eventCallback) {
+            m_eventCallback(m_status, "Registration lost");
+        }
+    }
 }
 
 void CellularManager::parseSignalQuality(const String& response) {
@@ -672,15 +1146,57 @@ void CellularManager::parseSignalQuality(const String& response) {
 }
 
 void CellularManager::parseSMSNotification(const String& response) {
-    // Parse incoming SMS notification
-    if (response.indexOf("+CMTI:") >= 0) {
-        m_stats.smsMessagesReceived++;
-        if (m_smsCallback) {
-            // Parse and call callback
-        }
+    // +CMTI: "SM",<index> - fetch the stored message without blocking this task
+    int comma = response.indexOf(',');
+    if (comma < 0) {
+        return;
+    }
+    
+    m_stats.smsMessagesReceived++;
+    uint16_t index = response.substring(comma + 1).toInt();
+    if (m_smsCallback) {
+        sendATCommandAsync("AT+CMGR=" + String(index), onSMSRead, this, 5000);
+    }
+}
+
+void CellularManager::onSignalQuality(const ATRequest& request, void* context) {
+    if (request.success) {
+        static_cast<CellularManager*>(context)->parseSignalQuality(request.response);
     }
 }
 
+void CellularManager::onSMSRead(const ATRequest& request, void* context) {
+    // Runs on the cellular task; response is +CMGR: <stat>,<oa>,<alpha>,<scts> then the text
+    CellularManager* manager = static_cast<CellularManager*>(context);
+    if (!request.success || !manager->m_smsCallback) {
+        return;
+    }
+    
+    const String& response = request.response;
+    SMSMessage msg;
+    msg.index = request.command.substring(8).toInt();  // "AT+CMGR=<index>"
+    msg.isRead = response.indexOf("REC READ") >= 0;
+    
+    // Quoted fields: 1 = status, 2 = sender, 3 = alpha, 4 = timestamp
+    int quote = -1;
+    String fields[4];
+    for (int i = 0; i < 4; i++) {
+        int open = response.indexOf('"', quote + 1);
+        if (open < 0) break;
+        int close = response.indexOf('"', open + 1);
+        if (close < 0) break;
+        fields[i] = response.substring(open + 1, close);
+        quote = close;
+    }
+    msg.sender = fields[1];
+    msg.timestamp = fields[3];
+    
+    int body = response.indexOf('\n');
+    msg.message = body >= 0 ? response.substring(body + 1) : String();
+    
+    manager->m_smsCallback(msg);
+}
+
 void CellularManager::parseCallNotification(const String& response) {
     // Parse incoming call notification
     if (response.indexOf("RING") >= 0) {
@@ -698,8 +1214,19 @@ void CellularManager::updateStats() {
 }
 
 CellularNetworkType CellularManager::parseNetworkType(const String& response) {
-    // Parse network type from AT response
-    return CellularNetworkType::UNKNOWN;
+    // 3GPP 27.007 <AcT> value
+    switch (response.toInt()) {
+        case 0: return CellularNetworkType::GSM;
+        case 2: return CellularNetworkType::UMTS;
+        case 3: return CellularNetworkType::EDGE;
+        case 4: return CellularNetworkType::HSDPA;
+        case 5: return CellularNetworkType::HSUPA;
+        case 6: return CellularNetworkType::HSPA;
+        case 7: return CellularNetworkType::LTE;
+        case 8: return CellularNetworkType::LTE_CAT_M1;
+        case 9: return CellularNetworkType::LTE_NB_IOT;
+        default: return CellularNetworkType::UNKNOWN;
+    }
 }
 
 void CellularManager::powerCycle() {
@@ -713,7 +1240,7 @@ bool CellularManager::checkSIMCard() {
 }
 
 void CellularManager::processATResponse(const String& response) {
-    // Process unsolicited responses
+    // Dispatch one unsolicited result code line
     if (response.indexOf("+CMTI:") >= 0) {
         parseSMSNotification(response);
     } else if (response.indexOf("RING") >= 0) {
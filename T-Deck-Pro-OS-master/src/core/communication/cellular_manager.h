@@ -8,6 +8,7 @@
 #pragma once
 
 #include <HardwareSerial.h>
+#include <vector>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/queue.h>
@@ -142,6 +143,40 @@ typedef void (*CellularEventCallback)(CellularStatus status, const String& info)
 typedef void (*SMSCallback)(const SMSMessage& message);
 typedef void (*CallCallback)(const String& number, bool incoming);
 
+struct ATRequest;
+
+/**
+ * @brief Completion callback for asynchronous AT commands
+ * @note Runs on the cellular task; it must not call the blocking sendATCommand()
+ */
+typedef void (*ATResponseCallback)(const ATRequest& request, void* context);
+
+/**
+ * @brief In-flight AT command, taken from a fixed pool and carried on the command queue
+ */
+struct ATRequest {
+    String command;
+    String payload;             // Sent after the '>' prompt and terminated with Ctrl+Z
+    String response;            // Intermediate result lines, '\n' separated
+    uint32_t timeoutMs;
+    uint32_t startTime;
+    uint32_t traceStart;        // Microsecond timestamp for the AT round-trip histogram
+    const char* finalPrefix;    // Line completing the command instead of OK, e.g. "+HTTPACTION:"
+    const char* dataPrefix;     // Line announcing raw bytes, length follows the prefix
+    uint8_t* data;              // Receives the raw bytes, owned by the blocked caller
+    size_t dataCapacity;
+    size_t dataLength;
+    size_t dataRemaining;       // Raw bytes still expected on the UART
+    ATResponseCallback callback;
+    void* context;
+    SemaphoreHandle_t done;     // Given on completion when a caller is blocked on it
+    bool inUse;
+    bool waiter;
+    bool completed;
+    bool success;
+    bool payloadSent;
+};
+
 /**
  * @brief Cellular Manager class for A7682E modem
  */
@@ -193,6 +228,25 @@ public:
      */
     bool isPoweredOn() const { return m_poweredOn; }
 
+    /**
+     * @brief Let the modem sleep between AT commands
+     *
+     * Enables PSM and eDRX, so the network pages the modem less often, and
+     * AT+CSCLK=1, so the modem sleeps while DTR is high. DTR goes high once
+     * the AT engine has been quiet for SLEEP_IDLE_MS and low again before the
+     * next command. Unsolicited results raise RI, which wakes the host.
+     * @param enable true to allow modem sleep
+     * @return true if the commands were queued, false otherwise
+     */
+    bool setLowPower(bool enable);
+
+    bool isLowPower() const { return m_lowPower; }
+
+    /**
+     * @brief Check whether DTR currently lets the modem sleep
+     */
+    bool isModemAsleep() const { return m_modemAsleep; }
+
     /**
      * @brief Connect to cellular network
      * @param callback Optional callback for connection events
@@ -303,6 +357,42 @@ public:
      */
     bool sendATCommand(const String& command, String& response, uint32_t timeoutMs = 1000);
 
+    /**
+     * @brief Queue an AT command without waiting for it
+     * @param command AT command
+     * @param callback Optional completion callback, invoked on the cellular task
+     * @param context User pointer passed to the callback
+     * @param timeoutMs Timeout in milliseconds, counted from when the command is sent
+     * @return true if queued, false if the request pool is exhausted
+     */
+    bool sendATCommandAsync(const String& command, ATResponseCallback callback = nullptr,
+                            void* context = nullptr, uint32_t timeoutMs = 1000);
+
+    /**
+     * @brief Send AT command whose answer ends with a line other than the result code
+     * @param command AT command
+     * @param finalPrefix Line that completes the command, e.g. "+HTTPACTION:"; OK is then intermediate
+     * @param response Response lines, including the final one
+     * @param timeoutMs Timeout in milliseconds
+     * @return true if the final line arrived, false on error or timeout
+     */
+    bool sendATCommandUntil(const String& command, const char* finalPrefix, String& response,
+                            uint32_t timeoutMs = 1000);
+
+    /**
+     * @brief Send AT command that returns raw binary data, e.g. AT+HTTPREAD
+     * @param command AT command
+     * @param dataPrefix Line announcing the data, followed by its length
+     * @param finalPrefix Line that completes the command
+     * @param buffer Receives the data; bytes beyond capacity are discarded
+     * @param capacity Buffer size
+     * @param received Number of bytes stored
+     * @param timeoutMs Timeout in milliseconds
+     * @return true if the final line arrived, false on error or timeout
+     */
+    bool readATData(const String& command, const char* dataPrefix, const char* finalPrefix,
+                    uint8_t* buffer, size_t capacity, size_t& received, uint32_t timeoutMs = 5000);
+
     /**
      * @brief Get modem information
      * @return Modem info string
@@ -357,6 +447,15 @@ public:
     void setEventCallback(CellularEventCallback callback) { m_eventCallback = callback; }
 
 private:
+    static constexpr size_t RX_RING_SIZE = 1024;        // Power of two
+    static constexpr size_t UART_RX_BUFFER_SIZE = 4096; // Driver buffer, holds a raw read while the task sleeps
+    static constexpr size_t MAX_LINE_LENGTH = 256;
+    static constexpr uint8_t AT_POOL_SIZE = 8;
+    static constexpr uint32_t AT_QUEUE_SLACK_MS = 60000; // Extra wait for commands queued behind others
+    static constexpr uint32_t SLEEP_IDLE_MS = 2000;      // AT engine quiet time before DTR lets the modem sleep
+    static constexpr uint32_t DTR_WAKE_MS = 50;          // Modem UART ready after DTR goes low
+    static constexpr uint32_t KEEPALIVE_MS = 60000;      // AT+CSQ after this long without traffic while connected
+
     // Hardware
     HardwareSerial* m_serial;
     
@@ -382,17 +481,41 @@ private:
     QueueHandle_t m_commandQueue;
     SemaphoreHandle_t m_mutex;
     
+    // AT engine
+    ATRequest m_requestPool[AT_POOL_SIZE];
+    ATRequest* m_activeRequest;
+    uint8_t m_rxRing[RX_RING_SIZE];
+    uint32_t m_rxHead;
+    uint32_t m_rxTail;
+    char m_lineBuffer[MAX_LINE_LENGTH];
+    size_t m_lineLength;
+    NetworkRegistration m_registration;
+    CellularNetworkType m_networkType;
+    
     // Internal state
-    String m_responseBuffer;
     uint32_t m_lastActivity;
+    volatile bool m_lowPower;
+    bool m_modemAsleep;
     
     // Internal methods
     static void cellularTask(void* parameter);
     bool initializeModem();
-    bool checkModemResponse();
-    bool waitForResponse(const String& expected, uint32_t timeoutMs);
     bool setupPDP();
     void handleIncomingData();
+    uint32_t nextTaskWakeMs() const;
+    ATRequest* acquireRequest(const String& command, uint32_t timeoutMs, bool waiter);
+    void releaseRequest(ATRequest* request);
+    bool submitRequest(ATRequest* request);
+    bool waitRequest(ATRequest* request, String& response, size_t* dataLength = nullptr);
+    bool executeRequest(const String& command, ATRequest* request, String& response,
+                        size_t* dataLength = nullptr);
+    bool isCellularTask(const String& command) const;
+    void consumeData();
+    void startNextRequest();
+    void completeRequest(bool success);
+    void processLine(const char* line);
+    bool isFinalResult(const char* line, bool& success) const;
+    bool isURC(const char* line) const;
     void parseNetworkRegistration(const String& response);
     void parseSignalQuality(const String& response);
     void parseSMSNotification(const String& response);
@@ -402,6 +525,8 @@ private:
     void powerCycle();
     bool checkSIMCard();
     void processATResponse(const String& response);
+    static void onSMSRead(const ATRequest& request, void* context);
+    static void onSignalQuality(const ATRequest& request, void* context);
 };
 
 } // namespace Communication
@@ -6,7 +6,10 @@
  */
 
 #include "communication_manager.h"
+#include "message_bus.h"
+#include "link_scorer.h"
 #include "core/utils/logger.h"
+#include "core/system/scheduler.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/semphr.h>
@@ -17,6 +20,56 @@ static const char* TAG = "CommMgr";
 // Static instance
 CommunicationManager* CommunicationManager::instance = nullptr;
 
+// Received messages held for receiveMessage() callers
+static QueueHandle_t inbox = nullptr;
+
+static comm_interface_t toCommInterface(CommInterface interface) {
+    switch (interface) {
+        case CommInterface::LORA:     return COMM_INTERFACE_LORA;
+        case CommInterface::WIFI:     return COMM_INTERFACE_WIFI;
+        case CommInterface::CELLULAR: return COMM_INTERFACE_CELLULAR;
+        default:                      return COMM_INTERFACE_NONE;
+    }
+}
+
+static CommInterface toBusInterface(comm_interface_t interface) {
+    switch (interface) {
+        case COMM_INTERFACE_WIFI:     return CommInterface::WIFI;
+        case COMM_INTERFACE_CELLULAR: return CommInterface::CELLULAR;
+        default:                      return CommInterface::LORA;
+    }
+}
+
+// Score bonus for the interface chosen with setPreferredInterface()
+static const float PREFERRED_INTERFACE_BONUS = 5.0f;
+
+static bool loraTransport(const BusMessage& message, void* context) {
+    LoRaManager* lora = static_cast<LoRaManager*>(context);
+    return lora->transmit(message.data, message.length);
+}
+
+static void onLoRaPacket(const LoRaPacket& packet) {
+    // The only copy on the receive path: radio slot into a bus buffer
+    MessageBus::getInstance().publish(BUS_TOPIC_LORA_RX, packet.data, packet.length,
+                                      CommInterface::LORA, packet.rssi);
+}
+
+static void inboxSubscriber(const BusMessage& message, void* context) {
+    CommunicationManager* manager = static_cast<CommunicationManager*>(context);
+    BusMessage* held = const_cast<BusMessage*>(&message);
+    
+    MessageBus::getInstance().retain(held);
+    if (xQueueSend(inbox, &held, 0) != pdTRUE) {
+        // Oldest unread message makes room for the new one
+        BusMessage* stale;
+        if (xQueueReceive(inbox, &stale, 0) == pdTRUE) {
+            MessageBus::getInstance().release(stale);
+        }
+        xQueueSend(inbox, &held, 0);
+    }
+    manager->notifyReceive(toCommInterface(message.interface), message.length);
+}
+
 CommunicationManager::CommunicationManager() :
     initialized(false),
     activeInterface(COMM_INTERFACE_NONE),
@@ -72,6 +125,15 @@ bool CommunicationManager::initialize() {
         return false;
     }
     
+    MessageBus& bus = MessageBus::getInstance();
+    if (!bus.initialize()) {
+        ESP_LOGE(TAG, "Failed to initialize message bus");
+        return false;
+    }
+    
+    inbox = xQueueCreate(BUS_QUEUE_DEPTH, sizeof(BusMessage*));
+    bus.subscribe(BUS_TOPIC_ANY, inboxSubscriber, this);
+    
     // Initialize all communication interfaces
     bool loraOk = loraManager->initialize();
     bool wifiOk = wifiManager->initialize();
@@ -79,7 +141,13 @@ bool CommunicationManager::initialize() {
     
     if (!loraOk) {
         ESP_LOGW(TAG, "LoRa initialization failed");
+    } else {
+        // Packets are pushed to the bus from the LoRa task as they arrive
+        bus.registerTransport(CommInterface::LORA, loraTransport, loraManager);
+        loraManager->startReceive(onLoRaPacket);
     }
+    // WiFi and cellular get a transport only when a service registers one for them;
+    // until then sendMessage() refuses them and the scorer never selects them
     if (!wifiOk) {
         ESP_LOGW(TAG, "WiFi initialization failed");
     }
@@ -141,6 +209,17 @@ void CommunicationManager::deinitialize() {
         cellularManager->deinitialize();
     }
     
+    MessageBus& bus = MessageBus::getInstance();
+    if (inbox) {
+        BusMessage* message;
+        while (xQueueReceive(inbox, &message, 0) == pdTRUE) {
+            bus.release(message);
+        }
+        vQueueDelete(inbox);
+        inbox = nullptr;
+    }
+    bus.deinitialize();
+    
     activeInterface = COMM_INTERFACE_NONE;
     initialized = false;
     
@@ -148,6 +227,11 @@ void CommunicationManager::deinitialize() {
 }
 
 bool CommunicationManager::sendMessage(const uint8_t* data, size_t length, comm_interface_t interface) {
+    return sendMessage(data, length, interface, MessageClass::NORMAL);
+}
+
+bool CommunicationManager::sendMessage(const uint8_t* data, size_t length, comm_interface_t interface,
+                                       MessageClass messageClass) {
     if (!initialized) {
         ESP_LOGE(TAG, "Not initialized");
         return false;
@@ -158,14 +242,27 @@ bool CommunicationManager::sendMessage(const uint8_t* data, size_t length, comm_
         return false;
     }
     
-    // Use specified interface or active interface
-    comm_interface_t targetInterface = (interface == COMM_INTERFACE_AUTO) ? activeInterface : interface;
+    // Use specified interface or the best scoring one for this class of traffic
+    comm_interface_t targetInterface = interface;
+    if (interface == COMM_INTERFACE_AUTO) {
+        bool found = false;
+        CommInterface selected = LinkScorer::getInstance().select(messageClass, found);
+        targetInterface = found ? toCommInterface(selected) : COMM_INTERFACE_NONE;
+    }
     
     if (targetInterface == COMM_INTERFACE_NONE) {
         ESP_LOGE(TAG, "No active interface available");
         return false;
     }
     
+    // WiFi and cellular deliver only through a registered bus transport; without one the
+    // send is refused here rather than counted as a failure against the link
+    if ((targetInterface == COMM_INTERFACE_WIFI || targetInterface == COMM_INTERFACE_CELLULAR) &&
+        !MessageBus::getInstance().hasTransport(toBusInterface(targetInterface))) {
+        ESP_LOGW(TAG, "No transport registered for interface %d", targetInterface);
+        return false;
+    }
+    
     bool success = false;
     
     // Take mutex for thread safety
@@ -184,10 +281,10 @@ bool CommunicationManager::sendMessage(const uint8_t* data, size_t length, comm_
                 break;
                 
             case COMM_INTERFACE_WIFI:
-                // WiFi sending would typically go through a protocol like TCP/UDP
-                // For now, we'll mark as successful if WiFi is connected
-                if (wifiManager && wifiManager->isConnected()) {
-                    success = true; // Placeholder - implement actual WiFi sending
+                // Queued to whichever transport (e.g. MQTT) registered for WiFi
+                if (wifiManager && wifiManager->isConnected() &&
+                    MessageBus::getInstance().send(data, length, CommInterface::WIFI)) {
+                    success = true;
                     stats.wifi.messagesSent++;
                     stats.wifi.bytesSent += length;
                 } else {
@@ -196,9 +293,9 @@ bool CommunicationManager::sendMessage(const uint8_t* data, size_t length, comm_
                 break;
                 
             case COMM_INTERFACE_CELLULAR:
-                // Cellular sending would typically go through SMS or data connection
-                if (cellularManager && cellularManager->isConnected()) {
-                    success = true; // Placeholder - implement actual cellular sending
+                if (cellularManager && cellularManager->isConnected() &&
+                    MessageBus::getInstance().send(data, length, CommInterface::CELLULAR)) {
+                    success = true;
                     stats.cellular.messagesSent++;
                     stats.cellular.bytesSent += length;
                 } else {
@@ -216,10 +313,35 @@ bool CommunicationManager::sendMessage(const uint8_t* data, size_t length, comm_
         ESP_LOGE(TAG, "Failed to take mutex");
     }
     
+    // Failures count against the link straight away so the next send avoids it. Only the
+    // enqueue is timed here, so no duration is passed; LoRa reports its own outcome at TX
+    // done, the others are timed by their acknowledgements
+    if (!success || targetInterface != COMM_INTERFACE_LORA) {
+        LinkScorer::getInstance().recordSend(toBusInterface(targetInterface), success, length);
+    }
+    
     // Handle failover if enabled and send failed
     if (!success && autoFailover && interface == COMM_INTERFACE_AUTO) {
         ESP_LOGW(TAG, "Send failed on interface %d, attempting failover", targetInterface);
-        success = attemptFailover(data, length);
+        success = attemptFailover(data, length, messageClass, targetInterface);
+    }
+    
+    return success;
+}
+
+bool CommunicationManager::broadcastMesh(const String& message) {
+    if (!initialized || !loraManager || !loraManager->isInitialized()) {
+        ESP_LOGE(TAG, "LoRa not available for mesh broadcast");
+        return false;
+    }
+    
+    // Queued in the LoRa task; it is sent once the channel is clear and airtime allows
+    bool success = loraManager->transmit(message, nullptr, LoRaTxPriority::NORMAL);
+    if (success) {
+        stats.lora.messagesSent++;
+        stats.lora.bytesSent += message.length();
+    } else {
+        stats.lora.sendErrors++;
     }
     
     return success;
@@ -230,36 +352,44 @@ bool CommunicationManager::receiveMessage(uint8_t* buffer, size_t bufferSize, si
         return false;
     }
     
-    bool messageReceived = false;
+    // Messages arrive through the bus; nothing is polled here
+    BusMessage* message;
+    if (!inbox || xQueueReceive(inbox, &message, 0) != pdTRUE) {
+        return false;
+    }
     
-    // Take mutex for thread safety
-    if (xSemaphoreTake(mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        // Check LoRa for messages
-        if (loraManager && loraManager->isInitialized()) {
-            if (loraManager->receive(buffer, bufferSize, receivedLength)) {
-                messageReceived = true;
-                if (sourceInterface) *sourceInterface = COMM_INTERFACE_LORA;
-                stats.lora.messagesReceived++;
-                stats.lora.bytesReceived += *receivedLength;
-            }
-        }
-        
-        // Check WiFi for messages (placeholder)
-        if (!messageReceived && wifiManager && wifiManager->isConnected()) {
-            // Placeholder for WiFi message reception
-            // Would typically check TCP/UDP sockets or other protocols
-        }
-        
-        // Check Cellular for messages (placeholder)
-        if (!messageReceived && cellularManager && cellularManager->isConnected()) {
-            // Placeholder for cellular message reception
-            // Would typically check SMS or data connection
-        }
-        
-        xSemaphoreGive(mutex);
+    size_t length = message->length < bufferSize ? message->length : bufferSize;
+    memcpy(buffer, message->data, length);
+    if (receivedLength) *receivedLength = length;
+    if (sourceInterface) *sourceInterface = toCommInterface(message->interface);
+    MessageBus::getInstance().release(message);
+    
+    return true;
+}
+
+void CommunicationManager::notifyReceive(comm_interface_t interface, size_t length) {
+    if (xSemaphoreTake(mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return;
+    }
+    
+    switch (interface) {
+        case COMM_INTERFACE_LORA:
+            stats.lora.messagesReceived++;
+            stats.lora.bytesReceived += length;
+            break;
+        case COMM_INTERFACE_WIFI:
+            stats.wifi.messagesReceived++;
+            stats.wifi.bytesReceived += length;
+            break;
+        case COMM_INTERFACE_CELLULAR:
+            stats.cellular.messagesReceived++;
+            stats.cellular.bytesReceived += length;
+            break;
+        default:
+            break;
     }
     
-    return messageReceived;
+    xSemaphoreGive(mutex);
 }
 
 bool CommunicationManager::isInterfaceAvailable(comm_interface_t interface) {
@@ -289,11 +419,9 @@ comm_interface_t CommunicationManager::getActiveInterface() {
 void CommunicationManager::setPreferredInterface(comm_interface_t interface) {
     preferredInterface = interface;
     
-    // If the preferred interface is available, switch to it
-    if (isInterfaceAvailable(interface)) {
-        activeInterface = interface;
-        ESP_LOGI(TAG, "Switched to preferred interface: %d", interface);
-    }
+    // A preference biases the link score; it no longer overrides link quality
+    LinkScorer::getInstance().setPreference(toBusInterface(interface), PREFERRED_INTERFACE_BONUS);
+    selectBestInterface();
 }
 
 void CommunicationManager::setAutoFailover(bool enabled) {
@@ -322,40 +450,68 @@ void CommunicationManager::resetStatistics() {
     }
 }
 
-void CommunicationManager::selectBestInterface() {
-    comm_interface_t bestInterface = COMM_INTERFACE_NONE;
+void CommunicationManager::sampleLinks() {
+    LinkScorer& scorer = LinkScorer::getInstance();
+    MessageBus& bus = MessageBus::getInstance();
+    
+    bool loraUp = isInterfaceAvailable(COMM_INTERFACE_LORA);
+    scorer.setAvailable(CommInterface::LORA, loraUp);
+    if (loraUp) {
+        LoRaStats loraStats = loraManager->getStats();
+        if (loraStats.packetsReceived > 0) {
+            scorer.sampleSignal(CommInterface::LORA, loraStats.lastRssi, loraStats.lastSnr);
+        }
+    }
     
-    // Priority order: Preferred -> WiFi -> Cellular -> LoRa
-    if (isInterfaceAvailable(preferredInterface)) {
-        bestInterface = preferredInterface;
-    } else if (isInterfaceAvailable(COMM_INTERFACE_WIFI)) {
-        bestInterface = COMM_INTERFACE_WIFI;
-    } else if (isInterfaceAvailable(COMM_INTERFACE_CELLULAR)) {
-        bestInterface = COMM_INTERFACE_CELLULAR;
-    } else if (isInterfaceAvailable(COMM_INTERFACE_LORA)) {
-        bestInterface = COMM_INTERFACE_LORA;
+    // A link with nothing registered to put messages on it cannot win selection,
+    // or every AUTO send would fail on it before failing over
+    bool wifiUp = isInterfaceAvailable(COMM_INTERFACE_WIFI) && bus.hasTransport(CommInterface::WIFI);
+    scorer.setAvailable(CommInterface::WIFI, wifiUp);
+    if (wifiUp) {
+        scorer.sampleSignal(CommInterface::WIFI, wifiManager->getRSSI());
     }
     
+    bool cellularUp = isInterfaceAvailable(COMM_INTERFACE_CELLULAR) && bus.hasTransport(CommInterface::CELLULAR);
+    scorer.setAvailable(CommInterface::CELLULAR, cellularUp);
+    if (cellularUp) {
+        // Last value from the modem's periodic +CSQ; querying here would block on the AT queue
+        CellularStats cellularStats = cellularManager->getStats();
+        if (cellularStats.lastRssi != 0) {
+            scorer.sampleSignal(CommInterface::CELLULAR, cellularStats.lastRssi);
+        }
+    }
+}
+
+void CommunicationManager::selectBestInterface() {
+    sampleLinks();
+    
+    bool found = false;
+    CommInterface selected = LinkScorer::getInstance().select(MessageClass::NORMAL, found);
+    comm_interface_t bestInterface = found ? toCommInterface(selected) : COMM_INTERFACE_NONE;
+    
     if (bestInterface != activeInterface) {
         activeInterface = bestInterface;
         ESP_LOGI(TAG, "Selected interface: %d", activeInterface);
     }
 }
 
-bool CommunicationManager::attemptFailover(const uint8_t* data, size_t length) {
-    // Try interfaces in priority order, excluding the current active interface
-    comm_interface_t interfaces[] = {COMM_INTERFACE_WIFI, COMM_INTERFACE_CELLULAR, COMM_INTERFACE_LORA};
-    
-    for (int i = 0; i < 3; i++) {
-        if (interfaces[i] != activeInterface && isInterfaceAvailable(interfaces[i])) {
-            ESP_LOGI(TAG, "Attempting failover to interface %d", interfaces[i]);
-            
-            if (sendMessage(data, length, interfaces[i])) {
-                // Update active interface to the working one
-                activeInterface = interfaces[i];
-                ESP_LOGI(TAG, "Failover successful to interface %d", activeInterface);
-                return true;
-            }
+bool CommunicationManager::attemptFailover(const uint8_t* data, size_t length, MessageClass messageClass,
+                                           comm_interface_t failedInterface) {
+    // Try the remaining interfaces best score first; the failed one has just been penalized
+    CommInterface order[COMM_INTERFACE_COUNT];
+    size_t count = LinkScorer::getInstance().rank(messageClass, order);
+    
+    for (size_t i = 0; i < count; i++) {
+        comm_interface_t candidate = toCommInterface(order[i]);
+        if (candidate == failedInterface || candidate == COMM_INTERFACE_NONE) {
+            continue;
+        }
+        
+        ESP_LOGI(TAG, "Attempting failover to interface %d", candidate);
+        if (sendMessage(data, length, candidate, messageClass)) {
+            activeInterface = candidate;
+            ESP_LOGI(TAG, "Failover successful to interface %d", activeInterface);
+            return true;
         }
     }
     
@@ -368,22 +524,15 @@ void CommunicationManager::communicationTask(void* parameter) {
     
     ESP_LOGI(TAG, "Communication task started");
     
-    TickType_t lastInterfaceCheck = 0;
-    const TickType_t interfaceCheckInterval = pdMS_TO_TICKS(5000); // Check every 5 seconds
+    const uint32_t interfaceCheckInterval = 1000; // Sample links every second
+    sched_source_t sampleSource = sched_register("link_sample", NULL);
     
     while (true) {
-        TickType_t currentTime = xTaskGetTickCount();
-        
-        // Periodically check interface availability and select best one
-        if (currentTime - lastInterfaceCheck >= interfaceCheckInterval) {
-            manager->selectBestInterface();
-            lastInterfaceCheck = currentTime;
-        }
-        
-        // Handle any pending communication tasks
-        // This could include processing queued messages, handling callbacks, etc.
+        // Feed the link scorer; hysteresis keeps frequent sampling from flapping
+        manager->selectBestInterface();
         
-        // Sleep for a short time to prevent busy waiting
-        vTaskDelay(pdMS_TO_TICKS(100));
+        // Nothing else runs here; block until the next sample is due
+        sched_set_deadline(sampleSource, interfaceCheckInterval);
+        sched_wait();
     }
 }
\ No newline at end of file
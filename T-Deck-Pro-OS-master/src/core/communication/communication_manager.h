@@ -10,6 +10,8 @@
 #include "lora_manager.h"
 #include "wifi_manager.h"
 #include "cellular_manager.h"
+#include "message_bus.h"
+#include "link_scorer.h"
 #include "core/utils/logger.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -18,16 +20,6 @@
 namespace TDeckOS {
 namespace Communication {
 
-/**
- * @brief Communication interface types
- */
-enum class CommInterface {
-    LORA,
-    WIFI,
-    CELLULAR,
-    BLUETOOTH
-};
-
 /**
  * @brief Communication status
  */
@@ -169,17 +161,21 @@ public:
      * @param data Data to send
      * @param length Data length
      * @param interface Preferred interface (optional)
+     * @param messageClass Traffic class used to pick the link (optional)
      * @return true if successful, false otherwise
      */
-    bool sendData(const uint8_t* data, size_t length, CommInterface interface = CommInterface::WIFI);
+    bool sendData(const uint8_t* data, size_t length, CommInterface interface = CommInterface::WIFI,
+                  MessageClass messageClass = MessageClass::NORMAL);
 
     /**
      * @brief Send string via best available interface
      * @param message Message to send
      * @param interface Preferred interface (optional)
+     * @param messageClass Traffic class used to pick the link (optional)
      * @return true if successful, false otherwise
      */
-    bool sendMessage(const String& message, CommInterface interface = CommInterface::WIFI);
+    bool sendMessage(const String& message, CommInterface interface = CommInterface::WIFI,
+                     MessageClass messageClass = MessageClass::NORMAL);
 
     /**
      * @brief Broadcast message via LoRa (for mesh networking)
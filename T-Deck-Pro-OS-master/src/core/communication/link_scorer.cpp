@@ -0,0 +1,267 @@
+/**
+ * @file link_scorer.cpp
+ * @brief Link quality scoring implementation
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ */
+
+#include "link_scorer.h"
+#include "core/utils/logger.h"
+
+namespace TDeckOS {
+namespace Communication {
+
+namespace {
+
+/**
+ * @brief Static characteristics of each interface
+ */
+struct LinkProfile {
+    int16_t rssiFloor;          // dBm mapped to 0
+    int16_t rssiCeiling;        // dBm mapped to 1
+    float snrFloor;             // dB, only used when snrWeight > 0
+    float snrCeiling;
+    float snrWeight;
+    float defaultRttMs;         // Assumed until measured
+    float defaultThroughput;    // Bytes per second, assumed until measured
+    float cost;                 // 0 free .. 1 expensive (money, power, airtime)
+};
+
+// Indexed by CommInterface
+constexpr LinkProfile PROFILES[COMM_INTERFACE_COUNT] = {
+    {-130, -60, -20.0f, 10.0f, 0.5f, 2000.0f, 300.0f, 0.2f},    // LORA
+    { -90, -40,   0.0f,  0.0f, 0.0f,   50.0f, 500000.0f, 0.0f}, // WIFI
+    {-113, -51,   0.0f,  0.0f, 0.0f,  400.0f, 50000.0f, 0.7f},  // CELLULAR
+    { -100, -40,  0.0f,  0.0f, 0.0f,   50.0f, 50000.0f, 0.0f},  // BLUETOOTH
+};
+
+/**
+ * @brief Weights and requirements per message class
+ */
+struct ClassProfile {
+    float signalWeight;
+    float latencyWeight;
+    float costWeight;
+    float throughputWeight;
+    float latencyBudgetMs;      // RTT that scores 0
+    float neededThroughput;     // Bytes per second that scores 1
+};
+
+// Indexed by MessageClass
+constexpr ClassProfile CLASSES[MESSAGE_CLASS_COUNT] = {
+    {0.30f, 0.05f, 0.45f, 0.20f, 30000.0f, 10000.0f},   // BULK
+    {0.40f, 0.25f, 0.25f, 0.10f,  5000.0f,  1000.0f},   // NORMAL
+    {0.45f, 0.45f, 0.05f, 0.05f,  2000.0f,   100.0f},   // URGENT
+};
+
+inline float clamp01(float value) {
+    return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+}
+
+inline float ewma(float average, float sample) {
+    return average + LINK_EWMA_ALPHA * (sample - average);
+}
+
+} // namespace
+
+LinkScorer& LinkScorer::getInstance() {
+    static LinkScorer instance;
+    return instance;
+}
+
+LinkScorer::LinkScorer()
+    : m_links{}
+    , m_selected{}
+    , m_hasSelection{}
+    , m_selectedSince{}
+    , m_preferred(CommInterface::WIFI)
+    , m_preferenceBonus(0.0f)
+    , m_switchCount(0)
+    , m_lock(portMUX_INITIALIZER_UNLOCKED)
+{
+    for (size_t i = 0; i < COMM_INTERFACE_COUNT; i++) {
+        m_links[i].signal = 0.5f;
+        m_links[i].rttMs = PROFILES[i].defaultRttMs;
+        m_links[i].throughput = PROFILES[i].defaultThroughput;
+        m_links[i].delivery = 1.0f;
+    }
+}
+
+void LinkScorer::sampleSignal(CommInterface interface, int16_t rssi, float snr) {
+    const LinkProfile& profile = PROFILES[static_cast<size_t>(interface)];
+
+    float quality = clamp01((float)(rssi - profile.rssiFloor) / (profile.rssiCeiling - profile.rssiFloor));
+    if (profile.snrWeight > 0.0f) {
+        float snrQuality = clamp01((snr - profile.snrFloor) / (profile.snrCeiling - profile.snrFloor));
+        quality = quality * (1.0f - profile.snrWeight) + snrQuality * profile.snrWeight;
+    }
+
+    portENTER_CRITICAL(&m_lock);
+    LinkMetrics& link = m_links[static_cast<size_t>(interface)];
+    // The first real sample replaces the neutral default instead of averaging with it
+    link.signal = link.sampled ? ewma(link.signal, quality) : quality;
+    link.sampled = true;
+    portEXIT_CRITICAL(&m_lock);
+}
+
+void LinkScorer::sampleRoundTrip(CommInterface interface, uint32_t rttMs) {
+    portENTER_CRITICAL(&m_lock);
+    LinkMetrics& link = m_links[static_cast<size_t>(interface)];
+    link.rttMs = ewma(link.rttMs, (float)rttMs);
+    portEXIT_CRITICAL(&m_lock);
+}
+
+void LinkScorer::recordSend(CommInterface interface, bool success, size_t bytes, uint32_t elapsedMs) {
+    portENTER_CRITICAL(&m_lock);
+    LinkMetrics& link = m_links[static_cast<size_t>(interface)];
+    link.delivery = ewma(link.delivery, success ? 1.0f : 0.0f);
+
+    if (success) {
+        link.consecutiveFailures = 0;
+        if (elapsedMs > 0 && bytes > 0) {
+            link.throughput = ewma(link.throughput, bytes * 1000.0f / elapsedMs);
+        }
+    } else {
+        if (link.consecutiveFailures < UINT8_MAX) {
+            link.consecutiveFailures++;
+        }
+        link.lastFailure = millis();
+    }
+    portEXIT_CRITICAL(&m_lock);
+}
+
+void LinkScorer::setAvailable(CommInterface interface, bool available) {
+    portENTER_CRITICAL(&m_lock);
+    LinkMetrics& link = m_links[static_cast<size_t>(interface)];
+    if (available && !link.available) {
+        // A link that just came up starts with a clean delivery record
+        link.consecutiveFailures = 0;
+        link.delivery = 1.0f;
+    }
+    link.available = available;
+    portEXIT_CRITICAL(&m_lock);
+}
+
+void LinkScorer::setPreference(CommInterface interface, float bonus) {
+    portENTER_CRITICAL(&m_lock);
+    m_preferred = interface;
+    m_preferenceBonus = bonus;
+    portEXIT_CRITICAL(&m_lock);
+}
+
+bool LinkScorer::usable(CommInterface interface) const {
+    const LinkMetrics& link = m_links[static_cast<size_t>(interface)];
+    if (!link.available) {
+        return false;
+    }
+    return link.consecutiveFailures < LINK_FAILURES_TO_DROP ||
+           millis() - link.lastFailure >= LINK_MIN_DWELL_MS;
+}
+
+float LinkScorer::scoreLocked(CommInterface interface, MessageClass messageClass) const {
+    if (!usable(interface)) {
+        return 0.0f;
+    }
+
+    const LinkMetrics& link = m_links[static_cast<size_t>(interface)];
+    const LinkProfile& profile = PROFILES[static_cast<size_t>(interface)];
+    const ClassProfile& cls = CLASSES[static_cast<size_t>(messageClass)];
+
+    float latency = clamp01(1.0f - link.rttMs / cls.latencyBudgetMs);
+    float throughput = clamp01(link.throughput / cls.neededThroughput);
+
+    float quality = cls.signalWeight * link.signal +
+                    cls.latencyWeight * latency +
+                    cls.costWeight * (1.0f - profile.cost) +
+                    cls.throughputWeight * throughput;
+
+    // Delivery scales the whole score so a link that drops messages loses quickly
+    float result = 100.0f * quality * link.delivery;
+    if (interface == m_preferred) {
+        result += m_preferenceBonus;
+    }
+    return result > 100.0f ? 100.0f : result;
+}
+
+float LinkScorer::score(CommInterface interface, MessageClass messageClass) const {
+    portENTER_CRITICAL(&m_lock);
+    float result = scoreLocked(interface, messageClass);
+    portEXIT_CRITICAL(&m_lock);
+    return result;
+}
+
+size_t LinkScorer::rank(MessageClass messageClass, CommInterface* order) const {
+    float scores[COMM_INTERFACE_COUNT];
+    size_t count = 0;
+
+    portENTER_CRITICAL(&m_lock);
+    for (size_t i = 0; i < COMM_INTERFACE_COUNT; i++) {
+        CommInterface interface = static_cast<CommInterface>(i);
+        float value = scoreLocked(interface, messageClass);
+        if (value <= 0.0f) {
+            continue;
+        }
+
+        // Insertion sort, at most four entries
+        size_t pos = count++;
+        while (pos > 0 && scores[pos - 1] < value) {
+            scores[pos] = scores[pos - 1];
+            order[pos] = order[pos - 1];
+            pos--;
+        }
+        scores[pos] = value;
+        order[pos] = interface;
+    }
+    portEXIT_CRITICAL(&m_lock);
+
+    return count;
+}
+
+CommInterface LinkScorer::select(MessageClass messageClass, bool& found) {
+    CommInterface order[COMM_INTERFACE_COUNT];
+    size_t count = rank(messageClass, order);
+    size_t cls = static_cast<size_t>(messageClass);
+
+    found = count > 0;
+    if (!found) {
+        m_hasSelection[cls] = false;
+        return CommInterface::LORA;
+    }
+
+    CommInterface best = order[0];
+    uint32_t now = millis();
+
+    portENTER_CRITICAL(&m_lock);
+    CommInterface current = m_selected[cls];
+    bool keep = false;
+    if (m_hasSelection[cls] && current != best) {
+        float currentScore = scoreLocked(current, messageClass);
+        float bestScore = scoreLocked(best, messageClass);
+        // Hysteresis: a live link is only abandoned for a clearly better one after the dwell time
+        keep = currentScore > 0.0f &&
+               (bestScore < currentScore + LINK_SWITCH_MARGIN ||
+                now - m_selectedSince[cls] < LINK_MIN_DWELL_MS);
+    }
+
+    bool switched = false;
+    if (keep) {
+        best = current;
+    } else if (!m_hasSelection[cls] || current != best) {
+        m_selected[cls] = best;
+        m_selectedSince[cls] = now;
+        switched = m_hasSelection[cls];
+        m_hasSelection[cls] = true;
+        if (switched) {
+            m_switchCount++;
+        }
+    }
+    portEXIT_CRITICAL(&m_lock);
+
+    if (switched) {
+        LOG_INFO_TAG("Link", "Class %d moved to interface %d", (int)cls, static_cast<int>(best));
+    }
+    return best;
+}
+
+} // namespace Communication
+} // namespace TDeckOS
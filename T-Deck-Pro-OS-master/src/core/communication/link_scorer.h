@@ -0,0 +1,145 @@
+/**
+ * @file link_scorer.h
+ * @brief Link quality scoring and interface selection with hysteresis
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include "message_bus.h"
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+
+namespace TDeckOS {
+namespace Communication {
+
+/**
+ * @brief Traffic class of a message, selects the cost/latency trade-off
+ */
+enum class MessageClass : uint8_t {
+    BULK,       // Telemetry, logs: cheapest link that can carry it
+    NORMAL,
+    URGENT      // Alerts: lowest latency, cost is secondary
+};
+
+constexpr size_t MESSAGE_CLASS_COUNT = 3;
+
+/**
+ * @brief Scoring parameters
+ */
+constexpr float LINK_EWMA_ALPHA = 0.25f;            // Weight of a new sample
+constexpr float LINK_SWITCH_MARGIN = 10.0f;         // Score a candidate must win by
+constexpr uint32_t LINK_MIN_DWELL_MS = 15000;       // Minimum time on a link before switching back
+constexpr uint8_t LINK_FAILURES_TO_DROP = 2;        // Consecutive send failures that zero a link
+
+/**
+ * @brief Smoothed measurements for one interface
+ */
+struct LinkMetrics {
+    float signal;               // Normalized signal quality 0..1 (EWMA)
+    float rttMs;                // Round trip time (EWMA)
+    float throughput;           // Bytes per second (EWMA)
+    float delivery;             // Send success ratio 0..1 (EWMA)
+    uint8_t consecutiveFailures;
+    uint32_t lastFailure;       // millis() of the last failed send
+    bool available;
+    bool sampled;
+};
+
+/**
+ * @brief Scores interfaces from sampled link quality and picks one per message class
+ *
+ * Samples are folded into exponentially weighted averages. Selection keeps
+ * the current link until a candidate beats it by LINK_SWITCH_MARGIN and the
+ * current link has been held for LINK_MIN_DWELL_MS, except when the current
+ * link is down or has failed LINK_FAILURES_TO_DROP sends in a row. A dropped
+ * link is probed again once LINK_MIN_DWELL_MS has passed since its last failure.
+ */
+class LinkScorer {
+public:
+    /**
+     * @brief Get the scorer instance
+     */
+    static LinkScorer& getInstance();
+
+    /**
+     * @brief Record a signal sample
+     * @param interface Sampled interface
+     * @param rssi RSSI in dBm
+     * @param snr SNR in dB, ignored where the interface does not report it
+     */
+    void sampleSignal(CommInterface interface, int16_t rssi, float snr = 0.0f);
+
+    /**
+     * @brief Record a round trip measurement, e.g. from an MQTT or AT exchange
+     */
+    void sampleRoundTrip(CommInterface interface, uint32_t rttMs);
+
+    /**
+     * @brief Record the outcome of a send
+     * @param interface Interface used
+     * @param success Whether the transport accepted the message
+     * @param bytes Message size
+     * @param elapsedMs Time the send took, 0 if not measured
+     */
+    void recordSend(CommInterface interface, bool success, size_t bytes, uint32_t elapsedMs = 0);
+
+    /**
+     * @brief Mark an interface up or down
+     */
+    void setAvailable(CommInterface interface, bool available);
+
+    /**
+     * @brief Score an interface for a message class
+     * @return 0 (unusable) to 100
+     */
+    float score(CommInterface interface, MessageClass messageClass) const;
+
+    /**
+     * @brief Pick the interface for a message class
+     * @param messageClass Traffic class
+     * @param found Set to false if no interface is usable
+     * @return Selected interface
+     */
+    CommInterface select(MessageClass messageClass, bool& found);
+
+    /**
+     * @brief Interfaces ordered by score, best first, unusable ones omitted
+     * @param messageClass Traffic class
+     * @param order Receives up to COMM_INTERFACE_COUNT interfaces
+     * @return Number of usable interfaces
+     */
+    size_t rank(MessageClass messageClass, CommInterface* order) const;
+
+    /**
+     * @brief Bias selection towards an interface
+     * @param interface Preferred interface
+     * @param bonus Score added to it
+     */
+    void setPreference(CommInterface interface, float bonus);
+
+    const LinkMetrics& getMetrics(CommInterface interface) const {
+        return m_links[static_cast<size_t>(interface)];
+    }
+
+    uint32_t getSwitchCount() const { return m_switchCount; }
+
+private:
+    LinkScorer();
+
+    LinkMetrics m_links[COMM_INTERFACE_COUNT];
+    CommInterface m_selected[MESSAGE_CLASS_COUNT];
+    bool m_hasSelection[MESSAGE_CLASS_COUNT];
+    uint32_t m_selectedSince[MESSAGE_CLASS_COUNT];
+    CommInterface m_preferred;
+    float m_preferenceBonus;
+    uint32_t m_switchCount;
+    mutable portMUX_TYPE m_lock;
+
+    float scoreLocked(CommInterface interface, MessageClass messageClass) const;
+    bool usable(CommInterface interface) const;
+};
+
+} // namespace Communication
+} // namespace TDeckOS
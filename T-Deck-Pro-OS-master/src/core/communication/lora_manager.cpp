@@ -6,8 +6,12 @@
  */
 
 #include "lora_manager.h"
+#include "link_scorer.h"
+#include "core/utils/trace.h"
+#include <esp_timer.h>
 #include <Arduino.h>
 #include <SPI.h>
+#include <math.h>
 
 namespace TDeckOS {
 namespace Communication {
@@ -17,10 +21,8 @@ LoRaManager* LoRaManager::s_instance = nullptr;
 
 LoRaManager::LoRaManager()
     : m_radio(nullptr)
-    , m_spi(nullptr)
     , m_initialized(false)
     , m_currentMode(LoRaMode::IDLE)
-    , m_transmitCallback(nullptr)
     , m_receiveCallback(nullptr)
     , m_stats{}
     , m_initTime(0)
@@ -29,8 +31,23 @@ LoRaManager::LoRaManager()
     , m_mutex(nullptr)
     , m_transmittedFlag(false)
     , m_receivedFlag(false)
+    , m_txDoneUs(0)
+    , m_rxDoneUs(0)
+    , m_txStartUs(0)
+    , m_receiveEnabled(false)
+    , m_rxDutyCycle(false)
+    , m_txQueue{}
+    , m_txLock(portMUX_INITIALIZER_UNLOCKED)
+    , m_txSequence(0)
+    , m_txActive(-1)
+    , m_txDeadline(0)
+    , m_txNextAttempt(0)
+    , m_airtimeBuckets{}
+    , m_airtimeBucketMinute(0)
+    , m_airtimeWindowTotal(0)
 {
     s_instance = this;
+    resetReceivePool();
 }
 
 LoRaManager::~LoRaManager() {
@@ -40,11 +57,11 @@ LoRaManager::~LoRaManager() {
 
 bool LoRaManager::initialize(const LoRaConfig& config) {
     if (m_initialized) {
-        LOG_WARN("LoRa", "Already initialized");
+        LOG_WARN_TAG("LoRa", "Already initialized");
         return true;
     }
 
-    LOG_INFO("LoRa", "Initializing LoRa manager...");
+    LOG_INFO_TAG("LoRa", "Initializing LoRa manager...");
     
     // Store configuration
     m_config = config;
@@ -53,36 +70,34 @@ bool LoRaManager::initialize(const LoRaConfig& config) {
     // Create mutex
     m_mutex = xSemaphoreCreateMutex();
     if (!m_mutex) {
-        LOG_ERROR("LoRa", "Failed to create mutex");
+        LOG_ERROR_TAG("LoRa", "Failed to create mutex");
         return false;
     }
     
     // Create event queue
     m_eventQueue = xQueueCreate(10, sizeof(uint32_t));
     if (!m_eventQueue) {
-        LOG_ERROR("LoRa", "Failed to create event queue");
+        LOG_ERROR_TAG("LoRa", "Failed to create event queue");
         vSemaphoreDelete(m_mutex);
         return false;
     }
     
-    // Enable LoRa module
-    pinMode(BOARD_LORA_EN, OUTPUT);
-    digitalWrite(BOARD_LORA_EN, HIGH);
-    delay(100);
-    
-    // Initialize SPI
-    m_spi = &SPI;
-    m_spi->begin(BOARD_SPI_SCK, BOARD_SPI_MISO, BOARD_SPI_MOSI, BOARD_LORA_CS);
+    if (!ActiveLoRaRadio::supportsFrequency(m_config.frequency)) {
+        LOG_ERROR_TAG("LoRa", "%.1f MHz is outside the %s band", m_config.frequency, ActiveLoRaRadio::NAME);
+        vQueueDelete(m_eventQueue);
+        vSemaphoreDelete(m_mutex);
+        return false;
+    }
     
-    // Create radio instance
-    m_radio = new SX1262(new Module(BOARD_LORA_CS, BOARD_LORA_INT, BOARD_LORA_RST, BOARD_LORA_BUSY));
+    // Power the module and build the driver for this board's chip and pins
+    m_radio = m_hardware.create();
     
     // Initialize radio
-    LOG_INFO("LoRa", "Initializing SX1262 radio...");
+    LOG_INFO_TAG("LoRa", "Initializing %s radio...", ActiveLoRaRadio::NAME);
     int state = m_radio->begin(m_config.frequency);
     if (state != RADIOLIB_ERR_NONE) {
-        LOG_ERROR("LoRa", "Failed to initialize radio, code: %d", state);
-        delete m_radio;
+        LOG_ERROR_TAG("LoRa", "Failed to initialize radio, code: %d", state);
+        m_hardware.destroy();
         m_radio = nullptr;
         vQueueDelete(m_eventQueue);
         vSemaphoreDelete(m_mutex);
@@ -91,14 +106,17 @@ bool LoRaManager::initialize(const LoRaConfig& config) {
     
     // Configure radio parameters
     if (!configureRadio()) {
-        LOG_ERROR("LoRa", "Failed to configure radio");
-        delete m_radio;
+        LOG_ERROR_TAG("LoRa", "Failed to configure radio");
+        m_hardware.destroy();
         m_radio = nullptr;
         vQueueDelete(m_eventQueue);
         vSemaphoreDelete(m_mutex);
         return false;
     }
     
+    // Every receive slot starts out free
+    resetReceivePool();
+    
     // Create LoRa task
     BaseType_t result = xTaskCreate(
         loraTask,
@@ -110,8 +128,8 @@ bool LoRaManager::initialize(const LoRaConfig& config) {
     );
     
     if (result != pdPASS) {
-        LOG_ERROR("LoRa", "Failed to create LoRa task");
-        delete m_radio;
+        LOG_ERROR_TAG("LoRa", "Failed to create LoRa task");
+        m_hardware.destroy();
         m_radio = nullptr;
         vQueueDelete(m_eventQueue);
         vSemaphoreDelete(m_mutex);
@@ -124,7 +142,7 @@ bool LoRaManager::initialize(const LoRaConfig& config) {
     // Reset statistics
     resetStats();
     
-    LOG_INFO("LoRa", "LoRa manager initialized successfully");
+    LOG_INFO_TAG("LoRa", "LoRa manager initialized successfully");
     return true;
 }
 
@@ -133,7 +151,7 @@ void LoRaManager::deinitialize() {
         return;
     }
     
-    LOG_INFO("LoRa", "Deinitializing LoRa manager...");
+    LOG_INFO_TAG("LoRa", "Deinitializing LoRa manager...");
     
     // Stop task
     if (m_taskHandle) {
@@ -147,12 +165,11 @@ void LoRaManager::deinitialize() {
     // Put radio to sleep
     if (m_radio) {
         m_radio->sleep();
-        delete m_radio;
         m_radio = nullptr;
     }
     
     // Disable LoRa module
-    digitalWrite(BOARD_LORA_EN, LOW);
+    m_hardware.destroy();
     
     // Clean up FreeRTOS objects
     if (m_eventQueue) {
@@ -168,17 +185,17 @@ void LoRaManager::deinitialize() {
     m_initialized = false;
     m_currentMode = LoRaMode::IDLE;
     
-    LOG_INFO("LoRa", "LoRa manager deinitialized");
+    LOG_INFO_TAG("LoRa", "LoRa manager deinitialized");
 }
 
 bool LoRaManager::setMode(LoRaMode mode) {
     if (!m_initialized) {
-        LOG_ERROR("LoRa", "Not initialized");
+        LOG_ERROR_TAG("LoRa", "Not initialized");
         return false;
     }
     
     if (xSemaphoreTake(m_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
-        LOG_ERROR("LoRa", "Failed to acquire mutex");
+        LOG_ERROR_TAG("LoRa", "Failed to acquire mutex");
         return false;
     }
     
@@ -186,6 +203,7 @@ bool LoRaManager::setMode(LoRaMode mode) {
     
     switch (mode) {
         case LoRaMode::IDLE:
+            m_receiveEnabled = false;
             disableInterrupts();
             m_radio->standby();
             break;
@@ -195,14 +213,16 @@ bool LoRaManager::setMode(LoRaMode mode) {
             break;
             
         case LoRaMode::RECEIVE:
+            m_receiveEnabled = true;
             enableInterrupts();
             m_radio->setPacketReceivedAction(receiveISR);
-            if (m_radio->startReceive() != RADIOLIB_ERR_NONE) {
+            if (armReceive() != RADIOLIB_ERR_NONE) {
                 success = false;
             }
             break;
             
         case LoRaMode::SLEEP:
+            m_receiveEnabled = false;
             disableInterrupts();
             m_radio->sleep();
             break;
@@ -214,58 +234,98 @@ bool LoRaManager::setMode(LoRaMode mode) {
     
     if (success) {
         m_currentMode = mode;
-        LOG_DEBUG("LoRa", "Mode changed to %d", static_cast<int>(mode));
+        LOG_DEBUG_TAG("LoRa", "Mode changed to %d", static_cast<int>(mode));
     }
     
     xSemaphoreGive(m_mutex);
     return success;
 }
 
-bool LoRaManager::transmit(const uint8_t* data, size_t length, LoRaTransmitCallback callback) {
+bool LoRaManager::transmit(const uint8_t* data, size_t length, LoRaTransmitCallback callback,
+                           LoRaTxPriority priority) {
     if (!m_initialized) {
-        LOG_ERROR("LoRa", "Not initialized");
+        LOG_ERROR_TAG("LoRa", "Not initialized");
         return false;
     }
     
     if (!data || length == 0 || length > 255) {
-        LOG_ERROR("LoRa", "Invalid data or length");
+        LOG_ERROR_TAG("LoRa", "Invalid data or length");
         return false;
     }
     
-    if (xSemaphoreTake(m_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
-        LOG_ERROR("LoRa", "Failed to acquire mutex for transmission");
+    // Copy into a free queue entry; the LoRa task schedules it
+    LoRaTxEntry* entry = nullptr;
+    portENTER_CRITICAL(&m_txLock);
+    for (size_t i = 0; i < LORA_TX_QUEUE_SIZE; i++) {
+        if (!m_txQueue[i].inUse) {
+            entry = &m_txQueue[i];
+            entry->inUse = true;
+            entry->sequence = m_txSequence++;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&m_txLock);
+    
+    if (!entry) {
+        m_stats.txQueueDrops++;
+        LOG_WARN_TAG("LoRa", "Transmit queue full, dropping %d bytes", length);
         return false;
     }
     
-    m_transmitCallback = callback;
-    m_transmittedFlag = false;
+    memcpy(entry->data, data, length);
+    entry->priority = priority;
+    entry->callback = callback;
+    entry->queuedAt = millis();
+    entry->cadAttempts = 0;
     
-    // Set transmit interrupt
-    m_radio->setPacketSentAction(transmitISR);
+    // Publish: the task only looks at entries with a length set
+    portENTER_CRITICAL(&m_txLock);
+    entry->length = length;
+    portEXIT_CRITICAL(&m_txLock);
     
-    // Start transmission
-    int state = m_radio->startTransmit(const_cast<uint8_t*>(data), length);
+    uint32_t event = 3; // Transmit queued
+    xQueueSend(m_eventQueue, &event, 0);
     
-    if (state == RADIOLIB_ERR_NONE) {
-        m_currentMode = LoRaMode::TRANSMIT;
-        LOG_DEBUG("LoRa", "Started transmission of %d bytes", length);
-        xSemaphoreGive(m_mutex);
-        return true;
-    } else {
-        LOG_ERROR("LoRa", "Failed to start transmission, code: %d", state);
-        m_transmitCallback = nullptr;
-        xSemaphoreGive(m_mutex);
-        return false;
+    LOG_DEBUG_TAG("LoRa", "Queued %d bytes for transmission (priority %d)", length, static_cast<int>(priority));
+    return true;
+}
+
+bool LoRaManager::transmit(const String& message, LoRaTransmitCallback callback, LoRaTxPriority priority) {
+    return transmit(reinterpret_cast<const uint8_t*>(message.c_str()), message.length(), callback, priority);
+}
+
+size_t LoRaManager::getQueuedTransmissions() const {
+    size_t count = 0;
+    portENTER_CRITICAL(&m_txLock);
+    for (size_t i = 0; i < LORA_TX_QUEUE_SIZE; i++) {
+        if (m_txQueue[i].inUse) {
+            count++;
+        }
     }
+    portEXIT_CRITICAL(&m_txLock);
+    return count;
 }
 
-bool LoRaManager::transmit(const String& message, LoRaTransmitCallback callback) {
-    return transmit(reinterpret_cast<const uint8_t*>(message.c_str()), message.length(), callback);
+uint32_t LoRaManager::getTimeOnAir(size_t length) const {
+    // Semtech SX1261/2 datasheet section 6.1.4, explicit header
+    float symbolMs = (float)(1UL << m_config.spreadingFactor) / m_config.bandwidth;
+    bool lowDataRate = symbolMs > 16.0f;
+    int sf = m_config.spreadingFactor;
+    
+    float preambleMs = (m_config.preambleLength + 4.25f) * symbolMs;
+    int numerator = 8 * (int)length - 4 * sf + 28 + (m_config.crcEnabled ? 16 : 0);
+    int denominator = 4 * (sf - (lowDataRate ? 2 : 0));
+    int payloadSymbols = 8;
+    if (numerator > 0) {
+        payloadSymbols += (int)ceilf((float)numerator / denominator) * m_config.codingRate;
+    }
+    
+    return (uint32_t)ceilf(preambleMs + payloadSymbols * symbolMs);
 }
 
 bool LoRaManager::startReceive(LoRaReceiveCallback callback) {
     if (!m_initialized) {
-        LOG_ERROR("LoRa", "Not initialized");
+        LOG_ERROR_TAG("LoRa", "Not initialized");
         return false;
     }
     
@@ -280,6 +340,31 @@ void LoRaManager::stopReceive() {
     }
 }
 
+bool LoRaManager::setReceiveDutyCycle(bool enable) {
+    if (!m_initialized) {
+        return false;
+    }
+    
+    if (xSemaphoreTake(m_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        LOG_ERROR_TAG("LoRa", "Failed to acquire mutex");
+        return false;
+    }
+    
+    bool success = true;
+    if (enable != m_rxDutyCycle) {
+        m_rxDutyCycle = enable;
+        // A transmission in flight re-arms through rearmReceive() with the new setting
+        if (m_currentMode == LoRaMode::RECEIVE) {
+            m_radio->standby();
+            success = armReceive() == RADIOLIB_ERR_NONE;
+        }
+        LOG_INFO_TAG("LoRa", "Receive %s", enable ? "duty-cycled" : "continuous");
+    }
+    
+    xSemaphoreGive(m_mutex);
+    return success;
+}
+
 bool LoRaManager::sleep() {
     return setMode(LoRaMode::SLEEP);
 }
@@ -290,12 +375,12 @@ bool LoRaManager::wakeup() {
 
 bool LoRaManager::updateConfig(const LoRaConfig& config) {
     if (!m_initialized) {
-        LOG_ERROR("LoRa", "Not initialized");
+        LOG_ERROR_TAG("LoRa", "Not initialized");
         return false;
     }
     
     if (xSemaphoreTake(m_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
-        LOG_ERROR("LoRa", "Failed to acquire mutex");
+        LOG_ERROR_TAG("LoRa", "Failed to acquire mutex");
         return false;
     }
     
@@ -306,10 +391,10 @@ bool LoRaManager::updateConfig(const LoRaConfig& config) {
     bool success = configureRadio();
     
     if (success) {
-        LOG_INFO("LoRa", "Configuration updated successfully");
+        LOG_INFO_TAG("LoRa", "Configuration updated successfully");
         setMode(oldMode);
     } else {
-        LOG_ERROR("LoRa", "Failed to update configuration");
+        LOG_ERROR_TAG("LoRa", "Failed to update configuration");
     }
     
     xSemaphoreGive(m_mutex);
@@ -331,7 +416,51 @@ void LoRaManager::resetStats() {
         m_stats = LoRaStats{};
         m_initTime = millis();
         xSemaphoreGive(m_mutex);
-        LOG_INFO("LoRa", "Statistics reset");
+        LOG_INFO_TAG("LoRa", "Statistics reset");
+    }
+}
+
+bool LoRaManager::acquirePacket(LoRaPacket& packet) {
+    uint8_t slot;
+    if (!m_rxReady.pop(slot)) {
+        return false;
+    }
+    packet = m_rxPackets[slot];
+    return true;
+}
+
+void LoRaManager::releasePacket(const LoRaPacket& packet) {
+    if (packet.slot < LORA_RX_POOL_SIZE) {
+        m_rxFree.push(packet.slot);
+    }
+}
+
+bool LoRaManager::receive(uint8_t* buffer, size_t bufferSize, size_t* receivedLength) {
+    LoRaPacket packet;
+    if (!buffer || !acquirePacket(packet)) {
+        return false;
+    }
+    
+    size_t length = packet.length < bufferSize ? packet.length : bufferSize;
+    memcpy(buffer, packet.data, length);
+    if (receivedLength) {
+        *receivedLength = length;
+    }
+    
+    releasePacket(packet);
+    return true;
+}
+
+void LoRaManager::resetReceivePool() {
+    uint8_t slot;
+    while (m_rxReady.pop(slot)) {}
+    while (m_rxFree.pop(slot)) {}
+    
+    for (uint8_t i = 0; i < LORA_RX_POOL_SIZE; i++) {
+        m_rxPackets[i] = LoRaPacket{};
+        m_rxPackets[i].data = m_rxBuffers[i];
+        m_rxPackets[i].slot = i;
+        m_rxFree.push(i);
     }
 }
 
@@ -358,7 +487,7 @@ float LoRaManager::getFrequencyError() const {
 
 bool LoRaManager::isBusy() const {
     if (m_initialized) {
-        return digitalRead(BOARD_LORA_BUSY) == HIGH;
+        return ActiveLoRaRadio::isBusy();
     }
     return false;
 }
@@ -373,79 +502,78 @@ bool LoRaManager::configureRadio() {
         return false;
     }
     
-    LOG_INFO("LoRa", "Configuring radio parameters...");
+    LOG_INFO_TAG("LoRa", "Configuring radio parameters...");
     
     // Set frequency
     if (m_radio->setFrequency(m_config.frequency) == RADIOLIB_ERR_INVALID_FREQUENCY) {
-        LOG_ERROR("LoRa", "Invalid frequency: %.1f MHz", m_config.frequency);
+        LOG_ERROR_TAG("LoRa", "Invalid frequency: %.1f MHz", m_config.frequency);
         return false;
     }
     
     // Set bandwidth
     if (m_radio->setBandwidth(m_config.bandwidth) == RADIOLIB_ERR_INVALID_BANDWIDTH) {
-        LOG_ERROR("LoRa", "Invalid bandwidth: %.1f kHz", m_config.bandwidth);
+        LOG_ERROR_TAG("LoRa", "Invalid bandwidth: %.1f kHz", m_config.bandwidth);
         return false;
     }
     
     // Set spreading factor
     if (m_radio->setSpreadingFactor(m_config.spreadingFactor) == RADIOLIB_ERR_INVALID_SPREADING_FACTOR) {
-        LOG_ERROR("LoRa", "Invalid spreading factor: %d", m_config.spreadingFactor);
+        LOG_ERROR_TAG("LoRa", "Invalid spreading factor: %d", m_config.spreadingFactor);
         return false;
     }
     
     // Set coding rate
     if (m_radio->setCodingRate(m_config.codingRate) == RADIOLIB_ERR_INVALID_CODING_RATE) {
-        LOG_ERROR("LoRa", "Invalid coding rate: %d", m_config.codingRate);
+        LOG_ERROR_TAG("LoRa", "Invalid coding rate: %d", m_config.codingRate);
         return false;
     }
     
     // Set sync word
     if (m_radio->setSyncWord(m_config.syncWord) != RADIOLIB_ERR_NONE) {
-        LOG_ERROR("LoRa", "Failed to set sync word: 0x%02X", m_config.syncWord);
+        LOG_ERROR_TAG("LoRa", "Failed to set sync word: 0x%02X", m_config.syncWord);
         return false;
     }
     
     // Set output power
-    if (m_radio->setOutputPower(m_config.outputPower) == RADIOLIB_ERR_INVALID_OUTPUT_POWER) {
-        LOG_ERROR("LoRa", "Invalid output power: %d dBm", m_config.outputPower);
+    int8_t outputPower = ActiveLoRaRadio::clampPower(m_config.outputPower);
+    if (outputPower != m_config.outputPower) {
+        LOG_WARN_TAG("LoRa", "Output power limited to %d dBm on this board", outputPower);
+    }
+    if (m_radio->setOutputPower(outputPower) == RADIOLIB_ERR_INVALID_OUTPUT_POWER) {
+        LOG_ERROR_TAG("LoRa", "Invalid output power: %d dBm", outputPower);
         return false;
     }
     
     // Set current limit
     if (m_radio->setCurrentLimit(m_config.currentLimit) == RADIOLIB_ERR_INVALID_CURRENT_LIMIT) {
-        LOG_ERROR("LoRa", "Invalid current limit: %d mA", m_config.currentLimit);
+        LOG_ERROR_TAG("LoRa", "Invalid current limit: %d mA", m_config.currentLimit);
         return false;
     }
     
     // Set preamble length
     if (m_radio->setPreambleLength(m_config.preambleLength) == RADIOLIB_ERR_INVALID_PREAMBLE_LENGTH) {
-        LOG_ERROR("LoRa", "Invalid preamble length: %d", m_config.preambleLength);
+        LOG_ERROR_TAG("LoRa", "Invalid preamble length: %d", m_config.preambleLength);
         return false;
     }
     
     // Set CRC
     if (m_radio->setCRC(m_config.crcEnabled) == RADIOLIB_ERR_INVALID_CRC_CONFIGURATION) {
-        LOG_ERROR("LoRa", "Invalid CRC configuration");
-        return false;
-    }
-    
-    // Set TCXO voltage
-    if (m_radio->setTCXO(m_config.tcxoVoltage) == RADIOLIB_ERR_INVALID_TCXO_VOLTAGE) {
-        LOG_ERROR("LoRa", "Invalid TCXO voltage: %.1f V", m_config.tcxoVoltage);
+        LOG_ERROR_TAG("LoRa", "Invalid CRC configuration");
         return false;
     }
     
-    // Set DIO2 as RF switch
-    if (m_radio->setDio2AsRfSwitch() != RADIOLIB_ERR_NONE) {
-        LOG_ERROR("LoRa", "Failed to set DIO2 as RF switch");
+    // TCXO and RF switch follow the board wiring
+    int16_t boardState = m_hardware.configureBoard();
+    if (boardState != RADIOLIB_ERR_NONE) {
+        LOG_ERROR_TAG("LoRa", "Failed to apply board RF settings, code: %d", boardState);
         return false;
     }
     
-    LOG_INFO("LoRa", "Radio configured successfully");
-    LOG_INFO("LoRa", "  Frequency: %.1f MHz", m_config.frequency);
-    LOG_INFO("LoRa", "  Bandwidth: %.1f kHz", m_config.bandwidth);
-    LOG_INFO("LoRa", "  SF: %d, CR: %d", m_config.spreadingFactor, m_config.codingRate);
-    LOG_INFO("LoRa", "  Power: %d dBm", m_config.outputPower);
+    LOG_INFO_TAG("LoRa", "Radio configured successfully");
+    LOG_INFO_TAG("LoRa", "  Frequency: %.1f MHz", m_config.frequency);
+    LOG_INFO_TAG("LoRa", "  Bandwidth: %.1f kHz", m_config.bandwidth);
+    LOG_INFO_TAG("LoRa", "  SF: %d, CR: %d", m_config.spreadingFactor, m_config.codingRate);
+    LOG_INFO_TAG("LoRa", "  Power: %d dBm", outputPower);
     
     return true;
 }
@@ -463,6 +591,7 @@ void LoRaManager::disableInterrupts() {
 
 void IRAM_ATTR LoRaManager::transmitISR() {
     if (s_instance) {
+        s_instance->m_txDoneUs = (uint32_t)esp_timer_get_time();
         s_instance->m_transmittedFlag = true;
         uint32_t event = 1; // Transmit event
         BaseType_t xHigherPriorityTaskWoken = pdFALSE;
@@ -475,6 +604,7 @@ void IRAM_ATTR LoRaManager::transmitISR() {
 
 void IRAM_ATTR LoRaManager::receiveISR() {
     if (s_instance) {
+        s_instance->m_rxDoneUs = (uint32_t)esp_timer_get_time();
         s_instance->m_receivedFlag = true;
         uint32_t event = 2; // Receive event
         BaseType_t xHigherPriorityTaskWoken = pdFALSE;
@@ -489,16 +619,22 @@ void LoRaManager::loraTask(void* parameter) {
     LoRaManager* manager = static_cast<LoRaManager*>(parameter);
     uint32_t event;
     
-    LOG_INFO("LoRa", "LoRa task started");
+    LOG_INFO_TAG("LoRa", "LoRa task started");
     
     while (true) {
-        if (xQueueReceive(manager->m_eventQueue, &event, pdMS_TO_TICKS(1000)) == pdTRUE) {
+        // Start the next queued transmission if the channel and duty cycle allow it
+        TickType_t wait = manager->serviceTxQueue();
+        
+        if (xQueueReceive(manager->m_eventQueue, &event, wait) == pdTRUE) {
             switch (event) {
                 case 1: // Transmit complete
                     manager->handleTransmitComplete();
                     break;
                 case 2: // Receive complete
                     manager->handleReceiveComplete();
+                    manager->dispatchReceived();
+                    break;
+                case 3: // Transmit queued
                     break;
                 default:
                     break;
@@ -510,36 +646,57 @@ void LoRaManager::loraTask(void* parameter) {
     }
 }
 
-void LoRaManager::handleTransmitComplete() {
-    if (!m_transmittedFlag) {
+void LoRaManager::handleTransmitComplete(bool timedOut) {
+    if (!m_transmittedFlag && !timedOut) {
         return;
     }
     
+    // The flag is only cleared under the mutex; if the wait times out, serviceTxQueue() retries
+    if (xSemaphoreTake(m_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return;
+    }
+    
+    // The interrupt may still have come in while the watchdog waited for the mutex
+    timedOut = timedOut && !m_transmittedFlag;
     m_transmittedFlag = false;
     
-    if (xSemaphoreTake(m_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        // Finish transmission
-        int state = m_radio->finishTransmit();
-        bool success = (state == RADIOLIB_ERR_NONE);
-        
-        if (success) {
-            m_stats.packetsTransmitted++;
-            LOG_DEBUG("LoRa", "Transmission completed successfully");
-        } else {
-            m_stats.transmissionErrors++;
-            LOG_ERROR("LoRa", "Transmission failed, code: %d", state);
-        }
-        
-        // Call callback if set
-        if (m_transmitCallback) {
-            m_transmitCallback(success, state);
-            m_transmitCallback = nullptr;
-        }
-        
-        // Return to idle mode
-        m_currentMode = LoRaMode::IDLE;
-        
+    int8_t index = m_txActive;
+    if (index < 0) {
         xSemaphoreGive(m_mutex);
+        return;
+    }
+    
+    // Finish transmission; after a lost TX done interrupt this resets the radio's IRQ state
+    int state = m_radio->finishTransmit();
+    if (timedOut) {
+        state = LORA_ERR_TX_TIMEOUT;
+    }
+    bool success = (state == RADIOLIB_ERR_NONE);
+    
+    if (success) {
+        trace_record(TRACE_LORA_TX_AIRTIME, m_txStartUs, m_txDoneUs - m_txStartUs);
+        m_stats.packetsTransmitted++;
+        LOG_DEBUG_TAG("LoRa", "Transmission completed successfully");
+    } else if (timedOut) {
+        m_stats.transmissionErrors++;
+        LOG_ERROR_TAG("LoRa", "Transmission timed out, TX done interrupt never arrived");
+    } else {
+        m_stats.transmissionErrors++;
+        LOG_ERROR_TAG("LoRa", "Transmission failed, code: %d", state);
+    }
+    
+    // Back to listening between packets
+    rearmReceive();
+    
+    m_txActive = -1;
+    xSemaphoreGive(m_mutex);
+    
+    // Call callback outside the radio mutex
+    scoreTransmit(index, success);
+    LoRaTransmitCallback callback = m_txQueue[index].callback;
+    releaseTx(index);
+    if (callback) {
+        callback(success, state);
     }
 }
 
@@ -551,15 +708,21 @@ void LoRaManager::handleReceiveComplete() {
     m_receivedFlag = false;
     
     if (xSemaphoreTake(m_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        // Read received data
-        String receivedData;
-        int state = m_radio->readData(receivedData);
+        // Read straight into a pool slot; with none free the FIFO still has to be drained
+        static uint8_t discard[LORA_RX_SLOT_SIZE];
+        uint8_t slot = LORA_NO_SLOT;
+        bool haveSlot = m_rxFree.pop(slot);
+        uint8_t* buffer = haveSlot ? m_rxBuffers[slot] : discard;
+        
+        size_t length = m_radio->getPacketLength();
+        if (length > LORA_RX_SLOT_SIZE) {
+            length = LORA_RX_SLOT_SIZE;
+        }
+        int state = m_radio->readData(buffer, length);
         
-        if (state == RADIOLIB_ERR_NONE) {
-            // Create packet structure
-            LoRaPacket packet;
-            packet.data = reinterpret_cast<uint8_t*>(const_cast<char*>(receivedData.c_str()));
-            packet.length = receivedData.length();
+        if (state == RADIOLIB_ERR_NONE && haveSlot) {
+            LoRaPacket& packet = m_rxPackets[slot];
+            packet.length = length;
             packet.rssi = m_radio->getRSSI();
             packet.snr = m_radio->getSNR();
             packet.frequencyError = m_radio->getFrequencyError();
@@ -570,29 +733,240 @@ void LoRaManager::handleReceiveComplete() {
             m_stats.lastRssi = packet.rssi;
             m_stats.lastSnr = packet.snr;
             
-            LOG_DEBUG("LoRa", "Received packet: %d bytes, RSSI: %d dBm, SNR: %.1f dB", 
+            LOG_DEBUG_TAG("LoRa", "Received packet: %d bytes, RSSI: %d dBm, SNR: %.1f dB", 
                      packet.length, packet.rssi, packet.snr);
             
-            // Call callback if set
-            if (m_receiveCallback) {
-                m_receiveCallback(packet);
-            }
+            m_rxStampUs[slot] = m_rxDoneUs;
+            m_rxReady.push(slot);
+            haveSlot = false;
             
+        } else if (state == RADIOLIB_ERR_NONE) {
+            m_stats.rxOverruns++;
+            LOG_WARN_TAG("LoRa", "Receive pool exhausted, packet dropped");
         } else if (state == RADIOLIB_ERR_CRC_MISMATCH) {
             m_stats.crcErrors++;
-            LOG_WARN("LoRa", "CRC error in received packet");
+            LOG_WARN_TAG("LoRa", "CRC error in received packet");
         } else {
             m_stats.receptionErrors++;
-            LOG_ERROR("LoRa", "Reception failed, code: %d", state);
+            LOG_ERROR_TAG("LoRa", "Reception failed, code: %d", state);
+        }
+        
+        if (haveSlot) {
+            m_rxFree.push(slot);
         }
         
         // Continue receiving if still in receive mode
         if (m_currentMode == LoRaMode::RECEIVE) {
-            m_radio->startReceive();
+            armReceive();
+        }
+        
+        xSemaphoreGive(m_mutex);
+    }
+}
+
+void LoRaManager::dispatchReceived() {
+    // Runs after the radio is re-armed and without m_mutex, so slow callbacks cost no packets
+    LoRaReceiveCallback callback = m_receiveCallback;
+    if (!callback) {
+        return;
+    }
+    
+    LoRaPacket packet;
+    while (acquirePacket(packet)) {
+        trace_end(TRACE_LORA_RX_LATENCY, m_rxStampUs[packet.slot]);
+        callback(packet);
+        releasePacket(packet);
+    }
+}
+
+int8_t LoRaManager::selectNextTx() {
+    // Highest priority first, oldest first within a priority
+    int8_t best = -1;
+    portENTER_CRITICAL(&m_txLock);
+    for (size_t i = 0; i < LORA_TX_QUEUE_SIZE; i++) {
+        const LoRaTxEntry& entry = m_txQueue[i];
+        if (!entry.inUse || entry.length == 0 || (int8_t)i == m_txActive) {
+            continue;
+        }
+        if (best < 0 || entry.priority > m_txQueue[best].priority ||
+            (entry.priority == m_txQueue[best].priority &&
+             (int32_t)(entry.sequence - m_txQueue[best].sequence) < 0)) {
+            best = i;
+        }
+    }
+    portEXIT_CRITICAL(&m_txLock);
+    return best;
+}
+
+void LoRaManager::releaseTx(int8_t index) {
+    portENTER_CRITICAL(&m_txLock);
+    m_txQueue[index].length = 0;
+    m_txQueue[index].inUse = false;
+    portEXIT_CRITICAL(&m_txLock);
+}
+
+void LoRaManager::rollAirtimeWindow(uint32_t now) {
+    uint32_t minute = now / 60000;
+    if (minute - m_airtimeBucketMinute >= 60) {
+        memset(m_airtimeBuckets, 0, sizeof(m_airtimeBuckets));
+        m_airtimeWindowTotal = 0;
+    } else {
+        while (m_airtimeBucketMinute != minute) {
+            m_airtimeBucketMinute++;
+            uint32_t& bucket = m_airtimeBuckets[m_airtimeBucketMinute % 60];
+            m_airtimeWindowTotal -= bucket;
+            bucket = 0;
+        }
+    }
+    m_airtimeBucketMinute = minute;
+}
+
+bool LoRaManager::channelClear() {
+    // CAD reports on DIO1; keep it away from the receive handler while scanning
+    m_radio->clearPacketReceivedAction();
+    int state = m_radio->scanChannel();
+    return state != RADIOLIB_LORA_DETECTED;
+}
+
+int16_t LoRaManager::armReceive() {
+    if (!m_rxDutyCycle) {
+        return m_radio->startReceive();
+    }
+    // Listen windows are timed so a sender's preamble always spans one of them
+    int16_t state = m_radio->startReceiveDutyCycleAuto(m_config.preambleLength, 8);
+    if (state != RADIOLIB_ERR_NONE) {
+        // Preamble too short to fit a sleep period at this spreading factor
+        LOG_WARN_TAG("LoRa", "RX duty cycle unavailable (%d), receiving continuously", state);
+        state = m_radio->startReceive();
+    }
+    return state;
+}
+
+void LoRaManager::rearmReceive() {
+    // DIO1 is shared by TX done, RX done and CAD, so restore the receive action every time
+    if (m_receiveEnabled) {
+        m_radio->setPacketReceivedAction(receiveISR);
+        armReceive();
+        m_currentMode = LoRaMode::RECEIVE;
+    } else {
+        m_currentMode = LoRaMode::IDLE;
+    }
+}
+
+void LoRaManager::scoreTransmit(int8_t index, bool success) {
+    const LoRaTxEntry& entry = m_txQueue[index];
+    LinkScorer& scorer = LinkScorer::getInstance();
+    
+    if (!success) {
+        scorer.recordSend(CommInterface::LORA, false, entry.length);
+        return;
+    }
+    
+    // Throughput from time on air; latency from queueing to TX done, so LBT backoff
+    // and duty cycle holds count against the link
+    uint32_t airtimeMs = (m_txDoneUs - m_txStartUs) / 1000;
+    scorer.recordSend(CommInterface::LORA, true, entry.length, airtimeMs > 0 ? airtimeMs : 1);
+    scorer.sampleRoundTrip(CommInterface::LORA, millis() - entry.queuedAt);
+}
+
+TickType_t LoRaManager::serviceTxQueue() {
+    const TickType_t idleWait = pdMS_TO_TICKS(1000);
+    
+    // One transmission at a time; the TX done interrupt wakes the task
+    if (m_txActive >= 0) {
+        int32_t left = (int32_t)(m_txDeadline - millis());
+        if (m_transmittedFlag || left <= 0) {
+            // A completion whose mutex wait timed out, or a lost DIO1 interrupt
+            handleTransmitComplete(!m_transmittedFlag);
+        }
+        if (m_txActive >= 0) {
+            left = (int32_t)(m_txDeadline - millis());
+            return (m_transmittedFlag || left <= 0) ? pdMS_TO_TICKS(10) : pdMS_TO_TICKS(left);
+        }
+    }
+    
+    uint32_t now = millis();
+    int32_t until = (int32_t)(m_txNextAttempt - now);
+    if (until > 0) {
+        return pdMS_TO_TICKS(until);
+    }
+    
+    int8_t index = selectNextTx();
+    if (index < 0) {
+        return idleWait;
+    }
+    LoRaTxEntry& entry = m_txQueue[index];
+    
+    // Duty cycle: hold the packet until enough airtime has rolled out of the window
+    uint32_t airtime = getTimeOnAir(entry.length);
+    rollAirtimeWindow(now);
+    if (m_config.dutyCyclePercent > 0.0f) {
+        uint32_t budget = (uint32_t)(m_config.dutyCyclePercent * 36000.0f);
+        if (m_airtimeWindowTotal + airtime > budget) {
+            m_stats.dutyCycleDeferrals++;
+            m_txNextAttempt = now + (60000 - now % 60000) + 1;
+            LOG_DEBUG_TAG("LoRa", "Duty cycle budget exhausted (%lu/%lu ms)", m_airtimeWindowTotal, budget);
+            return pdMS_TO_TICKS(m_txNextAttempt - now);
         }
+    }
+    
+    if (xSemaphoreTake(m_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return pdMS_TO_TICKS(10);
+    }
+    
+    // Listen before talk with randomized exponential backoff
+    if (m_config.listenBeforeTalk && !channelClear()) {
+        m_stats.channelBusy++;
+        entry.cadAttempts++;
+        rearmReceive();
+        xSemaphoreGive(m_mutex);
         
+        if (entry.cadAttempts >= LORA_MAX_CAD_ATTEMPTS) {
+            LOG_WARN_TAG("LoRa", "Channel busy, giving up after %d attempts", entry.cadAttempts);
+            m_stats.transmissionErrors++;
+            scoreTransmit(index, false);
+            LoRaTransmitCallback callback = entry.callback;
+            releaseTx(index);
+            if (callback) {
+                callback(false, LORA_ERR_CHANNEL_BUSY);
+            }
+            return 0;
+        }
+        
+        uint32_t slotMs = getTimeOnAir(0) / 4 + 1;
+        m_txNextAttempt = now + slotMs * random(1, (1L << entry.cadAttempts) + 1);
+        return pdMS_TO_TICKS(m_txNextAttempt - now);
+    }
+    
+    m_transmittedFlag = false;
+    m_radio->setPacketSentAction(transmitISR);
+    m_txStartUs = trace_begin();
+    int state = m_radio->startTransmit(entry.data, entry.length);
+    
+    if (state == RADIOLIB_ERR_NONE) {
+        m_txActive = index;
+        m_txDeadline = millis() + airtime + LORA_TX_WATCHDOG_MARGIN_MS;
+        m_currentMode = LoRaMode::TRANSMIT;
+        m_airtimeBuckets[m_airtimeBucketMinute % 60] += airtime;
+        m_airtimeWindowTotal += airtime;
+        m_stats.airtimeMs += airtime;
+        LOG_DEBUG_TAG("LoRa", "Started transmission of %d bytes (%lu ms on air)", entry.length, airtime);
         xSemaphoreGive(m_mutex);
+        return pdMS_TO_TICKS(airtime + LORA_TX_WATCHDOG_MARGIN_MS);
     }
+    
+    LOG_ERROR_TAG("LoRa", "Failed to start transmission, code: %d", state);
+    m_stats.transmissionErrors++;
+    rearmReceive();
+    xSemaphoreGive(m_mutex);
+    
+    scoreTransmit(index, false);
+    LoRaTransmitCallback callback = entry.callback;
+    releaseTx(index);
+    if (callback) {
+        callback(false, state);
+    }
+    return 0;
 }
 
 void LoRaManager::updateStats() {
@@ -13,7 +13,9 @@
 #include <freertos/queue.h>
 #include <freertos/semphr.h>
 #include "core/hal/board_config.h"
+#include "core/communication/lora_radio.h"
 #include "core/utils/logger.h"
+#include "core/utils/spsc_ring.h"
 
 namespace TDeckOS {
 namespace Communication {
@@ -36,16 +38,34 @@ struct LoRaConfig {
     float bandwidth = 125.0;        // kHz
     uint8_t spreadingFactor = 10;   // SF10
     uint8_t codingRate = 6;         // CR 4/6
-    int8_t outputPower = 22;        // dBm
+    int8_t outputPower = 22;        // dBm, capped at the board's PA limit
     uint16_t preambleLength = 15;   // symbols
     uint8_t syncWord = 0xAB;        // LoRa sync word
-    float tcxoVoltage = 2.4;        // V
     uint8_t currentLimit = 140;     // mA
     bool crcEnabled = false;
+    bool listenBeforeTalk = true;   // CAD before every transmission
+    float dutyCyclePercent = 10.0;  // Airtime budget per rolling hour, 0 = unlimited
 };
 
+/**
+ * @brief Transmit queue priority; higher priorities are sent first
+ */
+enum class LoRaTxPriority : uint8_t {
+    BACKGROUND,
+    NORMAL,
+    URGENT
+};
+
+/**
+ * @brief Receive pool dimensions; a slot holds the largest SX1262 payload
+ */
+constexpr size_t LORA_RX_POOL_SIZE = 8;     // Power of two
+constexpr size_t LORA_RX_SLOT_SIZE = 256;
+constexpr uint8_t LORA_NO_SLOT = 0xFF;
+
 /**
  * @brief LoRa packet structure
+ * @note data points into a receive pool slot and stays valid until the slot is released
  */
 struct LoRaPacket {
     uint8_t* data;
@@ -55,6 +75,7 @@ struct LoRaPacket {
     float frequencyError;
     uint32_t timestamp;
     bool isValid;
+    uint8_t slot;               // Receive pool slot, LORA_NO_SLOT if not pooled
 };
 
 /**
@@ -66,6 +87,11 @@ struct LoRaStats {
     uint32_t transmissionErrors;
     uint32_t receptionErrors;
     uint32_t crcErrors;
+    uint32_t rxOverruns;        // Packets dropped because every pool slot was held
+    uint32_t txQueueDrops;      // Transmissions rejected because the queue was full
+    uint32_t channelBusy;       // CAD found the channel occupied
+    uint32_t dutyCycleDeferrals;// Transmissions held back by the airtime budget
+    uint32_t airtimeMs;         // Total time on air
     int16_t lastRssi;
     float lastSnr;
     uint32_t uptime;
@@ -77,6 +103,29 @@ struct LoRaStats {
 typedef void (*LoRaTransmitCallback)(bool success, int errorCode);
 typedef void (*LoRaReceiveCallback)(const LoRaPacket& packet);
 
+/**
+ * @brief Transmit queue dimensions
+ */
+constexpr size_t LORA_TX_QUEUE_SIZE = 8;
+constexpr uint8_t LORA_MAX_CAD_ATTEMPTS = 8;
+constexpr int LORA_ERR_CHANNEL_BUSY = -1000;
+constexpr int LORA_ERR_TX_TIMEOUT = -1001;
+constexpr uint32_t LORA_TX_WATCHDOG_MARGIN_MS = 1000;   // Past the time on air before TX is given up
+
+/**
+ * @brief Queued transmission
+ */
+struct LoRaTxEntry {
+    uint8_t data[LORA_RX_SLOT_SIZE];
+    size_t length;
+    LoRaTxPriority priority;
+    LoRaTransmitCallback callback;
+    uint32_t sequence;          // FIFO order within a priority
+    uint32_t queuedAt;          // millis() when queued, for delivery latency
+    uint8_t cadAttempts;
+    bool inUse;
+};
+
 /**
  * @brief LoRa Manager class for SX1262 radio
  */
@@ -124,21 +173,44 @@ public:
     LoRaMode getMode() const { return m_currentMode; }
 
     /**
-     * @brief Transmit data
-     * @param data Data to transmit
+     * @brief Queue data for transmission
+     * @param data Data to transmit (copied)
      * @param length Data length
-     * @param callback Optional callback for transmission result
-     * @return true if transmission started, false otherwise
+     * @param callback Optional callback for transmission result, invoked on the LoRa task
+     * @param priority Queue priority
+     * @return true if queued, false if invalid or the queue is full
      */
-    bool transmit(const uint8_t* data, size_t length, LoRaTransmitCallback callback = nullptr);
+    bool transmit(const uint8_t* data, size_t length, LoRaTransmitCallback callback = nullptr,
+                  LoRaTxPriority priority = LoRaTxPriority::NORMAL);
 
     /**
-     * @brief Transmit string
+     * @brief Queue string for transmission
      * @param message String to transmit
      * @param callback Optional callback for transmission result
-     * @return true if transmission started, false otherwise
+     * @param priority Queue priority
+     * @return true if queued, false otherwise
+     */
+    bool transmit(const String& message, LoRaTransmitCallback callback = nullptr,
+                  LoRaTxPriority priority = LoRaTxPriority::NORMAL);
+
+    /**
+     * @brief Get number of queued or in-flight transmissions
+     * @return Queue depth
+     */
+    size_t getQueuedTransmissions() const;
+
+    /**
+     * @brief Calculate time on air for a payload with the current configuration
+     * @param length Payload length in bytes
+     * @return Airtime in milliseconds
      */
-    bool transmit(const String& message, LoRaTransmitCallback callback = nullptr);
+    uint32_t getTimeOnAir(size_t length) const;
+
+    /**
+     * @brief Get airtime used in the rolling duty-cycle window
+     * @return Airtime in milliseconds over the last hour
+     */
+    uint32_t getAirtimeUsed() const { return m_airtimeWindowTotal; }
 
     /**
      * @brief Start continuous receive mode
@@ -147,6 +219,29 @@ public:
      */
     bool startReceive(LoRaReceiveCallback callback);
 
+    /**
+     * @brief Take the oldest received packet without copying it
+     * @param packet Receives the packet; its data stays valid until releasePacket()
+     * @return true if a packet was available, false otherwise
+     * @note Single consumer; only used when no receive callback is installed
+     */
+    bool acquirePacket(LoRaPacket& packet);
+
+    /**
+     * @brief Return a packet's slot to the receive pool
+     * @param packet Packet obtained from acquirePacket()
+     */
+    void releasePacket(const LoRaPacket& packet);
+
+    /**
+     * @brief Copy out the oldest received packet and release its slot
+     * @param buffer Destination buffer
+     * @param bufferSize Destination size; longer packets are truncated
+     * @param receivedLength Receives the copied length
+     * @return true if a packet was available, false otherwise
+     */
+    bool receive(uint8_t* buffer, size_t bufferSize, size_t* receivedLength);
+
     /**
      * @brief Stop receive mode
      */
@@ -158,6 +253,19 @@ public:
      */
     bool isReceiving() const { return m_currentMode == LoRaMode::RECEIVE; }
 
+    /**
+     * @brief Listen in SX1262 RX duty-cycle mode instead of continuous receive
+     *
+     * The radio sleeps between short listen windows sized from the preamble
+     * length, so a packet sent with the configured preamble is still caught.
+     * Takes effect at once if receiving, otherwise at the next receive.
+     * @param enable true to duty-cycle, false for continuous receive
+     * @return true if successful, false otherwise
+     */
+    bool setReceiveDutyCycle(bool enable);
+
+    bool isReceiveDutyCycled() const { return m_rxDutyCycle; }
+
     /**
      * @brief Set sleep mode
      * @return true if successful, false otherwise
@@ -225,8 +333,8 @@ public:
 
 private:
     // Hardware
-    SX1262* m_radio;
-    SPIClass* m_spi;
+    ActiveLoRaRadio m_hardware;     // Driver objects for this board, in place
+    LoRaChip* m_radio;              // Null until initialized
     
     // Configuration
     LoRaConfig m_config;
@@ -234,7 +342,6 @@ private:
     LoRaMode m_currentMode;
     
     // Callbacks
-    LoRaTransmitCallback m_transmitCallback;
     LoRaReceiveCallback m_receiveCallback;
     
     // Statistics
@@ -250,6 +357,33 @@ private:
     volatile bool m_transmittedFlag;
     volatile bool m_receivedFlag;
     
+    // Trace timestamps in microseconds, taken in the ISRs and at transmit start
+    volatile uint32_t m_txDoneUs;
+    volatile uint32_t m_rxDoneUs;
+    uint32_t m_txStartUs;
+    
+    // Receive pool: free slots flow consumer -> radio, filled slots radio -> consumer
+    uint8_t m_rxBuffers[LORA_RX_POOL_SIZE][LORA_RX_SLOT_SIZE];
+    LoRaPacket m_rxPackets[LORA_RX_POOL_SIZE];
+    uint32_t m_rxStampUs[LORA_RX_POOL_SIZE];
+    Utils::SpscRing<uint8_t, LORA_RX_POOL_SIZE> m_rxFree;
+    Utils::SpscRing<uint8_t, LORA_RX_POOL_SIZE> m_rxReady;
+    bool m_receiveEnabled;
+    bool m_rxDutyCycle;
+    
+    // Transmit queue, shared by any number of producers under a spinlock
+    LoRaTxEntry m_txQueue[LORA_TX_QUEUE_SIZE];
+    mutable portMUX_TYPE m_txLock;
+    uint32_t m_txSequence;
+    int8_t m_txActive;
+    uint32_t m_txDeadline;          // TX done interrupt overdue after this
+    uint32_t m_txNextAttempt;
+    
+    // Duty cycle: airtime per minute over a rolling hour
+    uint32_t m_airtimeBuckets[60];
+    uint32_t m_airtimeBucketMinute;
+    uint32_t m_airtimeWindowTotal;
+    
     // Internal methods
     bool configureRadio();
     void enableInterrupts();
@@ -257,8 +391,18 @@ private:
     static void transmitISR();
     static void receiveISR();
     static void loraTask(void* parameter);
-    void handleTransmitComplete();
+    void handleTransmitComplete(bool timedOut = false);
     void handleReceiveComplete();
+    void dispatchReceived();
+    void resetReceivePool();
+    TickType_t serviceTxQueue();
+    int8_t selectNextTx();
+    void releaseTx(int8_t index);
+    void scoreTransmit(int8_t index, bool success);
+    bool channelClear();
+    void rearmReceive();
+    int16_t armReceive();
+    void rollAirtimeWindow(uint32_t now);
     void updateStats();
     
     // Static instance for ISR
@@ -0,0 +1,135 @@
+/**
+ * @file lora_radio.h
+ * @brief Board-specialised LoRa radio facade
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ *
+ * LoRaRadio owns the RadioLib Module and chip objects in static storage,
+ * built from a board profile: the chip class, pins, SPI clock and the
+ * board-fixed RF settings (TCXO, RF switch, PA limit) are template
+ * constants, so there is no heap allocation and no runtime configuration
+ * for anything the board decides.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <RadioLib.h>
+#include <new>
+#include "core/hal/board_profile.h"
+
+namespace TDeckOS {
+namespace Communication {
+
+/**
+ * @brief RadioLib class and limits per chip
+ */
+template <Board::RadioChip Chip>
+struct LoRaChipTraits;
+
+template <>
+struct LoRaChipTraits<Board::RadioChip::SX1262> {
+    using Type = SX1262;
+    static constexpr const char* NAME = "SX1262";
+    static constexpr float MIN_FREQUENCY = 150.0f;
+    static constexpr float MAX_FREQUENCY = 960.0f;
+};
+
+template <>
+struct LoRaChipTraits<Board::RadioChip::SX1268> {
+    using Type = SX1268;
+    static constexpr const char* NAME = "SX1268";
+    static constexpr float MIN_FREQUENCY = 410.0f;
+    static constexpr float MAX_FREQUENCY = 810.0f;
+};
+
+/**
+ * @brief LoRa radio of a board profile
+ */
+template <typename Profile>
+class LoRaRadio {
+public:
+    using Pins = typename Profile::LoRa;
+    using Traits = LoRaChipTraits<Pins::CHIP>;
+    using Chip = typename Traits::Type;
+
+    static constexpr const char* NAME = Traits::NAME;
+
+    /**
+     * @brief Power the radio, start the bus and construct the driver in place
+     * @return The chip driver, not yet begun
+     */
+    Chip* create() {
+        if (m_chip) {
+            return m_chip;
+        }
+
+        if constexpr (Pins::ENABLE != Board::NO_PIN) {
+            pinMode(Pins::ENABLE, OUTPUT);
+            digitalWrite(Pins::ENABLE, HIGH);
+            delay(100);
+        }
+
+        // The bus is shared with the panel and already started by setup_hardware()
+        m_module = new (m_moduleStorage) Module(Pins::CS, Pins::IRQ, Pins::RST, Pins::BUSY, SPI,
+                                                SPISettings(Pins::SPI_HZ, MSBFIRST, SPI_MODE0));
+        m_chip = new (m_chipStorage) Chip(m_module);
+        return m_chip;
+    }
+
+    /**
+     * @brief Destroy the driver and power the radio down
+     */
+    void destroy() {
+        if (m_chip) {
+            m_chip->~Chip();
+            m_module->~Module();
+            m_chip = nullptr;
+            m_module = nullptr;
+        }
+
+        if constexpr (Pins::ENABLE != Board::NO_PIN) {
+            digitalWrite(Pins::ENABLE, LOW);
+        }
+    }
+
+    /**
+     * @brief Apply the settings the board wiring decides
+     * @return RADIOLIB_ERR_NONE or the first error
+     */
+    int16_t configureBoard() {
+        int16_t state = m_chip->setTCXO(Pins::TCXO_VOLTAGE);
+        if (state != RADIOLIB_ERR_NONE) {
+            return state;
+        }
+        if constexpr (Pins::DIO2_RF_SWITCH) {
+            state = m_chip->setDio2AsRfSwitch();
+        }
+        return state;
+    }
+
+    Chip* chip() const { return m_chip; }
+
+    static bool isBusy() { return digitalRead(Pins::BUSY) == HIGH; }
+
+    static constexpr int8_t clampPower(int8_t dbm) {
+        return dbm > Pins::MAX_POWER_DBM ? Pins::MAX_POWER_DBM : dbm;
+    }
+
+    static constexpr bool supportsFrequency(float mhz) {
+        return mhz >= Traits::MIN_FREQUENCY && mhz <= Traits::MAX_FREQUENCY;
+    }
+
+private:
+    alignas(Module) uint8_t m_moduleStorage[sizeof(Module)];
+    alignas(Chip) uint8_t m_chipStorage[sizeof(Chip)];
+    Module* m_module = nullptr;
+    Chip* m_chip = nullptr;
+};
+
+using ActiveLoRaRadio = LoRaRadio<Board::Active>;
+using LoRaChip = ActiveLoRaRadio::Chip;
+
+} // namespace Communication
+} // namespace TDeckOS
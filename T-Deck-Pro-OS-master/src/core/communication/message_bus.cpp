@@ -0,0 +1,380 @@
+/**
+ * @file message_bus.cpp
+ * @brief Zero-copy message bus implementation
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ */
+
+#include "message_bus.h"
+#include "core/hal/board_config.h"
+#include "core/utils/logger.h"
+#include <string.h>
+
+namespace TDeckOS {
+namespace Communication {
+
+MessageBus& MessageBus::getInstance() {
+    static MessageBus instance;
+    return instance;
+}
+
+MessageBus::MessageBus()
+    : m_initialized(false)
+    , m_storage(nullptr)
+    , m_freeCount(0)
+    , m_rxQueues{}
+    , m_txQueues{}
+    , m_subscriptions{}
+    , m_transports{}
+    , m_lock(portMUX_INITIALIZER_UNLOCKED)
+    , m_taskHandle(nullptr)
+    , m_stats{}
+    , m_traffic{}
+{
+}
+
+bool MessageBus::initialize() {
+    if (m_initialized) {
+        return true;
+    }
+
+    // One PSRAM block for every payload; buffers never move or get freed while running
+    m_storage = (uint8_t*)ps_malloc(BUS_BUFFER_COUNT * BUS_BUFFER_SIZE);
+    if (!m_storage) {
+        LOG_ERROR_TAG("Bus", "Failed to allocate message buffers");
+        return false;
+    }
+
+    for (size_t i = 0; i < BUS_BUFFER_COUNT; i++) {
+        m_messages[i].data = m_storage + i * BUS_BUFFER_SIZE;
+        m_messages[i].refCount.store(0);
+        m_freeList[i] = i;
+    }
+    m_freeCount = BUS_BUFFER_COUNT;
+
+    for (size_t i = 0; i < COMM_INTERFACE_COUNT; i++) {
+        m_rxQueues[i] = xQueueCreate(BUS_QUEUE_DEPTH, sizeof(BusMessage*));
+        m_txQueues[i] = xQueueCreate(BUS_QUEUE_DEPTH, sizeof(BusMessage*));
+        if (!m_rxQueues[i] || !m_txQueues[i]) {
+            LOG_ERROR_TAG("Bus", "Failed to create interface queues");
+            deinitialize();
+            return false;
+        }
+    }
+
+    BaseType_t result = xTaskCreate(
+        busTask,
+        "MsgBus",
+        4096,
+        this,
+        SYSTEM_TASK_PRIORITY,
+        &m_taskHandle
+    );
+
+    if (result != pdPASS) {
+        LOG_ERROR_TAG("Bus", "Failed to create bus task");
+        deinitialize();
+        return false;
+    }
+
+    m_initialized = true;
+    LOG_INFO_TAG("Bus", "Message bus initialized (%d x %d byte buffers)", BUS_BUFFER_COUNT, BUS_BUFFER_SIZE);
+    return true;
+}
+
+void MessageBus::deinitialize() {
+    if (m_taskHandle) {
+        vTaskDelete(m_taskHandle);
+        m_taskHandle = nullptr;
+    }
+
+    m_initialized = false;
+
+    for (size_t i = 0; i < COMM_INTERFACE_COUNT; i++) {
+        if (m_rxQueues[i]) {
+            vQueueDelete(m_rxQueues[i]);
+            m_rxQueues[i] = nullptr;
+        }
+        if (m_txQueues[i]) {
+            vQueueDelete(m_txQueues[i]);
+            m_txQueues[i] = nullptr;
+        }
+    }
+
+    if (m_storage) {
+        free(m_storage);
+        m_storage = nullptr;
+    }
+    m_freeCount = 0;
+    m_stats.buffersInUse = 0;
+}
+
+BusMessage* MessageBus::allocate(size_t length) {
+    if (length > BUS_BUFFER_SIZE) {
+        m_stats.allocFailures++;
+        return nullptr;
+    }
+
+    BusMessage* message = nullptr;
+    portENTER_CRITICAL(&m_lock);
+    if (m_freeCount > 0) {
+        message = &m_messages[m_freeList[--m_freeCount]];
+        m_stats.buffersInUse++;
+    }
+    portEXIT_CRITICAL(&m_lock);
+
+    if (!message) {
+        m_stats.allocFailures++;
+        return nullptr;
+    }
+
+    message->length = length;
+    message->topic = BUS_TOPIC_ANY;
+    message->interface = CommInterface::LORA;
+    message->rssi = 0;
+    message->timestamp = millis();
+    message->refCount.store(1, std::memory_order_relaxed);
+    return message;
+}
+
+void MessageBus::retain(BusMessage* message) {
+    if (message) {
+        message->refCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void MessageBus::release(BusMessage* message) {
+    if (!message || message->refCount.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+
+    portENTER_CRITICAL(&m_lock);
+    m_freeList[m_freeCount++] = message - m_messages;
+    m_stats.buffersInUse--;
+    portEXIT_CRITICAL(&m_lock);
+}
+
+bool MessageBus::publish(BusMessage* message) {
+    if (!message) {
+        return false;
+    }
+
+    size_t index = static_cast<size_t>(message->interface);
+    if (!m_initialized || xQueueSend(m_rxQueues[index], &message, 0) != pdTRUE) {
+        m_stats.queueDrops++;
+        release(message);
+        return false;
+    }
+
+    m_stats.published++;
+    notify(1UL << (RX_NOTIFY_SHIFT + index));
+    return true;
+}
+
+bool MessageBus::publish(uint32_t topic, const uint8_t* data, size_t length, CommInterface source, int16_t rssi) {
+    BusMessage* message = allocate(length);
+    if (!message) {
+        return false;
+    }
+
+    memcpy(message->data, data, length);
+    message->topic = topic;
+    message->interface = source;
+    message->rssi = rssi;
+    return publish(message);
+}
+
+bool MessageBus::send(BusMessage* message, CommInterface interface) {
+    if (!message) {
+        return false;
+    }
+
+    size_t index = static_cast<size_t>(interface);
+    if (!m_initialized || !hasTransport(interface)) {
+        m_stats.sendErrors++;
+        release(message);
+        return false;
+    }
+
+    message->interface = interface;
+    if (xQueueSend(m_txQueues[index], &message, 0) != pdTRUE) {
+        m_stats.queueDrops++;
+        release(message);
+        return false;
+    }
+
+    notify(1UL << (TX_NOTIFY_SHIFT + index));
+    return true;
+}
+
+bool MessageBus::send(const uint8_t* data, size_t length, CommInterface interface, uint32_t topic) {
+    if (!hasTransport(interface)) {
+        m_stats.sendErrors++;
+        return false;
+    }
+
+    BusMessage* message = allocate(length);
+    if (!message) {
+        return false;
+    }
+
+    memcpy(message->data, data, length);
+    message->topic = topic;
+    return send(message, interface);
+}
+
+int MessageBus::subscribe(uint32_t topic, BusSubscriber handler, void* context) {
+    if (!handler) {
+        return -1;
+    }
+
+    int id = -1;
+    portENTER_CRITICAL(&m_lock);
+    for (size_t i = 0; i < BUS_MAX_SUBSCRIBERS; i++) {
+        if (!m_subscriptions[i].handler) {
+            m_subscriptions[i].topic = topic;
+            m_subscriptions[i].context = context;
+            m_subscriptions[i].handler = handler;
+            id = i;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&m_lock);
+
+    if (id < 0) {
+        LOG_WARN_TAG("Bus", "Subscription table full");
+    }
+    return id;
+}
+
+void MessageBus::unsubscribe(int id) {
+    if (id < 0 || id >= (int)BUS_MAX_SUBSCRIBERS) {
+        return;
+    }
+
+    portENTER_CRITICAL(&m_lock);
+    m_subscriptions[id].handler = nullptr;
+    m_subscriptions[id].context = nullptr;
+    portEXIT_CRITICAL(&m_lock);
+}
+
+void MessageBus::registerTransport(CommInterface interface, BusTransport transport, void* context) {
+    size_t index = static_cast<size_t>(interface);
+
+    portENTER_CRITICAL(&m_lock);
+    m_transports[index].send = transport;
+    m_transports[index].context = context;
+    portEXIT_CRITICAL(&m_lock);
+}
+
+bool MessageBus::hasTransport(CommInterface interface) const {
+    return m_transports[static_cast<size_t>(interface)].send != nullptr;
+}
+
+BusStats MessageBus::getStats() const {
+    portENTER_CRITICAL(&m_lock);
+    BusStats stats = m_stats;
+    portEXIT_CRITICAL(&m_lock);
+    return stats;
+}
+
+BusTraffic MessageBus::getTraffic(CommInterface interface) const {
+    portENTER_CRITICAL(&m_lock);
+    BusTraffic traffic = m_traffic[static_cast<size_t>(interface)];
+    portEXIT_CRITICAL(&m_lock);
+    return traffic;
+}
+
+void MessageBus::notify(uint32_t bits) {
+    if (m_taskHandle) {
+        xTaskNotify(m_taskHandle, bits, eSetBits);
+    }
+}
+
+void MessageBus::dispatch(BusMessage* message) {
+    bool handled = false;
+    countTraffic(*message, false);
+
+    for (size_t i = 0; i < BUS_MAX_SUBSCRIBERS; i++) {
+        portENTER_CRITICAL(&m_lock);
+        Subscription subscription = m_subscriptions[i];
+        portEXIT_CRITICAL(&m_lock);
+
+        if (!subscription.handler) {
+            continue;
+        }
+        if (subscription.topic != BUS_TOPIC_ANY && subscription.topic != message->topic) {
+            continue;
+        }
+
+        // Handlers borrow the bus reference; they retain() to keep the message
+        subscription.handler(*message, subscription.context);
+        m_stats.delivered++;
+        handled = true;
+    }
+
+    if (!handled) {
+        m_stats.unhandled++;
+    }
+    release(message);
+}
+
+void MessageBus::transmit(BusMessage* message) {
+    portENTER_CRITICAL(&m_lock);
+    Transport transport = m_transports[static_cast<size_t>(message->interface)];
+    portEXIT_CRITICAL(&m_lock);
+
+    if (transport.send && transport.send(*message, transport.context)) {
+        m_stats.sent++;
+        countTraffic(*message, true);
+    } else {
+        m_stats.sendErrors++;
+        LOG_WARN_TAG("Bus", "Transport %d failed to send %d bytes",
+                 static_cast<int>(message->interface), message->length);
+    }
+    release(message);
+}
+
+void MessageBus::countTraffic(const BusMessage& message, bool sent) {
+    portENTER_CRITICAL(&m_lock);
+    BusTraffic& traffic = m_traffic[static_cast<size_t>(message.interface)];
+    if (sent) {
+        traffic.sent++;
+    } else {
+        traffic.received++;
+    }
+    traffic.bytes += message.length;
+    traffic.lastActivity = millis();
+    portEXIT_CRITICAL(&m_lock);
+}
+
+void MessageBus::busTask(void* parameter) {
+    MessageBus* bus = static_cast<MessageBus*>(parameter);
+
+    LOG_INFO_TAG("Bus", "Message bus task started");
+
+    while (true) {
+        // Sleep until a publisher or sender sets a bit; there is no polling interval
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+
+        for (size_t i = 0; i < COMM_INTERFACE_COUNT; i++) {
+            BusMessage* message;
+
+            if (bits & (1UL << (RX_NOTIFY_SHIFT + i))) {
+                while (xQueueReceive(bus->m_rxQueues[i], &message, 0) == pdTRUE) {
+                    bus->dispatch(message);
+                }
+            }
+
+            if (bits & (1UL << (TX_NOTIFY_SHIFT + i))) {
+                while (xQueueReceive(bus->m_txQueues[i], &message, 0) == pdTRUE) {
+                    bus->transmit(message);
+                }
+            }
+        }
+    }
+}
+
+} // namespace Communication
+} // namespace TDeckOS
@@ -0,0 +1,254 @@
+/**
+ * @file message_bus.h
+ * @brief Zero-copy message bus shared by all communication interfaces
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+
+namespace TDeckOS {
+namespace Communication {
+
+/**
+ * @brief Communication interface types
+ */
+enum class CommInterface {
+    LORA,
+    WIFI,
+    CELLULAR,
+    BLUETOOTH
+};
+
+constexpr size_t COMM_INTERFACE_COUNT = 4;
+
+/**
+ * @brief Bus dimensions; buffers are carved from one PSRAM block at initialize()
+ */
+constexpr size_t BUS_BUFFER_COUNT = 32;
+constexpr size_t BUS_BUFFER_SIZE = 512;
+constexpr size_t BUS_QUEUE_DEPTH = 8;          // Per interface and direction
+constexpr size_t BUS_MAX_SUBSCRIBERS = 16;
+constexpr uint32_t BUS_TOPIC_ANY = 0;
+
+/**
+ * @brief Hash a topic name (FNV-1a) so topics compare as integers
+ * @param name Topic name, e.g. "mesh/text"
+ * @return Topic id, never BUS_TOPIC_ANY
+ */
+constexpr uint32_t busTopic(const char* name) {
+    uint32_t hash = 2166136261u;
+    while (*name) {
+        hash = (hash ^ static_cast<uint8_t>(*name++)) * 16777619u;
+    }
+    return hash ? hash : 1;
+}
+
+/**
+ * @brief Well known topics
+ */
+constexpr uint32_t BUS_TOPIC_LORA_RX = busTopic("lora/rx");
+constexpr uint32_t BUS_TOPIC_WIFI_RX = busTopic("wifi/rx");
+constexpr uint32_t BUS_TOPIC_CELLULAR_RX = busTopic("cellular/rx");
+
+/**
+ * @brief Reference counted message buffer
+ * @note Obtained from MessageBus::allocate(). Handlers receive a borrowed
+ *       reference; call MessageBus::retain() to keep the message beyond the call.
+ */
+struct BusMessage {
+    uint8_t* data;                  // Payload, BUS_BUFFER_SIZE bytes of PSRAM
+    uint16_t length;
+    uint32_t topic;
+    CommInterface interface;        // Source for received, destination for sent messages
+    int16_t rssi;                   // Link quality of the source, 0 if unknown
+    uint32_t timestamp;
+    std::atomic<uint8_t> refCount;
+};
+
+/**
+ * @brief Subscriber and transport callbacks
+ */
+typedef void (*BusSubscriber)(const BusMessage& message, void* context);
+typedef bool (*BusTransport)(const BusMessage& message, void* context);
+
+/**
+ * @brief Message bus statistics
+ */
+struct BusStats {
+    uint32_t published;
+    uint32_t delivered;         // Subscriber invocations
+    uint32_t unhandled;         // Published messages without a matching subscriber
+    uint32_t sent;
+    uint32_t sendErrors;        // Transport missing or refused the message
+    uint32_t queueDrops;        // Queue full at publish or send time
+    uint32_t allocFailures;
+    uint32_t buffersInUse;
+};
+
+/**
+ * @brief Traffic seen on one interface, sampled by the power manager
+ */
+struct BusTraffic {
+    uint32_t received;          // Messages delivered from the interface
+    uint32_t sent;              // Messages handed to its transport
+    uint32_t bytes;             // Payload bytes either way
+    uint32_t lastActivity;      // millis() of the latest message, 0 if none yet
+};
+
+/**
+ * @brief Message bus
+ *
+ * Each interface has an RX and a TX queue of message pointers. Publishing or
+ * sending only moves a pointer and wakes the bus task, which fans received
+ * messages out to topic subscribers and feeds outgoing messages to the
+ * registered transport for their interface.
+ */
+class MessageBus {
+public:
+    /**
+     * @brief Get the bus instance
+     */
+    static MessageBus& getInstance();
+
+    /**
+     * @brief Allocate buffers and queues and start the bus task
+     * @return true if successful, false otherwise
+     */
+    bool initialize();
+
+    /**
+     * @brief Stop the bus task and release all buffers
+     */
+    void deinitialize();
+
+    bool isInitialized() const { return m_initialized; }
+
+    /**
+     * @brief Take a free buffer with one reference held by the caller
+     * @param length Payload length the caller will write
+     * @return Buffer, nullptr if none is free or length exceeds BUS_BUFFER_SIZE
+     */
+    BusMessage* allocate(size_t length);
+
+    /**
+     * @brief Add a reference to a message
+     */
+    void retain(BusMessage* message);
+
+    /**
+     * @brief Drop a reference; the buffer returns to the pool at zero
+     */
+    void release(BusMessage* message);
+
+    /**
+     * @brief Deliver a received message to subscribers
+     * @param message Message with topic and interface set; the caller's reference moves to the bus
+     * @return true if queued, false if the RX queue is full (the reference is released)
+     */
+    bool publish(BusMessage* message);
+
+    /**
+     * @brief Copy a payload into a buffer and publish it
+     * @return true if queued, false otherwise
+     */
+    bool publish(uint32_t topic, const uint8_t* data, size_t length, CommInterface source, int16_t rssi = 0);
+
+    /**
+     * @brief Queue a message for transmission on an interface
+     * @param message Message to send; the caller's reference moves to the bus
+     * @param interface Destination interface
+     * @return true if queued, false if no transport is registered or the queue is full
+     */
+    bool send(BusMessage* message, CommInterface interface);
+
+    /**
+     * @brief Copy a payload into a buffer and queue it for transmission
+     * @return true if queued, false otherwise
+     */
+    bool send(const uint8_t* data, size_t length, CommInterface interface, uint32_t topic = BUS_TOPIC_ANY);
+
+    /**
+     * @brief Subscribe to a topic
+     * @param topic Topic id, BUS_TOPIC_ANY for every message
+     * @param handler Called from the bus task for each matching message
+     * @param context Passed back to the handler
+     * @return Subscription id, -1 if the table is full
+     */
+    int subscribe(uint32_t topic, BusSubscriber handler, void* context = nullptr);
+
+    /**
+     * @brief Remove a subscription
+     * @param id Subscription id returned by subscribe()
+     */
+    void unsubscribe(int id);
+
+    /**
+     * @brief Register the function that puts messages on the wire for an interface
+     * @param interface Interface served by the transport
+     * @param transport Send function, nullptr to unregister
+     * @param context Passed back to the transport
+     */
+    void registerTransport(CommInterface interface, BusTransport transport, void* context = nullptr);
+
+    /**
+     * @brief Check whether an interface can currently accept messages
+     */
+    bool hasTransport(CommInterface interface) const;
+
+    /**
+     * @brief Get bus statistics
+     */
+    BusStats getStats() const;
+
+    /**
+     * @brief Get traffic counters for an interface
+     */
+    BusTraffic getTraffic(CommInterface interface) const;
+
+private:
+    MessageBus();
+
+    struct Subscription {
+        uint32_t topic;
+        BusSubscriber handler;
+        void* context;
+    };
+
+    struct Transport {
+        BusTransport send;
+        void* context;
+    };
+
+    static constexpr uint32_t RX_NOTIFY_SHIFT = 0;
+    static constexpr uint32_t TX_NOTIFY_SHIFT = 8;
+
+    bool m_initialized;
+    uint8_t* m_storage;
+    BusMessage m_messages[BUS_BUFFER_COUNT];
+    uint8_t m_freeList[BUS_BUFFER_COUNT];
+    size_t m_freeCount;
+    QueueHandle_t m_rxQueues[COMM_INTERFACE_COUNT];
+    QueueHandle_t m_txQueues[COMM_INTERFACE_COUNT];
+    Subscription m_subscriptions[BUS_MAX_SUBSCRIBERS];
+    Transport m_transports[COMM_INTERFACE_COUNT];
+    mutable portMUX_TYPE m_lock;
+    TaskHandle_t m_taskHandle;
+    mutable BusStats m_stats;
+    BusTraffic m_traffic[COMM_INTERFACE_COUNT];
+
+    static void busTask(void* parameter);
+    void dispatch(BusMessage* message);
+    void transmit(BusMessage* message);
+    void countTraffic(const BusMessage& message, bool sent);
+    void notify(uint32_t bits);
+};
+
+} // namespace Communication
+} // namespace TDeckOS
@@ -6,6 +6,7 @@
  */
 
 #include "wifi_manager.h"
+#include "core/system/scheduler.h"
 #include <Arduino.h>
 
 namespace TDeckOS {
@@ -24,6 +25,24 @@ WiFiManager::WiFiManager()
     , m_initTime(0)
     , m_lastConnectAttempt(0)
     , m_retryCount(0)
+    , m_holdsWakeLock(false)
+    , m_powerSave(WiFiPowerSave::MIN_MODEM)
+    , m_listenInterval(3)
+    , m_prefsOpen(false)
+    , m_cache{}
+    , m_cacheValid(false)
+    , m_phase(ConnectPhase::IDLE)
+    , m_leaseReused(false)
+    , m_attemptDeadline(0)
+    , m_nextReconnectAt(0)
+    , m_reconnectPending(false)
+    , m_lastRoamCheck(0)
+    , m_lastRoamScan(0)
+    , m_weakSamples(0)
+    , m_roamScanIndex(-1)
+    , m_roamBestRssi(0)
+    , m_roamBestBssid{}
+    , m_roamBestChannel(0)
     , m_taskHandle(nullptr)
     , m_eventQueue(nullptr)
     , m_mutex(nullptr)
@@ -38,29 +57,35 @@ WiFiManager::~WiFiManager() {
 
 bool WiFiManager::initialize() {
     if (m_initialized) {
-        LOG_WARN("WiFi", "Already initialized");
+        LOG_WARN_TAG("WiFi", "Already initialized");
         return true;
     }
 
-    LOG_INFO("WiFi", "Initializing WiFi manager...");
+    LOG_INFO_TAG("WiFi", "Initializing WiFi manager...");
     
     m_initTime = millis();
     
     // Create mutex
     m_mutex = xSemaphoreCreateMutex();
     if (!m_mutex) {
-        LOG_ERROR("WiFi", "Failed to create mutex");
+        LOG_ERROR_TAG("WiFi", "Failed to create mutex");
         return false;
     }
     
     // Create event queue
     m_eventQueue = xQueueCreate(20, sizeof(WiFiEvent_t));
     if (!m_eventQueue) {
-        LOG_ERROR("WiFi", "Failed to create event queue");
+        LOG_ERROR_TAG("WiFi", "Failed to create event queue");
         vSemaphoreDelete(m_mutex);
         return false;
     }
     
+    // Without the cache every connect is a full scan, which still works
+    m_prefsOpen = m_prefs.begin(WIFI_PREFS_NAMESPACE, false);
+    if (!m_prefsOpen) {
+        LOG_WARN_TAG("WiFi", "Failed to open preferences, fast connect disabled");
+    }
+
     // Set WiFi event handler
     WiFi.onEvent(wifiEventHandler);
     
@@ -75,7 +100,7 @@ bool WiFiManager::initialize() {
     );
     
     if (result != pdPASS) {
-        LOG_ERROR("WiFi", "Failed to create WiFi task");
+        LOG_ERROR_TAG("WiFi", "Failed to create WiFi task");
         vQueueDelete(m_eventQueue);
         vSemaphoreDelete(m_mutex);
         return false;
@@ -88,7 +113,7 @@ bool WiFiManager::initialize() {
     // Reset statistics
     resetStats();
     
-    LOG_INFO("WiFi", "WiFi manager initialized successfully");
+    LOG_INFO_TAG("WiFi", "WiFi manager initialized successfully");
     return true;
 }
 
@@ -97,7 +122,7 @@ void WiFiManager::deinitialize() {
         return;
     }
     
-    LOG_INFO("WiFi", "Deinitializing WiFi manager...");
+    LOG_INFO_TAG("WiFi", "Deinitializing WiFi manager...");
     
     // Stop task
     if (m_taskHandle) {
@@ -119,22 +144,27 @@ void WiFiManager::deinitialize() {
         vSemaphoreDelete(m_mutex);
         m_mutex = nullptr;
     }
+
+    if (m_prefsOpen) {
+        m_prefs.end();
+        m_prefsOpen = false;
+    }
     
     m_initialized = false;
     m_currentMode = WiFiMode::OFF;
     m_status = WiFiStatus::DISCONNECTED;
     
-    LOG_INFO("WiFi", "WiFi manager deinitialized");
+    LOG_INFO_TAG("WiFi", "WiFi manager deinitialized");
 }
 
 bool WiFiManager::setMode(WiFiMode mode) {
     if (!m_initialized) {
-        LOG_ERROR("WiFi", "Not initialized");
+        LOG_ERROR_TAG("WiFi", "Not initialized");
         return false;
     }
     
     if (xSemaphoreTake(m_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
-        LOG_ERROR("WiFi", "Failed to acquire mutex");
+        LOG_ERROR_TAG("WiFi", "Failed to acquire mutex");
         return false;
     }
     
@@ -165,7 +195,7 @@ bool WiFiManager::setMode(WiFiMode mode) {
     
     if (success) {
         m_currentMode = mode;
-        LOG_DEBUG("WiFi", "Mode changed to %d", static_cast<int>(mode));
+        LOG_DEBUG_TAG("WiFi", "Mode changed to %d", static_cast<int>(mode));
     }
     
     xSemaphoreGive(m_mutex);
@@ -174,73 +204,125 @@ bool WiFiManager::setMode(WiFiMode mode) {
 
 bool WiFiManager::connect(const WiFiStationConfig& config, WiFiEventCallback callback) {
     if (!m_initialized) {
-        LOG_ERROR("WiFi", "Not initialized");
+        LOG_ERROR_TAG("WiFi", "Not initialized");
         return false;
     }
     
     if (config.ssid.isEmpty()) {
-        LOG_ERROR("WiFi", "SSID cannot be empty");
+        LOG_ERROR_TAG("WiFi", "SSID cannot be empty");
         return false;
     }
+
+    // Set station mode if not already set; setMode takes the mutex itself
+    if (m_currentMode != WiFiMode::STATION && m_currentMode != WiFiMode::STATION_AP) {
+        setMode(WiFiMode::STATION);
+    }
     
     if (xSemaphoreTake(m_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
-        LOG_ERROR("WiFi", "Failed to acquire mutex");
+        LOG_ERROR_TAG("WiFi", "Failed to acquire mutex");
         return false;
     }
     
     m_stationConfig = config;
     m_eventCallback = callback;
     m_retryCount = 0;
+    m_reconnectPending = false;
+    m_weakSamples = 0;
+    m_stats.connectAttempts++;
+
+    loadCache(config.ssid);
+    bool success = startAttempt(config.fastConnect);
     
-    // Set station mode if not already set
-    if (m_currentMode != WiFiMode::STATION && m_currentMode != WiFiMode::STATION_AP) {
-        setMode(WiFiMode::STATION);
-    }
-    
+    xSemaphoreGive(m_mutex);
+    return success;
+}
+
+bool WiFiManager::startAttempt(bool allowFast) {
+    bool fast = allowFast && m_cacheValid && m_cache.channels[0] != 0;
+    m_leaseReused = fast && m_stationConfig.useDHCP && m_stationConfig.reuseLease &&
+                    m_cache.ip != 0 && m_cache.leaseReuses < WIFI_LEASE_MAX_REUSES;
+
     // Configure station
     if (!configureStation()) {
-        xSemaphoreGive(m_mutex);
+        m_phase = ConnectPhase::IDLE;
         return false;
     }
-    
-    // Start connection
+
+    uint32_t now = millis();
     m_status = WiFiStatus::CONNECTING;
-    m_lastConnectAttempt = millis();
-    m_stats.connectAttempts++;
-    
-    LOG_INFO("WiFi", "Connecting to '%s'...", config.ssid.c_str());
-    
-    if (config.password.isEmpty()) {
-        WiFi.begin(config.ssid.c_str());
+    m_lastConnectAttempt = now;
+
+    if (fast) {
+        // Skips the all-channel scan; a stale BSSID fails fast and falls back to a full connect
+        LOG_INFO_TAG("WiFi", "Connecting to '%s' on channel %u%s...", m_stationConfig.ssid.c_str(),
+                     m_cache.channels[0], m_leaseReused ? " with cached lease" : "");
+        m_phase = ConnectPhase::FAST;
+        m_attemptDeadline = now + WIFI_FAST_CONNECT_TIMEOUT_MS;
+        beginStation(m_cache.channels[0], m_cache.bssid);
     } else {
-        WiFi.begin(config.ssid.c_str(), config.password.c_str());
+        LOG_INFO_TAG("WiFi", "Connecting to '%s'...", m_stationConfig.ssid.c_str());
+        m_phase = ConnectPhase::FULL;
+        m_attemptDeadline = now + m_stationConfig.connectTimeoutMs;
+        beginStation(0, nullptr);
     }
-    
-    xSemaphoreGive(m_mutex);
     return true;
 }
 
+void WiFiManager::beginStation(int32_t channel, const uint8_t* bssid) {
+    const char* password = m_stationConfig.password.isEmpty() ? nullptr : m_stationConfig.password.c_str();
+
+    // begin() rewrites the station config, so patch in the listen interval before connecting
+    WiFi.begin(m_stationConfig.ssid.c_str(), password, channel, bssid, false);
+    wifi_config_t config;
+    if (esp_wifi_get_config(WIFI_IF_STA, &config) == ESP_OK) {
+        config.sta.listen_interval = m_listenInterval;
+        esp_wifi_set_config(WIFI_IF_STA, &config);
+    }
+    esp_wifi_connect();
+}
+
 void WiFiManager::disconnect() {
     if (m_initialized) {
-        LOG_INFO("WiFi", "Disconnecting from WiFi...");
-        WiFi.disconnect();
+        LOG_INFO_TAG("WiFi", "Disconnecting from WiFi...");
+        m_reconnectPending = false;
+        m_phase = ConnectPhase::IDLE;
         m_status = WiFiStatus::DISCONNECTED;
+        WiFi.disconnect();
+    }
+}
+
+void WiFiManager::forgetNetwork(const String& ssid) {
+    if (!m_prefsOpen) {
+        return;
+    }
+    if (ssid.isEmpty()) {
+        m_prefs.clear();
+        m_cacheValid = false;
+        return;
+    }
+    int slot = findCacheSlot(ssid.c_str(), false);
+    if (slot >= 0) {
+        char key[4] = {'n', (char)('0' + slot), '\0'};
+        m_prefs.remove(key);
+    }
+    if (ssid == m_cache.ssid) {
+        m_cacheValid = false;
     }
 }
 
 bool WiFiManager::startAP(const WiFiAPConfig& config) {
     if (!m_initialized) {
-        LOG_ERROR("WiFi", "Not initialized");
+        LOG_ERROR_TAG("WiFi", "Not initialized");
         return false;
     }
     
     if (config.ssid.isEmpty()) {
-        LOG_ERROR("WiFi", "AP SSID cannot be empty");
+        LOG_ERROR_TAG("WiFi", "AP SSID cannot be empty");
         return false;
     }
     
     if (xSemaphoreTake(m_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
-        LOG_ERROR("WiFi", "Failed to acquire mutex");
+        LOG_ERROR_TAG("WiFi", "Failed to acquire mutex");
         return false;
     }
     
@@ -255,8 +337,8 @@ bool WiFiManager::startAP(const WiFiAPConfig& config) {
     bool success = configureAP();
     
     if (success) {
-        LOG_INFO("WiFi", "Access Point '%s' started", config.ssid.c_str());
-        LOG_INFO("WiFi", "IP address: %s", config.ip.toString().c_str());
+        LOG_INFO_TAG("WiFi", "Access Point '%s' started", config.ssid.c_str());
+        LOG_INFO_TAG("WiFi", "IP address: %s", config.ip.toString().c_str());
     }
     
     xSemaphoreGive(m_mutex);
@@ -265,21 +347,26 @@ bool WiFiManager::startAP(const WiFiAPConfig& config) {
 
 void WiFiManager::stopAP() {
     if (m_initialized) {
-        LOG_INFO("WiFi", "Stopping Access Point...");
+        LOG_INFO_TAG("WiFi", "Stopping Access Point...");
         WiFi.softAPdisconnect(true);
     }
 }
 
 bool WiFiManager::scanNetworks(WiFiScanCallback callback, bool async) {
     if (!m_initialized) {
-        LOG_ERROR("WiFi", "Not initialized");
+        LOG_ERROR_TAG("WiFi", "Not initialized");
+        return false;
+    }
+
+    if (m_roamScanIndex >= 0) {
+        LOG_WARN_TAG("WiFi", "Roaming scan in progress");
         return false;
     }
     
     m_scanCallback = callback;
     m_stats.scanCount++;
     
-    LOG_INFO("WiFi", "Starting WiFi scan...");
+    LOG_INFO_TAG("WiFi", "Starting WiFi scan...");
     
     if (async) {
         return WiFi.scanNetworks(true) != WIFI_SCAN_FAILED;
@@ -355,11 +442,25 @@ uint8_t WiFiManager::getConnectedClients() const {
 }
 
 bool WiFiManager::setPowerSave(bool enable) {
+    return setPowerSaveLevel(enable ? WiFiPowerSave::MIN_MODEM : WiFiPowerSave::NONE, m_listenInterval);
+}
+
+bool WiFiManager::setPowerSaveLevel(WiFiPowerSave level, uint8_t listenInterval) {
     if (!m_initialized) {
         return false;
     }
     
-    return WiFi.setSleep(enable);
+    static const wifi_ps_type_t PS_TYPES[] = {WIFI_PS_NONE, WIFI_PS_MIN_MODEM, WIFI_PS_MAX_MODEM};
+    if (!WiFi.setSleep(PS_TYPES[static_cast<int>(level)])) {
+        return false;
+    }
+    
+    if (level != m_powerSave || listenInterval != m_listenInterval) {
+        LOG_DEBUG_TAG("WiFi", "Modem sleep level %d, listen interval %u", static_cast<int>(level), listenInterval);
+    }
+    m_powerSave = level;
+    m_listenInterval = listenInterval ? listenInterval : 3;
+    return true;
 }
 
 bool WiFiManager::setPower(float power) {
@@ -387,7 +488,7 @@ void WiFiManager::resetStats() {
         m_stats = WiFiStats{};
         m_initTime = millis();
         xSemaphoreGive(m_mutex);
-        LOG_INFO("WiFi", "Statistics reset");
+        LOG_INFO_TAG("WiFi", "Statistics reset");
     }
 }
 
@@ -400,14 +501,15 @@ void WiFiManager::wifiTask(void* parameter) {
     WiFiManager* manager = static_cast<WiFiManager*>(parameter);
     WiFiEvent_t event;
     
-    LOG_INFO("WiFi", "WiFi task started");
+    LOG_INFO_TAG("WiFi", "WiFi task started");
     
     while (true) {
-        if (xQueueReceive(manager->m_eventQueue, &event, pdMS_TO_TICKS(1000)) == pdTRUE) {
+        // Reconnects are driven by events; the timeout only covers scheduled work
+        if (xQueueReceive(manager->m_eventQueue, &event, pdMS_TO_TICKS(manager->nextWakeDelay())) == pdTRUE) {
             manager->handleWiFiEvent(event);
         }
         
-        // Check connection status and handle reconnection
+        // Run due reconnects, attempt watchdogs and roaming checks
         manager->checkConnection();
         
         // Update statistics periodically
@@ -428,51 +530,93 @@ void WiFiManager::wifiEventHandler(WiFiEvent_t event) {
 void WiFiManager::handleWiFiEvent(WiFiEvent_t event) {
     switch (event) {
         case ARDUINO_EVENT_WIFI_STA_START:
-            LOG_DEBUG("WiFi", "Station started");
+            LOG_DEBUG_TAG("WiFi", "Station started");
             break;
             
         case ARDUINO_EVENT_WIFI_STA_CONNECTED:
-            LOG_INFO("WiFi", "Connected to WiFi");
+            LOG_INFO_TAG("WiFi", "Connected to WiFi");
+            if (m_phase == ConnectPhase::FAST) {
+                m_stats.fastConnects++;
+            } else if (m_phase == ConnectPhase::ROAMING) {
+                // The interface keeps its address across a roam, so there may be no new GOT_IP
+                m_stats.roams++;
+                storeCache();
+                m_phase = ConnectPhase::IDLE;
+            }
             m_status = WiFiStatus::CONNECTED;
             m_stats.successfulConnections++;
             m_retryCount = 0;
+            m_reconnectPending = false;
+            m_weakSamples = 0;
+            if (!m_holdsWakeLock) {
+                sched_wake_lock();
+                m_holdsWakeLock = true;
+            }
             if (m_eventCallback) {
                 m_eventCallback(m_status, "Connected");
             }
             break;
             
         case ARDUINO_EVENT_WIFI_STA_GOT_IP:
-            LOG_INFO("WiFi", "Got IP address: %s", WiFi.localIP().toString().c_str());
+            m_stats.lastConnectMs = millis() - m_lastConnectAttempt;
+            LOG_INFO_TAG("WiFi", "Got IP address: %s after %u ms", WiFi.localIP().toString().c_str(),
+                         (unsigned)m_stats.lastConnectMs);
+            storeCache();
+            m_phase = ConnectPhase::IDLE;
             break;
             
         case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
-            LOG_WARN("WiFi", "Disconnected from WiFi");
+            if (m_phase == ConnectPhase::ROAMING && m_status == WiFiStatus::CONNECTED) {
+                // Leaving the old BSSID; the link is back when the new one connects
+                LOG_INFO_TAG("WiFi", "Leaving BSSID to roam");
+                m_status = WiFiStatus::CONNECTING;
+                break;
+            }
+            if (m_status == WiFiStatus::DISCONNECTED) {
+                // Caused by disconnect()
+                break;
+            }
+
+            LOG_WARN_TAG("WiFi", "Disconnected from WiFi");
+            if (m_status == WiFiStatus::CONNECTING && (m_phase == ConnectPhase::FAST || m_phase == ConnectPhase::ROAMING)) {
+                // The cached or roaming target is gone; a full connect follows at once
+                onAttemptFailed();
+                break;
+            }
             if (m_status == WiFiStatus::CONNECTED) {
                 m_stats.disconnections++;
                 m_status = WiFiStatus::LOST_CONNECTION;
             } else {
                 m_status = WiFiStatus::FAILED;
             }
+            if (m_holdsWakeLock) {
+                sched_wake_unlock();
+                m_holdsWakeLock = false;
+            }
             if (m_eventCallback) {
                 m_eventCallback(m_status, "Disconnected");
             }
+            m_phase = ConnectPhase::IDLE;
+            scheduleReconnect();
             break;
             
         case ARDUINO_EVENT_WIFI_AP_START:
-            LOG_INFO("WiFi", "Access Point started");
+            LOG_INFO_TAG("WiFi", "Access Point started");
             break;
             
         case ARDUINO_EVENT_WIFI_AP_STACONNECTED:
-            LOG_INFO("WiFi", "Client connected to AP");
+            LOG_INFO_TAG("WiFi", "Client connected to AP");
             break;
             
         case ARDUINO_EVENT_WIFI_AP_STADISCONNECTED:
-            LOG_INFO("WiFi", "Client disconnected from AP");
+            LOG_INFO_TAG("WiFi", "Client disconnected from AP");
             break;
             
         case ARDUINO_EVENT_WIFI_SCAN_DONE:
-            LOG_DEBUG("WiFi", "Scan completed");
-            if (m_scanCallback) {
+            LOG_DEBUG_TAG("WiFi", "Scan completed");
+            if (m_roamScanIndex >= 0) {
+                handleRoamScan();
+            } else if (m_scanCallback) {
                 int n = WiFi.scanComplete();
                 if (n >= 0) {
                     std::vector<WiFiNetwork> networks;
@@ -524,12 +668,24 @@ bool WiFiManager::configureStation() {
     if (!m_stationConfig.useDHCP) {
         if (!WiFi.config(m_stationConfig.staticIP, m_stationConfig.gateway, 
                         m_stationConfig.subnet, m_stationConfig.dns1, m_stationConfig.dns2)) {
-            LOG_ERROR("WiFi", "Failed to configure static IP");
+            LOG_ERROR_TAG("WiFi", "Failed to configure static IP");
             return false;
         }
+    } else if (m_leaseReused) {
+        // Skips the DHCP exchange; the address is the one the server handed out last time
+        if (!WiFi.config(IPAddress(m_cache.ip), IPAddress(m_cache.gateway),
+                         IPAddress(m_cache.subnet), IPAddress(m_cache.dns))) {
+            LOG_WARN_TAG("WiFi", "Failed to apply cached lease, using DHCP");
+            m_leaseReused = false;
+            WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+        }
+    } else {
+        // Back to DHCP in case the previous attempt used a cached lease
+        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
     }
     
-    WiFi.setAutoReconnect(m_stationConfig.autoReconnect);
+    // Reconnects are scheduled by checkConnection, not by the driver
+    WiFi.setAutoReconnect(false);
     return true;
 }
 
@@ -549,20 +705,262 @@ bool WiFiManager::configureAP() {
 }
 
 void WiFiManager::checkConnection() {
-    if (m_status == WiFiStatus::LOST_CONNECTION && m_stationConfig.autoReconnect) {
-        uint32_t now = millis();
-        if (now - m_lastConnectAttempt > 5000 && m_retryCount < m_stationConfig.maxRetries) {
-            LOG_INFO("WiFi", "Attempting to reconnect... (attempt %d/%d)", 
-                    m_retryCount + 1, m_stationConfig.maxRetries);
-            
-            m_retryCount++;
-            m_lastConnectAttempt = now;
-            m_stats.reconnections++;
-            m_status = WiFiStatus::CONNECTING;
-            
-            WiFi.reconnect();
+    uint32_t now = millis();
+
+    if (m_reconnectPending && (int32_t)(now - m_nextReconnectAt) >= 0) {
+        m_reconnectPending = false;
+        m_retryCount++;
+        m_stats.reconnections++;
+        if (m_stationConfig.maxRetries) {
+            LOG_INFO_TAG("WiFi", "Attempting to reconnect... (attempt %d/%d)",
+                         m_retryCount, m_stationConfig.maxRetries);
+        } else {
+            LOG_INFO_TAG("WiFi", "Attempting to reconnect... (attempt %d)", m_retryCount);
         }
+        startAttempt(m_stationConfig.fastConnect);
+        return;
+    }
+
+    // An attempt the driver never reported on; the disconnect produces the event that moves it on
+    if (m_status == WiFiStatus::CONNECTING && m_phase != ConnectPhase::IDLE &&
+        (int32_t)(now - m_attemptDeadline) >= 0) {
+        LOG_WARN_TAG("WiFi", "Connect attempt timed out");
+        m_attemptDeadline = now + m_stationConfig.connectTimeoutMs;
+        WiFi.disconnect();
+        return;
+    }
+
+    checkRoaming();
+}
+
+uint32_t WiFiManager::nextWakeDelay() const {
+    uint32_t wait = 1000;
+    uint32_t now = millis();
+    if (m_reconnectPending) {
+        int32_t due = (int32_t)(m_nextReconnectAt - now);
+        wait = due <= 0 ? 1 : (due < (int32_t)wait ? due : wait);
+    }
+    if (m_status == WiFiStatus::CONNECTING && m_phase != ConnectPhase::IDLE) {
+        int32_t due = (int32_t)(m_attemptDeadline - now);
+        wait = due <= 0 ? 1 : (due < (int32_t)wait ? due : wait);
+    }
+    return wait;
+}
+
+void WiFiManager::onAttemptFailed() {
+    m_stats.fastConnectFallbacks++;
+    LOG_INFO_TAG("WiFi", "Cached connect failed, doing a full connect");
+
+    // The BSSID or lease may be what failed; the full connect refreshes both
+    if (m_leaseReused) {
+        m_cache.leaseReuses = WIFI_LEASE_MAX_REUSES;
     }
+    startAttempt(false);
+}
+
+void WiFiManager::scheduleReconnect() {
+    if (!m_stationConfig.autoReconnect || m_stationConfig.ssid.isEmpty()) {
+        return;
+    }
+    if (m_stationConfig.maxRetries && m_retryCount >= m_stationConfig.maxRetries) {
+        LOG_WARN_TAG("WiFi", "Giving up after %d reconnect attempts", m_retryCount);
+        return;
+    }
+
+    // The first retry goes out at once, on the cached channel; later ones back off with jitter
+    uint32_t delayMs = 0;
+    if (m_retryCount > 0) {
+        uint8_t shift = m_retryCount - 1 < 16 ? m_retryCount - 1 : 16;
+        delayMs = WIFI_BACKOFF_BASE_MS << shift;
+        if (delayMs > WIFI_BACKOFF_MAX_MS) delayMs = WIFI_BACKOFF_MAX_MS;
+        delayMs += random(0, delayMs / 4 + 1);
+    }
+    m_nextReconnectAt = millis() + delayMs;
+    m_reconnectPending = true;
+    LOG_DEBUG_TAG("WiFi", "Reconnect in %u ms", (unsigned)delayMs);
+}
+
+int WiFiManager::findCacheSlot(const char* ssid, bool forWrite) {
+    int empty = -1;
+    int oldest = -1;
+    uint32_t oldestSequence = UINT32_MAX;
+    char key[4] = {'n', '0', '\0'};
+    NetworkCache entry;
+
+    for (int slot = 0; slot < WIFI_CACHE_SLOTS; slot++) {
+        key[1] = '0' + slot;
+        if (m_prefs.getBytes(key, &entry, sizeof(entry)) != sizeof(entry)) {
+            if (empty < 0) empty = slot;
+            continue;
+        }
+        if (strncmp(entry.ssid, ssid, sizeof(entry.ssid)) == 0) {
+            return slot;
+        }
+        if (entry.sequence < oldestSequence) {
+            oldestSequence = entry.sequence;
+            oldest = slot;
+        }
+    }
+    if (!forWrite) {
+        return -1;
+    }
+    return empty >= 0 ? empty : oldest;
+}
+
+bool WiFiManager::loadCache(const String& ssid) {
+    m_cacheValid = false;
+    if (m_prefsOpen) {
+        int slot = findCacheSlot(ssid.c_str(), false);
+        if (slot >= 0) {
+            char key[4] = {'n', (char)('0' + slot), '\0'};
+            m_cacheValid = m_prefs.getBytes(key, &m_cache, sizeof(m_cache)) == sizeof(m_cache);
+        }
+    }
+    if (!m_cacheValid) {
+        memset(&m_cache, 0, sizeof(m_cache));
+        strncpy(m_cache.ssid, ssid.c_str(), sizeof(m_cache.ssid) - 1);
+    }
+    return m_cacheValid;
+}
+
+void WiFiManager::rememberChannel(uint8_t channel) {
+    if (channel == 0) {
+        return;
+    }
+    uint8_t position = WIFI_CACHE_CHANNELS - 1;
+    for (uint8_t i = 0; i < WIFI_CACHE_CHANNELS; i++) {
+        if (m_cache.channels[i] == channel) {
+            position = i;
+            break;
+        }
+    }
+    memmove(&m_cache.channels[1], &m_cache.channels[0], position);
+    m_cache.channels[0] = channel;
+}
+
+void WiFiManager::storeCache() {
+    NetworkCache previous = m_cache;
+
+    const uint8_t* bssid = WiFi.BSSID();
+    if (bssid) {
+        memcpy(m_cache.bssid, bssid, sizeof(m_cache.bssid));
+    }
+    rememberChannel(WiFi.channel());
+
+    if (m_stationConfig.useDHCP) {
+        if (m_leaseReused) {
+            m_cache.leaseReuses++;
+        } else {
+            m_cache.ip = (uint32_t)WiFi.localIP();
+            m_cache.gateway = (uint32_t)WiFi.gatewayIP();
+            m_cache.subnet = (uint32_t)WiFi.subnetMask();
+            m_cache.dns = (uint32_t)WiFi.dnsIP(0);
+            m_cache.leaseReuses = 0;
+        }
+    }
+    m_cacheValid = true;
+
+    if (!m_prefsOpen) {
+        return;
+    }
+
+    // NVS is only written when something changed or another network was used in between
+    uint32_t sequence = m_prefs.getUInt("seq", 0);
+    previous.sequence = m_cache.sequence;
+    if (memcmp(&previous, &m_cache, sizeof(m_cache)) == 0 && m_cache.sequence == sequence) {
+        return;
+    }
+    m_cache.sequence = ++sequence;
+    m_prefs.putUInt("seq", sequence);
+
+    int slot = findCacheSlot(m_cache.ssid, true);
+    char key[4] = {'n', (char)('0' + slot), '\0'};
+    if (m_prefs.putBytes(key, &m_cache, sizeof(m_cache)) != sizeof(m_cache)) {
+        LOG_WARN_TAG("WiFi", "Failed to store connect cache");
+    }
+}
+
+void WiFiManager::checkRoaming() {
+    if (!m_stationConfig.roaming || m_status != WiFiStatus::CONNECTED || m_phase != ConnectPhase::IDLE ||
+        m_roamScanIndex >= 0 || m_scanCallback) {
+        return;
+    }
+
+    uint32_t now = millis();
+    if (now - m_lastRoamCheck < WIFI_ROAM_CHECK_MS) {
+        return;
+    }
+    m_lastRoamCheck = now;
+
+    int32_t rssi = WiFi.RSSI();
+    if (rssi >= m_stationConfig.roamThreshold) {
+        m_weakSamples = 0;
+        return;
+    }
+    if (++m_weakSamples < WIFI_ROAM_WEAK_SAMPLES) {
+        return;
+    }
+    if (m_lastRoamScan != 0 && now - m_lastRoamScan < WIFI_ROAM_SCAN_INTERVAL_MS) {
+        return;
+    }
+
+    // Only the channels this network was seen on are scanned, one at a time, so the link stays up
+    m_lastRoamScan = now;
+    m_weakSamples = 0;
+    m_roamBestRssi = rssi + WIFI_ROAM_HYSTERESIS_DB;
+    m_roamBestChannel = 0;
+    m_stats.roamScans++;
+    LOG_INFO_TAG("WiFi", "RSSI %d dBm, scanning known channels", (int)rssi);
+    if (!startRoamScan(0)) {
+        m_roamScanIndex = -1;
+    }
+}
+
+bool WiFiManager::startRoamScan(int8_t index) {
+    while (index < WIFI_CACHE_CHANNELS && m_cache.channels[index] != 0) {
+        m_roamScanIndex = index;
+        if (WiFi.scanNetworks(true, false, false, WIFI_ROAM_SCAN_MS_PER_CHANNEL, m_cache.channels[index]) != WIFI_SCAN_FAILED) {
+            return true;
+        }
+        index++;
+    }
+    return false;
+}
+
+void WiFiManager::handleRoamScan() {
+    const uint8_t* current = WiFi.BSSID();
+    int n = WiFi.scanComplete();
+    for (int i = 0; i < n; i++) {
+        if (WiFi.SSID(i) != m_stationConfig.ssid || WiFi.RSSI(i) <= m_roamBestRssi) {
+            continue;
+        }
+        const uint8_t* bssid = WiFi.BSSID(i);
+        if (!bssid || (current && memcmp(bssid, current, sizeof(m_roamBestBssid)) == 0)) {
+            continue;
+        }
+        m_roamBestRssi = WiFi.RSSI(i);
+        m_roamBestChannel = WiFi.channel(i);
+        memcpy(m_roamBestBssid, bssid, sizeof(m_roamBestBssid));
+    }
+    WiFi.scanDelete();
+
+    if (startRoamScan(m_roamScanIndex + 1)) {
+        return;
+    }
+    m_roamScanIndex = -1;
+
+    if (m_roamBestChannel == 0 || m_status != WiFiStatus::CONNECTED) {
+        LOG_DEBUG_TAG("WiFi", "No stronger access point found");
+        return;
+    }
+
+    LOG_INFO_TAG("WiFi", "Roaming to %02x:%02x:%02x:%02x:%02x:%02x on channel %u (%d dBm)",
+                 m_roamBestBssid[0], m_roamBestBssid[1], m_roamBestBssid[2], m_roamBestBssid[3],
+                 m_roamBestBssid[4], m_roamBestBssid[5], m_roamBestChannel, (int)m_roamBestRssi);
+    m_phase = ConnectPhase::ROAMING;
+    m_lastConnectAttempt = millis();
+    m_attemptDeadline = m_lastConnectAttempt + WIFI_FAST_CONNECT_TIMEOUT_MS;
+    beginStation(m_roamBestChannel, m_roamBestBssid);
 }
 
 } // namespace Communication
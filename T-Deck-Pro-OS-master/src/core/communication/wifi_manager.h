@@ -14,8 +14,23 @@
 #include <freertos/task.h>
 #include <freertos/queue.h>
 #include <freertos/semphr.h>
+#include <Preferences.h>
+#include <esp_wifi.h>
 #include "core/utils/logger.h"
 
+#define WIFI_PREFS_NAMESPACE "wifi"
+#define WIFI_CACHE_SLOTS 4                  // Networks remembered for fast connect, least recently used replaced
+#define WIFI_CACHE_CHANNELS 3               // Channels an SSID was seen on, scanned when roaming
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 1500   // A cached connect that takes longer falls back to a full one
+#define WIFI_LEASE_MAX_REUSES 16            // Cached-lease connects before DHCP is used again
+#define WIFI_BACKOFF_BASE_MS 500            // Reconnect delay doubles per failure up to the maximum
+#define WIFI_BACKOFF_MAX_MS 60000
+#define WIFI_ROAM_CHECK_MS 5000             // RSSI sampling interval while connected
+#define WIFI_ROAM_WEAK_SAMPLES 3            // Consecutive weak samples before a roaming scan
+#define WIFI_ROAM_SCAN_INTERVAL_MS 60000    // At most one roaming scan per interval
+#define WIFI_ROAM_HYSTERESIS_DB 8           // A candidate must be this much stronger
+#define WIFI_ROAM_SCAN_MS_PER_CHANNEL 120
+
 namespace TDeckOS {
 namespace Communication {
 
@@ -40,6 +55,15 @@ enum class WiFiStatus {
     LOST_CONNECTION
 };
 
+/**
+ * @brief Station modem sleep levels
+ */
+enum class WiFiPowerSave {
+    NONE,                   // Receiver always on
+    MIN_MODEM,              // Wakes for every DTIM beacon
+    MAX_MODEM               // Wakes once per listen interval
+};
+
 /**
  * @brief WiFi security types
  */
@@ -74,9 +98,13 @@ struct WiFiStationConfig {
     String ssid;
     String password;
     bool autoReconnect = true;
-    uint32_t connectTimeoutMs = 10000;
-    uint8_t maxRetries = 3;
+    uint32_t connectTimeoutMs = 10000;  // Gives up on an attempt that produces no event at all
+    uint8_t maxRetries = 3;             // Reconnect attempts after a loss, 0 for no limit
     bool useDHCP = true;
+    bool fastConnect = true;            // Connect to the cached BSSID and channel first
+    bool reuseLease = true;             // With DHCP, start from the cached lease as a static IP
+    bool roaming = true;
+    int8_t roamThreshold = -75;         // RSSI below which a roaming scan is considered
     IPAddress staticIP;
     IPAddress gateway;
     IPAddress subnet;
@@ -112,6 +140,11 @@ struct WiFiStats {
     uint32_t uptime;
     int32_t lastRssi;
     uint8_t lastChannel;
+    uint32_t fastConnects;          // Connects that used the cached BSSID and channel
+    uint32_t fastConnectFallbacks;
+    uint32_t roamScans;
+    uint32_t roams;
+    uint32_t lastConnectMs;         // From starting the attempt to having an IP
 };
 
 /**
@@ -122,6 +155,17 @@ typedef void (*WiFiScanCallback)(const std::vector<WiFiNetwork>& networks);
 
 /**
  * @brief WiFi Manager class
+ *
+ * Each successful connect records the BSSID, channels and DHCP lease of the
+ * network in NVS. The next connect goes straight to that BSSID and channel,
+ * optionally on the cached lease, and only falls back to a full scan when
+ * the driver reports it failed. A cached lease is reused at most
+ * WIFI_LEASE_MAX_REUSES times before DHCP runs again.
+ *
+ * Reconnects are scheduled from disconnect events with exponential backoff
+ * instead of a fixed poll. While connected, a run of weak RSSI samples
+ * triggers a scan of the channels the network was seen on, and the station
+ * moves to a BSSID that is WIFI_ROAM_HYSTERESIS_DB stronger.
  */
 class WiFiManager {
 public:
@@ -178,6 +222,12 @@ public:
      */
     void disconnect();
 
+    /**
+     * @brief Forget the cached BSSID, channels and lease of a network
+     * @param ssid Network to forget, empty for all
+     */
+    void forgetNetwork(const String& ssid = String());
+
     /**
      * @brief Start access point
      * @param config AP configuration
@@ -253,6 +303,17 @@ public:
      */
     bool setPowerSave(bool enable);
 
+    /**
+     * @brief Set the station modem sleep level
+     * @param level Sleep level
+     * @param listenInterval Beacon intervals between wake-ups at MAX_MODEM; the
+     *        AP learns it when associating, so a change applies from the next connect
+     * @return true if successful, false otherwise
+     */
+    bool setPowerSaveLevel(WiFiPowerSave level, uint8_t listenInterval = 3);
+
+    WiFiPowerSave getPowerSaveLevel() const { return m_powerSave; }
+
     /**
      * @brief Set WiFi power
      * @param power Power level (0-20.5 dBm)
@@ -299,6 +360,48 @@ private:
     uint32_t m_initTime;
     uint32_t m_lastConnectAttempt;
     uint8_t m_retryCount;
+    bool m_holdsWakeLock;       // Light sleep would drop the association
+    WiFiPowerSave m_powerSave;
+    uint8_t m_listenInterval;
+
+    // What the last successful connect to a network learned, kept in NVS
+    struct NetworkCache {
+        char ssid[33];
+        uint8_t bssid[6];
+        uint8_t channels[WIFI_CACHE_CHANNELS];  // Most recent first, 0 for unused
+        uint32_t ip;
+        uint32_t gateway;
+        uint32_t subnet;
+        uint32_t dns;
+        uint8_t leaseReuses;
+        uint32_t sequence;                      // Larger is more recently used
+    };
+
+    enum class ConnectPhase : uint8_t {
+        IDLE,
+        FAST,                   // Targeted at the cached BSSID and channel
+        FULL,                   // Plain connect, scanning every channel
+        ROAMING                 // Reassociating to a stronger BSSID
+    };
+
+    Preferences m_prefs;
+    bool m_prefsOpen;
+    NetworkCache m_cache;
+    bool m_cacheValid;
+    ConnectPhase m_phase;
+    bool m_leaseReused;         // The current attempt runs on the cached lease
+    uint32_t m_attemptDeadline;
+    uint32_t m_nextReconnectAt;
+    bool m_reconnectPending;
+
+    // Roaming
+    uint32_t m_lastRoamCheck;
+    uint32_t m_lastRoamScan;
+    uint8_t m_weakSamples;
+    int8_t m_roamScanIndex;     // Channel being scanned, -1 when no roaming scan runs
+    int32_t m_roamBestRssi;
+    uint8_t m_roamBestBssid[6];
+    uint8_t m_roamBestChannel;
     
     // FreeRTOS
     TaskHandle_t m_taskHandle;
@@ -314,6 +417,22 @@ private:
     bool configureStation();
     bool configureAP();
     void checkConnection();
+    uint32_t nextWakeDelay() const;
+
+    // Fast connect and reconnect
+    bool startAttempt(bool allowFast);
+    void beginStation(int32_t channel, const uint8_t* bssid);
+    void scheduleReconnect();
+    void onAttemptFailed();
+    bool loadCache(const String& ssid);
+    void storeCache();
+    int findCacheSlot(const char* ssid, bool forWrite);
+    void rememberChannel(uint8_t channel);
+
+    // Roaming
+    void checkRoaming();
+    bool startRoamScan(int8_t index);
+    void handleRoamScan();
     
     // Static instance for event handler
     static WiFiManager* s_instance;
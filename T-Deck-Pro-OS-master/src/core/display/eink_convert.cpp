@@ -0,0 +1,190 @@
+/**
+ * @file eink_convert.cpp
+ * @brief LVGL to E-ink framebuffer conversion engine implementation
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ */
+
+#include "eink_convert.h"
+#include "../hal/board_config.h"
+#include "../utils/logger.h"
+#include <Arduino.h>
+#include <string.h>
+
+// LV_COLOR_DEPTH 1 stores one pixel per byte with the colour in bit 0
+static_assert(sizeof(lv_color_t) == 1, "E-ink conversion requires LV_COLOR_DEPTH 1");
+
+/**
+ * Gather bit 0 of four consecutive pixel bytes into a nibble, first pixel in
+ * bit 3. Each input bit is multiplied into a distinct position of the top
+ * byte, so there are no carries between lanes.
+ */
+static inline uint32_t pack4(const uint8_t* src) {
+    uint32_t v;
+    memcpy(&v, src, sizeof(v));
+    return ((v & 0x01010101u) * 0x08040201u) >> 24;
+}
+
+static inline uint8_t pack8(const uint8_t* src) {
+    return (uint8_t)((pack4(src) << 4) | pack4(src + 4));
+}
+
+/**
+ * Pack up to 8 pixels into one byte starting at bit_offset (0 = MSB) and
+ * merge them into dst without touching the other bits.
+ */
+static inline void pack_masked(const uint8_t* src, uint8_t* dst, uint8_t bit_offset, uint8_t count) {
+    uint8_t bits = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        bits |= (uint8_t)((src[i] & 0x01) << (7 - bit_offset - i));
+    }
+
+    uint8_t mask = (uint8_t)((0xFF >> bit_offset) & (0xFF << (8 - bit_offset - count)));
+    *dst = (uint8_t)((*dst & ~mask) | (bits & mask));
+}
+
+static void pack_row(const uint8_t* src, uint8_t* dst_row, uint32_t x, uint32_t w) {
+    uint8_t* dst = dst_row + (x >> 3);
+
+    // Unaligned head
+    uint8_t bit_offset = x & 7;
+    if (bit_offset) {
+        uint8_t count = (uint8_t)((w < (uint32_t)(8 - bit_offset)) ? w : (8 - bit_offset));
+        pack_masked(src, dst, bit_offset, count);
+        src += count;
+        w -= count;
+        dst++;
+    }
+
+    // Aligned body, 32 pixels per iteration
+    while (w >= 32) {
+        uint32_t word = (uint32_t)pack8(src) |
+                        ((uint32_t)pack8(src + 8) << 8) |
+                        ((uint32_t)pack8(src + 16) << 16) |
+                        ((uint32_t)pack8(src + 24) << 24);
+        memcpy(dst, &word, sizeof(word));  // Little-endian: first byte lands first
+        src += 32;
+        dst += 4;
+        w -= 32;
+    }
+
+    while (w >= 8) {
+        *dst++ = pack8(src);
+        src += 8;
+        w -= 8;
+    }
+
+    // Unaligned tail
+    if (w) {
+        pack_masked(src, dst, 0, (uint8_t)w);
+    }
+}
+
+void eink_convert_area(const lv_color_t* color_p, uint8_t* fb, uint16_t fb_width, uint16_t fb_height,
+                       const lv_area_t* area) {
+    if (!color_p || !fb || !area) {
+        return;
+    }
+
+    // Clip once against the framebuffer; the source stride stays the area width
+    int32_t src_stride = area->x2 - area->x1 + 1;
+    int32_t x1 = area->x1 < 0 ? 0 : area->x1;
+    int32_t y1 = area->y1 < 0 ? 0 : area->y1;
+    int32_t x2 = area->x2 >= fb_width ? fb_width - 1 : area->x2;
+    int32_t y2 = area->y2 >= fb_height ? fb_height - 1 : area->y2;
+
+    if (src_stride <= 0 || x1 > x2 || y1 > y2) {
+        return;
+    }
+
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(color_p) +
+                         (y1 - area->y1) * src_stride + (x1 - area->x1);
+    uint32_t fb_stride = fb_width / 8;
+    uint32_t w = x2 - x1 + 1;
+
+    for (int32_t y = y1; y <= y2; y++) {
+        pack_row(src, fb + y * fb_stride, x1, w);
+        src += src_stride;
+    }
+}
+
+void eink_convert_stats_record(eink_convert_stats_t* stats, uint32_t cycles, uint32_t pixels) {
+    if (!stats) {
+        return;
+    }
+
+    stats->last_cycles = cycles;
+    stats->last_pixels = pixels;
+    if (cycles > stats->max_cycles) {
+        stats->max_cycles = cycles;
+    }
+    stats->total_cycles += cycles;
+    stats->total_pixels += pixels;
+    stats->area_count++;
+}
+
+uint32_t eink_convert_benchmark(uint16_t iterations) {
+    const uint16_t width = BOARD_EPD_WIDTH;
+    const uint16_t height = BOARD_EPD_HEIGHT;
+
+    struct BenchArea {
+        const char* name;
+        lv_area_t area;
+    };
+
+    const BenchArea areas[] = {
+        {"full",     {0, 0, width - 1, height - 1}},
+        {"band",     {0, 96, width - 1, 127}},
+        {"label",    {13, 40, 13 + 37 - 1, 40 + 16 - 1}},
+        {"statusbar", {3, 0, width - 4, 19}},
+    };
+
+    uint8_t* src = (uint8_t*)ps_malloc(width * height);
+    uint8_t* fb = (uint8_t*)ps_malloc(width * height / 8);
+    if (!src || !fb) {
+        LOG_ERROR("Failed to allocate conversion benchmark buffers");
+        free(src);
+        free(fb);
+        return 0;
+    }
+
+    // Checkerboard-ish pattern so every lane sees both colours
+    for (uint32_t i = 0; i < (uint32_t)width * height; i++) {
+        src[i] = (uint8_t)(((i * 7) >> 3) & 0x01);
+    }
+    memset(fb, 0xFF, width * height / 8);
+
+    if (iterations == 0) {
+        iterations = 1;
+    }
+
+    uint32_t full_avg = 0;
+    for (const BenchArea& bench : areas) {
+        uint32_t pixels = (bench.area.x2 - bench.area.x1 + 1) * (bench.area.y2 - bench.area.y1 + 1);
+        uint64_t total = 0;
+        uint32_t worst = 0;
+
+        for (uint16_t i = 0; i < iterations; i++) {
+            uint32_t start = ESP.getCycleCount();
+            eink_convert_area(reinterpret_cast<const lv_color_t*>(src), fb, width, height, &bench.area);
+            uint32_t cycles = ESP.getCycleCount() - start;
+            total += cycles;
+            if (cycles > worst) {
+                worst = cycles;
+            }
+        }
+
+        uint32_t avg = (uint32_t)(total / iterations);
+        if (bench.area.x1 == 0 && bench.area.y1 == 0 && pixels == (uint32_t)width * height) {
+            full_avg = avg;
+        }
+
+        LOG_INFO("Convert bench %-9s %3dx%-3d: %lu cycles/area (max %lu), %.2f cycles/px, %lu us",
+                 bench.name, bench.area.x2 - bench.area.x1 + 1, bench.area.y2 - bench.area.y1 + 1,
+                 avg, worst, (float)avg / pixels, avg / ESP.getCpuFreqMHz());
+    }
+
+    free(src);
+    free(fb);
+    return full_avg;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file eink_convert.h
+ * @brief LVGL to E-ink framebuffer conversion engine
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ */
+
+#ifndef EINK_CONVERT_H
+#define EINK_CONVERT_H
+
+#include <stdint.h>
+#include "lvgl.h"
+
+// ===== CONVERSION STATISTICS =====
+typedef struct {
+    uint32_t last_cycles;       // CPU cycles spent on the last flushed area
+    uint32_t last_pixels;       // Pixels converted for the last flushed area
+    uint32_t max_cycles;        // Worst case cycles for a single area
+    uint64_t total_cycles;      // Accumulated cycles since reset
+    uint64_t total_pixels;      // Accumulated pixels since reset
+    uint32_t area_count;        // Number of areas converted since reset
+} eink_convert_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Pack an LVGL 1-bit area into a MSB-first e-ink framebuffer
+ *
+ * Aligned spans are packed 32 pixels per iteration, unaligned leading and
+ * trailing pixels are merged with a masked read-modify-write so neighbouring
+ * pixels in the same byte are preserved. The area is clipped to the
+ * framebuffer once up front instead of per pixel.
+ *
+ * @param color_p LVGL pixel buffer for the area (stride = area width)
+ * @param fb Destination framebuffer (1 = white, 0 = black)
+ * @param fb_width Framebuffer width in pixels
+ * @param fb_height Framebuffer height in pixels
+ * @param area Area covered by color_p in framebuffer coordinates
+ */
+void eink_convert_area(const lv_color_t* color_p, uint8_t* fb, uint16_t fb_width, uint16_t fb_height,
+                       const lv_area_t* area);
+
+/**
+ * @brief Record the cost of one converted area
+ * @param stats Statistics to update
+ * @param cycles CPU cycles spent on the area
+ * @param pixels Pixels in the area
+ */
+void eink_convert_stats_record(eink_convert_stats_t* stats, uint32_t cycles, uint32_t pixels);
+
+/**
+ * @brief Micro-benchmark of the conversion engine
+ *
+ * Converts a set of representative flush areas (full repaint, aligned band,
+ * unaligned label) from scratch buffers and logs cycles per flushed area and
+ * cycles per pixel for each shape.
+ *
+ * @param iterations Number of conversions per area shape
+ * @return Average cycles for a full-screen area
+ */
+uint32_t eink_convert_benchmark(uint16_t iterations);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EINK_CONVERT_H
@@ -8,6 +8,8 @@
 #include "eink_manager.h"
 #include "../hal/board_config.h"
 #include "../utils/logger.h"
+#include "../utils/trace.h"
+#include "../system/scheduler.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/timers.h>
@@ -32,47 +34,53 @@ EinkManager::EinkManager() :
     clear_interval(1800000),        // Clear cycle every 30 minutes
     dirty_region_count(0),
     current_policy(EINK_POLICY_ADAPTIVE),
+    pending_mode(EINK_REFRESH_PARTIAL),
+    frame_complete(false),
     current_buffer(nullptr),
     previous_buffer(nullptr),
     diff_buffer(nullptr),
     last_update_time(0),
     min_update_interval(100),       // Minimum 100ms between updates
+    max_update_interval(2000),      // Adaptive policy never waits longer than 2s
+    adaptive_interval(100),
+    last_frame_time(0),
+    frame_interval_avg(0),
+    coalesced_update_count(0),
     update_pending(false),
     lvgl_buf1(nullptr),
-    lvgl_buf2(nullptr)
+    lvgl_buf2(nullptr),
+    display_task_handle(nullptr),
+    frame_mutex(nullptr),
+    pending_frame(nullptr),
+    render_frame(nullptr),
+    pending_frame_mode(EINK_REFRESH_PARTIAL),
+    frame_queued(false),
+    frames_coalesced(0),
+    frames_rendered(0),
+    skipped_refresh_count(0),
+    diff_rect_count(0)
 {
     // Initialize burn-in prevention data
     memset(&burn_in_data, 0, sizeof(burn_in_data));
     burn_in_data.needs_maintenance = false;
+    memset(&wear_map, 0, sizeof(wear_map));
     
     // Initialize dirty regions
     memset(dirty_regions, 0, sizeof(dirty_regions));
+    
+    // Initialize conversion statistics
+    memset(&convert_stats, 0, sizeof(convert_stats));
 }
 
 EinkManager::~EinkManager() {
-    if (current_buffer) free(current_buffer);
-    if (previous_buffer) free(previous_buffer);
-    if (diff_buffer) free(diff_buffer);
-    if (lvgl_buf1) free(lvgl_buf1);
-    if (lvgl_buf2) free(lvgl_buf2);
+    releaseBuffers();
 }
 
 bool EinkManager::initialize() {
     LOG_INFO("Initializing E-ink Display Manager");
     
-    // Initialize display hardware
-    display = new GxEPD2_BW<GxEPD2_310_GDEQ031T10, GxEPD2_310_GDEQ031T10::HEIGHT>(
-        GxEPD2_310_GDEQ031T10(BOARD_EPD_CS, BOARD_EPD_DC, BOARD_EPD_RST, BOARD_EPD_BUSY)
-    );
-    
-    if (!display) {
-        LOG_ERROR("Failed to create display instance");
-        return false;
-    }
-    
-    // Initialize display with conservative settings
-    display->init(115200, true, 2, false);
-    display->setRotation(0);
+    // Initialize display hardware; driver, pins and bus speed come from the board profile
+    display = ActiveEinkPanel::create();
     display->setTextColor(GxEPD_BLACK);
     
     // Initialize buffers
@@ -84,25 +92,42 @@ bool EinkManager::initialize() {
     // Configure LVGL
     configureLVGL();
     
-    // Perform initial clear to establish baseline
-    performClearCycle();
+    // From here on the display task owns the panel
+    if (startDisplayTask()) {
+        // The initial clear runs on the display task while the rest of the system boots;
+        // the first UI frame coalesces into it and is drawn once the panel is white
+        requestMaintenance(EINK_REFRESH_CLEAR);
+    } else {
+        LOG_WARN("Display task unavailable, refreshing synchronously");
+        performClearCycle();
+    }
     
     LOG_INFO("E-ink Display Manager initialized successfully");
     return true;
 }
 
-void EinkManager::initializeBuffers() {
+bool EinkManager::initializeBuffers() {
     // Allocate display buffers
     current_buffer = (uint8_t*)ps_malloc(EINK_BUFFER_SIZE);
     previous_buffer = (uint8_t*)ps_malloc(EINK_BUFFER_SIZE);
     diff_buffer = (uint8_t*)ps_malloc(EINK_BUFFER_SIZE);
+    pending_frame = (uint8_t*)ps_malloc(EINK_BUFFER_SIZE);
+    render_frame = (uint8_t*)ps_malloc(EINK_BUFFER_SIZE);
     
     // Allocate LVGL buffers
     lvgl_buf1 = (lv_color_t*)ps_malloc(sizeof(lv_color_t) * EINK_WIDTH * EINK_HEIGHT);
     lvgl_buf2 = (lv_color_t*)ps_malloc(sizeof(lv_color_t) * EINK_WIDTH * EINK_HEIGHT);
     
-    if (!current_buffer || !previous_buffer || !diff_buffer || !lvgl_buf1 || !lvgl_buf2) {
+    if (!current_buffer || !previous_buffer || !diff_buffer || !pending_frame || !render_frame ||
+        !lvgl_buf1 || !lvgl_buf2) {
         LOG_ERROR("Failed to allocate display buffers");
+        releaseBuffers();
+        return false;
+    }
+    
+    if (!eink_wear_init(&wear_map, EINK_WIDTH, EINK_HEIGHT)) {
+        LOG_ERROR("Failed to allocate wear map");
+        releaseBuffers();
         return false;
     }
     
@@ -110,10 +135,25 @@ void EinkManager::initializeBuffers() {
     memset(current_buffer, 0xFF, EINK_BUFFER_SIZE);
     memset(previous_buffer, 0xFF, EINK_BUFFER_SIZE);
     memset(diff_buffer, 0x00, EINK_BUFFER_SIZE);
+    memset(pending_frame, 0xFF, EINK_BUFFER_SIZE);
+    memset(render_frame, 0xFF, EINK_BUFFER_SIZE);
     
     return true;
 }
 
+void EinkManager::releaseBuffers() {
+    free(current_buffer);
+    free(previous_buffer);
+    free(diff_buffer);
+    free(pending_frame);
+    free(render_frame);
+    free(lvgl_buf1);
+    free(lvgl_buf2);
+    current_buffer = previous_buffer = diff_buffer = pending_frame = render_frame = nullptr;
+    lvgl_buf1 = lvgl_buf2 = nullptr;
+    eink_wear_deinit(&wear_map);
+}
+
 void EinkManager::configureLVGL() {
     LOG_INFO("Configuring LVGL for E-ink display");
     
@@ -143,6 +183,8 @@ void EinkManager::configureLVGL() {
 }
 
 void EinkManager::lvglFlushCallback(lv_disp_drv_t* disp_drv, const lv_area_t* area, lv_color_t* color_p) {
+    TRACE_SCOPE(TRACE_LVGL_FLUSH);
+    
     // Convert LVGL color buffer to E-ink format
     convertLvglToEink(color_p, current_buffer, area);
     
@@ -157,6 +199,13 @@ void EinkManager::lvglFlushCallback(lv_disp_drv_t* disp_drv, const lv_area_t* ar
         LOG_DEBUG("Performing full refresh to prevent burn-in");
     }
     
+    // Note frame boundaries so batched regions go out as one transaction
+    frame_complete = lv_disp_flush_is_last(disp_drv);
+    if (frame_complete) {
+        update_pending = false;
+        updateAdaptiveInterval(esp_timer_get_time() / 1000);
+    }
+    
     // Schedule the display update
     scheduleUpdate(area, refresh_mode);
     
@@ -165,42 +214,19 @@ void EinkManager::lvglFlushCallback(lv_disp_drv_t* disp_drv, const lv_area_t* ar
 }
 
 void EinkManager::lvglRenderStartCallback(struct _lv_disp_drv_t* disp_drv) {
-    // Called when LVGL starts rendering
-    // We can use this to batch updates or prepare for refresh
+    // Called when LVGL starts rendering; hold batched regions until the frame is complete
     update_pending = true;
+    frame_complete = false;
 }
 
 void EinkManager::convertLvglToEink(const lv_color_t* color_p, uint8_t* eink_buf, const lv_area_t* area) {
-    uint32_t w = (area->x2 - area->x1 + 1);
-    uint32_t h = (area->y2 - area->y1 + 1);
+    uint32_t start = ESP.getCycleCount();
     
-    // Convert LVGL 1-bit color to E-ink format
-    for (uint32_t y = 0; y < h; y++) {
-        for (uint32_t x = 0; x < w; x += 8) {
-            uint8_t byte_val = 0;
-            
-            // Pack 8 pixels into one byte
-            for (int bit = 0; bit < 8 && (x + bit) < w; bit++) {
-                uint32_t pixel_idx = y * w + x + bit;
-                if (pixel_idx < w * h) {
-                    // LVGL uses 0 for black, 1 for white
-                    // E-ink uses 0 for black, 1 for white (same)
-                    if ((color_p + pixel_idx)->full) {
-                        byte_val |= (1 << (7 - bit));
-                    }
-                }
-            }
-            
-            // Calculate buffer position
-            uint32_t buf_x = area->x1 + x;
-            uint32_t buf_y = area->y1 + y;
-            uint32_t buf_idx = (buf_y * EINK_WIDTH + buf_x) / 8;
-            
-            if (buf_idx < EINK_BUFFER_SIZE) {
-                eink_buf[buf_idx] = byte_val;
-            }
-        }
-    }
+    // LVGL uses 0 for black, 1 for white - same as the E-ink framebuffer
+    eink_convert_area(color_p, eink_buf, EINK_WIDTH, EINK_HEIGHT, area);
+    
+    uint32_t cycles = ESP.getCycleCount() - start;
+    eink_convert_stats_record(&convert_stats, cycles, lv_area_get_size(area));
 }
 
 bool EinkManager::shouldPerformFullRefresh() {
@@ -227,40 +253,441 @@ bool EinkManager::shouldPerformFullRefresh() {
     return false;
 }
 
+void EinkManager::setUpdatePolicy(EinkUpdatePolicy policy) {
+    current_policy = policy;
+    adaptive_interval = min_update_interval;
+    
+    // Anything held back under the old policy goes out now
+    if (policy == EINK_POLICY_IMMEDIATE && dirty_region_count > 0) {
+        flushDirtyRegions();
+    }
+}
+
+void EinkManager::forceFullRefresh() {
+    lv_area_t full_area = {0, 0, EINK_WIDTH - 1, EINK_HEIGHT - 1};
+    scheduleUpdate(&full_area, EINK_REFRESH_FULL);
+    flushDirtyRegions();
+}
+
+void EinkManager::optimizeRefreshRegion(lv_area_t* area) {
+    // Clip to the panel and widen x to whole bytes, the controller's addressing unit
+    if (area->x1 < 0) area->x1 = 0;
+    if (area->y1 < 0) area->y1 = 0;
+    if (area->x2 >= EINK_WIDTH) area->x2 = EINK_WIDTH - 1;
+    if (area->y2 >= EINK_HEIGHT) area->y2 = EINK_HEIGHT - 1;
+    
+    area->x1 &= ~7;
+    area->x2 |= 7;
+}
+
+static inline lv_area_t region_to_area(const EinkRegion& region) {
+    lv_area_t area = {region.x, region.y,
+                      (lv_coord_t)(region.x + region.width - 1),
+                      (lv_coord_t)(region.y + region.height - 1)};
+    return area;
+}
+
+static inline void area_to_region(const lv_area_t& area, EinkRegion& region) {
+    region.x = area.x1;
+    region.y = area.y1;
+    region.width = lv_area_get_width(&area);
+    region.height = lv_area_get_height(&area);
+}
+
+// Overlapping or edge-adjacent areas are refreshed as one
+static inline bool areas_touch(const lv_area_t& a, const lv_area_t& b) {
+    lv_area_t grown = {(lv_coord_t)(a.x1 - 1), (lv_coord_t)(a.y1 - 1),
+                       (lv_coord_t)(a.x2 + 1), (lv_coord_t)(a.y2 + 1)};
+    return _lv_area_is_on(&grown, &b);
+}
+
+void EinkManager::calculateDirtyRegions(const lv_area_t* area) {
+    if (!lv_area_get_size(area)) {
+        return;
+    }
+    
+    lv_area_t merged = *area;
+    uint8_t update_count = 1;
+    uint32_t now = esp_timer_get_time() / 1000;
+    
+    // Absorb every region the new area touches; a merge can make it touch others
+    bool absorbed;
+    do {
+        absorbed = false;
+        for (uint8_t i = 0; i < dirty_region_count; i++) {
+            lv_area_t existing = region_to_area(dirty_regions[i]);
+            if (areas_touch(existing, merged)) {
+                _lv_area_join(&merged, &merged, &existing);
+                update_count = (dirty_regions[i].update_count < 255) ? dirty_regions[i].update_count + 1 : 255;
+                dirty_regions[i] = dirty_regions[--dirty_region_count];
+                coalesced_update_count++;
+                absorbed = true;
+                break;
+            }
+        }
+    } while (absorbed);
+    
+    // List full: fold into the region whose bounding box grows the least
+    if (dirty_region_count >= EINK_MAX_DIRTY_REGIONS) {
+        uint8_t best = 0;
+        uint32_t best_growth = UINT32_MAX;
+        
+        for (uint8_t i = 0; i < dirty_region_count; i++) {
+            lv_area_t existing = region_to_area(dirty_regions[i]);
+            lv_area_t joined;
+            _lv_area_join(&joined, &existing, &merged);
+            uint32_t growth = lv_area_get_size(&joined) - lv_area_get_size(&existing);
+            if (growth < best_growth) {
+                best_growth = growth;
+                best = i;
+            }
+        }
+        
+        lv_area_t existing = region_to_area(dirty_regions[best]);
+        _lv_area_join(&merged, &merged, &existing);
+        dirty_regions[best] = dirty_regions[--dirty_region_count];
+        coalesced_update_count++;
+    }
+    
+    EinkRegion& region = dirty_regions[dirty_region_count++];
+    area_to_region(merged, region);
+    region.dirty = true;
+    region.last_update = now;
+    region.update_count = update_count;
+}
+
+bool EinkManager::isUpdateDue(uint32_t now) const {
+    switch (current_policy) {
+        case EINK_POLICY_IMMEDIATE:
+            return true;
+        case EINK_POLICY_BATCHED:
+            return frame_complete || now - last_update_time >= min_update_interval;
+        case EINK_POLICY_SCHEDULED:
+            return now - last_update_time >= min_update_interval;
+        case EINK_POLICY_ADAPTIVE:
+        default:
+            return now - last_update_time >= adaptive_interval;
+    }
+}
+
+void EinkManager::updateAdaptiveInterval(uint32_t now) {
+    uint32_t frame_interval = now - last_frame_time;
+    last_frame_time = now;
+    
+    // A frame after a long idle gap is user interaction; respond quickly
+    if (frame_interval >= max_update_interval) {
+        frame_interval_avg = frame_interval;
+        adaptive_interval = min_update_interval;
+        return;
+    }
+    
+    frame_interval_avg = frame_interval_avg ? (frame_interval_avg * 3 + frame_interval) / 4 : frame_interval;
+    
+    // Frames arriving faster than we refresh: back off. Quiet again: tighten.
+    if (frame_interval_avg < adaptive_interval) {
+        adaptive_interval = min(adaptive_interval * 3 / 2, max_update_interval);
+    } else if (frame_interval_avg > adaptive_interval * 2) {
+        adaptive_interval = max(adaptive_interval * 2 / 3, min_update_interval);
+    }
+}
+
 void EinkManager::scheduleUpdate(const lv_area_t* area, EinkRefreshMode mode) {
     // Optimize the refresh area to minimize unnecessary updates
     lv_area_t optimized_area = *area;
     optimizeRefreshRegion(&optimized_area);
     
-    // Check minimum update interval
-    uint32_t current_time = esp_timer_get_time() / 1000;
-    if (current_time - last_update_time < min_update_interval) {
-        // Too soon, batch this update
-        calculateDirtyRegions(&optimized_area);
+    // Queue the region; nothing is dropped, only deferred
+    calculateDirtyRegions(&optimized_area);
+    if (mode > pending_mode) {
+        pending_mode = mode;
+    }
+    
+    // LVGL is still flushing this frame; wait for the last area unless asked not to
+    if (current_policy != EINK_POLICY_IMMEDIATE && !frame_complete) {
+        return;
+    }
+    
+    if (isUpdateDue(esp_timer_get_time() / 1000)) {
+        flushDirtyRegions();
+    }
+}
+
+void EinkManager::processScheduledUpdates() {
+    if (dirty_region_count == 0 || update_pending) {
+        return;
+    }
+    
+    // Drain regions held back by the interval once it expires
+    if (isUpdateDue(esp_timer_get_time() / 1000)) {
+        flushDirtyRegions();
+    }
+}
+
+uint32_t EinkManager::getNextUpdateDelay() const {
+    if (dirty_region_count == 0 || update_pending) {
+        return UINT32_MAX;
+    }
+    
+    uint32_t interval;
+    switch (current_policy) {
+        case EINK_POLICY_IMMEDIATE:
+            return 0;
+        case EINK_POLICY_BATCHED:
+            if (frame_complete) {
+                return 0;
+            }
+            interval = min_update_interval;
+            break;
+        case EINK_POLICY_SCHEDULED:
+            interval = min_update_interval;
+            break;
+        case EINK_POLICY_ADAPTIVE:
+        default:
+            interval = adaptive_interval;
+            break;
+    }
+    
+    uint32_t elapsed = esp_timer_get_time() / 1000 - last_update_time;
+    return elapsed >= interval ? 0 : interval - elapsed;
+}
+
+void EinkManager::flushDirtyRegions() {
+    if (dirty_region_count == 0) {
         return;
     }
     
-    // Perform the update
-    flushDisplay(&optimized_area, current_buffer, mode);
-    last_update_time = current_time;
+    // One panel transaction for everything pending; the diff stage keeps it tight
+    lv_area_t bounds = region_to_area(dirty_regions[0]);
+    for (uint8_t i = 1; i < dirty_region_count; i++) {
+        lv_area_t existing = region_to_area(dirty_regions[i]);
+        _lv_area_join(&bounds, &bounds, &existing);
+    }
+    
+    EinkRefreshMode mode = pending_mode;
+    dirty_region_count = 0;
+    pending_mode = EINK_REFRESH_PARTIAL;
+    
+    submitFrame(&bounds, mode);
+    last_update_time = esp_timer_get_time() / 1000;
+}
+
+void EinkManager::submitFrame(const lv_area_t* area, EinkRefreshMode mode) {
+    if (!display_task_handle) {
+        flushDisplay(area, current_buffer, mode);
+        return;
+    }
+    
+    // Latest frame wins: a frame still waiting is overwritten and its area kept
+    xSemaphoreTake(frame_mutex, portMAX_DELAY);
+    memcpy(pending_frame, current_buffer, EINK_BUFFER_SIZE);
+    if (frame_queued) {
+        _lv_area_join(&pending_frame_area, &pending_frame_area, area);
+        if (mode > pending_frame_mode) {
+            pending_frame_mode = mode;
+        }
+        frames_coalesced++;
+    } else {
+        pending_frame_area = *area;
+        pending_frame_mode = mode;
+        frame_queued = true;
+    }
+    xSemaphoreGive(frame_mutex);
+    
+    xTaskNotifyGive(display_task_handle);
+}
+
+bool EinkManager::startDisplayTask() {
+    if (display_task_handle) {
+        return true;
+    }
+    
+    frame_mutex = xSemaphoreCreateMutex();
+    if (!frame_mutex) {
+        LOG_ERROR("Failed to create display frame mutex");
+        return false;
+    }
+    
+    // Core 0, away from the UI task; the task spends most of its time waiting on BUSY
+    BaseType_t result = xTaskCreatePinnedToCore(
+        displayTask,
+        "eink_display",
+        4096,
+        this,
+        DISPLAY_TASK_PRIORITY,
+        &display_task_handle,
+        0
+    );
+    
+    if (result != pdPASS) {
+        LOG_ERROR("Failed to create display task");
+        vSemaphoreDelete(frame_mutex);
+        frame_mutex = nullptr;
+        display_task_handle = nullptr;
+        return false;
+    }
+    
+    LOG_INFO("E-ink display task started");
+    return true;
+}
+
+void EinkManager::displayTask(void* parameter) {
+    static_cast<EinkManager*>(parameter)->displayTaskLoop();
+}
+
+void EinkManager::displayTaskLoop() {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        
+        // Take ownership of the published frame by swapping buffers
+        xSemaphoreTake(frame_mutex, portMAX_DELAY);
+        if (!frame_queued) {
+            xSemaphoreGive(frame_mutex);
+            continue;
+        }
+        uint8_t* frame = pending_frame;
+        pending_frame = render_frame;
+        render_frame = frame;
+        lv_area_t area = pending_frame_area;
+        EinkRefreshMode mode = pending_frame_mode;
+        frame_queued = false;
+        xSemaphoreGive(frame_mutex);
+        
+        // No light sleep while the panel is being driven
+        sched_wake_lock();
+        flushDisplay(&area, render_frame, mode);
+        
+        // Maintenance cycles leave the panel white; put the UI back
+        if (mode == EINK_REFRESH_CLEAR || mode == EINK_REFRESH_DEEP_CLEAN) {
+            lv_area_t full_area = {0, 0, EINK_WIDTH - 1, EINK_HEIGHT - 1};
+            flushDisplay(&full_area, render_frame, EINK_REFRESH_FULL);
+        }
+        sched_wake_unlock();
+        
+        frames_rendered++;
+    }
+}
+
+void EinkManager::requestMaintenance(EinkRefreshMode mode) {
+    lv_area_t full_area = {0, 0, EINK_WIDTH - 1, EINK_HEIGHT - 1};
+    submitFrame(&full_area, mode);
+}
+
+// Append a changed band as a rectangle; once the list is full, grow the last one
+static void push_diff_band(lv_area_t* rects, uint8_t* count, uint8_t max_rects,
+                           int32_t bx1, int32_t y1, int32_t bx2, int32_t y2) {
+    lv_area_t band = {(lv_coord_t)(bx1 * 8), (lv_coord_t)y1, (lv_coord_t)(bx2 * 8 + 7), (lv_coord_t)y2};
+    
+    if (*count < max_rects) {
+        rects[(*count)++] = band;
+    } else {
+        _lv_area_join(&rects[*count - 1], &rects[*count - 1], &band);
+    }
+}
+
+uint8_t EinkManager::computeDiffRects(const lv_area_t* area, const uint8_t* buffer, lv_area_t* rects, uint8_t max_rects) {
+    // Clip to the panel and widen to whole bytes; the controller addresses x in 8 pixel steps
+    int32_t y1 = area->y1 < 0 ? 0 : area->y1;
+    int32_t y2 = area->y2 >= EINK_HEIGHT ? EINK_HEIGHT - 1 : area->y2;
+    int32_t bx1 = (area->x1 < 0 ? 0 : area->x1) >> 3;
+    int32_t bx2 = (area->x2 >= EINK_WIDTH ? EINK_WIDTH - 1 : area->x2) >> 3;
+    
+    if (y1 > y2 || bx1 > bx2 || max_rects == 0) {
+        return 0;
+    }
+    
+    uint8_t count = 0;
+    bool band_open = false;
+    int32_t band_y1 = 0, band_y2 = 0, band_bx1 = 0, band_bx2 = 0;
+    
+    for (int32_t y = y1; y <= y2; y++) {
+        const uint8_t* cur = buffer + y * EINK_ROW_BYTES;
+        const uint8_t* prev = previous_buffer + y * EINK_ROW_BYTES;
+        uint8_t* diff = diff_buffer + y * EINK_ROW_BYTES;
+        
+        int32_t first = -1, last = -1;
+        for (int32_t bx = bx1; bx <= bx2; bx++) {
+            diff[bx] = cur[bx] ^ prev[bx];
+            if (diff[bx]) {
+                if (first < 0) first = bx;
+                last = bx;
+            }
+        }
+        
+        if (first < 0) {
+            continue;
+        }
+        
+        // Extend the open band if this row is close enough, otherwise close it
+        if (band_open && y - band_y2 <= EINK_DIFF_MERGE_ROWS) {
+            band_y2 = y;
+            if (first < band_bx1) band_bx1 = first;
+            if (last > band_bx2) band_bx2 = last;
+            continue;
+        }
+        
+        if (band_open) {
+            push_diff_band(rects, &count, max_rects, band_bx1, band_y1, band_bx2, band_y2);
+        }
+        
+        band_open = true;
+        band_y1 = band_y2 = y;
+        band_bx1 = first;
+        band_bx2 = last;
+    }
+    
+    if (band_open) {
+        push_diff_band(rects, &count, max_rects, band_bx1, band_y1, band_bx2, band_y2);
+    }
+    
+    return count;
+}
+
+void EinkManager::commitPreviousBuffer(const lv_area_t* rect, const uint8_t* buffer) {
+    // Record what the panel now shows so the next diff starts from it
+    int32_t bx1 = rect->x1 >> 3;
+    int32_t len = (rect->x2 >> 3) - bx1 + 1;
+    
+    for (int32_t y = rect->y1; y <= rect->y2; y++) {
+        uint32_t offset = y * EINK_ROW_BYTES + bx1;
+        memcpy(previous_buffer + offset, buffer + offset, len);
+    }
 }
 
 void EinkManager::flushDisplay(const lv_area_t* area, const uint8_t* buffer, EinkRefreshMode mode) {
     if (!display) return;
     
-    uint32_t w = area->x2 - area->x1 + 1;
-    uint32_t h = area->y2 - area->y1 + 1;
+    uint32_t trace_start = trace_begin();
     
     switch (mode) {
-        case EINK_REFRESH_PARTIAL:
-            display->setPartialWindow(area->x1, area->y1, w, h);
-            display->firstPage();
-            do {
-                display->drawInvertedBitmap(area->x1, area->y1, buffer, w, h, GxEPD_BLACK);
-            } while (display->nextPage());
+        case EINK_REFRESH_PARTIAL: {
+            // Only drive the panel for pixels that differ from what it already shows
+            lv_area_t rects[EINK_MAX_DIFF_RECTS];
+            uint8_t rect_count = computeDiffRects(area, buffer, rects, EINK_MAX_DIFF_RECTS);
+            
+            if (rect_count == 0) {
+                skipped_refresh_count++;
+                LOG_DEBUG("Partial refresh skipped, no pixels changed");
+                return;
+            }
+            
+            for (uint8_t i = 0; i < rect_count; i++) {
+                const lv_area_t* rect = &rects[i];
+                display->setPartialWindow(rect->x1, rect->y1, lv_area_get_width(rect), lv_area_get_height(rect));
+                display->firstPage();
+                do {
+                    // The partial window clips drawing, so the whole framebuffer can be passed
+                    display->drawInvertedBitmap(0, 0, buffer, EINK_WIDTH, EINK_HEIGHT, GxEPD_BLACK);
+                } while (display->nextPage());
+                
+                commitPreviousBuffer(rect, buffer);
+            }
+            
+            // Ghosting builds up per refresh, however many rects it took
             burn_in_data.partial_refresh_count++;
-            LOG_DEBUG("Partial refresh completed");
+            diff_rect_count += rect_count;
+            LOG_DEBUG("Partial refresh completed (%d rects)", rect_count);
             break;
+        }
             
         case EINK_REFRESH_FULL:
             display->setFullWindow();
@@ -268,6 +695,7 @@ void EinkManager::flushDisplay(const lv_area_t* area, const uint8_t* buffer, Ein
             do {
                 display->drawInvertedBitmap(0, 0, buffer, EINK_WIDTH, EINK_HEIGHT, GxEPD_BLACK);
             } while (display->nextPage());
+            memcpy(previous_buffer, buffer, EINK_BUFFER_SIZE);
             burn_in_data.partial_refresh_count = 0;
             burn_in_data.last_full_refresh_time = esp_timer_get_time() / 1000;
             burn_in_data.needs_maintenance = false;
@@ -284,6 +712,9 @@ void EinkManager::flushDisplay(const lv_area_t* area, const uint8_t* buffer, Ein
     }
     
     display->hibernate();
+    
+    // Refresh sites follow EinkRefreshMode order
+    trace_end((trace_site_t)(TRACE_EINK_PARTIAL + mode), trace_start);
 }
 
 void EinkManager::performClearCycle() {
@@ -316,7 +747,12 @@ void EinkManager::performClearCycle() {
     // Reset burn-in tracking
     burn_in_data.last_clear_time = esp_timer_get_time() / 1000;
     burn_in_data.partial_refresh_count = 0;
-    memset(burn_in_data.pixel_usage_map, 0, sizeof(burn_in_data.pixel_usage_map));
+    eink_wear_reset(&wear_map);
+    
+    // The panel is white now, so every non-white pixel must show up in the next diff
+    if (previous_buffer) {
+        memset(previous_buffer, 0xFF, EINK_BUFFER_SIZE);
+    }
     
     display->hibernate();
     LOG_INFO("Clear cycle completed");
@@ -335,18 +771,9 @@ void EinkManager::performDeepClean() {
 }
 
 void EinkManager::updatePixelUsageMap(const lv_area_t* area) {
-    // Track which pixels are being used to detect potential burn-in areas
-    for (int y = area->y1; y <= area->y2; y++) {
-        for (int x = area->x1; x <= area->x2; x += 8) {
-            if (y < EINK_HEIGHT && x < EINK_WIDTH) {
-                burn_in_data.pixel_usage_map[y][x/8]++;
-                
-                // Check for excessive usage
-                if (burn_in_data.pixel_usage_map[y][x/8] > 1000) {
-                    burn_in_data.needs_maintenance = true;
-                }
-            }
-        }
+    // Track which tiles are being used to detect potential burn-in areas
+    if (eink_wear_record_area(&wear_map, area)) {
+        burn_in_data.needs_maintenance = true;
     }
 }
 
@@ -356,7 +783,8 @@ void EinkManager::checkBurnInPrevention() {
     // Check if clear cycle is needed
     if (current_time - burn_in_data.last_clear_time >= clear_interval) {
         LOG_INFO("Scheduling clear cycle for burn-in prevention");
-        performClearCycle();
+        burn_in_data.last_clear_time = current_time;  // Don't re-request while the cycle is queued
+        requestMaintenance(EINK_REFRESH_CLEAR);
     }
     
     // Check pixel usage patterns
@@ -368,20 +796,12 @@ void EinkManager::checkBurnInPrevention() {
 }
 
 float EinkManager::getPixelUsagePercentage() {
-    uint32_t total_usage = 0;
-    uint32_t max_possible = EINK_HEIGHT * (EINK_WIDTH / 8) * 1000; // Max usage per pixel
-    
-    for (int y = 0; y < EINK_HEIGHT; y++) {
-        for (int x = 0; x < EINK_WIDTH / 8; x++) {
-            total_usage += burn_in_data.pixel_usage_map[y][x];
-        }
-    }
-    
-    return (float)total_usage / max_possible * 100.0f;
+    return eink_wear_usage_percent(&wear_map);
 }
 
 void EinkManager::enterSleepMode() {
-    if (display) {
+    // With the display task running the panel is hibernated after every refresh
+    if (display && !display_task_handle) {
         display->hibernate();
     }
     LOG_DEBUG("E-ink display entered sleep mode");
@@ -400,9 +820,10 @@ void eink_init() {
 }
 
 // Task handler for periodic maintenance
-void eink_task_handler() {
-    eink_manager.checkBurnInPrevention();
+uint32_t eink_task_handler() {
+    // Burn-in checks run in the maintenance task; this only drains held-back regions
     eink_manager.processScheduledUpdates();
+    return eink_manager.getNextUpdateDelay();
 }
 
 // FreeRTOS task for maintenance
@@ -410,7 +831,8 @@ void eink_maintenance_task(void* parameter) {
     const TickType_t xDelay = pdMS_TO_TICKS(60000); // Run every minute
     
     while (1) {
-        eink_task_handler();
+        // Scheduled updates are drained by the UI task; only burn-in checks run here
+        eink_manager.checkBurnInPrevention();
         vTaskDelay(xDelay);
     }
 }
\ No newline at end of file
@@ -9,13 +9,26 @@
 #define EINK_MANAGER_H
 
 #include <Arduino.h>
-#include <GxEPD2_BW.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
 #include "lvgl.h"
+#include "eink_convert.h"
+#include "eink_wear_map.h"
+#include "eink_panel.h"
 
-// E-ink specific configurations
-#define EINK_WIDTH 240
-#define EINK_HEIGHT 320
-#define EINK_BUFFER_SIZE (EINK_WIDTH * EINK_HEIGHT / 8)
+// E-ink specific configurations; geometry is that of the board's panel
+#define EINK_WIDTH ActiveEinkPanel::WIDTH
+#define EINK_HEIGHT ActiveEinkPanel::HEIGHT
+#define EINK_BUFFER_SIZE ActiveEinkPanel::BUFFER_SIZE
+#define EINK_ROW_BYTES ActiveEinkPanel::ROW_BYTES
+
+// Diff stage tuning: a refresh costs far more than a few extra rows, so
+// changed bands closer than EINK_DIFF_MERGE_ROWS are refreshed together
+#define EINK_MAX_DIFF_RECTS 4
+#define EINK_DIFF_MERGE_ROWS 24
+
+#define EINK_MAX_DIRTY_REGIONS 16
 
 // Refresh strategies to prevent burn-in
 enum EinkRefreshMode {
@@ -38,7 +51,6 @@ struct EinkBurnInPrevention {
     uint32_t partial_refresh_count;     // Track partial refreshes
     uint32_t last_full_refresh_time;    // Last full refresh timestamp
     uint32_t last_clear_time;           // Last clear operation
-    uint32_t pixel_usage_map[EINK_HEIGHT][EINK_WIDTH/8]; // Track pixel usage
     bool needs_maintenance;             // Flag for maintenance cycle
 };
 
@@ -52,18 +64,21 @@ struct EinkRegion {
 
 class EinkManager {
 private:
-    GxEPD2_BW<GxEPD2_310_GDEQ031T10, GxEPD2_310_GDEQ031T10::HEIGHT>* display;
+    ActiveEinkPanel::Display* display;
     
     // Burn-in prevention
     EinkBurnInPrevention burn_in_data;
     uint32_t partial_refresh_limit;
     uint32_t full_refresh_interval;
     uint32_t clear_interval;
+    eink_wear_map_t wear_map;           // Per-tile usage counters (PSRAM)
     
     // Update optimization
-    EinkRegion dirty_regions[16];
+    EinkRegion dirty_regions[EINK_MAX_DIRTY_REGIONS];
     uint8_t dirty_region_count;
     EinkUpdatePolicy current_policy;
+    EinkRefreshMode pending_mode;
+    bool frame_complete;
     
     // Buffers for optimization
     uint8_t* current_buffer;
@@ -73,6 +88,11 @@ private:
     // Timing control
     uint32_t last_update_time;
     uint32_t min_update_interval;
+    uint32_t max_update_interval;
+    uint32_t adaptive_interval;
+    uint32_t last_frame_time;
+    uint32_t frame_interval_avg;
+    uint32_t coalesced_update_count;
     bool update_pending;
     
     // LVGL integration
@@ -81,14 +101,41 @@ private:
     lv_color_t* lvgl_buf1;
     lv_color_t* lvgl_buf2;
     
+    // Async display pipeline: the UI publishes the latest frame, the display task renders it
+    TaskHandle_t display_task_handle;
+    SemaphoreHandle_t frame_mutex;
+    uint8_t* pending_frame;
+    uint8_t* render_frame;
+    lv_area_t pending_frame_area;
+    EinkRefreshMode pending_frame_mode;
+    bool frame_queued;
+    uint32_t frames_coalesced;
+    uint32_t frames_rendered;
+    
+    // Conversion cost tracking
+    eink_convert_stats_t convert_stats;
+    
+    // Diff stage statistics
+    uint32_t skipped_refresh_count;
+    uint32_t diff_rect_count;
+    
     // Private methods
-    void initializeBuffers();
+    bool initializeBuffers();
+    void releaseBuffers();
     void calculateDirtyRegions(const lv_area_t* area);
+    void flushDirtyRegions();
+    bool isUpdateDue(uint32_t now) const;
+    void updateAdaptiveInterval(uint32_t now);
+    void submitFrame(const lv_area_t* area, EinkRefreshMode mode);
+    void displayTaskLoop();
+    static void displayTask(void* parameter);
     bool shouldPerformFullRefresh();
     void performMaintenanceCycle();
     void updatePixelUsageMap(const lv_area_t* area);
     void optimizeRefreshRegion(lv_area_t* area);
     void convertLvglToEink(const lv_color_t* color_p, uint8_t* eink_buf, const lv_area_t* area);
+    uint8_t computeDiffRects(const lv_area_t* area, const uint8_t* buffer, lv_area_t* rects, uint8_t max_rects);
+    void commitPreviousBuffer(const lv_area_t* rect, const uint8_t* buffer);
     
 public:
     EinkManager();
@@ -104,6 +151,11 @@ public:
     void forceFullRefresh();
     void performClearCycle();
     void performDeepClean();
+    void requestMaintenance(EinkRefreshMode mode);
+    
+    // Display pipeline
+    bool startDisplayTask();
+    bool isFramePending() const { return frame_queued; }
     
     // LVGL callbacks
     static void lvglFlushCallback(lv_disp_drv_t* disp_drv, const lv_area_t* area, lv_color_t* color_p);
@@ -112,6 +164,7 @@ public:
     // Update management
     void scheduleUpdate(const lv_area_t* area, EinkRefreshMode mode = EINK_REFRESH_PARTIAL);
     void processScheduledUpdates();
+    uint32_t getNextUpdateDelay() const;   // ms until held-back regions flush, UINT32_MAX if none
     void flushDisplay(const lv_area_t* area, const uint8_t* buffer, EinkRefreshMode mode);
     
     // Burn-in prevention
@@ -129,12 +182,22 @@ public:
     void getDisplayStats(uint32_t* partial_count, uint32_t* full_count, uint32_t* clear_count);
     float getPixelUsagePercentage();
     uint32_t getTimeSinceLastFullRefresh();
+    const eink_convert_stats_t& getConversionStats() const { return convert_stats; }
+    void resetConversionStats() { memset(&convert_stats, 0, sizeof(convert_stats)); }
+    uint32_t getSkippedRefreshCount() const { return skipped_refresh_count; }
+    uint32_t getDiffRectCount() const { return diff_rect_count; }
+    uint32_t getCoalescedUpdateCount() const { return coalesced_update_count; }
+    uint32_t getAdaptiveInterval() const { return adaptive_interval; }
+    uint8_t getDirtyRegionCount() const { return dirty_region_count; }
+    uint32_t getCoalescedFrameCount() const { return frames_coalesced; }
+    uint32_t getRenderedFrameCount() const { return frames_rendered; }
     
     // Configuration
     void setPartialRefreshLimit(uint32_t limit) { partial_refresh_limit = limit; }
     void setFullRefreshInterval(uint32_t interval) { full_refresh_interval = interval; }
     void setClearInterval(uint32_t interval) { clear_interval = interval; }
     void setMinUpdateInterval(uint32_t interval) { min_update_interval = interval; }
+    void setMaxUpdateInterval(uint32_t interval) { max_update_interval = interval; }
 };
 
 // Global instance
@@ -142,7 +205,7 @@ extern EinkManager eink_manager;
 
 // Utility functions
 void eink_init();
-void eink_task_handler();
+uint32_t eink_task_handler();
 void eink_maintenance_task(void* parameter);
 
 #endif // EINK_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,69 @@
+/**
+ * @file eink_panel.h
+ * @brief Board-specialised E-ink panel facade
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ *
+ * Resolves the GxEPD2 driver, panel geometry and frame buffer sizes from a
+ * board profile at compile time. The display object lives in static
+ * storage; EINK_WIDTH, EINK_HEIGHT and EINK_BUFFER_SIZE are constants of
+ * the active panel.
+ */
+
+#ifndef EINK_PANEL_H
+#define EINK_PANEL_H
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <GxEPD2_BW.h>
+#include "../hal/board_profile.h"
+
+/**
+ * @brief GxEPD2 driver and geometry per panel
+ */
+template <TDeckOS::Board::DisplayPanel Panel>
+struct EinkPanelTraits;
+
+template <>
+struct EinkPanelTraits<TDeckOS::Board::DisplayPanel::GDEQ031T10> {
+    using Driver = GxEPD2_310_GDEQ031T10;
+    static constexpr uint16_t WIDTH = 240;
+    static constexpr uint16_t HEIGHT = 320;
+};
+
+/**
+ * @brief E-ink panel of a board profile
+ */
+template <typename Profile>
+struct EinkPanel {
+    using Pins = typename Profile::Display;
+    using Traits = EinkPanelTraits<Pins::PANEL>;
+    using Driver = typename Traits::Driver;
+    using Display = GxEPD2_BW<Driver, Driver::HEIGHT>;
+
+    static constexpr uint16_t WIDTH = Traits::WIDTH;
+    static constexpr uint16_t HEIGHT = Traits::HEIGHT;
+    static constexpr uint16_t ROW_BYTES = WIDTH / 8;
+    static constexpr uint32_t BUFFER_SIZE = (uint32_t)ROW_BYTES * HEIGHT;
+
+    static_assert(WIDTH % 8 == 0, "Panel rows must be whole bytes");
+
+    /**
+     * @brief Construct the display and bring up the panel
+     * @return The display; owned by the facade, never freed
+     */
+    static Display* create() {
+        static Display display(Driver(Pins::CS, Pins::DC, Pins::RST, Pins::BUSY));
+
+        // The bus is shared with the radio and started once by setup_hardware(),
+        // before the display and radio stages run concurrently
+        display.epd2.selectSPI(SPI, SPISettings(Pins::SPI_HZ, MSBFIRST, SPI_MODE0));
+        display.init(115200, true, Pins::RESET_PULSE_MS, false);
+        display.setRotation(Pins::ROTATION);
+        return &display;
+    }
+};
+
+using ActiveEinkPanel = EinkPanel<TDeckOS::Board::Active>;
+
+#endif // EINK_PANEL_H
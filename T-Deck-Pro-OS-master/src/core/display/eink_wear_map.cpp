@@ -0,0 +1,98 @@
+/**
+ * @file eink_wear_map.cpp
+ * @brief Tile based pixel wear tracking implementation
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ */
+
+#include "eink_wear_map.h"
+#include "../utils/logger.h"
+#include <Arduino.h>
+#include <string.h>
+
+bool eink_wear_init(eink_wear_map_t* map, uint16_t width, uint16_t height) {
+    if (!map) {
+        return false;
+    }
+
+    memset(map, 0, sizeof(*map));
+    map->tiles_x = (width + EINK_WEAR_TILE_SIZE - 1) >> EINK_WEAR_TILE_SHIFT;
+    map->tiles_y = (height + EINK_WEAR_TILE_SIZE - 1) >> EINK_WEAR_TILE_SHIFT;
+
+    // Counters live in PSRAM; they are touched once per tile per update, not per pixel
+    size_t size = (size_t)map->tiles_x * map->tiles_y * sizeof(uint16_t);
+    map->counters = (uint16_t*)ps_malloc(size);
+    if (!map->counters) {
+        LOG_ERROR("Failed to allocate wear map (%d bytes)", (int)size);
+        return false;
+    }
+
+    memset(map->counters, 0, size);
+    return true;
+}
+
+void eink_wear_deinit(eink_wear_map_t* map) {
+    if (map && map->counters) {
+        free(map->counters);
+        map->counters = NULL;
+    }
+}
+
+bool eink_wear_record_area(eink_wear_map_t* map, const lv_area_t* area) {
+    if (!map || !map->counters || !area) {
+        return false;
+    }
+
+    int32_t max_x = map->tiles_x * EINK_WEAR_TILE_SIZE - 1;
+    int32_t max_y = map->tiles_y * EINK_WEAR_TILE_SIZE - 1;
+    int32_t x1 = area->x1 < 0 ? 0 : area->x1;
+    int32_t y1 = area->y1 < 0 ? 0 : area->y1;
+    int32_t x2 = area->x2 > max_x ? max_x : area->x2;
+    int32_t y2 = area->y2 > max_y ? max_y : area->y2;
+
+    if (x1 > x2 || y1 > y2) {
+        return false;
+    }
+
+    uint16_t tx1 = x1 >> EINK_WEAR_TILE_SHIFT;
+    uint16_t tx2 = x2 >> EINK_WEAR_TILE_SHIFT;
+    uint16_t ty1 = y1 >> EINK_WEAR_TILE_SHIFT;
+    uint16_t ty2 = y2 >> EINK_WEAR_TILE_SHIFT;
+    bool became_hot = false;
+
+    for (uint16_t ty = ty1; ty <= ty2; ty++) {
+        uint16_t* row = map->counters + (uint32_t)ty * map->tiles_x;
+        for (uint16_t tx = tx1; tx <= tx2; tx++) {
+            // Saturate at the limit so usage_sum stays bounded and the percentage tops out at 100
+            if (row[tx] < EINK_WEAR_LIMIT) {
+                row[tx]++;
+                map->usage_sum++;
+                if (row[tx] == EINK_WEAR_LIMIT) {
+                    map->hot_tiles++;
+                    became_hot = true;
+                }
+            }
+        }
+    }
+
+    return became_hot;
+}
+
+void eink_wear_reset(eink_wear_map_t* map) {
+    if (!map || !map->counters) {
+        return;
+    }
+
+    memset(map->counters, 0, (size_t)map->tiles_x * map->tiles_y * sizeof(uint16_t));
+    map->usage_sum = 0;
+    map->hot_tiles = 0;
+}
+
+float eink_wear_usage_percent(const eink_wear_map_t* map) {
+    if (!map || !map->counters) {
+        return 0.0f;
+    }
+
+    uint32_t max_possible = (uint32_t)map->tiles_x * map->tiles_y * EINK_WEAR_LIMIT;
+    return (float)map->usage_sum / max_possible * 100.0f;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file eink_wear_map.h
+ * @brief Tile based pixel wear tracking for burn-in prevention
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ */
+
+#ifndef EINK_WEAR_MAP_H
+#define EINK_WEAR_MAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lvgl.h"
+
+// ===== WEAR MAP CONFIGURATION =====
+#define EINK_WEAR_TILE_SHIFT 3                       // 8x8 pixel tiles
+#define EINK_WEAR_TILE_SIZE  (1 << EINK_WEAR_TILE_SHIFT)
+#define EINK_WEAR_LIMIT      1000                    // Updates before a tile needs maintenance
+
+typedef struct {
+    uint16_t* counters;         // Saturating per-tile update counters (PSRAM)
+    uint16_t tiles_x;           // Tiles per row
+    uint16_t tiles_y;           // Tile rows
+    uint32_t usage_sum;         // Sum of all counters, kept incrementally
+    uint32_t hot_tiles;         // Tiles that reached EINK_WEAR_LIMIT
+} eink_wear_map_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Allocate the wear map for a panel
+ * @param map Wear map to initialize
+ * @param width Panel width in pixels
+ * @param height Panel height in pixels
+ * @return true if the counters were allocated
+ */
+bool eink_wear_init(eink_wear_map_t* map, uint16_t width, uint16_t height);
+
+/**
+ * @brief Release the wear map counters
+ * @param map Wear map to release
+ */
+void eink_wear_deinit(eink_wear_map_t* map);
+
+/**
+ * @brief Count one update for every tile touched by an area
+ * @param map Wear map
+ * @param area Updated area in panel coordinates
+ * @return true if a tile reached EINK_WEAR_LIMIT during this update
+ */
+bool eink_wear_record_area(eink_wear_map_t* map, const lv_area_t* area);
+
+/**
+ * @brief Zero all counters, e.g. after a clear cycle
+ * @param map Wear map
+ */
+void eink_wear_reset(eink_wear_map_t* map);
+
+/**
+ * @brief Average wear across the panel relative to EINK_WEAR_LIMIT
+ * @param map Wear map
+ * @return Usage percentage (0-100), O(1)
+ */
+float eink_wear_usage_percent(const eink_wear_map_t* map);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EINK_WEAR_MAP_H
@@ -8,6 +8,12 @@
 #ifndef BOARD_CONFIG_H
 #define BOARD_CONFIG_H
 
+// ===== HARDWARE REVISION =====
+// Selects the profile in board_profile.h; the pins below are revision 1
+#ifndef BOARD_REVISION
+#define BOARD_REVISION 1
+#endif
+
 // ===== DISPLAY PINS (E-ink) =====
 #define BOARD_EPD_CS        10
 #define BOARD_EPD_DC        11
@@ -113,7 +119,7 @@
 #define BOARD_ENABLE_PSRAM      1
 #define BOARD_ENABLE_BLUETOOTH  1
 #define BOARD_ENABLE_WIFI       1
-#define BOARD_ENABLE_4G         1
+#define BOARD_ENABLE_4G         (BOARD_REVISION == 1)  // Revision 2 has no modem
 #define BOARD_ENABLE_LORA       1
 #define BOARD_ENABLE_SENSORS    1
 #define BOARD_ENABLE_AUDIO      1
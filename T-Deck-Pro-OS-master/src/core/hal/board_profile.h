@@ -0,0 +1,115 @@
+/**
+ * @file board_profile.h
+ * @brief Compile-time board profiles for each T-Deck-Pro hardware revision
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ *
+ * A profile is a struct of constexpr pin maps, bus settings and part
+ * choices. Driver facades (LoRaRadio, EinkPanel) take the profile as a
+ * template parameter, so the radio and panel types, pins and buffer sizes
+ * are fixed when the firmware is compiled and parts a revision does not
+ * have are removed with if constexpr rather than checked at run time.
+ *
+ * BOARD_REVISION selects the profile; each revision has its own
+ * PlatformIO environment. Revision 1 takes its pins from board_config.h,
+ * later revisions derive from it and override what changed.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "board_config.h"
+
+namespace TDeckOS {
+namespace Board {
+
+constexpr int8_t NO_PIN = -1;
+
+enum class RadioChip : uint8_t {
+    SX1262,                     // 150-960 MHz, +22 dBm
+    SX1268                      // 410-810 MHz, +22 dBm
+};
+
+enum class DisplayPanel : uint8_t {
+    GDEQ031T10                  // 3.1" 240x320, fast partial refresh
+};
+
+/**
+ * @brief LilyGo T-Deck-Pro, first revision, with A7682E modem
+ */
+struct TDeckPro {
+    static constexpr uint8_t REVISION = 1;
+    static constexpr const char* NAME = "T-Deck-Pro";
+
+    // SPI bus shared by the panel and the radio
+    struct Spi {
+        static constexpr int8_t SCK = BOARD_EPD_SCK;
+        static constexpr int8_t MOSI = BOARD_EPD_MOSI;
+        static constexpr int8_t MISO = BOARD_LORA_MISO;
+    };
+
+    struct Display {
+        static constexpr DisplayPanel PANEL = DisplayPanel::GDEQ031T10;
+        static constexpr int8_t CS = BOARD_EPD_CS;
+        static constexpr int8_t DC = BOARD_EPD_DC;
+        static constexpr int8_t RST = BOARD_EPD_RST;
+        static constexpr int8_t BUSY = BOARD_EPD_BUSY;
+        static constexpr uint32_t SPI_HZ = 10000000;
+        static constexpr uint8_t RESET_PULSE_MS = 2;        // Short pulse; the panel has no reset circuit
+        static constexpr uint8_t ROTATION = BOARD_EPD_ROTATION;
+    };
+
+    struct LoRa {
+        static constexpr RadioChip CHIP = RadioChip::SX1262;
+        static constexpr int8_t CS = BOARD_LORA_CS;
+        static constexpr int8_t IRQ = BOARD_LORA_DIO1;
+        static constexpr int8_t RST = BOARD_LORA_RST;
+        static constexpr int8_t BUSY = BOARD_LORA_BUSY;
+        static constexpr int8_t ENABLE = NO_PIN;            // On the 3V3 rail
+        static constexpr uint32_t SPI_HZ = 8000000;
+        static constexpr float TCXO_VOLTAGE = 2.4f;         // 0 for a plain crystal
+        static constexpr bool DIO2_RF_SWITCH = true;
+        static constexpr int8_t MAX_POWER_DBM = 22;         // PA and matching network limit
+    };
+
+    struct Modem {
+        static constexpr bool FITTED = true;
+        static constexpr int8_t TX = BOARD_MODEM_TX;        // ESP32 side
+        static constexpr int8_t RX = BOARD_MODEM_RX;
+        static constexpr int8_t PWRKEY = BOARD_MODEM_PWRKEY;
+        static constexpr int8_t POWER_ENABLE = BOARD_MODEM_PWR;
+        static constexpr int8_t RST = NO_PIN;
+        static constexpr int8_t DTR = BOARD_MODEM_DTR;
+        static constexpr int8_t RI = BOARD_MODEM_RI;
+    };
+};
+
+/**
+ * @brief Second revision: no cellular modem; everything else as revision 1
+ */
+struct TDeckProRev2 : TDeckPro {
+    static constexpr uint8_t REVISION = 2;
+    static constexpr const char* NAME = "T-Deck-Pro rev2";
+
+    struct Modem {
+        static constexpr bool FITTED = false;
+        static constexpr int8_t TX = NO_PIN;
+        static constexpr int8_t RX = NO_PIN;
+        static constexpr int8_t PWRKEY = NO_PIN;
+        static constexpr int8_t POWER_ENABLE = NO_PIN;
+        static constexpr int8_t RST = NO_PIN;
+        static constexpr int8_t DTR = NO_PIN;
+        static constexpr int8_t RI = NO_PIN;
+    };
+};
+
+#if BOARD_REVISION == 1
+using Active = TDeckPro;
+#elif BOARD_REVISION == 2
+using Active = TDeckProRev2;
+#else
+#error "Unknown BOARD_REVISION"
+#endif
+
+} // namespace Board
+} // namespace TDeckOS
@@ -0,0 +1,221 @@
+/**
+ * @file boot.cpp
+ * @brief Staged boot with concurrent subsystem bring-up and a boot timeline
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ */
+
+#include "boot.h"
+#include "../utils/logger.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
+#include <esp_timer.h>
+#include <esp_system.h>
+
+static_assert(BOOT_STAGE_COUNT <= 24, "Stage bits must fit a FreeRTOS event group");
+
+// ===== INTERNAL STATE =====
+typedef struct {
+    boot_stage_t stage;
+    boot_stage_fn_t fn;
+    void* arg;
+} boot_job_t;
+
+static const char* const stage_names[BOOT_STAGE_COUNT] = {
+    "hardware",
+    "filesystem",
+    "display",
+    "communication",
+    "modem",
+    "apps",
+    "services"
+};
+
+static boot_timeline_t timeline = {};
+static boot_job_t jobs[BOOT_STAGE_COUNT];
+static EventGroupHandle_t finished = NULL;
+static portMUX_TYPE boot_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool ready = false;
+
+static inline uint32_t boot_now_us(void) {
+    return (uint32_t)esp_timer_get_time();
+}
+
+static void stage_begin(boot_stage_t stage) {
+    portENTER_CRITICAL(&boot_lock);
+    boot_stage_record_t* record = &timeline.stages[stage];
+    record->state = BOOT_STATE_RUNNING;
+    record->core = (int8_t)xPortGetCoreID();
+    record->start_us = boot_now_us();
+    portEXIT_CRITICAL(&boot_lock);
+}
+
+static void stage_end(boot_stage_t stage, bool ok) {
+    portENTER_CRITICAL(&boot_lock);
+    boot_stage_record_t* record = &timeline.stages[stage];
+    record->state = ok ? BOOT_STATE_DONE : BOOT_STATE_FAILED;
+    record->end_us = boot_now_us();
+    bool late = ready;
+    boot_stage_record_t copy = *record;
+    portEXIT_CRITICAL(&boot_lock);
+
+    if (finished) {
+        xEventGroupSetBits(finished, BOOT_STAGE_BIT(stage));
+    }
+
+    // Background stages outlive setup(); report them as they land
+    if (late) {
+        LOG_INFO("Boot stage %s %s at %lu ms after %lu ms", stage_names[stage],
+                 ok ? "finished" : "failed", copy.end_us / 1000,
+                 (copy.end_us - copy.start_us) / 1000);
+    } else if (!ok) {
+        LOG_ERROR("Boot stage %s failed", stage_names[stage]);
+    }
+}
+
+static void boot_task(void* parameter) {
+    boot_job_t* job = (boot_job_t*)parameter;
+
+    stage_begin(job->stage);
+    bool ok = job->fn(job->arg);
+    stage_end(job->stage, ok);
+
+    vTaskDelete(NULL);
+}
+
+// ===== PUBLIC API =====
+
+void boot_init(void) {
+    timeline.reset_reason = (int)esp_reset_reason();
+
+    if (!finished) {
+        finished = xEventGroupCreate();
+    }
+}
+
+bool boot_is_cold_start(void) {
+    return timeline.reset_reason == ESP_RST_POWERON;
+}
+
+bool boot_run(boot_stage_t stage, boot_stage_fn_t fn, void* arg) {
+    if (stage >= BOOT_STAGE_COUNT || !fn) {
+        return false;
+    }
+
+    stage_begin(stage);
+    bool ok = fn(arg);
+    stage_end(stage, ok);
+    return ok;
+}
+
+bool boot_start(boot_stage_t stage, boot_stage_fn_t fn, void* arg, int core) {
+    if (stage >= BOOT_STAGE_COUNT || !fn) {
+        return false;
+    }
+
+    boot_job_t* job = &jobs[stage];
+    job->stage = stage;
+    job->fn = fn;
+    job->arg = arg;
+
+    BaseType_t result = xTaskCreatePinnedToCore(
+        boot_task,
+        stage_names[stage],
+        BOOT_TASK_STACK_SIZE,
+        job,
+        BOOT_TASK_PRIORITY,
+        NULL,
+        core == BOOT_CORE_ANY ? tskNO_AFFINITY : core
+    );
+
+    if (result != pdPASS) {
+        LOG_ERROR("Failed to create boot task for %s", stage_names[stage]);
+        stage_end(stage, false);
+        return false;
+    }
+    return true;
+}
+
+bool boot_wait(uint32_t stage_mask, uint32_t timeout_ms) {
+    if (!finished || stage_mask == 0) {
+        return false;
+    }
+
+    EventBits_t bits = xEventGroupWaitBits(finished, (EventBits_t)stage_mask, pdFALSE, pdTRUE,
+                                           pdMS_TO_TICKS(timeout_ms));
+
+    bool ok = true;
+    for (int stage = 0; stage < BOOT_STAGE_COUNT; stage++) {
+        if (!(stage_mask & BOOT_STAGE_BIT(stage))) {
+            continue;
+        }
+        if (!(bits & BOOT_STAGE_BIT(stage))) {
+            LOG_WARN("Boot stage %s still running after %lu ms", stage_names[stage], timeout_ms);
+            ok = false;
+        } else if (boot_get_state((boot_stage_t)stage) != BOOT_STATE_DONE) {
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+boot_state_t boot_get_state(boot_stage_t stage) {
+    if (stage >= BOOT_STAGE_COUNT) {
+        return BOOT_STATE_PENDING;
+    }
+
+    portENTER_CRITICAL(&boot_lock);
+    boot_state_t state = timeline.stages[stage].state;
+    portEXIT_CRITICAL(&boot_lock);
+    return state;
+}
+
+void boot_ready(void) {
+    portENTER_CRITICAL(&boot_lock);
+    timeline.ready_us = boot_now_us();
+    ready = true;
+    portEXIT_CRITICAL(&boot_lock);
+
+    boot_log_report();
+}
+
+void boot_get_timeline(boot_timeline_t* out) {
+    if (!out) {
+        return;
+    }
+
+    portENTER_CRITICAL(&boot_lock);
+    *out = timeline;
+    portEXIT_CRITICAL(&boot_lock);
+}
+
+void boot_log_report(void) {
+    static const char* const state_names[] = {"pending", "running", "done", "failed"};
+
+    boot_timeline_t copy;
+    boot_get_timeline(&copy);
+
+    LOG_INFO("Boot timeline (reset reason %d):", copy.reset_reason);
+    for (int stage = 0; stage < BOOT_STAGE_COUNT; stage++) {
+        const boot_stage_record_t* record = &copy.stages[stage];
+        if (record->state == BOOT_STATE_PENDING) {
+            continue;
+        }
+        if (record->state == BOOT_STATE_RUNNING) {
+            LOG_INFO("  %-13s core %d  %6lu ms  running", stage_names[stage], record->core,
+                     record->start_us / 1000);
+        } else {
+            LOG_INFO("  %-13s core %d  %6lu - %6lu ms  (%lu ms) %s", stage_names[stage], record->core,
+                     record->start_us / 1000, record->end_us / 1000,
+                     (record->end_us - record->start_us) / 1000, state_names[record->state]);
+        }
+    }
+    if (copy.ready_us) {
+        LOG_INFO("  Usable after %lu ms", copy.ready_us / 1000);
+    }
+}
+
+const char* boot_stage_name(boot_stage_t stage) {
+    return stage < BOOT_STAGE_COUNT ? stage_names[stage] : "unknown";
+}
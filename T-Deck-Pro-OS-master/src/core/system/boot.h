@@ -0,0 +1,142 @@
+/**
+ * @file boot.h
+ * @brief Staged boot with concurrent subsystem bring-up and a boot timeline
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ *
+ * setup() runs through a fixed set of stages. A stage either runs inline on
+ * the setup task or on a boot task of its own, pinned to a core, so that
+ * subsystems which do not depend on each other come up at the same time:
+ * the display (panel init and clear) on one core while the radios come up
+ * on the other, with the modem power-up sequence left running in the
+ * background past the end of setup(). Dependent stages wait for the ones
+ * they need with boot_wait().
+ *
+ * Every stage records when it started and finished, so the time from reset
+ * to a usable screen can be read from the timeline. boot_ready() marks that
+ * point and logs the report.
+ */
+
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ===== CONFIGURATION =====
+#ifndef BOOT_SERIAL_WAIT_MS
+#define BOOT_SERIAL_WAIT_MS 5000        // Wait for a serial monitor, after power-on resets only
+#endif
+
+#ifndef BOOT_STAGE_TIMEOUT_MS
+#define BOOT_STAGE_TIMEOUT_MS 30000     // boot_wait() gives up on a stage after this long
+#endif
+
+#define BOOT_TASK_STACK_SIZE 8192
+#define BOOT_TASK_PRIORITY 2            // Above the setup task so a waiting setup() never delays a stage
+#define BOOT_CORE_ANY (-1)
+
+// ===== STAGES =====
+typedef enum {
+    BOOT_STAGE_HARDWARE = 0,            // Board pins, power rails, battery check
+    BOOT_STAGE_FILESYSTEM,
+    BOOT_STAGE_DISPLAY,                 // Panel init, LVGL driver, background clear
+    BOOT_STAGE_COMMUNICATION,           // Message bus, LoRa, WiFi, modem UART
+    BOOT_STAGE_MODEM,                   // A7682E power-up and AT setup
+    BOOT_STAGE_APPS,                    // App registration; auto-start apps are deferred
+    BOOT_STAGE_SERVICES,                // OTA and power manager
+    BOOT_STAGE_COUNT
+} boot_stage_t;
+
+#define BOOT_STAGE_BIT(stage) (1UL << (stage))
+
+typedef enum {
+    BOOT_STATE_PENDING = 0,
+    BOOT_STATE_RUNNING,
+    BOOT_STATE_DONE,
+    BOOT_STATE_FAILED
+} boot_state_t;
+
+// ===== DATA STRUCTURES =====
+typedef struct {
+    boot_state_t state;
+    int8_t core;                        // Core the stage ran on
+    uint32_t start_us;                  // Since reset
+    uint32_t end_us;
+} boot_stage_record_t;
+
+typedef struct {
+    boot_stage_record_t stages[BOOT_STAGE_COUNT];
+    uint32_t ready_us;                  // boot_ready(), 0 before
+    int reset_reason;                   // esp_reset_reason_t of this boot
+} boot_timeline_t;
+
+// Stage body; runs on the setup task or a boot task
+typedef bool (*boot_stage_fn_t)(void* arg);
+
+// ===== FUNCTION DECLARATIONS =====
+
+/**
+ * @brief Start the timeline; first call in setup()
+ */
+void boot_init(void);
+
+/**
+ * @brief True after a power-on reset, false after a watchdog, panic or software reset
+ */
+bool boot_is_cold_start(void);
+
+/**
+ * @brief Run a stage on the calling task
+ * @return The stage's result
+ */
+bool boot_run(boot_stage_t stage, boot_stage_fn_t fn, void* arg);
+
+/**
+ * @brief Run a stage on a boot task of its own
+ * @param core 0, 1 or BOOT_CORE_ANY
+ * @return false if the task could not be created; the stage is marked failed
+ */
+bool boot_start(boot_stage_t stage, boot_stage_fn_t fn, void* arg, int core);
+
+/**
+ * @brief Block until every stage in the mask has finished
+ * @param stage_mask BOOT_STAGE_BIT() values or-ed together
+ * @param timeout_ms Upper bound, BOOT_STAGE_TIMEOUT_MS is a sensible default
+ * @return true if all of them finished and succeeded
+ */
+bool boot_wait(uint32_t stage_mask, uint32_t timeout_ms);
+
+/**
+ * @brief State of a stage
+ */
+boot_state_t boot_get_state(boot_stage_t stage);
+
+/**
+ * @brief Mark the screen usable and log the timeline
+ *
+ * Stages still running in the background are logged as they finish.
+ */
+void boot_ready(void);
+
+/**
+ * @brief Copy the timeline
+ */
+void boot_get_timeline(boot_timeline_t* timeline);
+
+/**
+ * @brief Log one line per stage and the time to boot_ready()
+ */
+void boot_log_report(void);
+
+const char* boot_stage_name(boot_stage_t stage);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BOOT_H
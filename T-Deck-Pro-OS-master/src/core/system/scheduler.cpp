@@ -0,0 +1,374 @@
+/**
+ * @file scheduler.cpp
+ * @brief Deadline-driven task scheduling and light sleep control
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ */
+
+#include "scheduler.h"
+#include "../hal/board_config.h"
+#include "../hal/board_profile.h"
+#include "../utils/logger.h"
+#include <sdkconfig.h>
+#include <esp_timer.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include <esp32-hal-cpu.h>
+
+#if defined(CONFIG_PM_ENABLE) && defined(CONFIG_FREERTOS_USE_TICKLESS_IDLE)
+#define SCHED_AUTO_LIGHT_SLEEP 1
+#include <esp_pm.h>
+#else
+#define SCHED_AUTO_LIGHT_SLEEP 0
+#endif
+
+static_assert(SCHED_MAX_SOURCES <= 32, "sched_wait() reports due sources as a 32-bit mask");
+
+// ===== INTERNAL STATE =====
+typedef struct {
+    const char* name;
+    TaskHandle_t owner;
+    uint32_t deadline;      // Absolute, in scheduler milliseconds
+    bool armed;
+    bool pending;           // Woken explicitly
+    bool waiting;           // Owner is blocked in sched_wait()
+} sched_source_entry_t;
+
+static sched_source_entry_t sources[SCHED_MAX_SOURCES];
+static uint8_t source_count = 0;
+static uint32_t wake_locks = 0;
+static TaskHandle_t idle_task = NULL;
+static sched_stats_t stats = {};
+static portMUX_TYPE sched_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool initialized = false;
+static uint32_t cpu_max_mhz = BOARD_CPU_FREQ;
+
+#if SCHED_AUTO_LIGHT_SLEEP
+static esp_pm_lock_handle_t pm_lock = NULL;
+#endif
+
+static inline uint32_t sched_now(void) {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+// Remaining time of an armed deadline, 0 once it has passed
+static inline uint32_t remaining_ms(const sched_source_entry_t* source, uint32_t now) {
+    int32_t left = (int32_t)(source->deadline - now);
+    return left > 0 ? (uint32_t)left : 0;
+}
+
+// Caller holds sched_lock
+static bool all_waiting_locked(void) {
+    for (uint8_t i = 0; i < source_count; i++) {
+        if (!sources[i].waiting || sources[i].pending) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Caller holds sched_lock
+static uint32_t time_to_next_locked(uint32_t now) {
+    uint32_t next = SCHED_NO_DEADLINE;
+    for (uint8_t i = 0; i < source_count; i++) {
+        if (sources[i].armed) {
+            uint32_t left = remaining_ms(&sources[i], now);
+            if (left < next) {
+                next = left;
+            }
+        }
+    }
+    return next;
+}
+
+bool sched_init(void) {
+    if (initialized) {
+        return true;
+    }
+
+    // Radio packet, modem ring and trackball click bring the chip out of light sleep
+    gpio_wakeup_enable((gpio_num_t)TDeckOS::Board::Active::LoRa::IRQ, GPIO_INTR_HIGH_LEVEL);
+    if constexpr (TDeckOS::Board::Active::Modem::FITTED) {
+        gpio_wakeup_enable((gpio_num_t)TDeckOS::Board::Active::Modem::RI, GPIO_INTR_LOW_LEVEL);
+    }
+    gpio_wakeup_enable((gpio_num_t)BOARD_TB_CLICK, GPIO_INTR_LOW_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+
+#if SCHED_AUTO_LIGHT_SLEEP
+    esp_pm_config_esp32s3_t pm_config = {
+        .max_freq_mhz = (int)cpu_max_mhz,
+        .min_freq_mhz = 80,
+        .light_sleep_enable = true
+    };
+    if (esp_pm_configure(&pm_config) != ESP_OK ||
+        esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "sched", &pm_lock) != ESP_OK) {
+        LOG_ERROR("Failed to enable automatic light sleep");
+        return false;
+    }
+    LOG_INFO("Scheduler using automatic light sleep");
+#else
+    LOG_INFO("Scheduler using explicit light sleep from idle hook");
+#endif
+
+    initialized = true;
+    return true;
+}
+
+sched_source_t sched_register(const char* name, TaskHandle_t owner) {
+    if (!owner) {
+        owner = xTaskGetCurrentTaskHandle();
+    }
+
+    portENTER_CRITICAL(&sched_lock);
+    if (source_count >= SCHED_MAX_SOURCES) {
+        portEXIT_CRITICAL(&sched_lock);
+        LOG_ERROR("Scheduler source table full, cannot register %s", name);
+        return SCHED_INVALID_SOURCE;
+    }
+
+    sched_source_t id = (sched_source_t)source_count;
+    sched_source_entry_t* source = &sources[source_count++];
+    source->name = name;
+    source->owner = owner;
+    source->deadline = 0;
+    source->armed = false;
+    source->pending = false;
+    source->waiting = false;
+    portEXIT_CRITICAL(&sched_lock);
+
+    LOG_DEBUG("Scheduler source %d registered: %s", id, name);
+    return id;
+}
+
+void sched_set_deadline(sched_source_t source, uint32_t delay_ms) {
+    if (source < 0 || source >= source_count) {
+        return;
+    }
+
+    portENTER_CRITICAL(&sched_lock);
+    sched_source_entry_t* entry = &sources[source];
+    entry->armed = delay_ms != SCHED_NO_DEADLINE;
+    entry->deadline = sched_now() + delay_ms;
+    TaskHandle_t owner = entry->owner;
+    portEXIT_CRITICAL(&sched_lock);
+
+    // A waiting owner re-plans its timeout around the new deadline
+    if (owner != xTaskGetCurrentTaskHandle()) {
+        xTaskNotifyGive(owner);
+    }
+}
+
+void sched_wake(sched_source_t source) {
+    if (source < 0 || source >= source_count) {
+        return;
+    }
+
+    portENTER_CRITICAL(&sched_lock);
+    sources[source].pending = true;
+    TaskHandle_t owner = sources[source].owner;
+    portEXIT_CRITICAL(&sched_lock);
+
+    xTaskNotifyGive(owner);
+}
+
+void sched_wake_from_isr(sched_source_t source, BaseType_t* woken) {
+    if (source < 0 || source >= source_count) {
+        return;
+    }
+
+    portENTER_CRITICAL_ISR(&sched_lock);
+    sources[source].pending = true;
+    TaskHandle_t owner = sources[source].owner;
+    portEXIT_CRITICAL_ISR(&sched_lock);
+
+    vTaskNotifyGiveFromISR(owner, woken);
+}
+
+uint32_t sched_wait(void) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    bool notified = false;
+
+    while (true) {
+        uint32_t due = 0;
+        uint32_t timeout = SCHED_NO_DEADLINE;
+        bool wake_idle = false;
+
+        portENTER_CRITICAL(&sched_lock);
+        uint32_t now = sched_now();
+        for (uint8_t i = 0; i < source_count; i++) {
+            sched_source_entry_t* source = &sources[i];
+            if (source->owner != self) {
+                continue;
+            }
+
+            if (source->pending || (source->armed && remaining_ms(source, now) == 0)) {
+                due |= 1UL << i;
+                source->pending = false;
+                source->armed = false;
+            } else if (source->armed) {
+                uint32_t left = remaining_ms(source, now);
+                if (left < timeout) {
+                    timeout = left;
+                }
+            }
+        }
+
+        for (uint8_t i = 0; i < source_count; i++) {
+            if (sources[i].owner == self) {
+                sources[i].waiting = due == 0;
+            }
+        }
+        if (due == 0) {
+            wake_idle = idle_task && all_waiting_locked();
+        } else if (notified) {
+            stats.notify_wakeups++;
+        } else {
+            stats.deadline_wakeups++;
+        }
+        portEXIT_CRITICAL(&sched_lock);
+
+        if (due) {
+            return due;
+        }
+
+        // The last task to settle lets the idle hook re-evaluate sleep
+        if (wake_idle) {
+            xTaskNotifyGive(idle_task);
+        }
+
+        TickType_t ticks = portMAX_DELAY;
+        if (timeout != SCHED_NO_DEADLINE) {
+            ticks = pdMS_TO_TICKS(timeout);
+            if (ticks == 0) {
+                ticks = 1;
+            }
+        }
+        notified = ulTaskNotifyTake(pdTRUE, ticks) > 0;
+    }
+}
+
+uint32_t sched_time_to_next(void) {
+    portENTER_CRITICAL(&sched_lock);
+    uint32_t next = time_to_next_locked(sched_now());
+    portEXIT_CRITICAL(&sched_lock);
+    return next;
+}
+
+void sched_wake_lock(void) {
+    portENTER_CRITICAL(&sched_lock);
+    wake_locks++;
+    portEXIT_CRITICAL(&sched_lock);
+
+#if SCHED_AUTO_LIGHT_SLEEP
+    if (pm_lock) {
+        esp_pm_lock_acquire(pm_lock);
+    }
+#endif
+}
+
+void sched_wake_unlock(void) {
+    portENTER_CRITICAL(&sched_lock);
+    bool released = wake_locks > 0 && --wake_locks == 0;
+    TaskHandle_t idle = idle_task;
+    portEXIT_CRITICAL(&sched_lock);
+
+#if SCHED_AUTO_LIGHT_SLEEP
+    if (pm_lock) {
+        esp_pm_lock_release(pm_lock);
+    }
+#endif
+
+    if (released && idle) {
+        xTaskNotifyGive(idle);
+    }
+}
+
+void sched_idle(uint32_t max_ms) {
+    portENTER_CRITICAL(&sched_lock);
+    idle_task = xTaskGetCurrentTaskHandle();
+    uint32_t wait = time_to_next_locked(sched_now());
+    bool can_sleep = initialized && all_waiting_locked();
+    bool locked = wake_locks > 0;
+    portEXIT_CRITICAL(&sched_lock);
+
+    if (wait > max_ms) {
+        wait = max_ms;
+    }
+
+#if !SCHED_AUTO_LIGHT_SLEEP
+    if (can_sleep && locked) {
+        stats.sleep_vetoes++;
+    } else if (can_sleep && wait >= SCHED_LIGHT_SLEEP_MIN_MS) {
+        // Everything registered is blocked; sleep until the earliest deadline or a wake pin
+        esp_sleep_enable_timer_wakeup((uint64_t)wait * 1000);
+        int64_t start = esp_timer_get_time();
+        esp_light_sleep_start();
+        stats.light_sleeps++;
+        stats.light_sleep_ms += (uint32_t)((esp_timer_get_time() - start) / 1000);
+
+        // The RTOS tick stood still while asleep; kick owners whose deadline expired meanwhile
+        TaskHandle_t owners[SCHED_MAX_SOURCES];
+        uint8_t owner_count = 0;
+        portENTER_CRITICAL(&sched_lock);
+        uint32_t now = sched_now();
+        for (uint8_t i = 0; i < source_count; i++) {
+            if (sources[i].armed && remaining_ms(&sources[i], now) == 0) {
+                owners[owner_count++] = sources[i].owner;
+            }
+        }
+        portEXIT_CRITICAL(&sched_lock);
+        for (uint8_t i = 0; i < owner_count; i++) {
+            xTaskNotifyGive(owners[i]);
+        }
+        return;
+    }
+#else
+    (void) can_sleep;
+    (void) locked;
+#endif
+
+    // Woken when the last registered task settles or a wake lock is dropped
+    ulTaskNotifyTake(pdTRUE, wait ? pdMS_TO_TICKS(wait) : 1);
+}
+
+bool sched_set_cpu_freq(uint32_t max_mhz) {
+    if (max_mhz != 80 && max_mhz != 160 && max_mhz != 240) {
+        return false;
+    }
+    if (max_mhz == cpu_max_mhz) {
+        return true;
+    }
+
+#if SCHED_AUTO_LIGHT_SLEEP
+    esp_pm_config_esp32s3_t pm_config = {
+        .max_freq_mhz = (int)max_mhz,
+        .min_freq_mhz = 80,
+        .light_sleep_enable = true
+    };
+    if (esp_pm_configure(&pm_config) != ESP_OK) {
+        return false;
+    }
+#else
+    if (!setCpuFrequencyMhz(max_mhz)) {
+        return false;
+    }
+#endif
+
+    cpu_max_mhz = max_mhz;
+    LOG_INFO("CPU clock limited to %u MHz", (unsigned)max_mhz);
+    return true;
+}
+
+uint32_t sched_get_cpu_freq(void) {
+    return cpu_max_mhz;
+}
+
+void sched_get_stats(sched_stats_t* out) {
+    if (!out) {
+        return;
+    }
+
+    portENTER_CRITICAL(&sched_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&sched_lock);
+}
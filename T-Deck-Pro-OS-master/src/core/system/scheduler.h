@@ -0,0 +1,130 @@
+/**
+ * @file scheduler.h
+ * @brief Deadline-driven task scheduling and light sleep control
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ *
+ * Subsystems register a source and tell the scheduler when they next need
+ * to run. The owning task blocks in sched_wait() until the earliest of its
+ * deadlines expires or another task or ISR wakes one of its sources. When
+ * every registered task is waiting and no wake lock is held, sched_idle()
+ * puts the chip into light sleep until the earliest deadline or a wake pin.
+ *
+ * If the SDK has power management and tickless idle enabled, the idle task
+ * enters light sleep on its own and wake locks map to PM locks.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// ===== CONFIGURATION =====
+#ifndef SCHED_MAX_SOURCES
+#define SCHED_MAX_SOURCES 16
+#endif
+
+#ifndef SCHED_LIGHT_SLEEP_MIN_MS
+#define SCHED_LIGHT_SLEEP_MIN_MS 20     // Shorter gaps are not worth the wake-up cost
+#endif
+
+#define SCHED_NO_DEADLINE UINT32_MAX
+#define SCHED_INVALID_SOURCE (-1)
+
+typedef int8_t sched_source_t;
+
+// ===== STATISTICS =====
+typedef struct {
+    uint32_t deadline_wakeups;      // sched_wait() returned because a deadline expired
+    uint32_t notify_wakeups;        // sched_wait() returned because a source was woken
+    uint32_t light_sleeps;
+    uint32_t light_sleep_ms;        // Total time spent in light sleep
+    uint32_t sleep_vetoes;          // Idle passes where a wake lock prevented sleep
+} sched_stats_t;
+
+// ===== FUNCTION DECLARATIONS =====
+
+/**
+ * @brief Initialize the scheduler and configure wake-up sources
+ * @return true if initialization successful
+ */
+bool sched_init(void);
+
+/**
+ * @brief Register a deadline source
+ * @param name Name for diagnostics, must outlive the source
+ * @param owner Task that waits for the source, NULL for the calling task
+ * @return Source id, SCHED_INVALID_SOURCE if the table is full
+ */
+sched_source_t sched_register(const char* name, TaskHandle_t owner);
+
+/**
+ * @brief Set when a source next needs to run
+ * @param source Source id
+ * @param delay_ms Milliseconds from now, SCHED_NO_DEADLINE to clear
+ *
+ * Deadlines are one-shot; sched_wait() clears them as it reports them.
+ * Setting a deadline from another task wakes the owner so it can re-plan.
+ */
+void sched_set_deadline(sched_source_t source, uint32_t delay_ms);
+
+/**
+ * @brief Mark a source due now and wake its owner
+ */
+void sched_wake(sched_source_t source);
+
+/**
+ * @brief ISR variant of sched_wake()
+ * @param woken Set to pdTRUE if a context switch is needed
+ */
+void sched_wake_from_isr(sched_source_t source, BaseType_t* woken);
+
+/**
+ * @brief Block the calling task until one of its sources is due
+ * @return Bit mask of due sources (bit n = source n)
+ */
+uint32_t sched_wait(void);
+
+/**
+ * @brief Milliseconds until the earliest deadline of any source
+ * @return SCHED_NO_DEADLINE if none is set
+ */
+uint32_t sched_time_to_next(void);
+
+/**
+ * @brief Prevent light sleep, e.g. during a panel refresh or while WiFi is associated
+ *
+ * Calls nest; every sched_wake_lock() needs a matching sched_wake_unlock().
+ */
+void sched_wake_lock(void);
+void sched_wake_unlock(void);
+
+/**
+ * @brief Idle hook for the lowest priority task
+ * @param max_ms Upper bound on the time spent here
+ *
+ * Light sleeps when allowed, otherwise blocks until the earliest deadline.
+ */
+void sched_idle(uint32_t max_ms);
+
+/**
+ * @brief Set the highest CPU clock
+ * @param max_mhz 80, 160 or 240
+ * @return true if applied
+ *
+ * With automatic light sleep the clock drops to 80 MHz whenever nothing
+ * needs it and rises to max_mhz under load; otherwise the CPU runs at
+ * max_mhz throughout.
+ */
+bool sched_set_cpu_freq(uint32_t max_mhz);
+uint32_t sched_get_cpu_freq(void);
+
+/**
+ * @brief Copy the scheduler statistics
+ */
+void sched_get_stats(sched_stats_t* stats);
+
+#endif // SCHEDULER_H
@@ -0,0 +1,280 @@
+#include "virtual_list.h"
+#include "../utils/logger.h"
+#include <string.h>
+
+#define HIDDEN_POSITION 0xFF
+
+VirtualList::VirtualList()
+    : container(nullptr)
+    , adapter(nullptr)
+    , rowHeight(0)
+    , rows{}
+    , rowCount(0)
+    , first(0)
+    , selected(NO_SELECTION)
+    , itemCount(0)
+    , bindCount(0)
+{
+}
+
+VirtualList::~VirtualList() {
+    destroy();
+}
+
+bool VirtualList::create(lv_obj_t* parent, VirtualListAdapter* listAdapter, lv_coord_t height) {
+    destroy();
+    if (!parent || !listAdapter || height <= 0) {
+        return false;
+    }
+
+    adapter = listAdapter;
+    rowHeight = height;
+    first = 0;
+    selected = NO_SELECTION;
+
+    // Rows are positioned by hand, so the container never scrolls itself
+    container = lv_obj_create(parent);
+    lv_obj_set_size(container, LV_PCT(100), LV_PCT(100));
+    lv_obj_clear_flag(container, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_set_style_pad_all(container, 0, 0);
+    lv_obj_set_style_border_width(container, 0, 0);
+    lv_obj_add_event_cb(container, onSizeChanged, LV_EVENT_SIZE_CHANGED, this);
+    lv_obj_add_event_cb(container, onDeleted, LV_EVENT_DELETE, this);
+
+    buildRows();
+    refresh();
+    return true;
+}
+
+void VirtualList::destroy() {
+    if (container) {
+        // onDeleted clears the pointers
+        lv_obj_del(container);
+    }
+    container = nullptr;
+    rowCount = 0;
+}
+
+void VirtualList::buildRows() {
+    clearRows();
+
+    lv_obj_update_layout(container);
+    lv_coord_t height = lv_obj_get_content_height(container);
+    uint32_t count = height > 0 ? (uint32_t)height / rowHeight : 0;
+    if (count == 0) count = 1;
+    if (count > MAX_ROWS) {
+        LOG_WARN_TAG("VirtualList", "%u rows fit, using %u", (unsigned)count, MAX_ROWS);
+        count = MAX_ROWS;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        Row& row = rows[i];
+        row.obj = lv_obj_create(container);
+        lv_obj_set_size(row.obj, LV_PCT(100), rowHeight);
+        lv_obj_clear_flag(row.obj, LV_OBJ_FLAG_SCROLLABLE);
+        lv_obj_set_style_radius(row.obj, 0, 0);
+        lv_obj_set_style_border_width(row.obj, 0, 0);
+        lv_obj_set_style_border_width(row.obj, 2, LV_STATE_CHECKED);
+        lv_obj_set_style_border_side(row.obj, LV_BORDER_SIDE_LEFT, LV_STATE_CHECKED);
+        lv_obj_add_flag(row.obj, LV_OBJ_FLAG_HIDDEN);
+        row.position = HIDDEN_POSITION;
+        row.bound = false;
+        row.selected = false;
+        adapter->createRow(row.obj);
+    }
+    rowCount = count;
+}
+
+void VirtualList::clearRows() {
+    for (uint8_t i = 0; i < rowCount; i++) {
+        if (rows[i].obj) {
+            lv_obj_del(rows[i].obj);
+        }
+        rows[i] = Row{};
+    }
+    rowCount = 0;
+}
+
+void VirtualList::invalidateAll() {
+    for (uint8_t i = 0; i < rowCount; i++) {
+        rows[i].bound = false;
+    }
+}
+
+uint32_t VirtualList::maxFirst() const {
+    return itemCount > rowCount ? itemCount - rowCount : 0;
+}
+
+void VirtualList::refresh() {
+    if (!container || !adapter) {
+        return;
+    }
+
+    itemCount = adapter->getItemCount();
+    if (first > maxFirst()) {
+        first = maxFirst();
+    }
+    if (selected != NO_SELECTION && selected >= itemCount) {
+        selected = itemCount ? itemCount - 1 : NO_SELECTION;
+    }
+
+    uint32_t visible = itemCount - first;
+    if (visible > rowCount) visible = rowCount;
+    if (visible > 0) {
+        adapter->prepare(first, visible);
+    }
+
+    uint32_t keys[MAX_ROWS];
+    uint8_t assigned[MAX_ROWS];
+    bool used[MAX_ROWS] = {};
+
+    // Rows that already show a visible item keep it, wherever it moved to
+    for (uint32_t p = 0; p < visible; p++) {
+        keys[p] = adapter->getItemKey(first + p);
+        assigned[p] = HIDDEN_POSITION;
+        for (uint8_t r = 0; r < rowCount; r++) {
+            if (!used[r] && rows[r].bound && rows[r].key == keys[p]) {
+                assigned[p] = r;
+                used[r] = true;
+                break;
+            }
+        }
+    }
+
+    // The remaining items take over rows whose items scrolled away
+    uint8_t spare = 0;
+    for (uint32_t p = 0; p < visible; p++) {
+        if (assigned[p] != HIDDEN_POSITION) {
+            continue;
+        }
+        while (used[spare]) spare++;
+        assigned[p] = spare;
+        used[spare] = true;
+        rows[spare].bound = false;
+    }
+
+    for (uint32_t p = 0; p < visible; p++) {
+        Row& row = rows[assigned[p]];
+        uint32_t index = first + p;
+        uint32_t version = adapter->getItemVersion(index);
+        if (!row.bound || row.version != version) {
+            adapter->bindRow(row.obj, index);
+            row.key = keys[p];
+            row.version = version;
+            row.bound = true;
+            bindCount++;
+        }
+        showRow(row, p);
+
+        bool isSelected = index == selected;
+        if (row.selected != isSelected) {
+            if (isSelected) {
+                lv_obj_add_state(row.obj, LV_STATE_CHECKED);
+            } else {
+                lv_obj_clear_state(row.obj, LV_STATE_CHECKED);
+            }
+            row.selected = isSelected;
+        }
+    }
+
+    // Spare rows keep their binding, so an item that comes back into view can reuse its row
+    for (uint8_t r = 0; r < rowCount; r++) {
+        if (!used[r]) {
+            hideRow(rows[r]);
+        }
+    }
+}
+
+void VirtualList::showRow(Row& row, uint8_t position) {
+    if (row.position == position) {
+        return;
+    }
+    lv_obj_set_y(row.obj, position * rowHeight);
+    if (row.position == HIDDEN_POSITION) {
+        lv_obj_clear_flag(row.obj, LV_OBJ_FLAG_HIDDEN);
+    }
+    row.position = position;
+}
+
+void VirtualList::hideRow(Row& row) {
+    if (row.position == HIDDEN_POSITION) {
+        return;
+    }
+    lv_obj_add_flag(row.obj, LV_OBJ_FLAG_HIDDEN);
+    row.position = HIDDEN_POSITION;
+}
+
+void VirtualList::scrollTo(uint32_t index) {
+    first = index;
+    refresh();
+}
+
+void VirtualList::scrollBy(int32_t delta) {
+    if (delta < 0 && (uint32_t)-delta > first) {
+        first = 0;
+    } else {
+        first += delta;
+    }
+    refresh();
+}
+
+void VirtualList::ensureVisible(uint32_t index) {
+    if (index < first) {
+        first = index;
+    } else if (index >= first + rowCount) {
+        first = index - rowCount + 1;
+    }
+}
+
+void VirtualList::setSelected(uint32_t index) {
+    selected = index;
+    if (index != NO_SELECTION) {
+        ensureVisible(index);
+    }
+    refresh();
+}
+
+void VirtualList::selectNext() {
+    if (itemCount == 0) {
+        return;
+    }
+    setSelected(selected == NO_SELECTION ? first : (selected + 1 < itemCount ? selected + 1 : selected));
+}
+
+void VirtualList::selectPrevious() {
+    if (itemCount == 0) {
+        return;
+    }
+    setSelected(selected == NO_SELECTION ? first : (selected > 0 ? selected - 1 : 0));
+}
+
+void VirtualList::setLabelText(lv_obj_t* label, const char* text) {
+    const char* current = lv_label_get_text(label);
+    if (current && strcmp(current, text) == 0) {
+        return;
+    }
+    lv_label_set_text(label, text);
+}
+
+void VirtualList::onSizeChanged(lv_event_t* e) {
+    VirtualList* list = static_cast<VirtualList*>(lv_event_get_user_data(e));
+    uint8_t previous = list->rowCount;
+    lv_coord_t height = lv_obj_get_content_height(list->container);
+    uint32_t fits = height > 0 ? (uint32_t)height / list->rowHeight : 1;
+    if (fits == 0) fits = 1;
+    if (fits > MAX_ROWS) fits = MAX_ROWS;
+    if (fits != previous) {
+        list->buildRows();
+        list->refresh();
+    }
+}
+
+void VirtualList::onDeleted(lv_event_t* e) {
+    // The parent screen was deleted; its children, the rows, go with it
+    VirtualList* list = static_cast<VirtualList*>(lv_event_get_user_data(e));
+    list->container = nullptr;
+    for (uint8_t i = 0; i < list->rowCount; i++) {
+        list->rows[i] = Row{};
+    }
+    list->rowCount = 0;
+}
@@ -0,0 +1,126 @@
+#ifndef VIRTUAL_LIST_H
+#define VIRTUAL_LIST_H
+
+#include <Arduino.h>
+#include <lvgl.h>
+
+/**
+ * @brief Data source for a VirtualList
+ *
+ * Items are addressed by position. The key identifies an item across
+ * refreshes so its row can follow it when items move; the version changes
+ * whenever anything the row shows changes.
+ */
+class VirtualListAdapter {
+public:
+    virtual ~VirtualListAdapter() {}
+
+    virtual uint32_t getItemCount() = 0;
+
+    // Called before the visible window is read, e.g. to load one page from flash
+    virtual void prepare(uint32_t /*first*/, uint32_t /*count*/) {}
+
+    virtual uint32_t getItemKey(uint32_t index) = 0;
+    virtual uint32_t getItemVersion(uint32_t index) = 0;
+
+    // Builds a row's children once; bindRow fills them for an item
+    virtual void createRow(lv_obj_t* row) = 0;
+    virtual void bindRow(lv_obj_t* row, uint32_t index) = 0;
+};
+
+/**
+ * @brief Fixed-height list that only keeps the visible rows
+ *
+ * A pool of row objects just large enough to fill the container is created
+ * once. On refresh each visible item is matched to the row already showing
+ * its key, so scrolling and insertions move rows instead of rebuilding them,
+ * and a row is rebound only when it shows a new item or its version changed.
+ * Labels are only written when their text differs. Together this keeps LVGL
+ * invalidation, and with it the e-ink partial refresh, to the rows that
+ * actually changed.
+ */
+class VirtualList {
+public:
+    static constexpr uint32_t NO_SELECTION = UINT32_MAX;
+    static constexpr uint8_t MAX_ROWS = 16;
+
+    VirtualList();
+    ~VirtualList();
+
+    /**
+     * @brief Create the list as a child of parent, filling it
+     * @param adapter Data source; must outlive the list
+     * @param rowHeight Height of every row in pixels
+     * @return true if successful, false otherwise
+     */
+    bool create(lv_obj_t* parent, VirtualListAdapter* adapter, lv_coord_t rowHeight);
+    void destroy();
+
+    /**
+     * @brief Bring the visible rows up to date with the adapter
+     */
+    void refresh();
+
+    /**
+     * @brief Rebind every visible row on the next refresh
+     */
+    void invalidateAll();
+
+    // Scrolling by whole rows; each call refreshes
+    void scrollTo(uint32_t first);
+    void scrollBy(int32_t rows);
+    void pageUp() { scrollBy(-(int32_t)getVisibleRows()); }
+    void pageDown() { scrollBy(getVisibleRows()); }
+
+    // Highlighted item, kept in view
+    void setSelected(uint32_t index);
+    void selectNext();
+    void selectPrevious();
+    uint32_t getSelected() const { return selected; }
+
+    uint32_t getFirstVisible() const { return first; }
+    uint8_t getVisibleRows() const { return rowCount; }
+    uint32_t getItemCount() const { return itemCount; }
+    uint32_t getBindCount() const { return bindCount; }
+    lv_obj_t* getContainer() const { return container; }
+
+    /**
+     * @brief Set a label's text unless it already shows it
+     *
+     * lv_label_set_text() invalidates the label even when the text is
+     * unchanged; row binders should use this instead.
+     */
+    static void setLabelText(lv_obj_t* label, const char* text);
+
+private:
+    struct Row {
+        lv_obj_t* obj;
+        uint32_t key;
+        uint32_t version;
+        uint8_t position;       // Visible position, 0xFF when hidden
+        bool bound;
+        bool selected;
+    };
+
+    lv_obj_t* container;
+    VirtualListAdapter* adapter;
+    lv_coord_t rowHeight;
+    Row rows[MAX_ROWS];
+    uint8_t rowCount;
+    uint32_t first;
+    uint32_t selected;
+    uint32_t itemCount;
+    uint32_t bindCount;
+
+    void buildRows();
+    void clearRows();
+    uint32_t maxFirst() const;
+    void ensureVisible(uint32_t index);
+    void showRow(Row& row, uint8_t position);
+    void hideRow(Row& row);
+
+    static void onSizeChanged(lv_event_t* e);
+    static void onDeleted(lv_event_t* e);
+};
+
+#endif // VIRTUAL_LIST_H
@@ -0,0 +1,697 @@
+/**
+ * @file logger.cpp
+ * @brief Logging system implementation: per-core record rings and a drain task
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ */
+
+#include "logger.h"
+#include "../system/scheduler.h"
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
+
+static_assert((LOG_RING_SLOTS & (LOG_RING_SLOTS - 1)) == 0, "LOG_RING_SLOTS must be a power of two");
+static_assert(offsetof(log_record_t, strings) == offsetof(log_record_t, words) + sizeof(((log_record_t*)0)->words),
+              "preformatted text spans words[] and strings[]");
+
+#define LOG_TEXT_CAPACITY (sizeof(((log_record_t*)0)->words) + sizeof(((log_record_t*)0)->strings))
+#define LOG_LINE_SIZE (LOG_MAX_MESSAGE_SIZE + 64)
+#define LOG_PERF_TIMERS 8
+
+volatile uint8_t log_runtime_level = DEFAULT_LOG_LEVEL;
+
+// ===== RECORD RINGS =====
+// Bounded multi-producer ring with one consumer (the drain task). Every slot
+// carries a sequence number; sequences are stored relative to the slot index
+// so the zero-initialized ring is valid before log_init() runs.
+typedef struct {
+    std::atomic<uint32_t> sequence;
+    log_record_t record;
+} log_slot_t;
+
+typedef struct {
+    log_slot_t slots[LOG_RING_SLOTS];
+    std::atomic<uint32_t> head;     // Next position to reserve
+    std::atomic<uint32_t> tail;     // Next position to drain
+} log_ring_t;
+
+static log_ring_t rings[portNUM_PROCESSORS];
+static std::atomic<uint32_t> dropped_count(0);
+
+// ===== CONFIGURATION STATE =====
+static log_config_t config = {
+    .level = DEFAULT_LOG_LEVEL,
+    .destinations = LOG_DEST_SERIAL,
+    .include_timestamp = true,
+    .include_function = true,
+    .include_line_number = false,
+    .color_output = false,
+    .log_file_path = NULL,
+    .buffer_size = LOG_BUFFER_SIZE,
+    .binary_file = false
+};
+static log_network_hook_t network_hook = NULL;
+static TaskHandle_t drain_task_handle = NULL;
+static bool initialized = false;
+
+// ===== FORMATTED HISTORY (LOG_DEST_BUFFER) =====
+static log_entry_t* history = NULL;
+static uint16_t history_capacity = 0;
+static uint16_t history_head = 0;
+static uint16_t history_count = 0;
+static portMUX_TYPE history_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// ===== PERFORMANCE TIMERS =====
+typedef struct {
+    const char* tag;
+    int64_t start_us;
+    bool in_use;
+} log_perf_timer_t;
+
+static log_perf_timer_t perf_timers[LOG_PERF_TIMERS];
+static portMUX_TYPE perf_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static inline uint32_t slot_index(uint32_t position) {
+    return position & (LOG_RING_SLOTS - 1);
+}
+
+// Push results
+#define RING_FULL    0
+#define RING_QUEUED  1
+#define RING_WAKE    2      // Queued into an empty ring
+
+static int ring_push(log_ring_t* ring, const log_record_t* record) {
+    uint32_t position = ring->head.load(std::memory_order_relaxed);
+    log_slot_t* slot;
+
+    while (true) {
+        slot = &ring->slots[slot_index(position)];
+        uint32_t sequence = slot->sequence.load(std::memory_order_acquire) + slot_index(position);
+        int32_t diff = (int32_t)(sequence - position);
+        if (diff == 0) {
+            if (ring->head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return RING_FULL;   // The consumer has not freed this slot yet
+        } else {
+            position = ring->head.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->record = *record;
+    slot->sequence.store(position + 1 - slot_index(position), std::memory_order_release);
+
+    // Only the record that makes the ring non-empty needs to wake the drain task
+    return position == ring->tail.load(std::memory_order_relaxed) ? RING_WAKE : RING_QUEUED;
+}
+
+static bool ring_pop(log_ring_t* ring, log_record_t* record) {
+    uint32_t position = ring->tail.load(std::memory_order_relaxed);
+    log_slot_t* slot = &ring->slots[slot_index(position)];
+    uint32_t sequence = slot->sequence.load(std::memory_order_acquire) + slot_index(position);
+    if ((int32_t)(sequence - (position + 1)) < 0) {
+        return false;
+    }
+
+    *record = slot->record;
+    slot->sequence.store(position + LOG_RING_SLOTS - slot_index(position), std::memory_order_release);
+    ring->tail.store(position + 1, std::memory_order_relaxed);
+    return true;
+}
+
+static bool rings_idle(void) {
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        if (rings[i].head.load(std::memory_order_relaxed) != rings[i].tail.load(std::memory_order_relaxed)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool log_submit(const log_record_t* record) {
+    int result = ring_push(&rings[xPortGetCoreID()], record);
+    if (result == RING_FULL) {
+        dropped_count.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    if (result == RING_WAKE) {
+        TaskHandle_t drain = drain_task_handle;
+        if (drain) {
+            if (xPortInIsrContext()) {
+                BaseType_t woken = pdFALSE;
+                vTaskNotifyGiveFromISR(drain, &woken);
+                if (woken) {
+                    portYIELD_FROM_ISR();
+                }
+            } else {
+                xTaskNotifyGive(drain);
+            }
+        }
+    }
+    return true;
+}
+
+// ===== FORMATTING =====
+
+static inline char* record_text(log_record_t* record) {
+    return reinterpret_cast<char*>(record->words);
+}
+
+// Copy a conversion spec without its length modifier and append a new one
+static void rebuild_spec(char* out, size_t size, const char* spec, size_t spec_length,
+                         const char* length, char conversion) {
+    size_t n = 0;
+    for (size_t i = 0; i < spec_length && n + 4 < size; i++) {
+        if (!strchr("hlLqjzt", spec[i])) {
+            out[n++] = spec[i];
+        }
+    }
+    while (*length && n + 2 < size) {
+        out[n++] = *length++;
+    }
+    out[n++] = conversion;
+    out[n] = '\0';
+}
+
+static size_t format_message(const log_record_t* record, char* out, size_t size) {
+    if (record->flags & LOG_RECORD_FORMATTED) {
+        return snprintf(out, size, "%.*s", (int)LOG_TEXT_CAPACITY, (const char*)record->words);
+    }
+
+    const char* p = record->format;
+    size_t n = 0;
+    uint8_t arg = 0;
+    uint8_t word = 0;
+
+    while (*p && n + 1 < size) {
+        if (*p != '%') {
+            out[n++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[n++] = '%';
+            p += 2;
+            continue;
+        }
+
+        // Flags, width, precision and length up to the conversion character
+        const char* spec = p++;
+        while (*p && strchr("-+ #0123456789.hlLqjzt", *p)) {
+            p++;
+        }
+        if (!*p) {
+            break;
+        }
+        char conversion = *p++;
+        size_t spec_length = (size_t)(p - spec - 1);
+
+        if (arg >= record->arg_count) {
+            out[n++] = '?';
+            continue;
+        }
+
+        char fmt[24];
+        int written = 0;
+        uint8_t type = (record->arg_types >> (arg * 2)) & 0x3;
+        arg++;
+
+        switch (type) {
+            case LOG_ARG_STRING: {
+                uint32_t offset = record->words[word++];
+                const char* value = offset < LOG_STRING_BYTES ? record->strings + offset : "";
+                rebuild_spec(fmt, sizeof(fmt), spec, spec_length, "", 's');
+                written = snprintf(out + n, size - n, fmt, value);
+                break;
+            }
+            case LOG_ARG_DOUBLE: {
+                double value;
+                memcpy(&value, &record->words[word], sizeof(value));
+                word += 2;
+                rebuild_spec(fmt, sizeof(fmt), spec, spec_length, "",
+                             strchr("fFeEgGaA", conversion) ? conversion : 'g');
+                written = snprintf(out + n, size - n, fmt, value);
+                break;
+            }
+            case LOG_ARG_U64: {
+                uint64_t value;
+                memcpy(&value, &record->words[word], sizeof(value));
+                word += 2;
+                rebuild_spec(fmt, sizeof(fmt), spec, spec_length, "ll",
+                             strchr("diouxX", conversion) ? conversion : 'u');
+                written = snprintf(out + n, size - n, fmt, (unsigned long long)value);
+                break;
+            }
+            case LOG_ARG_U32:
+            default: {
+                uint32_t value = record->words[word++];
+                if (conversion == 'p') {
+                    rebuild_spec(fmt, sizeof(fmt), spec, spec_length, "", 'p');
+                    written = snprintf(out + n, size - n, fmt, (void*)(uintptr_t)value);
+                } else if (conversion == 'c') {
+                    rebuild_spec(fmt, sizeof(fmt), spec, spec_length, "", 'c');
+                    written = snprintf(out + n, size - n, fmt, (int)value);
+                } else {
+                    // int, long and size_t are all 32 bits here
+                    rebuild_spec(fmt, sizeof(fmt), spec, spec_length, "",
+                                 strchr("diouxX", conversion) ? conversion : 'u');
+                    written = snprintf(out + n, size - n, fmt, value);
+                }
+                break;
+            }
+        }
+
+        if (written > 0) {
+            n += (size_t)written < size - n ? (size_t)written : size - n - 1;
+        }
+    }
+
+    out[n] = '\0';
+    return n;
+}
+
+static size_t format_line(const log_record_t* record, const char* message, char* out, size_t size) {
+    log_level_t level = (log_level_t)record->level;
+    size_t n = 0;
+
+    if (config.color_output) {
+        n += snprintf(out + n, size - n, "%s", log_level_to_color(level));
+    }
+    if (config.include_timestamp && n < size) {
+        n += snprintf(out + n, size - n, "[%lu] ", (unsigned long)record->timestamp);
+    }
+    if (n < size) {
+        n += snprintf(out + n, size - n, "%-5s ", log_level_to_string(level));
+    }
+    if (record->tag && n < size) {
+        n += snprintf(out + n, size - n, "[%s] ", record->tag);
+    }
+    if (config.include_function && record->function && n < size) {
+        if (config.include_line_number) {
+            n += snprintf(out + n, size - n, "%s:%u: ", record->function, record->line);
+        } else {
+            n += snprintf(out + n, size - n, "%s: ", record->function);
+        }
+    }
+    if (n < size) {
+        n += snprintf(out + n, size - n, "%s%s\r\n", message, config.color_output ? "\033[0m" : "");
+    }
+    return n < size ? n : size - 1;
+}
+
+static void store_history(const log_record_t* record, const char* message) {
+    if (!history) {
+        return;
+    }
+
+    portENTER_CRITICAL(&history_lock);
+    log_entry_t* entry = &history[history_head];
+    entry->timestamp = record->timestamp;
+    entry->level = (log_level_t)record->level;
+    strncpy(entry->tag, record->tag ? record->tag : "", LOG_MAX_TAG_SIZE - 1);
+    entry->tag[LOG_MAX_TAG_SIZE - 1] = '\0';
+    strncpy(entry->function, record->function ? record->function : "", sizeof(entry->function) - 1);
+    entry->function[sizeof(entry->function) - 1] = '\0';
+    entry->line = record->line;
+    strncpy(entry->message, message, LOG_MAX_MESSAGE_SIZE - 1);
+    entry->message[LOG_MAX_MESSAGE_SIZE - 1] = '\0';
+    history_head = (history_head + 1) % history_capacity;
+    if (history_count < history_capacity) {
+        history_count++;
+    }
+    portEXIT_CRITICAL(&history_lock);
+}
+
+// ===== DRAIN TASK =====
+
+static void emit_record(const log_record_t* record, File* file) {
+    static char message[LOG_MAX_MESSAGE_SIZE];
+    static char line[LOG_LINE_SIZE];
+
+    uint8_t destinations = config.destinations;
+    bool binary = file && config.binary_file;
+
+    if (binary) {
+        static const uint8_t sync[2] = {0xA5, 0x5A};
+        file->write(sync, sizeof(sync));
+        file->write(reinterpret_cast<const uint8_t*>(record), sizeof(*record));
+    }
+
+    if (!(destinations & (LOG_DEST_SERIAL | LOG_DEST_NETWORK | LOG_DEST_BUFFER)) && !(file && !binary)) {
+        return;
+    }
+
+    format_message(record, message, sizeof(message));
+    size_t length = format_line(record, message, line, sizeof(line));
+
+    if (destinations & LOG_DEST_SERIAL) {
+        Serial.write(reinterpret_cast<const uint8_t*>(line), length);
+    }
+    if (file && !binary) {
+        file->write(reinterpret_cast<const uint8_t*>(line), length);
+    }
+    if ((destinations & LOG_DEST_NETWORK) && network_hook) {
+        network_hook((log_level_t)record->level, line, length);
+    }
+    if (destinations & LOG_DEST_BUFFER) {
+        store_history(record, message);
+    }
+}
+
+static void drain_task(void* parameter) {
+    (void) parameter;
+    uint32_t reported_drops = 0;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, rings_idle() ? portMAX_DELAY : 1);
+
+        sched_wake_lock();
+
+        File file;
+        bool use_file = (config.destinations & LOG_DEST_FILE) && config.log_file_path;
+        bool file_open = false;
+
+        log_record_t record;
+        bool drained;
+        do {
+            drained = false;
+            for (int core = 0; core < portNUM_PROCESSORS; core++) {
+                // A few records per core per pass keeps the output roughly in time order
+                for (int i = 0; i < 4 && ring_pop(&rings[core], &record); i++) {
+                    if (use_file && !file_open) {
+                        file = SPIFFS.open(config.log_file_path, FILE_APPEND);
+                        file_open = (bool)file;
+                        use_file = file_open;
+                    }
+                    emit_record(&record, file_open ? &file : NULL);
+                    drained = true;
+                }
+            }
+        } while (drained);
+
+        uint32_t drops = dropped_count.load(std::memory_order_relaxed);
+        if (drops != reported_drops) {
+            memset(&record, 0, sizeof(record));
+            record.timestamp = log_get_timestamp();
+            record.level = LOG_LEVEL_WARN;
+            record.flags = LOG_RECORD_FORMATTED;
+            record.tag = "Log";
+            snprintf(record_text(&record), LOG_TEXT_CAPACITY, "%lu records dropped",
+                     (unsigned long)(drops - reported_drops));
+            emit_record(&record, file_open ? &file : NULL);
+            reported_drops = drops;
+        }
+
+        if (file_open) {
+            file.close();
+        }
+
+        sched_wake_unlock();
+    }
+}
+
+// ===== CORE LOGGING FUNCTIONS =====
+
+bool log_init(const log_config_t* cfg) {
+    if (initialized) {
+        return true;
+    }
+
+    if (cfg) {
+        config = *cfg;
+    }
+    log_runtime_level = (uint8_t)config.level;
+
+    if (config.destinations & LOG_DEST_BUFFER) {
+        size_t bytes = config.buffer_size ? config.buffer_size : LOG_BUFFER_SIZE;
+        history_capacity = bytes / sizeof(log_entry_t);
+        if (history_capacity == 0) {
+            history_capacity = 1;
+        }
+        history = (log_entry_t*)ps_malloc(history_capacity * sizeof(log_entry_t));
+        if (!history) {
+            history = (log_entry_t*)malloc(history_capacity * sizeof(log_entry_t));
+        }
+        if (!history) {
+            history_capacity = 0;
+            config.destinations &= ~LOG_DEST_BUFFER;
+        }
+    }
+
+    // Lowest priority above idle: formatting never competes with real work
+    if (xTaskCreate(drain_task, "log_drain", 4096, NULL, tskIDLE_PRIORITY + 1, &drain_task_handle) != pdPASS) {
+        drain_task_handle = NULL;
+        return false;
+    }
+
+    initialized = true;
+
+    // Records queued before init are waiting in the rings
+    xTaskNotifyGive(drain_task_handle);
+    return true;
+}
+
+void log_deinit(void) {
+    if (!initialized) {
+        return;
+    }
+
+    log_flush();
+
+    TaskHandle_t drain = drain_task_handle;
+    drain_task_handle = NULL;
+    vTaskDelete(drain);
+
+    portENTER_CRITICAL(&history_lock);
+    log_entry_t* old = history;
+    history = NULL;
+    history_capacity = 0;
+    history_count = 0;
+    history_head = 0;
+    portEXIT_CRITICAL(&history_lock);
+    free(old);
+
+    initialized = false;
+}
+
+static void submit_formatted(log_level_t level, const char* tag, const char* function, uint16_t line,
+                             const char* format, va_list args) {
+    log_record_t record;
+    record.timestamp = log_get_timestamp();
+    record.format = NULL;
+    record.tag = tag;
+    record.function = function;
+    record.line = line;
+    record.level = (uint8_t)level;
+    record.flags = LOG_RECORD_FORMATTED;
+    record.arg_count = 0;
+    record.string_used = 0;
+    record.arg_types = 0;
+    vsnprintf(record_text(&record), LOG_TEXT_CAPACITY, format, args);
+    log_submit(&record);
+}
+
+void log_write(log_level_t level, const char* function, uint16_t line, const char* format, ...) {
+    if ((uint8_t)level > log_runtime_level) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    submit_formatted(level, NULL, function, line, format, args);
+    va_end(args);
+}
+
+void log_write_tag(log_level_t level, const char* tag, const char* function, uint16_t line, const char* format, ...) {
+    if ((uint8_t)level > log_runtime_level) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    submit_formatted(level, tag, function, line, format, args);
+    va_end(args);
+}
+
+void log_write_va(log_level_t level, const char* function, uint16_t line, const char* format, va_list args) {
+    if ((uint8_t)level > log_runtime_level) {
+        return;
+    }
+    submit_formatted(level, NULL, function, line, format, args);
+}
+
+void log_hexdump(log_level_t level, const char* function, uint16_t line, const void* data, size_t length, const char* format, ...) {
+    if ((uint8_t)level > log_runtime_level) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    submit_formatted(level, NULL, function, line, format, args);
+    va_end(args);
+
+    // One preformatted record per 16 byte row
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t offset = 0; offset < length; offset += 16) {
+        log_record_t record;
+        memset(&record, 0, sizeof(record));
+        record.timestamp = log_get_timestamp();
+        record.function = function;
+        record.line = line;
+        record.level = (uint8_t)level;
+        record.flags = LOG_RECORD_FORMATTED;
+
+        char* text = record_text(&record);
+        size_t n = snprintf(text, LOG_TEXT_CAPACITY, "%04x:", (unsigned)offset);
+        size_t row = length - offset < 16 ? length - offset : 16;
+        for (size_t i = 0; i < 16; i++) {
+            n += snprintf(text + n, LOG_TEXT_CAPACITY - n, i < row ? " %02x" : "   ", bytes[offset + (i < row ? i : 0)]);
+        }
+        n += snprintf(text + n, LOG_TEXT_CAPACITY - n, "  ");
+        for (size_t i = 0; i < row && n + 1 < LOG_TEXT_CAPACITY; i++) {
+            uint8_t c = bytes[offset + i];
+            text[n++] = (c >= 0x20 && c < 0x7F) ? (char)c : '.';
+        }
+        text[n] = '\0';
+        log_submit(&record);
+    }
+}
+
+// ===== CONFIGURATION FUNCTIONS =====
+
+void log_set_level(log_level_t level) {
+    config.level = level;
+    log_runtime_level = (uint8_t)level;
+}
+
+log_level_t log_get_level(void) {
+    return (log_level_t)log_runtime_level;
+}
+
+void log_set_destinations(uint8_t destinations) {
+    config.destinations = destinations;
+}
+
+void log_set_color_output(bool enable) {
+    config.color_output = enable;
+}
+
+void log_set_file_path(const char* path) {
+    config.log_file_path = path;
+}
+
+void log_set_network_hook(log_network_hook_t hook) {
+    network_hook = hook;
+}
+
+// ===== UTILITY FUNCTIONS =====
+
+const char* log_level_to_string(log_level_t level) {
+    switch (level) {
+        case LOG_LEVEL_ERROR:   return "ERROR";
+        case LOG_LEVEL_WARN:    return "WARN";
+        case LOG_LEVEL_INFO:    return "INFO";
+        case LOG_LEVEL_DEBUG:   return "DEBUG";
+        case LOG_LEVEL_VERBOSE: return "VERB";
+        default:                return "NONE";
+    }
+}
+
+const char* log_level_to_color(log_level_t level) {
+    switch (level) {
+        case LOG_LEVEL_ERROR:   return "\033[31m";
+        case LOG_LEVEL_WARN:    return "\033[33m";
+        case LOG_LEVEL_INFO:    return "\033[32m";
+        case LOG_LEVEL_DEBUG:   return "\033[36m";
+        case LOG_LEVEL_VERBOSE: return "\033[37m";
+        default:                return "\033[0m";
+    }
+}
+
+void log_flush(void) {
+    TaskHandle_t drain = drain_task_handle;
+    if (!drain || xTaskGetCurrentTaskHandle() == drain) {
+        return;
+    }
+
+    xTaskNotifyGive(drain);
+    int64_t deadline = esp_timer_get_time() + 100000;
+    while (!rings_idle() && esp_timer_get_time() < deadline) {
+        vTaskDelay(1);
+    }
+}
+
+uint32_t log_get_timestamp(void) {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+uint32_t log_get_dropped_count(void) {
+    return dropped_count.load(std::memory_order_relaxed);
+}
+
+// ===== BUFFER MANAGEMENT =====
+
+uint16_t log_get_buffered_entries(log_entry_t* entries, uint16_t max_entries) {
+    if (!entries || !history) {
+        return 0;
+    }
+
+    portENTER_CRITICAL(&history_lock);
+    uint16_t count = history_count < max_entries ? history_count : max_entries;
+    uint16_t start = (history_head + history_capacity - history_count) % history_capacity;
+    for (uint16_t i = 0; i < count; i++) {
+        entries[i] = history[(start + i) % history_capacity];
+    }
+    portEXIT_CRITICAL(&history_lock);
+    return count;
+}
+
+void log_clear_buffer(void) {
+    portENTER_CRITICAL(&history_lock);
+    history_head = 0;
+    history_count = 0;
+    portEXIT_CRITICAL(&history_lock);
+}
+
+uint16_t log_get_buffer_count(void) {
+    return history_count;
+}
+
+// ===== PERFORMANCE MONITORING =====
+
+uint32_t log_perf_start(const char* tag) {
+    portENTER_CRITICAL(&perf_lock);
+    for (uint32_t i = 0; i < LOG_PERF_TIMERS; i++) {
+        if (!perf_timers[i].in_use) {
+            perf_timers[i].tag = tag;
+            perf_timers[i].start_us = esp_timer_get_time();
+            perf_timers[i].in_use = true;
+            portEXIT_CRITICAL(&perf_lock);
+            return i + 1;
+        }
+    }
+    portEXIT_CRITICAL(&perf_lock);
+    return 0;
+}
+
+void log_perf_end(uint32_t timer_id) {
+    if (timer_id == 0 || timer_id > LOG_PERF_TIMERS) {
+        return;
+    }
+
+    portENTER_CRITICAL(&perf_lock);
+    log_perf_timer_t timer = perf_timers[timer_id - 1];
+    perf_timers[timer_id - 1].in_use = false;
+    portEXIT_CRITICAL(&perf_lock);
+
+    if (timer.in_use) {
+        log_perf_measure(timer.tag, (uint32_t)((esp_timer_get_time() - timer.start_us) / 1000));
+    }
+}
+
+void log_perf_measure(const char* tag, uint32_t duration_ms) {
+    LOG_INFO_TAG("Perf", "%s: %lu ms", tag, (unsigned long)duration_ms);
+}
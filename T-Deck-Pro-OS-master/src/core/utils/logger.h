@@ -3,22 +3,43 @@
  * @brief Logging system for T-Deck-Pro OS
  * @author T-Deck-Pro OS Team
  * @date 2025
+ *
+ * A log call stores a compact binary record in a ring buffer for the calling
+ * core. The record holds the timestamp, pointers to the format string, tag
+ * and function name, and the raw arguments. A low priority drain task does
+ * the formatting and writes to the serial, file, buffer and network outputs.
+ * The format string must be a literal because it is read after the call
+ * returns. String arguments are copied into the record.
+ *
+ * Levels above LOG_COMPILE_LEVEL are removed at compile time, arguments
+ * included. Levels above the runtime level cost one comparison.
  */
 
 #ifndef LOGGER_H
 #define LOGGER_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
 
 // ===== LOG LEVELS =====
+// Numeric values so the preprocessor can compare them
+#define LOG_LEVEL_VALUE_NONE    0
+#define LOG_LEVEL_VALUE_ERROR   1
+#define LOG_LEVEL_VALUE_WARN    2
+#define LOG_LEVEL_VALUE_INFO    3
+#define LOG_LEVEL_VALUE_DEBUG   4
+#define LOG_LEVEL_VALUE_VERBOSE 5
+
 typedef enum {
-    LOG_LEVEL_NONE = 0,
-    LOG_LEVEL_ERROR = 1,
-    LOG_LEVEL_WARN = 2,
-    LOG_LEVEL_INFO = 3,
-    LOG_LEVEL_DEBUG = 4,
-    LOG_LEVEL_VERBOSE = 5
+    LOG_LEVEL_NONE = LOG_LEVEL_VALUE_NONE,
+    LOG_LEVEL_ERROR = LOG_LEVEL_VALUE_ERROR,
+    LOG_LEVEL_WARN = LOG_LEVEL_VALUE_WARN,
+    LOG_LEVEL_INFO = LOG_LEVEL_VALUE_INFO,
+    LOG_LEVEL_DEBUG = LOG_LEVEL_VALUE_DEBUG,
+    LOG_LEVEL_VERBOSE = LOG_LEVEL_VALUE_VERBOSE
 } log_level_t;
 
 // ===== LOG DESTINATIONS =====
@@ -35,13 +56,29 @@ typedef enum {
 #endif
 
 #ifndef LOG_BUFFER_SIZE
-#define LOG_BUFFER_SIZE 4096
+#define LOG_BUFFER_SIZE 4096    // Bytes of formatted history kept for LOG_DEST_BUFFER
 #endif
 
 #ifndef LOG_MAX_TAG_SIZE
 #define LOG_MAX_TAG_SIZE 16
 #endif
 
+#ifndef LOG_RING_SLOTS
+#define LOG_RING_SLOTS 32       // Records per core, power of two
+#endif
+
+#ifndef LOG_MAX_ARGS
+#define LOG_MAX_ARGS 8
+#endif
+
+#ifndef LOG_ARG_WORDS
+#define LOG_ARG_WORDS 12        // 64-bit and double arguments take two words
+#endif
+
+#ifndef LOG_STRING_BYTES
+#define LOG_STRING_BYTES 48     // Space for copied string arguments
+#endif
+
 // ===== DEFAULT LOG LEVEL =====
 #ifdef DEBUG
 #define DEFAULT_LOG_LEVEL LOG_LEVEL_DEBUG
@@ -49,27 +86,40 @@ typedef enum {
 #define DEFAULT_LOG_LEVEL LOG_LEVEL_INFO
 #endif
 
-// ===== LOG MACROS =====
-#define LOG_ERROR(format, ...) log_write(LOG_LEVEL_ERROR, __func__, __LINE__, format, ##__VA_ARGS__)
-#define LOG_WARN(format, ...)  log_write(LOG_LEVEL_WARN, __func__, __LINE__, format, ##__VA_ARGS__)
-#define LOG_INFO(format, ...)  log_write(LOG_LEVEL_INFO, __func__, __LINE__, format, ##__VA_ARGS__)
-#define LOG_DEBUG(format, ...) log_write(LOG_LEVEL_DEBUG, __func__, __LINE__, format, ##__VA_ARGS__)
-#define LOG_VERBOSE(format, ...) log_write(LOG_LEVEL_VERBOSE, __func__, __LINE__, format, ##__VA_ARGS__)
+// ===== COMPILE-TIME LOG LEVEL =====
+#ifndef LOG_COMPILE_LEVEL
+#ifdef LOG_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL
+#elif defined(DEBUG)
+#define LOG_COMPILE_LEVEL LOG_LEVEL_VALUE_DEBUG
+#else
+#define LOG_COMPILE_LEVEL LOG_LEVEL_VALUE_INFO
+#endif
+#endif
 
-// ===== TAGGED LOG MACROS =====
-#define LOG_ERROR_TAG(tag, format, ...) log_write_tag(LOG_LEVEL_ERROR, tag, __func__, __LINE__, format, ##__VA_ARGS__)
-#define LOG_WARN_TAG(tag, format, ...)  log_write_tag(LOG_LEVEL_WARN, tag, __func__, __LINE__, format, ##__VA_ARGS__)
-#define LOG_INFO_TAG(tag, format, ...)  log_write_tag(LOG_LEVEL_INFO, tag, __func__, __LINE__, format, ##__VA_ARGS__)
-#define LOG_DEBUG_TAG(tag, format, ...) log_write_tag(LOG_LEVEL_DEBUG, tag, __func__, __LINE__, format, ##__VA_ARGS__)
-#define LOG_VERBOSE_TAG(tag, format, ...) log_write_tag(LOG_LEVEL_VERBOSE, tag, __func__, __LINE__, format, ##__VA_ARGS__)
+// ===== BINARY RECORD =====
+// Argument types, two bits each in log_record_t.arg_types
+#define LOG_ARG_U32    0
+#define LOG_ARG_U64    1
+#define LOG_ARG_DOUBLE 2
+#define LOG_ARG_STRING 3   // Word holds the offset into strings[]
 
-// ===== CONDITIONAL LOGGING =====
-#define LOG_IF(condition, level, format, ...) \
-    do { if (condition) log_write(level, __func__, __LINE__, format, ##__VA_ARGS__); } while(0)
+#define LOG_RECORD_FORMATTED (1 << 0)   // words[]/strings[] hold finished text
 
-// ===== HEXDUMP LOGGING =====
-#define LOG_HEXDUMP(level, data, length, format, ...) \
-    log_hexdump(level, __func__, __LINE__, data, length, format, ##__VA_ARGS__)
+typedef struct {
+    uint32_t timestamp;
+    const char* format;
+    const char* tag;
+    const char* function;
+    uint16_t line;
+    uint8_t level;
+    uint8_t flags;
+    uint8_t arg_count;
+    uint8_t string_used;
+    uint16_t arg_types;
+    uint32_t words[LOG_ARG_WORDS];
+    char strings[LOG_STRING_BYTES];
+} log_record_t;
 
 // ===== LOG ENTRY STRUCTURE =====
 typedef struct {
@@ -91,16 +141,25 @@ typedef struct {
     bool color_output;
     const char* log_file_path;
     uint16_t buffer_size;
+    bool binary_file;       // Write raw records to the file; decode offline against the ELF
 } log_config_t;
 
+/**
+ * @brief Network output hook, called from the drain task with a formatted line
+ */
+typedef void (*log_network_hook_t)(log_level_t level, const char* line, size_t length);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Runtime level, read inline by the log macros
+extern volatile uint8_t log_runtime_level;
+
 // ===== CORE LOGGING FUNCTIONS =====
 
 /**
- * @brief Initialize the logging system
+ * @brief Initialize the logging system and start the drain task
  * @param config Logging configuration
  * @return true if successful, false otherwise
  */
@@ -118,6 +177,8 @@ void log_deinit(void);
  * @param line Line number
  * @param format Printf-style format string
  * @param ... Variable arguments
+ *
+ * Formats immediately; the C++ macros use the deferred path instead.
  */
 void log_write(log_level_t level, const char* function, uint16_t line, const char* format, ...);
 
@@ -142,6 +203,13 @@ void log_write_tag(log_level_t level, const char* tag, const char* function, uin
  */
 void log_write_va(log_level_t level, const char* function, uint16_t line, const char* format, va_list args);
 
+/**
+ * @brief Queue a binary record
+ * @param record Filled record, copied into the ring of the calling core
+ * @return false if the ring was full and the record was dropped
+ */
+bool log_submit(const log_record_t* record);
+
 /**
  * @brief Log hexdump of data
  * @param level Log level
@@ -186,6 +254,12 @@ void log_set_color_output(bool enable);
  */
 void log_set_file_path(const char* path);
 
+/**
+ * @brief Set the LOG_DEST_NETWORK output
+ * @param hook Called for every formatted line, NULL to disable
+ */
+void log_set_network_hook(log_network_hook_t hook);
+
 // ===== UTILITY FUNCTIONS =====
 
 /**
@@ -204,6 +278,8 @@ const char* log_level_to_color(log_level_t level);
 
 /**
  * @brief Flush all pending log messages
+ *
+ * Waits (up to 100 ms) for the drain task to write out everything queued.
  */
 void log_flush(void);
 
@@ -213,6 +289,11 @@ void log_flush(void);
  */
 uint32_t log_get_timestamp(void);
 
+/**
+ * @brief Number of records dropped because a ring was full
+ */
+uint32_t log_get_dropped_count(void);
+
 // ===== BUFFER MANAGEMENT =====
 
 /**
@@ -260,30 +341,134 @@ void log_perf_measure(const char* tag, uint32_t duration_ms);
 }
 #endif
 
-// ===== COMPILE-TIME LOG LEVEL FILTERING =====
-#if LOG_LEVEL < LOG_LEVEL_ERROR
-#undef LOG_ERROR
-#define LOG_ERROR(format, ...) do {} while(0)
-#endif
+// ===== DEFERRED RECORD PACKING =====
+#ifdef __cplusplus
+#include <type_traits>
+
+namespace log_detail {
+
+inline void pack_string(log_record_t* record, uint8_t index, const char* value) {
+    if (!value) {
+        value = "(null)";
+    }
+    size_t available = LOG_STRING_BYTES - record->string_used;
+    size_t length = available ? strnlen(value, available - 1) : 0;
+    uint32_t offset = record->string_used;
+    if (available) {
+        memcpy(record->strings + offset, value, length);
+        record->strings[offset + length] = '\0';
+        record->string_used += length + 1;
+    } else {
+        offset = LOG_STRING_BYTES;   // Out of space; rendered as an empty string
+    }
+    record->words[index] = offset;
+}
 
-#if LOG_LEVEL < LOG_LEVEL_WARN
-#undef LOG_WARN
-#define LOG_WARN(format, ...) do {} while(0)
-#endif
+inline void pack(log_record_t* record, uint8_t& word, uint8_t arg, const char* value) {
+    record->arg_types |= LOG_ARG_STRING << (arg * 2);
+    pack_string(record, word++, value);
+}
 
-#if LOG_LEVEL < LOG_LEVEL_INFO
-#undef LOG_INFO
-#define LOG_INFO(format, ...) do {} while(0)
-#endif
+inline void pack(log_record_t* record, uint8_t& word, uint8_t arg, char* value) {
+    pack(record, word, arg, static_cast<const char*>(value));
+}
 
-#if LOG_LEVEL < LOG_LEVEL_DEBUG
-#undef LOG_DEBUG
-#define LOG_DEBUG(format, ...) do {} while(0)
-#endif
+template <typename T>
+inline void pack(log_record_t* record, uint8_t& word, uint8_t arg, T value) {
+    static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value,
+                  "log arguments must be numbers, pointers or C strings");
+    if constexpr (std::is_floating_point<T>::value) {
+        double d = (double)value;
+        record->arg_types |= LOG_ARG_DOUBLE << (arg * 2);
+        memcpy(&record->words[word], &d, sizeof(d));
+        word += 2;
+    } else if constexpr (sizeof(T) > sizeof(uint32_t)) {
+        uint64_t v = (uint64_t)value;
+        record->arg_types |= LOG_ARG_U64 << (arg * 2);
+        memcpy(&record->words[word], &v, sizeof(v));
+        word += 2;
+    } else {
+        record->words[word++] = (uint32_t)(uintptr_t)value;
+    }
+}
+
+template <typename T>
+constexpr size_t word_count() {
+    return (std::is_floating_point<T>::value || sizeof(T) > sizeof(uint32_t)) ? 2 : 1;
+}
+
+inline void pack_all(log_record_t*, uint8_t&, uint8_t) {}
+
+template <typename T, typename... Rest>
+inline void pack_all(log_record_t* record, uint8_t& word, uint8_t arg, T value, Rest... rest) {
+    pack(record, word, arg, value);
+    pack_all(record, word, arg + 1, rest...);
+}
 
-#if LOG_LEVEL < LOG_LEVEL_VERBOSE
-#undef LOG_VERBOSE
-#define LOG_VERBOSE(format, ...) do {} while(0)
+template <typename... Args>
+inline void emit(log_level_t level, const char* tag, const char* function, uint16_t line,
+                 const char* format, Args... args) {
+    static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments");
+    static_assert((word_count<Args>() + ... + 0) <= LOG_ARG_WORDS, "log arguments do not fit the record");
+
+    log_record_t record;
+    record.timestamp = log_get_timestamp();
+    record.format = format;
+    record.tag = tag;
+    record.function = function;
+    record.line = line;
+    record.level = (uint8_t)level;
+    record.flags = 0;
+    record.arg_count = sizeof...(Args);
+    record.string_used = 0;
+    record.arg_types = 0;
+
+    uint8_t word = 0;
+    pack_all(&record, word, 0, args...);
+    log_submit(&record);
+}
+
+} // namespace log_detail
+
+#define LOG_EMIT(level, tag, format, ...) \
+    log_detail::emit(level, tag, __func__, __LINE__, format, ##__VA_ARGS__)
+#else
+#define LOG_EMIT(level, tag, format, ...) \
+    log_write_tag(level, tag, __func__, __LINE__, format, ##__VA_ARGS__)
 #endif
 
-#endif // LOGGER_H
\ No newline at end of file
+// Arguments are only evaluated when the level is enabled
+#define LOG_AT(level, tag, format, ...) \
+    do { \
+        if ((level) <= LOG_COMPILE_LEVEL && (level) <= log_runtime_level) { \
+            LOG_EMIT(level, tag, format, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+// ===== LOG MACROS =====
+#define LOG_ERROR(format, ...)   LOG_AT(LOG_LEVEL_ERROR, NULL, format, ##__VA_ARGS__)
+#define LOG_WARN(format, ...)    LOG_AT(LOG_LEVEL_WARN, NULL, format, ##__VA_ARGS__)
+#define LOG_INFO(format, ...)    LOG_AT(LOG_LEVEL_INFO, NULL, format, ##__VA_ARGS__)
+#define LOG_DEBUG(format, ...)   LOG_AT(LOG_LEVEL_DEBUG, NULL, format, ##__VA_ARGS__)
+#define LOG_VERBOSE(format, ...) LOG_AT(LOG_LEVEL_VERBOSE, NULL, format, ##__VA_ARGS__)
+
+// ===== TAGGED LOG MACROS =====
+#define LOG_ERROR_TAG(tag, format, ...)   LOG_AT(LOG_LEVEL_ERROR, tag, format, ##__VA_ARGS__)
+#define LOG_WARN_TAG(tag, format, ...)    LOG_AT(LOG_LEVEL_WARN, tag, format, ##__VA_ARGS__)
+#define LOG_INFO_TAG(tag, format, ...)    LOG_AT(LOG_LEVEL_INFO, tag, format, ##__VA_ARGS__)
+#define LOG_DEBUG_TAG(tag, format, ...)   LOG_AT(LOG_LEVEL_DEBUG, tag, format, ##__VA_ARGS__)
+#define LOG_VERBOSE_TAG(tag, format, ...) LOG_AT(LOG_LEVEL_VERBOSE, tag, format, ##__VA_ARGS__)
+
+// ===== CONDITIONAL LOGGING =====
+#define LOG_IF(condition, level, format, ...) \
+    do { if (condition) LOG_AT(level, NULL, format, ##__VA_ARGS__); } while(0)
+
+// ===== HEXDUMP LOGGING =====
+#define LOG_HEXDUMP(level, data, length, format, ...) \
+    do { \
+        if ((level) <= LOG_COMPILE_LEVEL && (level) <= log_runtime_level) { \
+            log_hexdump(level, __func__, __LINE__, data, length, format, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#endif // LOGGER_H
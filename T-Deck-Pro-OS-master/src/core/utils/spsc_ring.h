@@ -0,0 +1,80 @@
+/**
+ * @file spsc_ring.h
+ * @brief Lock-free single-producer single-consumer ring buffer
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+namespace TDeckOS {
+namespace Utils {
+
+/**
+ * @brief Fixed capacity SPSC ring
+ *
+ * One task (or ISR) may push and one other may pop without locking. Indices
+ * run freely and are masked on access, so the full capacity N is usable.
+ *
+ * @tparam T Trivially copyable element type
+ * @tparam N Capacity, must be a power of two
+ */
+template <typename T, size_t N>
+class SpscRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+    SpscRing() : m_head(0), m_tail(0) {}
+
+    /**
+     * @brief Append an element (producer side)
+     * @param value Element to append
+     * @return true if stored, false if the ring is full
+     */
+    bool push(const T& value) {
+        uint32_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) >= N) {
+            return false;
+        }
+        m_items[head & (N - 1)] = value;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Remove the oldest element (consumer side)
+     * @param value Receives the element
+     * @return true if an element was removed, false if the ring is empty
+     */
+    bool pop(T& value) {
+        uint32_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = m_items[tail & (N - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Number of stored elements (approximate while the other side runs)
+     */
+    size_t size() const {
+        return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+    static constexpr size_t capacity() { return N; }
+
+private:
+    T m_items[N];
+    std::atomic<uint32_t> m_head;
+    std::atomic<uint32_t> m_tail;
+};
+
+} // namespace Utils
+} // namespace TDeckOS
@@ -0,0 +1,343 @@
+/**
+ * @file trace.cpp
+ * @brief Hot-path latency histograms, task CPU statistics and trace events
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ */
+
+#include "trace.h"
+#include "logger.h"
+#include <Arduino.h>
+#include <string.h>
+#include <stdio.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
+
+// ===== INTERNAL STATE =====
+typedef struct {
+    uint32_t start_us;
+    uint32_t duration_us;
+    uint8_t site;
+    uint8_t core;
+} trace_event_t;
+
+static const char* const site_names[TRACE_SITE_COUNT] = {
+    "lvgl_flush",
+    "eink_partial",
+    "eink_full",
+    "eink_clear",
+    "eink_deep_clean",
+    "lora_tx_airtime",
+    "lora_rx_latency",
+    "at_rtt",
+    "mqtt_publish"
+};
+
+static trace_hist_t histograms[TRACE_SITE_COUNT];
+static portMUX_TYPE hist_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static trace_event_t* events = NULL;
+static uint32_t event_head = 0;         // Total events written; the ring keeps the newest
+static bool events_enabled = false;
+
+static trace_task_stat_t task_stats[TRACE_MAX_TASKS];
+static uint32_t task_numbers[TRACE_MAX_TASKS];
+static uint32_t task_runtimes[TRACE_MAX_TASKS];
+static uint8_t task_count = 0;
+static uint32_t last_total_runtime = 0;
+static float cpu_usage = 0.0f;
+static portMUX_TYPE task_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static inline uint8_t bucket_for(uint32_t us) {
+    uint8_t bucket = 0;
+    while (us > 1 && bucket < TRACE_HIST_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+// ===== HISTOGRAMS =====
+uint32_t trace_begin(void) {
+    return (uint32_t)esp_timer_get_time();
+}
+
+void trace_end(trace_site_t site, uint32_t start_us) {
+    trace_record(site, start_us, (uint32_t)esp_timer_get_time() - start_us);
+}
+
+void trace_record(trace_site_t site, uint32_t start_us, uint32_t duration_us) {
+    if ((unsigned)site >= TRACE_SITE_COUNT) {
+        return;
+    }
+    if (start_us == 0) {
+        start_us = (uint32_t)esp_timer_get_time() - duration_us;
+    }
+
+    portENTER_CRITICAL_SAFE(&hist_lock);
+    trace_hist_t* hist = &histograms[site];
+    if (hist->count == 0 || duration_us < hist->min_us) {
+        hist->min_us = duration_us;
+    }
+    if (duration_us > hist->max_us) {
+        hist->max_us = duration_us;
+    }
+    hist->count++;
+    hist->sum_us += duration_us;
+    hist->buckets[bucket_for(duration_us)]++;
+
+    if (events_enabled) {
+        trace_event_t* event = &events[event_head % TRACE_EVENT_CAPACITY];
+        event->start_us = start_us;
+        event->duration_us = duration_us;
+        event->site = (uint8_t)site;
+        event->core = (uint8_t)xPortGetCoreID();
+        event_head++;
+    }
+    portEXIT_CRITICAL_SAFE(&hist_lock);
+}
+
+bool trace_get_histogram(trace_site_t site, trace_hist_t* out) {
+    if ((unsigned)site >= TRACE_SITE_COUNT || !out) {
+        return false;
+    }
+
+    portENTER_CRITICAL(&hist_lock);
+    *out = histograms[site];
+    portEXIT_CRITICAL(&hist_lock);
+    return true;
+}
+
+uint32_t trace_hist_percentile(const trace_hist_t* hist, uint8_t percent) {
+    if (!hist || hist->count == 0) {
+        return 0;
+    }
+    if (percent > 100) {
+        percent = 100;
+    }
+
+    uint32_t target = (uint32_t)(((uint64_t)hist->count * percent + 99) / 100);
+    if (target == 0) {
+        target = 1;
+    }
+
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < TRACE_HIST_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= target) {
+            // The bucket bound can overshoot the largest sample seen
+            uint32_t bound = i >= 31 ? UINT32_MAX : (2UL << i) - 1;
+            return bound < hist->max_us ? bound : hist->max_us;
+        }
+    }
+    return hist->max_us;
+}
+
+const char* trace_site_name(trace_site_t site) {
+    if ((unsigned)site >= TRACE_SITE_COUNT) {
+        return "unknown";
+    }
+    return site_names[site];
+}
+
+void trace_reset(void) {
+    portENTER_CRITICAL(&hist_lock);
+    memset(histograms, 0, sizeof(histograms));
+    event_head = 0;
+    portEXIT_CRITICAL(&hist_lock);
+}
+
+// ===== CHROME TRACE EVENTS =====
+bool trace_events_enable(bool enable) {
+    if (enable && !events) {
+        trace_event_t* ring = (trace_event_t*)ps_malloc(TRACE_EVENT_CAPACITY * sizeof(trace_event_t));
+        if (!ring) {
+            ring = (trace_event_t*)malloc(TRACE_EVENT_CAPACITY * sizeof(trace_event_t));
+        }
+        if (!ring) {
+            LOG_ERROR_TAG("Trace", "Failed to allocate trace event ring");
+            return false;
+        }
+        portENTER_CRITICAL(&hist_lock);
+        events = ring;
+        event_head = 0;
+        portEXIT_CRITICAL(&hist_lock);
+    }
+
+    portENTER_CRITICAL(&hist_lock);
+    events_enabled = enable;
+    portEXIT_CRITICAL(&hist_lock);
+    return true;
+}
+
+uint32_t trace_dump_chrome(trace_writer_t writer, void* ctx) {
+    if (!writer) {
+        return 0;
+    }
+
+    // Capture pauses while the ring is walked so entries are not overwritten underneath
+    portENTER_CRITICAL(&hist_lock);
+    bool was_enabled = events_enabled;
+    events_enabled = false;
+    uint32_t head = event_head;
+    portEXIT_CRITICAL(&hist_lock);
+
+    static const char header[] = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    writer(header, sizeof(header) - 1, ctx);
+
+    char line[128];
+    int len;
+    for (uint8_t core = 0; core < portNUM_PROCESSORS; core++) {
+        len = snprintf(line, sizeof(line),
+                       "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"core%u\"}}",
+                       core ? "," : "", core, core);
+        writer(line, (size_t)len, ctx);
+    }
+
+    uint32_t written = 0;
+    if (events) {
+        uint32_t count = head < TRACE_EVENT_CAPACITY ? head : TRACE_EVENT_CAPACITY;
+        for (uint32_t i = head - count; i != head; i++) {
+            const trace_event_t* event = &events[i % TRACE_EVENT_CAPACITY];
+            len = snprintf(line, sizeof(line),
+                           ",{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lu,\"dur\":%lu}",
+                           site_names[event->site], event->core,
+                           (unsigned long)event->start_us, (unsigned long)event->duration_us);
+            writer(line, (size_t)len, ctx);
+            written++;
+        }
+    }
+
+    static const char footer[] = "]}\n";
+    writer(footer, sizeof(footer) - 1, ctx);
+
+    portENTER_CRITICAL(&hist_lock);
+    events_enabled = was_enabled;
+    portEXIT_CRITICAL(&hist_lock);
+    return written;
+}
+
+// ===== TASK STATISTICS =====
+uint8_t trace_sample_tasks(void) {
+#if configUSE_TRACE_FACILITY
+    UBaseType_t capacity = uxTaskGetNumberOfTasks() + 2;
+    TaskStatus_t* status = (TaskStatus_t*)malloc(capacity * sizeof(TaskStatus_t));
+    if (!status) {
+        return 0;
+    }
+
+    uint32_t total_runtime = 0;
+    UBaseType_t reported = uxTaskGetSystemState(status, capacity, &total_runtime);
+    if (reported > TRACE_MAX_TASKS) {
+        reported = TRACE_MAX_TASKS;
+    }
+
+    trace_task_stat_t stats[TRACE_MAX_TASKS];
+    uint32_t numbers[TRACE_MAX_TASKS];
+    uint32_t runtimes[TRACE_MAX_TASKS];
+
+    portENTER_CRITICAL(&task_lock);
+    // Every core contributes a full interval of CPU time
+    uint32_t capacity_runtime = (total_runtime - last_total_runtime) * portNUM_PROCESSORS;
+    bool have_interval = last_total_runtime != 0 && capacity_runtime > 0;
+    float idle_percent = 0.0f;
+
+    for (UBaseType_t i = 0; i < reported; i++) {
+        const TaskStatus_t* task = &status[i];
+        trace_task_stat_t* stat = &stats[i];
+        strncpy(stat->name, task->pcTaskName, TRACE_TASK_NAME_LEN - 1);
+        stat->name[TRACE_TASK_NAME_LEN - 1] = '\0';
+        stat->stack_free = task->usStackHighWaterMark;
+        stat->priority = (uint8_t)task->uxCurrentPriority;
+#if configTASKLIST_INCLUDE_COREID
+        stat->core = task->xCoreID == tskNO_AFFINITY ? -1 : (int8_t)task->xCoreID;
+#else
+        stat->core = -1;
+#endif
+        numbers[i] = task->xTaskNumber;
+        runtimes[i] = task->ulRunTimeCounter;
+        stat->cpu_percent = 0.0f;
+
+#if configGENERATE_RUN_TIME_STATS
+        // Tasks created since the last sample count from zero
+        uint32_t previous = 0;
+        for (uint8_t j = 0; j < task_count; j++) {
+            if (task_numbers[j] == task->xTaskNumber) {
+                previous = task_runtimes[j];
+                break;
+            }
+        }
+        if (have_interval) {
+            stat->cpu_percent = (float)(task->ulRunTimeCounter - previous) * 100.0f / (float)capacity_runtime;
+            if (strncmp(task->pcTaskName, "IDLE", 4) == 0) {
+                idle_percent += stat->cpu_percent;
+            }
+        }
+#endif
+    }
+
+    memcpy(task_stats, stats, reported * sizeof(trace_task_stat_t));
+    memcpy(task_numbers, numbers, reported * sizeof(uint32_t));
+    memcpy(task_runtimes, runtimes, reported * sizeof(uint32_t));
+    task_count = (uint8_t)reported;
+    last_total_runtime = total_runtime;
+    if (have_interval) {
+        float usage = 100.0f - idle_percent;
+        cpu_usage = usage < 0.0f ? 0.0f : (usage > 100.0f ? 100.0f : usage);
+    }
+    portEXIT_CRITICAL(&task_lock);
+
+    free(status);
+    return (uint8_t)reported;
+#else
+    return 0;
+#endif
+}
+
+uint8_t trace_get_task_stats(trace_task_stat_t* out, uint8_t max_entries) {
+    if (!out) {
+        return 0;
+    }
+
+    portENTER_CRITICAL(&task_lock);
+    uint8_t count = task_count < max_entries ? task_count : max_entries;
+    memcpy(out, task_stats, count * sizeof(trace_task_stat_t));
+    portEXIT_CRITICAL(&task_lock);
+    return count;
+}
+
+float trace_get_cpu_usage(void) {
+    portENTER_CRITICAL(&task_lock);
+    float usage = cpu_usage;
+    portEXIT_CRITICAL(&task_lock);
+    return usage;
+}
+
+void trace_log_summary(void) {
+    for (uint8_t i = 0; i < TRACE_SITE_COUNT; i++) {
+        trace_hist_t hist;
+        trace_get_histogram((trace_site_t)i, &hist);
+        if (hist.count == 0) {
+            continue;
+        }
+        LOG_INFO_TAG("Trace", "%s: n=%lu avg=%lu p50=%lu p99=%lu max=%lu us",
+                     site_names[i], (unsigned long)hist.count,
+                     (unsigned long)(hist.sum_us / hist.count),
+                     (unsigned long)trace_hist_percentile(&hist, 50),
+                     (unsigned long)trace_hist_percentile(&hist, 99),
+                     (unsigned long)hist.max_us);
+    }
+
+    trace_task_stat_t stats[TRACE_MAX_TASKS];
+    uint8_t count = trace_get_task_stats(stats, TRACE_MAX_TASKS);
+    for (uint8_t i = 0; i < count; i++) {
+        if (stats[i].stack_free < TRACE_STACK_WARN_BYTES) {
+            LOG_WARN_TAG("Trace", "Task %s close to stack overflow: %lu bytes free",
+                         stats[i].name, (unsigned long)stats[i].stack_free);
+        }
+        LOG_DEBUG_TAG("Trace", "task %s: cpu=%.1f%% stack_free=%lu prio=%u core=%d",
+                      stats[i].name, stats[i].cpu_percent, (unsigned long)stats[i].stack_free,
+                      stats[i].priority, stats[i].core);
+    }
+}
@@ -0,0 +1,185 @@
+/**
+ * @file trace.h
+ * @brief Hot-path latency histograms, task CPU statistics and trace events
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ *
+ * Each instrumented site keeps a log2 histogram of its latency in
+ * microseconds; recording is a handful of adds under a spinlock, cheap
+ * enough for the display flush and radio paths. Optionally every sample is
+ * also kept in an event ring that can be dumped in Chrome trace format
+ * (chrome://tracing, Perfetto) over serial or any other writer.
+ *
+ * trace_sample_tasks() turns FreeRTOS runtime counters into per-task CPU
+ * shares and stack high-water marks; it needs configUSE_TRACE_FACILITY and,
+ * for CPU figures, configGENERATE_RUN_TIME_STATS.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ===== CONFIGURATION =====
+#ifndef TRACE_HIST_BUCKETS
+#define TRACE_HIST_BUCKETS 24       // Bucket n holds [2^n, 2^(n+1)) us; the last one is open ended
+#endif
+
+#ifndef TRACE_EVENT_CAPACITY
+#define TRACE_EVENT_CAPACITY 512    // Events kept while the ring is enabled
+#endif
+
+#ifndef TRACE_MAX_TASKS
+#define TRACE_MAX_TASKS 24
+#endif
+
+#ifndef TRACE_STACK_WARN_BYTES
+#define TRACE_STACK_WARN_BYTES 512  // trace_log_summary() warns below this much free stack
+#endif
+
+#define TRACE_TASK_NAME_LEN 16
+
+// ===== INSTRUMENTED SITES =====
+typedef enum {
+    TRACE_LVGL_FLUSH = 0,           // LVGL flush callback into the e-ink frame buffer
+    TRACE_EINK_PARTIAL,             // Panel refresh, one site per EinkRefreshMode in order
+    TRACE_EINK_FULL,
+    TRACE_EINK_CLEAR,
+    TRACE_EINK_DEEP_CLEAN,
+    TRACE_LORA_TX_AIRTIME,          // startTransmit() to TX done interrupt
+    TRACE_LORA_RX_LATENCY,          // RX done interrupt to receive callback
+    TRACE_AT_RTT,                   // AT command written to result code or timeout
+    TRACE_MQTT_PUBLISH,             // MQTT publish call
+    TRACE_SITE_COUNT
+} trace_site_t;
+
+// ===== DATA STRUCTURES =====
+typedef struct {
+    uint32_t count;
+    uint64_t sum_us;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t buckets[TRACE_HIST_BUCKETS];
+} trace_hist_t;
+
+typedef struct {
+    char name[TRACE_TASK_NAME_LEN];
+    float cpu_percent;              // Share of total CPU time since the previous sample
+    uint32_t stack_free;            // Stack high-water mark (ESP-IDF reports bytes)
+    uint8_t priority;
+    int8_t core;                    // -1 if not pinned
+} trace_task_stat_t;
+
+/**
+ * @brief Output sink for trace_dump_chrome(); called with consecutive chunks
+ */
+typedef void (*trace_writer_t)(const char* data, size_t len, void* ctx);
+
+// ===== FUNCTION DECLARATIONS =====
+
+/**
+ * @brief Current timestamp for a later trace_end()
+ * @return Microseconds since boot, truncated to 32 bits
+ */
+uint32_t trace_begin(void);
+
+/**
+ * @brief Record the time elapsed since trace_begin()
+ */
+void trace_end(trace_site_t site, uint32_t start_us);
+
+/**
+ * @brief Record a duration measured elsewhere
+ * @param start_us Start timestamp for the event ring, 0 to derive it from now
+ */
+void trace_record(trace_site_t site, uint32_t start_us, uint32_t duration_us);
+
+/**
+ * @brief Copy the histogram of one site
+ * @return false if the site is out of range
+ */
+bool trace_get_histogram(trace_site_t site, trace_hist_t* out);
+
+/**
+ * @brief Approximate percentile of a histogram
+ * @param percent 0-100
+ * @return Upper bound of the bucket holding the percentile, in microseconds
+ */
+uint32_t trace_hist_percentile(const trace_hist_t* hist, uint8_t percent);
+
+/**
+ * @brief Site name for reports
+ */
+const char* trace_site_name(trace_site_t site);
+
+/**
+ * @brief Clear all histograms
+ */
+void trace_reset(void);
+
+/**
+ * @brief Start or stop capturing events for the Chrome trace ring
+ * @return false if the ring could not be allocated
+ */
+bool trace_events_enable(bool enable);
+
+/**
+ * @brief Write the captured events as Chrome trace JSON
+ * @return Number of events written
+ */
+uint32_t trace_dump_chrome(trace_writer_t writer, void* ctx);
+
+/**
+ * @brief Sample FreeRTOS runtime counters and stack high-water marks
+ * @return Number of tasks sampled, 0 when the kernel lacks trace support
+ */
+uint8_t trace_sample_tasks(void);
+
+/**
+ * @brief Copy the per-task statistics from the last sample
+ * @return Number of entries written
+ */
+uint8_t trace_get_task_stats(trace_task_stat_t* out, uint8_t max_entries);
+
+/**
+ * @brief CPU usage over the last sample interval, both cores averaged
+ * @return 0-100, 0 when runtime statistics are unavailable
+ */
+float trace_get_cpu_usage(void);
+
+/**
+ * @brief Log one line per site with samples and per-task statistics
+ */
+void trace_log_summary(void);
+
+#ifdef __cplusplus
+}
+
+/**
+ * @brief Records the lifetime of a scope into a trace site
+ */
+class TraceScope {
+public:
+    explicit TraceScope(trace_site_t site) : m_site(site), m_start(trace_begin()) {}
+    ~TraceScope() { trace_end(m_site, m_start); }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    trace_site_t m_site;
+    uint32_t m_start;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(site) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(site)
+#endif
+
+#endif // TRACE_H
@@ -8,14 +8,19 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <SPIFFS.h>
+#include <SPI.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <esp_task_wdt.h>
 
 // Core OS Components
 #include "core/hal/board_config.h"
+#include "core/hal/board_profile.h"
 #include "core/utils/logger.h"
+#include "core/utils/trace.h"
 #include "core/display/eink_manager.h"
+#include "core/system/scheduler.h"
+#include "core/system/boot.h"
 
 // LVGL Configuration
 #include "lvgl.h"
@@ -31,40 +36,46 @@
 #include "core/communication/lora_manager.h"
 #include "core/communication/wifi_manager.h"
 #include "core/communication/cellular_manager.h"
+#include "core/communication/message_bus.h"
 
 // System Services
 #include "services/power_manager.h"
 #include "services/file_manager.h"
 #include "services/ota_manager.h"
 
+#ifdef BENCH_BUILD
+#include "test_benchmark.h"
+#endif
+
 // ===== GLOBAL VARIABLES =====
 static TaskHandle_t main_task_handle = NULL;
 static TaskHandle_t ui_task_handle = NULL;
 static TaskHandle_t comm_task_handle = NULL;
 
 // ===== FUNCTION DECLARATIONS =====
-void setup_hardware(void);
-void setup_filesystem(void);
-void setup_communication(void);
-void setup_applications(void);
+bool setup_hardware(void* arg);
+bool setup_filesystem(void* arg);
+bool setup_display(void* arg);
+bool setup_communication(void* arg);
+bool setup_modem(void* arg);
+bool setup_applications(void* arg);
+bool setup_services(void* arg);
 void main_task(void* parameter);
 void ui_task(void* parameter);
 void comm_task(void* parameter);
 
-// ===== LVGL TICK CALLBACK =====
-static void lv_tick_task(void* arg) {
-    (void) arg;
-    lv_tick_inc(portTICK_PERIOD_MS);
-}
-
 /**
  * @brief Arduino setup function - System initialization
  */
 void setup() {
-    // Initialize serial communication
+    boot_init();
+    
+    // Initialize serial communication; a watchdog or panic reset in the field does not wait for a monitor
     Serial.begin(115200);
-    while (!Serial && millis() < 5000) {
-        delay(10);
+    if (boot_is_cold_start()) {
+        while (!Serial && millis() < BOOT_SERIAL_WAIT_MS) {
+            delay(10);
+        }
     }
     
     Serial.println("\n=== T-Deck-Pro OS Starting ===");
@@ -93,36 +104,63 @@ void setup() {
     LOG_INFO("T-Deck-Pro OS initialization started");
     
     // Initialize hardware
-    setup_hardware();
+    boot_run(BOOT_STAGE_HARDWARE, setup_hardware, NULL);
+    
+    // Initialize deadline scheduler and light sleep wake-up sources
+    if (!sched_init()) {
+        LOG_WARN("Scheduler light sleep unavailable");
+    }
     
     // Initialize filesystem
-    setup_filesystem();
+    boot_run(BOOT_STAGE_FILESYSTEM, setup_filesystem, NULL);
     
     // Initialize LVGL
     lv_init();
     
-    // Initialize E-ink display
-    if (!eink_manager.initialize()) {
+    // LVGL reads its tick from esp_timer (LV_TICK_CUSTOM); no periodic tick interrupt needed
+    
+    // Display and radio share the SPI bus, which setup_hardware() already started,
+    // and the SPI driver serialises their transactions, so they come up side by
+    // side: the panel on the UI core, the radios next to the tasks that drive them
+    boot_start(BOOT_STAGE_DISPLAY, setup_display, NULL, 1);
+    boot_start(BOOT_STAGE_COMMUNICATION, setup_communication, NULL, 0);
+    
+    // Apps build LVGL objects, so they need the display driver but not the radios
+    if (!boot_wait(BOOT_STAGE_BIT(BOOT_STAGE_DISPLAY), BOOT_STAGE_TIMEOUT_MS)) {
         LOG_ERROR("Failed to initialize E-ink display");
+        boot_log_report();
         while (1) {
             delay(1000);
         }
     }
+    boot_run(BOOT_STAGE_APPS, setup_applications, NULL);
     
-    // Setup LVGL tick
-    esp_timer_handle_t lvgl_tick_timer;
-    esp_timer_create_args_t lvgl_tick_timer_args = {
-        .callback = &lv_tick_task,
-        .name = "lvgl_tick"
-    };
-    esp_timer_create(&lvgl_tick_timer_args, &lvgl_tick_timer);
-    esp_timer_start_periodic(lvgl_tick_timer, portTICK_PERIOD_MS * 1000);
+    // The UI can run while the radios are still coming up
+    xTaskCreatePinnedToCore(
+        ui_task,
+        "ui_task",
+        16384,
+        NULL,
+        2,
+        &ui_task_handle,
+        1
+    );
     
-    // Initialize communication systems
-    setup_communication();
+    // Start E-ink maintenance task
+    xTaskCreate(
+        eink_maintenance_task,
+        "eink_maintenance",
+        4096,
+        NULL,
+        1,
+        NULL
+    );
     
-    // Initialize applications
-    setup_applications();
+    // Services and the remaining tasks use the radios; the modem keeps powering up in the background
+    if (!boot_wait(BOOT_STAGE_BIT(BOOT_STAGE_COMMUNICATION), BOOT_STAGE_TIMEOUT_MS)) {
+        LOG_ERROR("Communication systems unavailable");
+    }
+    boot_run(BOOT_STAGE_SERVICES, setup_services, NULL);
     
     // Create main tasks
     xTaskCreatePinnedToCore(
@@ -135,16 +173,6 @@ void setup() {
         0
     );
     
-    xTaskCreatePinnedToCore(
-        ui_task,
-        "ui_task",
-        16384,
-        NULL,
-        2,
-        &ui_task_handle,
-        1
-    );
-    
     xTaskCreatePinnedToCore(
         comm_task,
         "comm_task",
@@ -155,17 +183,12 @@ void setup() {
         0
     );
     
-    // Start E-ink maintenance task
-    xTaskCreate(
-        eink_maintenance_task,
-        "eink_maintenance",
-        4096,
-        NULL,
-        1,
-        NULL
-    );
-    
     LOG_INFO("T-Deck-Pro OS initialization completed");
+    boot_ready();
+    
+#ifdef BENCH_BUILD
+    bench_start(CommunicationManager::getInstance());
+#endif
     Serial.println("=== System Ready ===\n");
 }
 
@@ -174,27 +197,30 @@ void setup() {
  */
 void loop() {
     // Main loop is handled by FreeRTOS tasks
-    // This loop just handles watchdog and basic housekeeping
+    // This loop handles watchdog, basic housekeeping and light sleep between deadlines
     
     static uint32_t last_heartbeat = 0;
     uint32_t current_time = millis();
     
     if (current_time - last_heartbeat >= 30000) { // 30 second heartbeat
-        LOG_DEBUG("System heartbeat - Free heap: %d bytes", ESP.getFreeHeap());
+        sched_stats_t sched_stats;
+        sched_get_stats(&sched_stats);
+        LOG_DEBUG("System heartbeat - Free heap: %d bytes, light sleep: %lu ms in %lu sleeps",
+                  ESP.getFreeHeap(), sched_stats.light_sleep_ms, sched_stats.light_sleeps);
         last_heartbeat = current_time;
     }
     
     // Feed watchdog
     esp_task_wdt_reset();
     
-    // Small delay to prevent tight loop
-    delay(100);
+    // Sleep until the earliest deadline; never past the next heartbeat
+    sched_idle(30000 - (millis() - last_heartbeat));
 }
 
 /**
  * @brief Initialize hardware components
  */
-void setup_hardware() {
+bool setup_hardware(void* arg) {
     LOG_INFO("Initializing hardware components");
     
     // Initialize board configuration
@@ -203,6 +229,11 @@ void setup_hardware() {
         while (1) delay(1000);
     }
     
+    // The panel and the LoRa radio share one SPI bus. Start it here, once, so the
+    // display and communication stages do not race to begin it.
+    using Spi = TDeckOS::Board::Active::Spi;
+    SPI.begin(Spi::SCK, Spi::MISO, Spi::MOSI);
+    
     // Initialize power management
     if (!board_set_power_state(BOARD_POWER_ACTIVE)) {
         LOG_WARN("Failed to set initial power state");
@@ -220,18 +251,19 @@ void setup_hardware() {
     }
     
     LOG_INFO("Hardware initialization completed");
+    return true;
 }
 
 /**
  * @brief Initialize filesystem
  */
-void setup_filesystem() {
+bool setup_filesystem(void* arg) {
     LOG_INFO("Initializing filesystem");
     
     // Initialize SPIFFS
     if (!SPIFFS.begin(true)) {
         LOG_ERROR("Failed to initialize SPIFFS");
-        return;
+        return false;
     }
     
     // Create necessary directories
@@ -255,19 +287,27 @@ void setup_filesystem() {
              used_bytes, total_bytes, (float)used_bytes / total_bytes * 100.0);
     
     LOG_INFO("Filesystem initialization completed");
+    return true;
+}
+
+/**
+ * @brief Initialize the E-ink display; the initial clear finishes on the display task
+ */
+bool setup_display(void* arg) {
+    return eink_manager.initialize();
 }
 
 /**
  * @brief Initialize communication systems
  */
-void setup_communication() {
+bool setup_communication(void* arg) {
     LOG_INFO("Initializing communication systems");
     
     // Initialize communication manager (handles all interfaces)
     CommunicationManager* commMgr = CommunicationManager::getInstance();
     if (!commMgr->initialize()) {
         LOG_ERROR("Failed to initialize communication manager");
-        return;
+        return false;
     }
     
     // Set preferred interface to WiFi
@@ -276,13 +316,57 @@ void setup_communication() {
     // Enable auto failover
     commMgr->setAutoFailover(true);
     
+#if BOARD_ENABLE_4G
+    // The power key sequence and AT handshake take seconds; nothing else waits for them
+    boot_start(BOOT_STAGE_MODEM, setup_modem, commMgr, BOOT_CORE_ANY);
+#endif
+    
     LOG_INFO("Communication systems initialized successfully");
+    return true;
+}
+
+/**
+ * @brief Power up the cellular modem and connect if configured to
+ */
+bool setup_modem(void* arg) {
+    CommunicationManager* commMgr = static_cast<CommunicationManager*>(arg);
+    CellularManager* cellular = commMgr->getCellularManager();
+    if (!cellular || !cellular->isInitialized()) {
+        return false;
+    }
+    
+    if (!cellular->powerOn()) {
+        return false;
+    }
+    if (cellular->getConfig().autoConnect) {
+        cellular->connect();
+    }
+    return true;
+}
+
+/**
+ * @brief Initialize services that run on top of the radios
+ */
+bool setup_services(void* arg) {
+    CommunicationManager* commMgr = CommunicationManager::getInstance();
+    
+    // Picks up a download interrupted by a reset; offers arrive from the server
+    if (!OtaManager::getInstance().initialize(commMgr)) {
+        LOG_ERROR("Failed to initialize OTA manager");
+    }
+    
+    // Radios start in the ACTIVE profile and power down as their traffic dies away
+    if (!PowerManager::getInstance().initialize(commMgr)) {
+        LOG_ERROR("Failed to initialize power manager");
+        return false;
+    }
+    return true;
 }
 
 /**
  * @brief Initialize applications
  */
-void setup_applications() {
+bool setup_applications(void* arg) {
     LOG_INFO("Initializing applications");
     
     // Initialize application manager
@@ -294,11 +378,12 @@ void setup_applications() {
     REGISTER_APP(FileManagerApp, "file_manager", false);
     REGISTER_APP(SettingsApp, "settings", false);
     
-    // Auto-start applications
+    // Auto-start applications are launched by the UI task once the first frame is out
     appManager.autoStartApps();
     
     LOG_INFO("Applications initialized - %d apps registered",
              appManager.getRegisteredApps().size());
+    return true;
 }
 
 /**
@@ -307,8 +392,8 @@ void setup_applications() {
 void main_task(void* parameter) {
     LOG_INFO("Main task started");
     
-    const TickType_t xDelay = pdMS_TO_TICKS(1000); // 1 second
     AppManager& appManager = AppManager::getInstance();
+    sched_source_t system_source = sched_register("system", NULL);
     
     while (1) {
         // Update application manager
@@ -325,36 +410,50 @@ void main_task(void* parameter) {
             appManager.handleMemoryWarning();
         }
         
+        // Account for the last second and re-plan profile and radio duty cycles;
+        // a low battery moves the power manager to field standby
+        PowerManager& powerManager = PowerManager::getInstance();
+        powerManager.update();
+        
         // Check power status
         uint16_t battery_mv = board_get_battery_voltage();
         if (battery_mv < BOARD_BAT_LOW_MV) {
             LOG_WARN("Low battery: %d mV", battery_mv);
-            // TODO: Trigger power saving mode
         }
         
         // Periodic tasks
         static uint32_t task_counter = 0;
         task_counter++;
         
+        if (task_counter % 10 == 0) { // Every 10 seconds
+            // Per-task CPU shares are deltas between consecutive samples
+            trace_sample_tasks();
+        }
+        
         if (task_counter % 60 == 0) { // Every minute
             log_flush();
             
             // Log system statistics
             AppManager::SystemStats stats = appManager.getSystemStats();
-            LOG_INFO("System Stats - Apps: %d/%d, Memory: %d KB, Uptime: %d min",
+            LOG_INFO("System Stats - Apps: %d/%d, Memory: %d KB, CPU: %.1f%%, Uptime: %d min",
                      stats.runningApps, stats.totalApps,
                      stats.totalMemoryUsed / 1024,
+                     stats.cpuUsage,
                      stats.uptime / 60000);
+            trace_log_summary();
+            powerManager.logReport();
         }
         
         if (task_counter % 300 == 0) { // Every 5 minutes
             // Save application configurations
             appManager.saveSystemConfig();
             // TODO: Sync with server
-            // TODO: Check for OTA updates
+            // Continue an update download that paused on a dropout
+            OtaManager::getInstance().resume();
         }
         
-        vTaskDelay(xDelay);
+        sched_set_deadline(system_source, 1000); // 1 second
+        sched_wait();
     }
 }
 
@@ -364,46 +463,64 @@ void main_task(void* parameter) {
 void ui_task(void* parameter) {
     LOG_INFO("UI task started");
     
-    const TickType_t xDelay = pdMS_TO_TICKS(10); // 10ms for smooth UI
+    AppManager& appManager = AppManager::getInstance();
+    sched_source_t lvgl_source = sched_register("lvgl", NULL);
+    sched_source_t eink_source = sched_register("eink", NULL);
     
     while (1) {
-        // Handle LVGL tasks
-        lv_timer_handler();
+        // Handle LVGL tasks; LVGL reports when its next timer is due
+        uint32_t lvgl_next = lv_timer_handler();
+        sched_set_deadline(lvgl_source, lvgl_next == LV_NO_TIMER_READY ? SCHED_NO_DEADLINE : lvgl_next);
         
-        // Handle E-ink display updates
-        eink_task_handler();
+        // Deferred auto-start apps, one per pass so input is handled in between
+        if (appManager.startDeferredApps()) {
+            sched_wake(lvgl_source);
+        }
+        
+#ifdef BENCH_BUILD
+        // Benchmark frames are rendered back to back
+        if (bench_ui_hook()) {
+            sched_wake(lvgl_source);
+        }
+#endif
         
-        vTaskDelay(xDelay);
+        // Handle E-ink display updates; held-back regions come with their own deadline
+        sched_set_deadline(eink_source, eink_task_handler());
+        
+        // Block until one of the two is due instead of polling every 10ms
+        sched_wait();
     }
 }
 
+/**
+ * @brief Log messages as the bus delivers them
+ */
+static void on_bus_message(const BusMessage& message, void* context) {
+    (void) context;
+    LOG_INFO("Received message (%d bytes) from interface %d", message.length, (int)message.interface);
+    // TODO: Process received message
+}
+
 /**
  * @brief Communication task - handles all communication protocols
  */
 void comm_task(void* parameter) {
     LOG_INFO("Communication task started");
     
-    const TickType_t xDelay = pdMS_TO_TICKS(1000); // 1 second
     CommunicationManager* commMgr = CommunicationManager::getInstance();
+    sched_source_t test_source = sched_register("comm_test", NULL);
+    sched_source_t stats_source = sched_register("comm_stats", NULL);
     
-    // Buffer for receiving messages
-    uint8_t rxBuffer[256];
-    size_t receivedLength;
-    comm_interface_t sourceInterface;
+    // Incoming messages are pushed by the bus task; this loop only does periodic work
+    MessageBus::getInstance().subscribe(BUS_TOPIC_ANY, on_bus_message);
     
     // Test message counter
     uint32_t messageCounter = 0;
     
     while (1) {
-        // Check for incoming messages
-        if (commMgr->receiveMessage(rxBuffer, sizeof(rxBuffer), &receivedLength, &sourceInterface)) {
-            LOG_INFO("Received message (%d bytes) from interface %d", receivedLength, sourceInterface);
-            // TODO: Process received message
-        }
-        
         // Send periodic test message every 30 seconds
         static uint32_t lastTestMessage = 0;
-        uint32_t currentTime = xTaskGetTickCount() * portTICK_PERIOD_MS;
+        uint32_t currentTime = millis(); // Tick count stands still in light sleep; millis() does not
         
         if (currentTime - lastTestMessage >= 30000) {
             char testMessage[64];
@@ -429,6 +546,9 @@ void comm_task(void* parameter) {
             lastStatsLog = currentTime;
         }
         
-        vTaskDelay(xDelay);
+        // Sleep until the earlier of the two periodic jobs is due
+        sched_set_deadline(test_source, 30000 - (currentTime - lastTestMessage));
+        sched_set_deadline(stats_source, 60000 - (currentTime - lastStatsLog));
+        sched_wait();
     }
 }
\ No newline at end of file
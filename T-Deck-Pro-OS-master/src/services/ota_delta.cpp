@@ -0,0 +1,227 @@
+/**
+ * @file ota_delta.cpp
+ * @brief Streaming delta image decoder implementation
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ */
+
+#include "ota_delta.h"
+#include "core/utils/logger.h"
+#include <string.h>
+
+namespace {
+
+uint32_t readLE32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+} // namespace
+
+OtaDeltaDecoder::OtaDeltaDecoder()
+    : m_output(nullptr)
+    , m_outputContext(nullptr)
+    , m_baseRead(nullptr)
+    , m_baseContext(nullptr)
+{
+    reset();
+}
+
+void OtaDeltaDecoder::setOutput(OtaDeltaOutput output, void* context) {
+    m_output = output;
+    m_outputContext = context;
+}
+
+void OtaDeltaDecoder::setBase(OtaDeltaBaseRead baseRead, void* context) {
+    m_baseRead = baseRead;
+    m_baseContext = context;
+}
+
+void OtaDeltaDecoder::reset() {
+    memset(&m_state, 0, sizeof(m_state));
+    m_state.phase = PHASE_HEADER;
+}
+
+bool OtaDeltaDecoder::feed(const uint8_t* data, size_t length) {
+    while (m_state.phase != PHASE_DONE && m_state.phase != PHASE_ERROR) {
+        size_t used = 0;
+
+        if (m_state.phase == PHASE_DIFF && m_state.tokenRemaining && !m_state.tokenLiteral) {
+            // Copy tokens need no input, so they also run when the patch ends on one
+            size_t run = m_state.tokenRemaining;
+            if (!applyDiff(nullptr, run)) {
+                return false;
+            }
+            m_state.tokenRemaining -= run;
+            m_state.remaining -= run;
+            advance();
+            continue;
+        }
+
+        if (!length) {
+            break;
+        }
+
+        switch (m_state.phase) {
+            case PHASE_HEADER:
+                used = collect(data, length, OTA_DELTA_HEADER_SIZE);
+                if (m_state.pendingLength == OTA_DELTA_HEADER_SIZE && !parseHeader()) {
+                    return false;
+                }
+                break;
+
+            case PHASE_RECORD:
+                used = collect(data, length, OTA_DELTA_RECORD_SIZE);
+                if (m_state.pendingLength == OTA_DELTA_RECORD_SIZE && !parseRecord()) {
+                    return false;
+                }
+                break;
+
+            case PHASE_DIFF:
+                if (!m_state.tokenRemaining) {
+                    used = 1;
+                    if (!parseToken(data[0])) {
+                        return false;
+                    }
+                    break;
+                }
+                used = length < m_state.tokenRemaining ? length : m_state.tokenRemaining;
+                if (!applyDiff(data, used)) {
+                    return false;
+                }
+                m_state.tokenRemaining -= used;
+                m_state.remaining -= used;
+                break;
+
+            case PHASE_EXTRA:
+                used = length < m_state.remaining ? length : m_state.remaining;
+                if (!emit(data, used)) {
+                    return false;
+                }
+                m_state.remaining -= used;
+                break;
+
+            default:
+                break;
+        }
+
+        data += used;
+        length -= used;
+        advance();
+    }
+
+    if (length && m_state.phase == PHASE_DONE) {
+        return fail("trailing data");
+    }
+    return m_state.phase != PHASE_ERROR;
+}
+
+size_t OtaDeltaDecoder::collect(const uint8_t* data, size_t length, size_t needed) {
+    size_t take = needed - m_state.pendingLength;
+    if (take > length) take = length;
+    memcpy(m_state.pending + m_state.pendingLength, data, take);
+    m_state.pendingLength += take;
+    return take;
+}
+
+bool OtaDeltaDecoder::parseHeader() {
+    if (memcmp(m_state.pending, OTA_DELTA_MAGIC, 4) != 0) {
+        return fail("bad magic");
+    }
+
+    m_state.targetSize = readLE32(m_state.pending + 4);
+    m_state.baseSize = readLE32(m_state.pending + 8);
+    m_state.pendingLength = 0;
+    m_state.phase = m_state.targetSize ? PHASE_RECORD : PHASE_DONE;
+    return true;
+}
+
+bool OtaDeltaDecoder::parseRecord() {
+    uint32_t diffLength = readLE32(m_state.pending);
+    uint32_t extraLength = readLE32(m_state.pending + 4);
+    m_state.seek = (int32_t)readLE32(m_state.pending + 8);
+    m_state.pendingLength = 0;
+
+    // A record may not run past the target; this also catches a corrupted control word
+    uint32_t left = m_state.targetSize - m_state.produced;
+    if (diffLength > left || extraLength > left - diffLength) {
+        return fail("record exceeds target");
+    }
+
+    m_state.remaining = diffLength;
+    m_state.extraLength = extraLength;
+    m_state.tokenRemaining = 0;
+    m_state.phase = PHASE_DIFF;
+    return true;
+}
+
+bool OtaDeltaDecoder::parseToken(uint8_t token) {
+    uint8_t run = (token & 0x7F) + 1;
+    if (run > m_state.remaining) {
+        return fail("token exceeds diff run");
+    }
+
+    m_state.tokenRemaining = run;
+    m_state.tokenLiteral = (token & 0x80) ? 1 : 0;
+    return true;
+}
+
+void OtaDeltaDecoder::advance() {
+    // Step over finished runs, including empty ones, without waiting for more input
+    if (m_state.phase == PHASE_DIFF && m_state.remaining == 0) {
+        m_state.remaining = m_state.extraLength;
+        m_state.phase = PHASE_EXTRA;
+    }
+
+    if (m_state.phase == PHASE_EXTRA && m_state.remaining == 0) {
+        m_state.basePosition += m_state.seek;
+        m_state.phase = m_state.produced >= m_state.targetSize ? PHASE_DONE : PHASE_RECORD;
+    }
+}
+
+bool OtaDeltaDecoder::applyDiff(const uint8_t* deltas, size_t length) {
+    if (!m_baseRead) {
+        return fail("no base image");
+    }
+
+    while (length) {
+        size_t run = length < sizeof(m_scratch) ? length : sizeof(m_scratch);
+
+        // Only the part of the window that overlaps the base is read
+        memset(m_scratch, 0, run);
+        int64_t start = m_state.basePosition;
+        int64_t end = start + (int64_t)run;
+        int64_t from = start < 0 ? 0 : start;
+        int64_t to = end > (int64_t)m_state.baseSize ? (int64_t)m_state.baseSize : end;
+        if (from < to && !m_baseRead((uint32_t)from, m_scratch + (from - start), (size_t)(to - from), m_baseContext)) {
+            return fail("base read failed");
+        }
+
+        if (deltas) {
+            for (size_t i = 0; i < run; i++) {
+                m_scratch[i] += deltas[i];
+            }
+            deltas += run;
+        }
+
+        if (!emit(m_scratch, run)) {
+            return false;
+        }
+        m_state.basePosition += (int32_t)run;
+        length -= run;
+    }
+    return true;
+}
+
+bool OtaDeltaDecoder::emit(const uint8_t* data, size_t length) {
+    if (!m_output || !m_output(data, length, m_outputContext)) {
+        return fail("output rejected");
+    }
+    m_state.produced += length;
+    return true;
+}
+
+bool OtaDeltaDecoder::fail(const char* reason) {
+    LOG_ERROR_TAG("OTA", "Delta patch: %s at output offset %u", reason, m_state.produced);
+    m_state.phase = PHASE_ERROR;
+    return false;
+}
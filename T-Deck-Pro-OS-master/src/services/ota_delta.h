@@ -0,0 +1,124 @@
+/**
+ * @file ota_delta.h
+ * @brief Streaming decoder for bsdiff-style delta firmware images
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ *
+ * Patch layout, all integers little endian:
+ *
+ *   header   "TDD1", target size u32, base size u32, reserved u32
+ *   record   diff length u32, extra length u32, seek i32
+ *            diff tokens  producing diff length bytes from the base at the
+ *                         current base position:
+ *                         0x00-0x7F  copy n + 1 base bytes unchanged
+ *                         0x80-0xFF  n - 127 deltas follow, each added to a base byte
+ *            extra bytes  copied to the output as is
+ *            the base position then moves by seek
+ *
+ * Records repeat until the target size has been produced. This is bsdiff's
+ * control/diff/extra triplet interleaved into one stream, with the zero runs
+ * bsdiff leaves to bzip2 tokenized instead, so the patch can be applied as it
+ * arrives with no seeking and no decompressor window. The decoder state is a
+ * plain struct that can be persisted between chunks. Patches are built by
+ * server-infrastructure/ota_delta.py.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#define OTA_DELTA_MAGIC "TDD1"
+#define OTA_DELTA_HEADER_SIZE 16
+#define OTA_DELTA_RECORD_SIZE 12
+#define OTA_DELTA_SCRATCH_SIZE 256
+
+/**
+ * @brief Consumes decoded output; returns false to abort
+ */
+typedef bool (*OtaDeltaOutput)(const uint8_t* data, size_t length, void* context);
+
+/**
+ * @brief Reads from the base image; returns false on a read error
+ */
+typedef bool (*OtaDeltaBaseRead)(uint32_t offset, uint8_t* data, size_t length, void* context);
+
+class OtaDeltaDecoder {
+public:
+    enum Phase : uint8_t {
+        PHASE_HEADER,
+        PHASE_RECORD,
+        PHASE_DIFF,
+        PHASE_EXTRA,
+        PHASE_DONE,
+        PHASE_ERROR
+    };
+
+    /**
+     * @brief Decoder position, valid to persist between feed() calls
+     */
+    struct State {
+        uint8_t phase;
+        uint8_t pendingLength;                  // Header or record bytes collected so far
+        uint8_t pending[OTA_DELTA_HEADER_SIZE];
+        uint8_t tokenRemaining;                 // Output bytes left in the current diff token
+        uint8_t tokenLiteral;                   // Current token carries deltas
+        uint32_t remaining;                     // Output bytes left in the current diff or extra run
+        uint32_t extraLength;                   // Extra run following the current diff run
+        int32_t seek;                           // Applied after the extra run
+        int32_t basePosition;                   // May leave the base; bytes outside it read as 0
+        uint32_t targetSize;
+        uint32_t baseSize;
+        uint32_t produced;
+    };
+
+    OtaDeltaDecoder();
+
+    /**
+     * @brief Set where output goes and where base bytes come from
+     */
+    void setOutput(OtaDeltaOutput output, void* context);
+    void setBase(OtaDeltaBaseRead baseRead, void* context);
+
+    /**
+     * @brief Start a new patch
+     */
+    void reset();
+
+    /**
+     * @brief Continue from a persisted position
+     */
+    void restore(const State& state) { m_state = state; }
+    const State& getState() const { return m_state; }
+
+    /**
+     * @brief Decode the next patch bytes
+     * @return false on a malformed patch, base read error or rejected output
+     */
+    bool feed(const uint8_t* data, size_t length);
+
+    bool isComplete() const { return m_state.phase == PHASE_DONE; }
+    bool hasFailed() const { return m_state.phase == PHASE_ERROR; }
+
+    /**
+     * @brief Target size from the patch header, 0 until the header has been read
+     */
+    uint32_t getTargetSize() const { return m_state.targetSize; }
+    uint32_t getBaseSize() const { return m_state.baseSize; }
+
+private:
+    State m_state;
+    OtaDeltaOutput m_output;
+    void* m_outputContext;
+    OtaDeltaBaseRead m_baseRead;
+    void* m_baseContext;
+    uint8_t m_scratch[OTA_DELTA_SCRATCH_SIZE];
+
+    size_t collect(const uint8_t* data, size_t length, size_t needed);
+    bool parseHeader();
+    bool parseRecord();
+    bool parseToken(uint8_t token);
+    bool applyDiff(const uint8_t* deltas, size_t length);
+    bool emit(const uint8_t* data, size_t length);
+    void advance();
+    bool fail(const char* reason);
+};
@@ -0,0 +1,553 @@
+/**
+ * @file ota_manager.cpp
+ * @brief Chunked, resumable OTA download pipeline implementation
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ */
+
+#include "ota_manager.h"
+#include "core/communication/communication_manager.h"
+#include "core/communication/link_scorer.h"
+#include "core/utils/logger.h"
+#include <strings.h>
+
+using namespace TDeckOS::Communication;
+
+namespace {
+
+constexpr uint32_t CHECKPOINT_MAGIC = 0x4F544131; // "OTA1"
+
+bool digestMatches(const uint8_t* digest, const String& hex) {
+    char text[65];
+    for (int i = 0; i < 32; i++) {
+        snprintf(text + i * 2, 3, "%02x", digest[i]);
+    }
+    return hex.length() == 64 && strcasecmp(text, hex.c_str()) == 0;
+}
+
+} // namespace
+
+OtaManager& OtaManager::getInstance() {
+    static OtaManager instance;
+    return instance;
+}
+
+OtaManager::OtaManager()
+    : m_transport(nullptr)
+    , m_hasCheckpoint(false)
+    , m_useDelta(false)
+    , m_autoReboot(true)
+    , m_cancel(false)
+    , m_target(nullptr)
+    , m_running(nullptr)
+    , m_taskHandle(nullptr)
+    , m_mutex(nullptr)
+    , m_initialized(false)
+{
+    m_offer.size = 0;
+    m_offer.deltaSize = 0;
+    m_progress = OtaProgress{};
+    m_progress.state = OtaState::IDLE;
+    m_progress.link = CommInterface::WIFI;
+    memset(&m_checkpoint, 0, sizeof(m_checkpoint));
+}
+
+bool OtaManager::initialize(CommunicationManager* comm) {
+    if (m_initialized) {
+        return true;
+    }
+
+    m_cellularTransport.setCellularManager(comm ? comm->getCellularManager() : nullptr);
+
+    m_mutex = xSemaphoreCreateMutex();
+    if (!m_mutex) {
+        LOG_ERROR_TAG("OTA", "Failed to create mutex");
+        return false;
+    }
+
+    // The first boot of an updated image is confirmed once the OS has come up this far
+    m_running = esp_ota_get_running_partition();
+    esp_ota_img_states_t imageState;
+    if (esp_ota_get_state_partition(m_running, &imageState) == ESP_OK &&
+        imageState == ESP_OTA_IMG_PENDING_VERIFY) {
+        esp_ota_mark_app_valid_cancel_rollback();
+        LOG_INFO_TAG("OTA", "Firmware %s confirmed", FIRMWARE_VERSION);
+    }
+
+    if (!m_prefs.begin(OTA_PREFS_NAMESPACE, false)) {
+        LOG_ERROR_TAG("OTA", "Failed to open NVS namespace");
+        return false;
+    }
+
+    m_initialized = true;
+
+    if (loadOffer()) {
+        m_progress.state = OtaState::PAUSED;
+        m_progress.version = m_offer.version;
+        m_progress.delta = m_useDelta;
+        m_progress.received = m_checkpoint.received;
+        m_progress.total = m_useDelta ? m_offer.deltaSize : m_offer.size;
+        m_progress.written = m_checkpoint.written;
+        LOG_INFO_TAG("OTA", "Interrupted download of %s at %u/%u bytes", m_offer.version.c_str(),
+                     m_progress.received, m_progress.total);
+    }
+
+    LOG_INFO_TAG("OTA", "OTA manager initialized, running %s from %s", FIRMWARE_VERSION,
+                 m_running ? m_running->label : "?");
+    return true;
+}
+
+bool OtaManager::start(const OtaOffer& offer) {
+    if (!m_initialized || offer.url.isEmpty() || offer.size == 0) {
+        return false;
+    }
+
+    if (offer.version == FIRMWARE_VERSION) {
+        LOG_DEBUG_TAG("OTA", "Already running %s", FIRMWARE_VERSION);
+        return false;
+    }
+
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    if (m_taskHandle) {
+        bool same = offer.sha256.equalsIgnoreCase(m_offer.sha256);
+        xSemaphoreGive(m_mutex);
+        if (!same) {
+            LOG_WARN_TAG("OTA", "Ignoring %s while %s downloads", offer.version.c_str(), m_offer.version.c_str());
+        }
+        return same;
+    }
+    xSemaphoreGive(m_mutex);
+
+    if (m_hasCheckpoint && offer.sha256.equalsIgnoreCase(m_offer.sha256)) {
+        LOG_INFO_TAG("OTA", "Continuing download of %s", offer.version.c_str());
+    } else {
+        clearCheckpoint();
+        m_offer = offer;
+        m_useDelta = !offer.deltaUrl.isEmpty() && offer.deltaSize && baseMatches(offer.baseDigest);
+        if (!offer.deltaUrl.isEmpty() && !m_useDelta) {
+            LOG_INFO_TAG("OTA", "Running image is not the patch base, using the full image");
+        }
+        saveOffer();
+        m_progress.retries = 0;
+        m_progress.resumes = 0;
+    }
+
+    return launch();
+}
+
+bool OtaManager::resume() {
+    if (!m_initialized || m_taskHandle || m_offer.size == 0) {
+        return false;
+    }
+
+    OtaState state = getProgress().state;
+    if (state != OtaState::PAUSED) {
+        return false;
+    }
+    return launch();
+}
+
+void OtaManager::cancel() {
+    m_cancel = true;
+    if (!m_taskHandle) {
+        clearCheckpoint();
+        m_offer.size = 0;
+        setState(OtaState::IDLE);
+    }
+}
+
+bool OtaManager::isBusy() const {
+    return m_taskHandle != nullptr;
+}
+
+OtaProgress OtaManager::getProgress() const {
+    OtaProgress progress;
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    progress = m_progress;
+    xSemaphoreGive(m_mutex);
+    return progress;
+}
+
+bool OtaManager::launch() {
+    m_cancel = false;
+    setState(OtaState::DOWNLOADING);
+
+    // Core 0 with the radios; the flash writes stall that core's cache, not the UI's
+    BaseType_t result = xTaskCreatePinnedToCore(otaTask, "OTATask", OTA_TASK_STACK_SIZE, this,
+                                                OTA_TASK_PRIORITY, &m_taskHandle, 0);
+    if (result != pdPASS) {
+        LOG_ERROR_TAG("OTA", "Failed to create OTA task");
+        m_taskHandle = nullptr;
+        setState(OtaState::PAUSED);
+        return false;
+    }
+    return true;
+}
+
+void OtaManager::otaTask(void* parameter) {
+    OtaManager* manager = static_cast<OtaManager*>(parameter);
+    manager->run();
+
+    xSemaphoreTake(manager->m_mutex, portMAX_DELAY);
+    manager->m_taskHandle = nullptr;
+    xSemaphoreGive(manager->m_mutex);
+    vTaskDelete(NULL);
+}
+
+void OtaManager::run() {
+    for (;;) {
+        if (!prepare()) {
+            setState(OtaState::FAILED);
+            return;
+        }
+
+        Outcome outcome = download();
+        if (m_transport) {
+            m_transport->close();
+            m_transport = nullptr;
+        }
+
+        bool installed = outcome == Outcome::COMPLETE && !m_cancel && finish();
+        mbedtls_sha256_free(&m_sha);
+
+        if (m_cancel) {
+            clearCheckpoint();
+            setState(OtaState::IDLE);
+            return;
+        }
+
+        if (outcome == Outcome::INTERRUPTED) {
+            saveCheckpoint();
+            setState(OtaState::PAUSED);
+            LOG_INFO_TAG("OTA", "Download paused at %u bytes", m_checkpoint.received);
+            return;
+        }
+
+        if (installed) {
+            clearCheckpoint();
+            setState(OtaState::READY);
+            LOG_INFO_TAG("OTA", "Firmware %s verified and installed on %s", m_offer.version.c_str(),
+                         m_target->label);
+            if (m_autoReboot) {
+                log_flush();
+                vTaskDelay(pdMS_TO_TICKS(OTA_REBOOT_DELAY_MS));
+                ESP.restart();
+            }
+            return;
+        }
+
+        if (!m_useDelta) {
+            clearCheckpoint();
+            setState(OtaState::FAILED);
+            return;
+        }
+        fallBackToFull(outcome == Outcome::CORRUPT ? "patch rejected" : "patched image does not verify");
+    }
+}
+
+bool OtaManager::prepare() {
+    m_target = esp_ota_get_next_update_partition(nullptr);
+    if (!m_target) {
+        LOG_ERROR_TAG("OTA", "No OTA partition to write to");
+        return false;
+    }
+
+    if (m_offer.size > m_target->size) {
+        LOG_ERROR_TAG("OTA", "Image of %u bytes exceeds partition %s (%u bytes)", m_offer.size,
+                      m_target->label, m_target->size);
+        return false;
+    }
+
+    mbedtls_sha256_init(&m_sha);
+    mbedtls_sha256_starts(&m_sha, 0);
+    m_decoder.setOutput(deltaOutput, this);
+    m_decoder.setBase(deltaBaseRead, this);
+
+    if (m_hasCheckpoint) {
+        if (rehashWritten()) {
+            m_decoder.restore(m_checkpoint.decoder);
+            xSemaphoreTake(m_mutex, portMAX_DELAY);
+            m_progress.resumes++;
+            xSemaphoreGive(m_mutex);
+            LOG_INFO_TAG("OTA", "Resuming %s at %u bytes, %u on flash", m_offer.version.c_str(),
+                         m_checkpoint.received, m_checkpoint.written);
+        } else {
+            LOG_WARN_TAG("OTA", "Could not re-read partial image, starting over");
+            clearCheckpoint();
+            mbedtls_sha256_free(&m_sha);
+            mbedtls_sha256_init(&m_sha);
+            mbedtls_sha256_starts(&m_sha, 0);
+        }
+    }
+
+    if (!m_hasCheckpoint) {
+        memset(&m_checkpoint, 0, sizeof(m_checkpoint));
+        m_checkpoint.magic = CHECKPOINT_MAGIC;
+        m_checkpoint.partitionAddress = m_target->address;
+        m_checkpoint.delta = m_useDelta;
+        m_decoder.reset();
+        LOG_INFO_TAG("OTA", "Downloading %s (%s, %u bytes) to %s", m_offer.version.c_str(),
+                     m_useDelta ? "delta" : "full", m_useDelta ? m_offer.deltaSize : m_offer.size,
+                     m_target->label);
+    }
+
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    m_progress.version = m_offer.version;
+    m_progress.delta = m_useDelta;
+    m_progress.total = m_useDelta ? m_offer.deltaSize : m_offer.size;
+    m_progress.received = m_checkpoint.received;
+    m_progress.written = m_checkpoint.written;
+    xSemaphoreGive(m_mutex);
+    return true;
+}
+
+OtaManager::Outcome OtaManager::download() {
+    const String& url = m_useDelta ? m_offer.deltaUrl : m_offer.url;
+    uint32_t total = m_useDelta ? m_offer.deltaSize : m_offer.size;
+    uint32_t lastCheckpoint = m_checkpoint.received;
+    uint32_t failures = 0;
+
+    while (m_checkpoint.received < total) {
+        if (m_cancel) {
+            return Outcome::INTERRUPTED;
+        }
+
+        OtaTransport* transport = selectTransport();
+        if (!transport) {
+            LOG_WARN_TAG("OTA", "No link for the download");
+            return Outcome::INTERRUPTED;
+        }
+
+        size_t length = total - m_checkpoint.received;
+        if (length > OTA_CHUNK_SIZE) length = OTA_CHUNK_SIZE;
+
+        // The outcome feeds link scoring, so a slow or failing link loses the download
+        uint32_t started = millis();
+        int count = transport->fetch(url, m_checkpoint.received, m_chunk, length);
+        bool fetched = count == (int)length;
+        LinkScorer::getInstance().recordSend(transport->getInterface(), fetched, length, millis() - started);
+
+        if (!fetched) {
+            failures++;
+            xSemaphoreTake(m_mutex, portMAX_DELAY);
+            m_progress.retries++;
+            xSemaphoreGive(m_mutex);
+            if (failures >= OTA_MAX_RETRIES) {
+                return Outcome::INTERRUPTED;
+            }
+
+            uint32_t backoff = OTA_RETRY_BASE_MS << (failures - 1);
+            if (backoff > OTA_RETRY_MAX_MS) backoff = OTA_RETRY_MAX_MS;
+            vTaskDelay(pdMS_TO_TICKS(backoff));
+            continue;
+        }
+        failures = 0;
+
+        bool consumed = m_useDelta ? m_decoder.feed(m_chunk, length) : writeImage(m_chunk, length);
+        if (!consumed) {
+            return Outcome::CORRUPT;
+        }
+        m_checkpoint.received += length;
+
+        xSemaphoreTake(m_mutex, portMAX_DELAY);
+        m_progress.received = m_checkpoint.received;
+        m_progress.written = m_checkpoint.written;
+        xSemaphoreGive(m_mutex);
+
+        if (m_checkpoint.received - lastCheckpoint >= OTA_CHECKPOINT_BYTES) {
+            saveCheckpoint();
+            lastCheckpoint = m_checkpoint.received;
+        }
+    }
+    return Outcome::COMPLETE;
+}
+
+bool OtaManager::finish() {
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&m_sha, digest);
+
+    if (m_useDelta && !m_decoder.isComplete()) {
+        LOG_ERROR_TAG("OTA", "Patch ended before the image was complete");
+        return false;
+    }
+
+    if (m_checkpoint.written != m_offer.size) {
+        LOG_ERROR_TAG("OTA", "Image is %u bytes, expected %u", m_checkpoint.written, m_offer.size);
+        return false;
+    }
+
+    if (!digestMatches(digest, m_offer.sha256)) {
+        LOG_ERROR_TAG("OTA", "SHA-256 mismatch for %s", m_offer.version.c_str());
+        return false;
+    }
+
+    // Also checks the image header and segments before switching
+    esp_err_t err = esp_ota_set_boot_partition(m_target);
+    if (err != ESP_OK) {
+        LOG_ERROR_TAG("OTA", "Image rejected: %s", esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
+
+void OtaManager::setState(OtaState state) {
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    m_progress.state = state;
+    xSemaphoreGive(m_mutex);
+}
+
+OtaTransport* OtaManager::selectTransport() {
+    CommInterface order[COMM_INTERFACE_COUNT];
+    size_t count = LinkScorer::getInstance().rank(MessageClass::BULK, order);
+
+    OtaTransport* chosen = nullptr;
+    for (size_t i = 0; i < count && !chosen; i++) {
+        if (order[i] == CommInterface::WIFI && m_wifiTransport.isAvailable()) {
+            chosen = &m_wifiTransport;
+        } else if (order[i] == CommInterface::CELLULAR && m_cellularTransport.isAvailable()) {
+            chosen = &m_cellularTransport;
+        }
+    }
+
+    // Scores lag behind a link coming up; any live link beats pausing
+    if (!chosen) {
+        if (m_wifiTransport.isAvailable()) {
+            chosen = &m_wifiTransport;
+        } else if (m_cellularTransport.isAvailable()) {
+            chosen = &m_cellularTransport;
+        }
+    }
+
+    if (chosen != m_transport) {
+        if (m_transport) {
+            m_transport->close();
+        }
+        m_transport = chosen;
+        if (chosen) {
+            LOG_INFO_TAG("OTA", "Downloading over %s",
+                         chosen->getInterface() == CommInterface::WIFI ? "WiFi" : "cellular");
+            xSemaphoreTake(m_mutex, portMAX_DELAY);
+            m_progress.link = chosen->getInterface();
+            xSemaphoreGive(m_mutex);
+        }
+    }
+    return chosen;
+}
+
+bool OtaManager::writeImage(const uint8_t* data, size_t length) {
+    if (m_checkpoint.written + length > m_target->size) {
+        LOG_ERROR_TAG("OTA", "Image overruns partition %s", m_target->label);
+        return false;
+    }
+
+    while (m_checkpoint.erased < m_checkpoint.written + length) {
+        esp_err_t err = esp_partition_erase_range(m_target, m_checkpoint.erased, SPI_FLASH_SEC_SIZE);
+        if (err != ESP_OK) {
+            LOG_ERROR_TAG("OTA", "Erase at 0x%x failed: %s", m_checkpoint.erased, esp_err_to_name(err));
+            return false;
+        }
+        m_checkpoint.erased += SPI_FLASH_SEC_SIZE;
+    }
+
+    // After a reset, bytes past the checkpoint may already hold this data; flash
+    // programming only clears bits, so writing the same bytes again is harmless
+    esp_err_t err = esp_partition_write(m_target, m_checkpoint.written, data, length);
+    if (err != ESP_OK) {
+        LOG_ERROR_TAG("OTA", "Write at 0x%x failed: %s", m_checkpoint.written, esp_err_to_name(err));
+        return false;
+    }
+
+    mbedtls_sha256_update(&m_sha, data, length);
+    m_checkpoint.written += length;
+    return true;
+}
+
+bool OtaManager::rehashWritten() {
+    for (uint32_t offset = 0; offset < m_checkpoint.written; offset += OTA_CHUNK_SIZE) {
+        size_t length = m_checkpoint.written - offset;
+        if (length > OTA_CHUNK_SIZE) length = OTA_CHUNK_SIZE;
+        if (esp_partition_read(m_target, offset, m_chunk, length) != ESP_OK) {
+            return false;
+        }
+        mbedtls_sha256_update(&m_sha, m_chunk, length);
+    }
+    return true;
+}
+
+bool OtaManager::baseMatches(const String& baseDigest) const {
+    uint8_t digest[32];
+    if (!m_running || esp_partition_get_sha256(m_running, digest) != ESP_OK) {
+        return false;
+    }
+    return digestMatches(digest, baseDigest);
+}
+
+void OtaManager::fallBackToFull(const char* reason) {
+    LOG_WARN_TAG("OTA", "Delta update failed (%s), downloading the full image", reason);
+    clearCheckpoint();
+    m_useDelta = false;
+    saveOffer();
+}
+
+void OtaManager::saveOffer() {
+    m_prefs.putString("version", m_offer.version);
+    m_prefs.putString("url", m_offer.url);
+    m_prefs.putString("sha", m_offer.sha256);
+    m_prefs.putUInt("size", m_offer.size);
+    m_prefs.putString("durl", m_useDelta ? m_offer.deltaUrl : String());
+    m_prefs.putUInt("dsize", m_useDelta ? m_offer.deltaSize : 0);
+    m_prefs.putString("bdig", m_offer.baseDigest);
+}
+
+bool OtaManager::loadOffer() {
+    if (!m_prefs.isKey("ckpt") || m_prefs.getBytesLength("ckpt") != sizeof(m_checkpoint)) {
+        return false;
+    }
+
+    m_prefs.getBytes("ckpt", &m_checkpoint, sizeof(m_checkpoint));
+    m_offer.version = m_prefs.getString("version");
+    m_offer.url = m_prefs.getString("url");
+    m_offer.sha256 = m_prefs.getString("sha");
+    m_offer.size = m_prefs.getUInt("size");
+    m_offer.deltaUrl = m_prefs.getString("durl");
+    m_offer.deltaSize = m_prefs.getUInt("dsize");
+    m_offer.baseDigest = m_prefs.getString("bdig");
+    m_useDelta = m_checkpoint.delta;
+
+    // The update may have been installed since, or the other slot is now the running one
+    const esp_partition_t* target = esp_ota_get_next_update_partition(nullptr);
+    if (m_checkpoint.magic != CHECKPOINT_MAGIC || !target || target->address != m_checkpoint.partitionAddress ||
+        m_offer.version == FIRMWARE_VERSION || m_offer.size == 0 || (m_useDelta && m_offer.deltaUrl.isEmpty())) {
+        clearCheckpoint();
+        m_offer.size = 0;
+        return false;
+    }
+
+    m_hasCheckpoint = true;
+    return true;
+}
+
+void OtaManager::saveCheckpoint() {
+    m_checkpoint.decoder = m_decoder.getState();
+    m_prefs.putBytes("ckpt", &m_checkpoint, sizeof(m_checkpoint));
+    m_hasCheckpoint = true;
+}
+
+void OtaManager::clearCheckpoint() {
+    if (m_initialized) {
+        m_prefs.remove("ckpt");
+    }
+    m_hasCheckpoint = false;
+}
+
+bool OtaManager::deltaOutput(const uint8_t* data, size_t length, void* context) {
+    return static_cast<OtaManager*>(context)->writeImage(data, length);
+}
+
+bool OtaManager::deltaBaseRead(uint32_t offset, uint8_t* data, size_t length, void* context) {
+    OtaManager* manager = static_cast<OtaManager*>(context);
+    if (!manager->m_running || offset + length > manager->m_running->size) {
+        return false;
+    }
+    return esp_partition_read(manager->m_running, offset, data, length) == ESP_OK;
+}
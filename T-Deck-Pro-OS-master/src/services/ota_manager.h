@@ -0,0 +1,206 @@
+/**
+ * @file ota_manager.h
+ * @brief Chunked, resumable firmware updates written straight to the inactive partition
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ *
+ * Images are fetched in OTA_CHUNK_SIZE HTTP ranges over whichever link the
+ * link scorer ranks best for bulk traffic, re-checked before every chunk.
+ * Each chunk is written to the next OTA partition as it arrives and folded
+ * into a SHA-256 of the image, so nothing larger than a chunk is buffered.
+ *
+ * Progress is checkpointed to NVS every OTA_CHECKPOINT_BYTES. After a dropout
+ * or reset the download continues from the last checkpoint: the bytes already
+ * on flash are hashed again and fetching resumes where they end. Delta images
+ * (see ota_delta.h) are applied against the running partition while they
+ * stream, and the download falls back to the full image if the running image
+ * is not the patch's base or the patched result does not verify.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include "ota_delta.h"
+#include "ota_transport.h"
+
+namespace TDeckOS {
+namespace Communication {
+class CommunicationManager;
+}
+}
+
+// ===== CONFIGURATION =====
+#ifndef FIRMWARE_VERSION
+#define FIRMWARE_VERSION "1.0.0"
+#endif
+
+#ifndef OTA_CHUNK_SIZE
+#define OTA_CHUNK_SIZE 4096                         // One flash sector per full-image chunk
+#endif
+
+#ifndef OTA_CHECKPOINT_BYTES
+#define OTA_CHECKPOINT_BYTES (16 * OTA_CHUNK_SIZE)  // Download lost at most on a reset
+#endif
+
+#define OTA_MAX_RETRIES 8                           // Consecutive failed chunks before pausing
+#define OTA_RETRY_BASE_MS 1000                      // Backoff doubles per failure up to the maximum
+#define OTA_RETRY_MAX_MS 30000
+#define OTA_TASK_STACK_SIZE 8192
+#define OTA_TASK_PRIORITY 1
+#define OTA_REBOOT_DELAY_MS 3000
+#define OTA_PREFS_NAMESPACE "ota"
+
+// ===== DATA STRUCTURES =====
+
+/**
+ * @brief Update offered by the server
+ */
+struct OtaOffer {
+    String version;
+    String url;                 // Full image
+    String sha256;              // Hex digest of the full image, also the delta's result
+    uint32_t size;
+    String deltaUrl;            // Empty when no patch against the running version exists
+    uint32_t deltaSize;
+    String baseDigest;          // Hex image digest of the base the patch applies to
+};
+
+enum class OtaState : uint8_t {
+    IDLE,
+    DOWNLOADING,
+    PAUSED,                     // Link down or too many failures; resume() continues
+    READY,                      // Verified and set as boot partition
+    FAILED
+};
+
+struct OtaProgress {
+    OtaState state;
+    String version;
+    bool delta;
+    uint32_t received;          // Bytes fetched of the image or patch
+    uint32_t total;
+    uint32_t written;           // Bytes of the target image on flash
+    uint32_t retries;
+    uint32_t resumes;
+    TDeckOS::Communication::CommInterface link;
+};
+
+/**
+ * @brief Downloads, verifies and installs firmware updates
+ */
+class OtaManager {
+public:
+    static OtaManager& getInstance();
+
+    /**
+     * @brief Confirm the running image and load any interrupted download
+     * @param comm Communication manager providing the links
+     * @return true if successful, false otherwise
+     */
+    bool initialize(TDeckOS::Communication::CommunicationManager* comm);
+
+    /**
+     * @brief Start downloading an offer
+     *
+     * An offer matching the interrupted download continues it; an offer for
+     * the running version or one already in progress is ignored.
+     * @return true if a download is running afterwards
+     */
+    bool start(const OtaOffer& offer);
+
+    /**
+     * @brief Continue a paused download
+     * @return true if a download is running afterwards
+     */
+    bool resume();
+
+    /**
+     * @brief Stop the download and discard its checkpoint
+     */
+    void cancel();
+
+    bool isBusy() const;
+    OtaState getState() const { return m_progress.state; }
+    OtaProgress getProgress() const;
+
+    /**
+     * @brief Restart into a verified image automatically (default on)
+     */
+    void setAutoReboot(bool enable) { m_autoReboot = enable; }
+
+    static const char* getRunningVersion() { return FIRMWARE_VERSION; }
+
+private:
+    /**
+     * @brief Persisted download position, stored next to the offer in NVS
+     */
+    struct Checkpoint {
+        uint32_t magic;
+        uint32_t partitionAddress;      // Target partition; a different one invalidates the checkpoint
+        uint32_t received;
+        uint32_t written;
+        uint32_t erased;                // Flash erased up to here
+        uint8_t delta;
+        uint8_t reserved[3];
+        OtaDeltaDecoder::State decoder;
+    };
+
+    enum class Outcome : uint8_t {
+        COMPLETE,
+        INTERRUPTED,            // Checkpointed, continues on resume()
+        CORRUPT                 // Patch or flash write rejected, starts over
+    };
+
+    OtaManager();
+
+    WiFiOtaTransport m_wifiTransport;
+    CellularOtaTransport m_cellularTransport;
+    OtaTransport* m_transport;
+
+    OtaOffer m_offer;
+    OtaProgress m_progress;
+    Checkpoint m_checkpoint;
+    bool m_hasCheckpoint;
+    bool m_useDelta;
+    bool m_autoReboot;
+    volatile bool m_cancel;
+
+    const esp_partition_t* m_target;
+    const esp_partition_t* m_running;
+    mbedtls_sha256_context m_sha;
+    OtaDeltaDecoder m_decoder;
+    uint8_t m_chunk[OTA_CHUNK_SIZE];
+
+    Preferences m_prefs;
+    TaskHandle_t m_taskHandle;
+    SemaphoreHandle_t m_mutex;
+    bool m_initialized;
+
+    static void otaTask(void* parameter);
+    void run();
+    bool prepare();
+    Outcome download();
+    bool finish();
+    bool launch();
+    void setState(OtaState state);
+
+    OtaTransport* selectTransport();
+    bool writeImage(const uint8_t* data, size_t length);
+    bool rehashWritten();
+    bool baseMatches(const String& baseDigest) const;
+    void fallBackToFull(const char* reason);
+
+    void saveOffer();
+    bool loadOffer();
+    void saveCheckpoint();
+    void clearCheckpoint();
+
+    static bool deltaOutput(const uint8_t* data, size_t length, void* context);
+    static bool deltaBaseRead(uint32_t offset, uint8_t* data, size_t length, void* context);
+};
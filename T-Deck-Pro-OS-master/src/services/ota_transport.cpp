@@ -0,0 +1,198 @@
+/**
+ * @file ota_transport.cpp
+ * @brief Ranged HTTP fetch implementations for OTA downloads
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ */
+
+#include "ota_transport.h"
+#include "core/communication/cellular_manager.h"
+#include "core/utils/logger.h"
+
+using TDeckOS::Communication::CellularManager;
+
+namespace {
+
+// A server without Range support answers with the whole file; the bytes before
+// the offset are then skipped. Returns the number to skip, or -1 to reject.
+int64_t bodySkip(int status, uint32_t offset) {
+    if (status == HTTP_CODE_PARTIAL_CONTENT) return 0;
+    if (status == HTTP_CODE_OK) return offset;
+    return -1;
+}
+
+String rangeValue(uint32_t offset, size_t length) {
+    char range[32];
+    snprintf(range, sizeof(range), "bytes=%u-%u", (unsigned)offset, (unsigned)(offset + length - 1));
+    return String(range);
+}
+
+} // namespace
+
+// ===== WiFi =====
+
+WiFiOtaTransport::WiFiOtaTransport() {
+    m_http.setReuse(true);
+    m_http.setTimeout(OTA_HTTP_TIMEOUT_MS);
+}
+
+bool WiFiOtaTransport::isAvailable() const {
+    return WiFi.isConnected();
+}
+
+int WiFiOtaTransport::fetch(const String& url, uint32_t offset, uint8_t* buffer, size_t length) {
+    // begin() keeps the kept-alive connection when the host is unchanged
+    if (!m_http.begin(m_client, url)) {
+        LOG_WARN_TAG("OTA", "Bad download URL %s", url.c_str());
+        return -1;
+    }
+    m_http.addHeader("Range", rangeValue(offset, length));
+
+    int status = m_http.GET();
+    int64_t skip = bodySkip(status, offset);
+    if (skip < 0) {
+        LOG_WARN_TAG("OTA", "HTTP %d for range at %u", status, offset);
+        close();
+        return -1;
+    }
+
+    WiFiClient* stream = m_http.getStreamPtr();
+    size_t received = 0;
+    uint32_t lastData = millis();
+    while (received < length) {
+        int available = stream->available();
+        if (available > 0) {
+            size_t want;
+            uint8_t* target;
+            if (skip > 0) {
+                // Bytes before the offset land in the buffer and are overwritten
+                want = skip < (int64_t)length ? (size_t)skip : length;
+                target = buffer;
+            } else {
+                want = length - received;
+                target = buffer + received;
+            }
+            if ((size_t)available < want) want = available;
+            int count = stream->read(target, want);
+            if (count > 0) {
+                if (skip > 0) {
+                    skip -= count;
+                } else {
+                    received += count;
+                }
+                lastData = millis();
+            }
+            continue;
+        }
+        if (!stream->connected() || millis() - lastData > OTA_HTTP_TIMEOUT_MS) {
+            break;
+        }
+        delay(1);
+    }
+
+    if (status == HTTP_CODE_OK || received < length) {
+        // The rest of the body is still on the wire, so the connection cannot be reused
+        close();
+    } else {
+        m_http.end();
+    }
+    return received == length ? (int)received : -1;
+}
+
+void WiFiOtaTransport::close() {
+    m_http.end();
+    m_client.stop();
+}
+
+// ===== Cellular =====
+
+CellularOtaTransport::CellularOtaTransport()
+    : m_cellular(nullptr)
+    , m_sessionOpen(false)
+{
+}
+
+bool CellularOtaTransport::isAvailable() const {
+    return m_cellular && m_cellular->isConnected();
+}
+
+bool CellularOtaTransport::openSession(const String& url) {
+    String response;
+
+    if (!m_sessionOpen) {
+        // A session may be left over from before a reset; HTTPINIT fails while it exists
+        m_cellular->sendATCommand("AT+HTTPTERM", response, 2000);
+        if (!m_cellular->sendATCommand("AT+HTTPINIT", response, 5000)) {
+            return false;
+        }
+        m_sessionOpen = true;
+        m_url = "";
+    }
+
+    if (url != m_url) {
+        if (!m_cellular->sendATCommand("AT+HTTPPARA=\"URL\",\"" + url + "\"", response, 2000)) {
+            return false;
+        }
+        m_url = url;
+    }
+    return true;
+}
+
+int CellularOtaTransport::fetch(const String& url, uint32_t offset, uint8_t* buffer, size_t length) {
+    if (!m_cellular || !openSession(url)) {
+        close();
+        return -1;
+    }
+
+    String response;
+    String header = "AT+HTTPPARA=\"USERDATA\",\"Range: " + rangeValue(offset, length) + "\"";
+    if (!m_cellular->sendATCommand(header, response, 2000)) {
+        return -1;
+    }
+
+    // OK only acknowledges the request; the status arrives as +HTTPACTION: <method>,<status>,<length>
+    if (!m_cellular->sendATCommandUntil("AT+HTTPACTION=0", "+HTTPACTION:", response, OTA_HTTP_TIMEOUT_MS * 2)) {
+        LOG_WARN_TAG("OTA", "Modem HTTP request failed: %s", response.c_str());
+        close();
+        return -1;
+    }
+
+    int method = 0;
+    int status = 0;
+    unsigned bodyLength = 0;
+    int64_t skip = -1;
+    int index = response.indexOf("+HTTPACTION:");
+    if (index >= 0 && sscanf(response.c_str() + index, "+HTTPACTION: %d,%d,%u", &method, &status, &bodyLength) == 3) {
+        skip = bodySkip(status, offset);
+    }
+    if (skip < 0 || bodyLength < skip + length) {
+        LOG_WARN_TAG("OTA", "Modem HTTP %d (%u bytes) for range at %u", status, bodyLength, offset);
+        return -1;
+    }
+
+    // The modem holds the body; read it out in pieces it can stream without flow control.
+    // A whole-file answer is read from the offset, so nothing before it crosses the UART.
+    size_t received = 0;
+    while (received < length) {
+        size_t want = length - received;
+        if (want > OTA_CELLULAR_READ_SIZE) want = OTA_CELLULAR_READ_SIZE;
+
+        size_t count = 0;
+        String command = "AT+HTTPREAD=" + String((unsigned)(skip + received)) + "," + String((unsigned)want);
+        if (!m_cellular->readATData(command, "+HTTPREAD:", "+HTTPREAD: 0", buffer + received, want, count,
+                                    OTA_HTTP_TIMEOUT_MS) || count == 0) {
+            break;
+        }
+        received += count;
+    }
+    return received == length ? (int)received : -1;
+}
+
+void CellularOtaTransport::close() {
+    if (m_sessionOpen && m_cellular) {
+        String response;
+        m_cellular->sendATCommand("AT+HTTPTERM", response, 2000);
+    }
+    m_sessionOpen = false;
+    m_url = "";
+}
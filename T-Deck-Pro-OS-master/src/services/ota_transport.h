@@ -0,0 +1,91 @@
+/**
+ * @file ota_transport.h
+ * @brief Ranged HTTP fetches for OTA images over WiFi or the cellular modem
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include "core/communication/message_bus.h"
+
+namespace TDeckOS {
+namespace Communication {
+class CellularManager;
+}
+}
+
+#define OTA_HTTP_TIMEOUT_MS 15000
+#define OTA_CELLULAR_READ_SIZE 1024     // Bytes per AT+HTTPREAD; bounded by the modem's UART buffering
+
+/**
+ * @brief Fetches byte ranges of a URL over one link
+ *
+ * A transport keeps its connection or modem HTTP session between fetches;
+ * close() drops it when the download switches links or ends.
+ */
+class OtaTransport {
+public:
+    virtual ~OtaTransport() {}
+
+    virtual TDeckOS::Communication::CommInterface getInterface() const = 0;
+
+    /**
+     * @brief Check whether the link is up
+     */
+    virtual bool isAvailable() const = 0;
+
+    /**
+     * @brief Fetch [offset, offset + length) of url
+     * @return Bytes stored in buffer, length on success, -1 on error
+     */
+    virtual int fetch(const String& url, uint32_t offset, uint8_t* buffer, size_t length) = 0;
+
+    virtual void close() = 0;
+};
+
+/**
+ * @brief HTTP Range requests over the WiFi station interface
+ */
+class WiFiOtaTransport : public OtaTransport {
+public:
+    WiFiOtaTransport();
+
+    TDeckOS::Communication::CommInterface getInterface() const override {
+        return TDeckOS::Communication::CommInterface::WIFI;
+    }
+    bool isAvailable() const override;
+    int fetch(const String& url, uint32_t offset, uint8_t* buffer, size_t length) override;
+    void close() override;
+
+private:
+    WiFiClient m_client;
+    HTTPClient m_http;
+};
+
+/**
+ * @brief HTTP Range requests through the A7682E modem's HTTP service
+ */
+class CellularOtaTransport : public OtaTransport {
+public:
+    CellularOtaTransport();
+
+    void setCellularManager(TDeckOS::Communication::CellularManager* cellular) { m_cellular = cellular; }
+
+    TDeckOS::Communication::CommInterface getInterface() const override {
+        return TDeckOS::Communication::CommInterface::CELLULAR;
+    }
+    bool isAvailable() const override;
+    int fetch(const String& url, uint32_t offset, uint8_t* buffer, size_t length) override;
+    void close() override;
+
+private:
+    TDeckOS::Communication::CellularManager* m_cellular;
+    bool m_sessionOpen;
+    String m_url;
+
+    bool openSession(const String& url);
+};
@@ -0,0 +1,426 @@
+/**
+ * @file power_manager.cpp
+ * @brief Power profile selection, radio duty cycling and energy accounting
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ */
+
+#include "power_manager.h"
+#include "ota_manager.h"
+#include "core/communication/communication_manager.h"
+#include "core/communication/lora_manager.h"
+#include "core/communication/cellular_manager.h"
+#include "core/display/eink_manager.h"
+#include "core/hal/board_config.h"
+#include "core/system/scheduler.h"
+#include "core/utils/logger.h"
+#include "core/utils/trace.h"
+
+using namespace TDeckOS::Communication;
+
+namespace {
+
+// uA x ms to mAh
+constexpr float UA_MS_PER_MAH = 3600.0f * 1000.0f * 1000.0f;
+
+const char* const PROFILE_NAMES[POWER_PROFILE_COUNT] = {"active", "idle", "field-standby"};
+const char* const SUBSYSTEM_NAMES[POWER_SUBSYSTEM_COUNT] = {"cpu", "display", "lora", "wifi", "cellular"};
+
+} // namespace
+
+PowerManager& PowerManager::getInstance() {
+    static PowerManager instance;
+    return instance;
+}
+
+PowerManager::PowerManager()
+    : m_lora(nullptr)
+    , m_wifi(nullptr)
+    , m_cellular(nullptr)
+    , m_configs{
+        // The user is at the device: full clock, radios only ever at their default modem sleep
+        {240, WiFiPowerSave::MIN_MODEM, WiFiPowerSave::MIN_MODEM, 3, false, false, 100, 2000},
+        {160, WiFiPowerSave::MIN_MODEM, WiFiPowerSave::MAX_MODEM, 3, true, true, 250, 4000},
+        {80, WiFiPowerSave::MIN_MODEM, WiFiPowerSave::MAX_MODEM, 10, true, true, 1000, 10000}}
+    , m_profile(PowerProfile::ACTIVE)
+    , m_autoProfile(true)
+    , m_configChanged(false)
+    , m_lastUserActivity(0)
+    , m_initialized(false)
+    , m_traffic{}
+    , m_counters{}
+    , m_lock(portMUX_INITIALIZER_UNLOCKED)
+    , m_lastUpdate(0)
+    , m_lastLightSleepMs(0)
+    , m_lastLoRaAirtimeMs(0)
+    , m_lastEinkRefreshUs(0)
+    , m_batteryMv(0)
+    , m_usbPowered(false)
+    , m_lastBatteryCheck(0)
+{
+}
+
+bool PowerManager::initialize(CommunicationManager* comm) {
+    if (m_initialized) {
+        return true;
+    }
+
+    if (comm) {
+        m_lora = comm->getLoRaManager();
+        m_wifi = comm->getWiFiManager();
+        m_cellular = comm->getCellularManager();
+    }
+
+    // Running totals start from here; only what follows is accounted
+    uint32_t now = millis();
+    sched_stats_t sched;
+    sched_get_stats(&sched);
+    m_lastLightSleepMs = sched.light_sleep_ms;
+    m_lastLoRaAirtimeMs = m_lora && m_lora->isInitialized() ? m_lora->getStats().airtimeMs : 0;
+    m_lastEinkRefreshUs = einkRefreshUs();
+    for (size_t i = 0; i < RADIO_COUNT; i++) {
+        BusTraffic traffic = MessageBus::getInstance().getTraffic(static_cast<CommInterface>(i));
+        m_traffic[i].messages = traffic.received + traffic.sent;
+        m_traffic[i].lastActivity = traffic.lastActivity;
+    }
+    m_lastUpdate = now;
+    m_lastUserActivity = now;
+    m_lastBatteryCheck = now - POWER_BATTERY_CHECK_MS;
+    checkBattery(now);
+
+    m_initialized = true;
+    applyProfile(PowerProfile::ACTIVE);
+
+    LOG_INFO_TAG("Power", "Power manager initialized, battery %u mV%s", m_batteryMv,
+                 m_usbPowered ? " on USB" : "");
+    return true;
+}
+
+void PowerManager::update() {
+    if (!m_initialized) {
+        return;
+    }
+
+    uint32_t now = millis();
+    uint32_t elapsed = now - m_lastUpdate;
+    m_lastUpdate = now;
+
+    // The last interval is charged to the states that were in force during it
+    account(elapsed);
+    sampleTraffic(now, elapsed);
+    checkBattery(now);
+
+    PowerProfile profile = m_autoProfile ? chooseProfile(now) : m_profile;
+    if (profile != m_profile || m_configChanged) {
+        applyProfile(profile);
+    } else {
+        applyRadios(false);
+    }
+}
+
+void PowerManager::setProfile(PowerProfile profile) {
+    m_autoProfile = false;
+    m_profile = profile;
+    m_configChanged = true;
+}
+
+void PowerManager::setProfileConfig(PowerProfile profile, const PowerProfileConfig& config) {
+    m_configs[static_cast<size_t>(profile)] = config;
+    m_configChanged = true;
+}
+
+const PowerProfileConfig& PowerManager::getProfileConfig(PowerProfile profile) const {
+    return m_configs[static_cast<size_t>(profile)];
+}
+
+float PowerManager::getTrafficRate(CommInterface interface) const {
+    size_t index = static_cast<size_t>(interface);
+    return index < RADIO_COUNT ? m_traffic[index].ratePerMin : 0.0f;
+}
+
+PowerProfile PowerManager::chooseProfile(uint32_t now) const {
+    uint32_t quiet = now - m_lastUserActivity;
+    bool lowBattery = !m_usbPowered && m_batteryMv != 0 && m_batteryMv < BOARD_BAT_LOW_MV;
+
+    if (quiet < POWER_IDLE_AFTER_MS) {
+        // Input still wakes the UI on a low battery, but the radios keep duty cycling
+        return lowBattery ? PowerProfile::IDLE : PowerProfile::ACTIVE;
+    }
+    if (lowBattery) {
+        return PowerProfile::FIELD_STANDBY;
+    }
+    if (quiet < POWER_STANDBY_AFTER_MS || m_usbPowered) {
+        return PowerProfile::IDLE;
+    }
+    return PowerProfile::FIELD_STANDBY;
+}
+
+void PowerManager::applyProfile(PowerProfile profile) {
+    const PowerProfileConfig& config = m_configs[static_cast<size_t>(profile)];
+
+    if (!sched_set_cpu_freq(config.cpuMaxMhz)) {
+        LOG_WARN_TAG("Power", "CPU clock %u MHz rejected", config.cpuMaxMhz);
+    }
+    eink_manager.setMinUpdateInterval(config.einkMinInterval);
+    eink_manager.setMaxUpdateInterval(config.einkMaxInterval);
+
+    LOG_INFO_TAG("Power", "Profile %s", getProfileName(profile));
+    m_profile = profile;
+    m_configChanged = false;
+    applyRadios(true);
+}
+
+void PowerManager::applyRadios(bool force) {
+    const PowerProfileConfig& config = m_configs[static_cast<size_t>(m_profile)];
+
+    // Each radio is only at full receive power while it carries traffic
+    if (m_wifi && m_wifi->isInitialized()) {
+        WiFiPowerSave level = m_traffic[static_cast<size_t>(CommInterface::WIFI)].busy
+                              ? config.wifiBusy : config.wifiQuiet;
+        if (force || level != m_wifi->getPowerSaveLevel()) {
+            m_wifi->setPowerSaveLevel(level, config.wifiListenInterval);
+        }
+    }
+
+    if (m_lora && m_lora->isInitialized()) {
+        bool dutyCycle = config.loraDutyCycle && !m_traffic[static_cast<size_t>(CommInterface::LORA)].busy;
+        if (dutyCycle != m_lora->isReceiveDutyCycled()) {
+            m_lora->setReceiveDutyCycle(dutyCycle);
+        }
+    }
+
+    if (m_cellular && m_cellular->isPoweredOn()) {
+        bool sleep = config.cellularSleep && !m_traffic[static_cast<size_t>(CommInterface::CELLULAR)].busy;
+        if (sleep != m_cellular->isLowPower()) {
+            m_cellular->setLowPower(sleep);
+        }
+    }
+}
+
+void PowerManager::sampleTraffic(uint32_t now, uint32_t elapsedMs) {
+    MessageBus& bus = MessageBus::getInstance();
+
+    for (size_t i = 0; i < RADIO_COUNT; i++) {
+        BusTraffic traffic = bus.getTraffic(static_cast<CommInterface>(i));
+        RadioTraffic& radio = m_traffic[i];
+
+        uint32_t messages = traffic.received + traffic.sent;
+        uint32_t delta = messages - radio.messages;
+        radio.messages = messages;
+        radio.lastActivity = traffic.lastActivity;
+
+        // Exponential moving average with time constant POWER_TRAFFIC_TAU_MS, whatever the sample spacing
+        if (elapsedMs > 0) {
+            float instant = delta * 60000.0f / elapsedMs;
+            float alpha = (float)elapsedMs / (elapsedMs + POWER_TRAFFIC_TAU_MS);
+            radio.ratePerMin += alpha * (instant - radio.ratePerMin);
+        }
+
+        bool recent = traffic.lastActivity != 0 && now - traffic.lastActivity < POWER_BURST_HOLD_MS;
+        radio.busy = recent || radio.ratePerMin >= POWER_BUSY_RATE_PER_MIN;
+    }
+
+    // Firmware downloads talk HTTP directly rather than through the bus
+    if (OtaManager::getInstance().isBusy()) {
+        m_traffic[static_cast<size_t>(CommInterface::WIFI)].busy = true;
+        m_traffic[static_cast<size_t>(CommInterface::CELLULAR)].busy = true;
+    }
+}
+
+void PowerManager::checkBattery(uint32_t now) {
+    if (now - m_lastBatteryCheck < POWER_BATTERY_CHECK_MS) {
+        return;
+    }
+    m_lastBatteryCheck = now;
+    m_batteryMv = board_get_battery_voltage();
+    m_usbPowered = board_is_usb_connected();
+}
+
+void PowerManager::account(uint32_t elapsedMs) {
+    uint64_t charge[POWER_SUBSYSTEM_COUNT] = {};
+    uint32_t lowPower[POWER_SUBSYSTEM_COUNT] = {};
+
+    // CPU: awake at the profile's clock except for the light sleep the scheduler
+    // measured. Automatic light sleep is not measured, so it counts as awake.
+    sched_stats_t sched;
+    sched_get_stats(&sched);
+    uint32_t slept = sched.light_sleep_ms - m_lastLightSleepMs;
+    m_lastLightSleepMs = sched.light_sleep_ms;
+    if (slept > elapsedMs) {
+        slept = elapsedMs;
+    }
+    charge[(size_t)PowerSubsystem::CPU] = (uint64_t)(elapsedMs - slept) * cpuCurrentUa(sched_get_cpu_freq()) +
+                                          (uint64_t)slept * POWER_CPU_SLEEP_UA;
+    lowPower[(size_t)PowerSubsystem::CPU] = slept;
+
+    // Display: refresh time from the trace histograms, hibernated otherwise
+    uint64_t refreshTotalUs = einkRefreshUs();
+    uint64_t refreshUs = refreshTotalUs >= m_lastEinkRefreshUs ? refreshTotalUs - m_lastEinkRefreshUs : refreshTotalUs;
+    m_lastEinkRefreshUs = refreshTotalUs;
+    uint32_t refreshMs = refreshUs / 1000 < elapsedMs ? (uint32_t)(refreshUs / 1000) : elapsedMs;
+    charge[(size_t)PowerSubsystem::DISPLAY] = refreshUs * POWER_EINK_REFRESH_UA / 1000 +
+                                              (uint64_t)(elapsedMs - refreshMs) * POWER_EINK_SLEEP_UA;
+    lowPower[(size_t)PowerSubsystem::DISPLAY] = elapsedMs - refreshMs;
+
+    // LoRa: airtime at transmit current, the rest in the current mode
+    if (m_lora && m_lora->isInitialized()) {
+        uint32_t airtimeTotal = m_lora->getStats().airtimeMs;
+        uint32_t airtime = 0;
+        if (airtimeTotal >= m_lastLoRaAirtimeMs) {
+            airtime = airtimeTotal - m_lastLoRaAirtimeMs;
+            m_lastLoRaAirtimeMs = airtimeTotal;
+        }
+        if (airtime > elapsedMs) {
+            airtime = elapsedMs;
+        }
+
+        uint32_t baseUa = POWER_LORA_RX_UA;
+        bool low = false;
+        switch (m_lora->getMode()) {
+            case LoRaMode::SLEEP:
+                baseUa = POWER_LORA_SLEEP_UA;
+                low = true;
+                break;
+            case LoRaMode::IDLE:
+                baseUa = POWER_LORA_STANDBY_UA;
+                break;
+            case LoRaMode::RECEIVE:
+                low = m_lora->isReceiveDutyCycled();
+                baseUa = low ? POWER_LORA_RX_DUTY_UA : POWER_LORA_RX_UA;
+                break;
+            default:
+                break;
+        }
+        charge[(size_t)PowerSubsystem::LORA] = (uint64_t)airtime * POWER_LORA_TX_UA +
+                                               (uint64_t)(elapsedMs - airtime) * baseUa;
+        lowPower[(size_t)PowerSubsystem::LORA] = low ? elapsedMs - airtime : 0;
+    } else {
+        lowPower[(size_t)PowerSubsystem::LORA] = elapsedMs;
+    }
+
+    // WiFi: modem sleep level while associated; scanning and connecting keep the receiver on
+    if (m_wifi && m_wifi->isInitialized() && m_wifi->getMode() != WiFiMode::OFF) {
+        uint32_t ua = POWER_WIFI_ACTIVE_UA;
+        if (m_wifi->getStatus() == WiFiStatus::CONNECTED) {
+            switch (m_wifi->getPowerSaveLevel()) {
+                case WiFiPowerSave::MIN_MODEM:
+                    ua = POWER_WIFI_MIN_MODEM_UA;
+                    break;
+                case WiFiPowerSave::MAX_MODEM:
+                    ua = POWER_WIFI_MAX_MODEM_UA;
+                    lowPower[(size_t)PowerSubsystem::WIFI] = elapsedMs;
+                    break;
+                default:
+                    break;
+            }
+        }
+        charge[(size_t)PowerSubsystem::WIFI] = (uint64_t)elapsedMs * ua;
+    } else {
+        lowPower[(size_t)PowerSubsystem::WIFI] = elapsedMs;
+    }
+
+    // Cellular: DTR sleep or awake; powered off draws nothing
+    if (m_cellular && m_cellular->isPoweredOn()) {
+        bool asleep = m_cellular->isModemAsleep();
+        charge[(size_t)PowerSubsystem::CELLULAR] =
+            (uint64_t)elapsedMs * (asleep ? POWER_CELLULAR_SLEEP_UA : POWER_CELLULAR_AWAKE_UA);
+        lowPower[(size_t)PowerSubsystem::CELLULAR] = asleep ? elapsedMs : 0;
+    } else {
+        lowPower[(size_t)PowerSubsystem::CELLULAR] = elapsedMs;
+    }
+
+    portENTER_CRITICAL(&m_lock);
+    for (size_t i = 0; i < POWER_SUBSYSTEM_COUNT; i++) {
+        m_counters.chargeUaMs[i] += charge[i];
+        m_counters.lowPowerMs[i] += lowPower[i];
+    }
+    m_counters.profileMs[static_cast<size_t>(m_profile)] += elapsedMs;
+    m_counters.elapsedMs += elapsedMs;
+    m_counters.lightSleepMs += slept;
+    portEXIT_CRITICAL(&m_lock);
+}
+
+PowerReport PowerManager::getReport() const {
+    portENTER_CRITICAL(&m_lock);
+    Counters counters = m_counters;
+    portEXIT_CRITICAL(&m_lock);
+
+    PowerReport report = {};
+    report.profile = m_profile;
+    report.elapsedMs = counters.elapsedMs;
+    report.lightSleepMs = counters.lightSleepMs;
+    report.batteryMv = m_batteryMv;
+    report.usbPowered = m_usbPowered;
+    memcpy(report.profileMs, counters.profileMs, sizeof(report.profileMs));
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < POWER_SUBSYSTEM_COUNT; i++) {
+        PowerSubsystemReport& subsystem = report.subsystems[i];
+        subsystem.chargeMah = counters.chargeUaMs[i] / UA_MS_PER_MAH;
+        subsystem.averageMa = counters.elapsedMs ? counters.chargeUaMs[i] / 1000.0f / counters.elapsedMs : 0.0f;
+        subsystem.lowPowerMs = counters.lowPowerMs[i];
+        total += counters.chargeUaMs[i];
+    }
+    report.totalMah = total / UA_MS_PER_MAH;
+    report.averageMa = counters.elapsedMs ? total / 1000.0f / counters.elapsedMs : 0.0f;
+
+    // Charge left assumes a linear discharge curve between the critical and full voltages
+    if (!m_usbPowered && report.averageMa > 0.0f && m_batteryMv > BOARD_BAT_CRIT_MV) {
+        float fraction = (float)(m_batteryMv - BOARD_BAT_CRIT_MV) / (BOARD_BAT_FULL_MV - BOARD_BAT_CRIT_MV);
+        if (fraction > 1.0f) {
+            fraction = 1.0f;
+        }
+        report.runtimeMinutes = (uint32_t)(POWER_BATTERY_CAPACITY_MAH * fraction / report.averageMa * 60.0f);
+    }
+    return report;
+}
+
+void PowerManager::resetReport() {
+    portENTER_CRITICAL(&m_lock);
+    m_counters = Counters{};
+    portEXIT_CRITICAL(&m_lock);
+}
+
+void PowerManager::logReport() const {
+    PowerReport report = getReport();
+
+    LOG_INFO_TAG("Power", "Profile %s, %.1f mA average, %.2f mAh over %u min, light sleep %u s, runtime %u min",
+                 getProfileName(report.profile), report.averageMa, report.totalMah,
+                 (unsigned)(report.elapsedMs / 60000), (unsigned)(report.lightSleepMs / 1000),
+                 (unsigned)report.runtimeMinutes);
+    for (size_t i = 0; i < POWER_SUBSYSTEM_COUNT; i++) {
+        const PowerSubsystemReport& subsystem = report.subsystems[i];
+        LOG_INFO_TAG("Power", "  %-8s %6.2f mA %7.3f mAh, low power %u%%",
+                     SUBSYSTEM_NAMES[i], subsystem.averageMa, subsystem.chargeMah,
+                     report.elapsedMs ? (unsigned)((uint64_t)subsystem.lowPowerMs * 100 / report.elapsedMs) : 0);
+    }
+}
+
+const char* PowerManager::getProfileName(PowerProfile profile) {
+    size_t index = static_cast<size_t>(profile);
+    return index < POWER_PROFILE_COUNT ? PROFILE_NAMES[index] : "?";
+}
+
+const char* PowerManager::getSubsystemName(PowerSubsystem subsystem) {
+    size_t index = static_cast<size_t>(subsystem);
+    return index < POWER_SUBSYSTEM_COUNT ? SUBSYSTEM_NAMES[index] : "?";
+}
+
+uint32_t PowerManager::cpuCurrentUa(uint32_t mhz) {
+    if (mhz >= 240) {
+        return POWER_CPU_240_UA;
+    }
+    return mhz >= 160 ? POWER_CPU_160_UA : POWER_CPU_80_UA;
+}
+
+uint64_t PowerManager::einkRefreshUs() {
+    // Every refresh mode is traced, so the histogram sums are the panel's busy time
+    uint64_t total = 0;
+    for (int site = TRACE_EINK_PARTIAL; site <= TRACE_EINK_DEEP_CLEAN; site++) {
+        trace_hist_t hist;
+        if (trace_get_histogram((trace_site_t)site, &hist)) {
+            total += hist.sum_us;
+        }
+    }
+    return total;
+}
@@ -0,0 +1,268 @@
+/**
+ * @file power_manager.h
+ * @brief Power profiles coordinating the radios, CPU clock and display
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ *
+ * A profile (active, idle, field standby) caps the CPU clock, sets the
+ * e-ink update pacing and decides how far each radio may power down. Within
+ * a profile each radio follows its own traffic, as seen on the message bus:
+ * a radio that carried a message in the last POWER_BURST_HOLD_MS, or whose
+ * smoothed message rate is at least POWER_BUSY_RATE_PER_MIN, stays at full
+ * receive power; once quiet it drops to the profile's low-power setting
+ * (SX1262 RX duty cycle, modem PSM/eDRX with DTR sleep, WiFi modem sleep
+ * with a longer listen interval).
+ *
+ * Profiles follow user input, USB power and the battery unless one is set
+ * explicitly. Charge drawn is estimated per subsystem from the time spent
+ * in each state and the typical currents below, so the effect of a profile
+ * shows up as mAh and as a runtime estimate.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "core/communication/message_bus.h"
+#include "core/communication/wifi_manager.h"
+
+namespace TDeckOS {
+namespace Communication {
+class CommunicationManager;
+class LoRaManager;
+class CellularManager;
+}
+}
+
+// ===== CONFIGURATION =====
+#define POWER_UPDATE_MS 1000                // update() period expected from the caller
+#define POWER_IDLE_AFTER_MS 60000           // No user input for this long selects IDLE
+#define POWER_STANDBY_AFTER_MS 900000       // and this long FIELD_STANDBY
+#define POWER_TRAFFIC_TAU_MS 300000         // Time constant of the smoothed message rate
+#define POWER_BURST_HOLD_MS 30000           // A radio stays at full power this long after a message
+#define POWER_BUSY_RATE_PER_MIN 2.0f        // Smoothed rate that keeps a radio at full power
+#define POWER_BATTERY_CHECK_MS 10000
+
+#ifndef POWER_BATTERY_CAPACITY_MAH
+#define POWER_BATTERY_CAPACITY_MAH 1400
+#endif
+
+// Typical currents in microamps, from the part datasheets; boards may override them
+#ifndef POWER_CPU_240_UA
+#define POWER_CPU_240_UA 44000
+#endif
+#ifndef POWER_CPU_160_UA
+#define POWER_CPU_160_UA 32000
+#endif
+#ifndef POWER_CPU_80_UA
+#define POWER_CPU_80_UA 22000
+#endif
+#ifndef POWER_CPU_SLEEP_UA
+#define POWER_CPU_SLEEP_UA 250              // Light sleep, RTC and PSRAM retained
+#endif
+#ifndef POWER_EINK_REFRESH_UA
+#define POWER_EINK_REFRESH_UA 4000          // While the panel drives a waveform
+#endif
+#ifndef POWER_EINK_SLEEP_UA
+#define POWER_EINK_SLEEP_UA 1               // Hibernated between refreshes
+#endif
+#ifndef POWER_LORA_RX_UA
+#define POWER_LORA_RX_UA 5300               // Continuous receive, boosted gain
+#endif
+#ifndef POWER_LORA_RX_DUTY_UA
+#define POWER_LORA_RX_DUTY_UA 1100          // RX duty cycle with the default preamble
+#endif
+#ifndef POWER_LORA_TX_UA
+#define POWER_LORA_TX_UA 118000             // +22 dBm
+#endif
+#ifndef POWER_LORA_STANDBY_UA
+#define POWER_LORA_STANDBY_UA 600
+#endif
+#ifndef POWER_LORA_SLEEP_UA
+#define POWER_LORA_SLEEP_UA 2
+#endif
+#ifndef POWER_WIFI_ACTIVE_UA
+#define POWER_WIFI_ACTIVE_UA 95000          // Receiver on: no modem sleep, scanning, connecting
+#endif
+#ifndef POWER_WIFI_MIN_MODEM_UA
+#define POWER_WIFI_MIN_MODEM_UA 22000       // Associated, waking every DTIM
+#endif
+#ifndef POWER_WIFI_MAX_MODEM_UA
+#define POWER_WIFI_MAX_MODEM_UA 9000        // Associated, waking every listen interval
+#endif
+#ifndef POWER_CELLULAR_AWAKE_UA
+#define POWER_CELLULAR_AWAKE_UA 21000       // Registered, UART awake
+#endif
+#ifndef POWER_CELLULAR_SLEEP_UA
+#define POWER_CELLULAR_SLEEP_UA 2500        // DTR sleep; PSM draws less still, as the network allows
+#endif
+
+// ===== DATA STRUCTURES =====
+
+enum class PowerProfile : uint8_t {
+    ACTIVE,                     // User at the device
+    IDLE,                       // No input for a minute
+    FIELD_STANDBY               // Long unattended stretches or low battery
+};
+
+constexpr size_t POWER_PROFILE_COUNT = 3;
+
+enum class PowerSubsystem : uint8_t {
+    CPU,
+    DISPLAY,
+    LORA,
+    WIFI,
+    CELLULAR
+};
+
+constexpr size_t POWER_SUBSYSTEM_COUNT = 5;
+
+/**
+ * @brief What a profile allows each subsystem to do
+ */
+struct PowerProfileConfig {
+    uint32_t cpuMaxMhz;                                 // 80, 160 or 240
+    TDeckOS::Communication::WiFiPowerSave wifiBusy;     // WiFi sleep level while carrying traffic
+    TDeckOS::Communication::WiFiPowerSave wifiQuiet;
+    uint8_t wifiListenInterval;                         // Beacons between wake-ups at MAX_MODEM
+    bool loraDutyCycle;                                 // Duty-cycle receive while LoRa is quiet
+    bool cellularSleep;                                 // Modem sleep while cellular is quiet
+    uint32_t einkMinInterval;                           // Passed to EinkManager, ms
+    uint32_t einkMaxInterval;
+};
+
+struct PowerSubsystemReport {
+    float chargeMah;            // Estimated charge drawn since the report was reset
+    float averageMa;
+    uint32_t lowPowerMs;        // Time spent asleep, duty-cycled or off
+};
+
+struct PowerReport {
+    PowerProfile profile;
+    uint32_t elapsedMs;         // Covered by the report
+    PowerSubsystemReport subsystems[POWER_SUBSYSTEM_COUNT];
+    float totalMah;
+    float averageMa;
+    uint32_t profileMs[POWER_PROFILE_COUNT];
+    uint32_t lightSleepMs;
+    uint16_t batteryMv;
+    bool usbPowered;
+    uint32_t runtimeMinutes;    // Remaining charge at the average draw, 0 on USB or before any data
+};
+
+/**
+ * @brief Chooses power profiles and accounts for the energy they use
+ */
+class PowerManager {
+public:
+    static PowerManager& getInstance();
+
+    /**
+     * @brief Attach to the radios and apply the ACTIVE profile
+     * @param comm Communication manager providing the radios
+     * @return true if successful, false otherwise
+     */
+    bool initialize(TDeckOS::Communication::CommunicationManager* comm);
+
+    /**
+     * @brief Account for the last interval, then re-plan profile and radios
+     *
+     * Call every POWER_UPDATE_MS from one task.
+     */
+    void update();
+
+    /**
+     * @brief Record user input; the next update() returns to ACTIVE
+     */
+    void notifyUserActivity() { m_lastUserActivity = millis(); }
+
+    /**
+     * @brief Pin a profile, disabling automatic selection
+     */
+    void setProfile(PowerProfile profile);
+
+    /**
+     * @brief Choose profiles from user input, USB and battery again (default)
+     */
+    void setAutoProfile(bool enable) { m_autoProfile = enable; }
+
+    PowerProfile getProfile() const { return m_profile; }
+    bool isAutoProfile() const { return m_autoProfile; }
+
+    /**
+     * @brief Replace what a profile allows; takes effect at the next update()
+     */
+    void setProfileConfig(PowerProfile profile, const PowerProfileConfig& config);
+    const PowerProfileConfig& getProfileConfig(PowerProfile profile) const;
+
+    /**
+     * @brief Smoothed message rate of an interface, messages per minute
+     */
+    float getTrafficRate(TDeckOS::Communication::CommInterface interface) const;
+
+    /**
+     * @brief Estimated charge per subsystem since the last reset
+     */
+    PowerReport getReport() const;
+    void resetReport();
+    void logReport() const;
+
+    static const char* getProfileName(PowerProfile profile);
+    static const char* getSubsystemName(PowerSubsystem subsystem);
+
+private:
+    // Interfaces whose power the manager controls, indexed by CommInterface
+    static constexpr size_t RADIO_COUNT = 3;
+
+    struct RadioTraffic {
+        uint32_t messages;      // Bus counters at the previous sample
+        uint32_t lastActivity;
+        float ratePerMin;
+        bool busy;
+    };
+
+    struct Counters {
+        uint64_t chargeUaMs[POWER_SUBSYSTEM_COUNT];
+        uint32_t lowPowerMs[POWER_SUBSYSTEM_COUNT];
+        uint32_t profileMs[POWER_PROFILE_COUNT];
+        uint32_t elapsedMs;
+        uint32_t lightSleepMs;
+    };
+
+    PowerManager();
+
+    TDeckOS::Communication::LoRaManager* m_lora;
+    TDeckOS::Communication::WiFiManager* m_wifi;
+    TDeckOS::Communication::CellularManager* m_cellular;
+
+    PowerProfileConfig m_configs[POWER_PROFILE_COUNT];
+    PowerProfile m_profile;
+    bool m_autoProfile;
+    bool m_configChanged;
+    volatile uint32_t m_lastUserActivity;
+    bool m_initialized;
+
+    RadioTraffic m_traffic[RADIO_COUNT];
+
+    // Accounting; sources are sampled as running totals and differenced
+    Counters m_counters;
+    mutable portMUX_TYPE m_lock;
+    uint32_t m_lastUpdate;
+    uint32_t m_lastLightSleepMs;
+    uint32_t m_lastLoRaAirtimeMs;
+    uint64_t m_lastEinkRefreshUs;
+
+    uint16_t m_batteryMv;
+    bool m_usbPowered;
+    uint32_t m_lastBatteryCheck;
+
+    void account(uint32_t elapsedMs);
+    void sampleTraffic(uint32_t now, uint32_t elapsedMs);
+    void checkBattery(uint32_t now);
+    PowerProfile chooseProfile(uint32_t now) const;
+    void applyProfile(PowerProfile profile);
+    void applyRadios(bool force);
+
+    static uint32_t cpuCurrentUa(uint32_t mhz);
+    static uint64_t einkRefreshUs();
+};
@@ -2,7 +2,7 @@
 #include "core/utils/logger.h"
 
 bool AppFrameworkTests::runAllTests() {
-    Logger::info("AppFrameworkTests", "Starting Phase 3 Application Framework Tests");
+    LOG_INFO_TAG("AppFrameworkTests", "Starting Phase 3 Application Framework Tests");
     
     bool allPassed = true;
     
@@ -32,15 +32,14 @@ bool AppFrameworkTests::runAllTests() {
     allPassed &= testStartupTime();
     allPassed &= testResponseTime();
     
-    Logger::info("AppFrameworkTests", 
-                String("Phase 3 Application Framework Tests ") + 
-                (allPassed ? "PASSED" : "FAILED"));
+    LOG_INFO_TAG("AppFrameworkTests", "Phase 3 Application Framework Tests %s",
+                 allPassed ? "PASSED" : "FAILED");
     
     return allPassed;
 }
 
 bool AppFrameworkTests::testAppBaseLifecycle() {
-    Logger::info("AppFrameworkTests", "Testing AppBase lifecycle management");
+    LOG_INFO_TAG("AppFrameworkTests", "Testing AppBase lifecycle management");
     
     // Create mock app
     MockApp::AppInfo info = MockApp::getAppInfo();
@@ -98,7 +97,7 @@ bool AppFrameworkTests::testAppBaseLifecycle() {
 }
 
 bool AppFrameworkTests::testAppManagerInitialization() {
-    Logger::info("AppFrameworkTests", "Testing AppManager initialization");
+    LOG_INFO_TAG("AppFrameworkTests", "Testing AppManager initialization");
     
     AppManager& manager = AppManager::getInstance();
     
@@ -121,7 +120,7 @@ bool AppFrameworkTests::testAppManagerInitialization() {
 }
 
 bool AppFrameworkTests::testAppRegistration() {
-    Logger::info("AppFrameworkTests", "Testing app registration");
+    LOG_INFO_TAG("AppFrameworkTests", "Testing app registration");
     
     AppManager& manager = AppManager::getInstance();
     bool passed = true;
@@ -152,7 +151,7 @@ bool AppFrameworkTests::testAppRegistration() {
 }
 
 bool AppFrameworkTests::testAppLaunching() {
-    Logger::info("AppFrameworkTests", "Testing app launching");
+    LOG_INFO_TAG("AppFrameworkTests", "Testing app launching");
     
     AppManager& manager = AppManager::getInstance();
     bool passed = true;
@@ -192,7 +191,7 @@ bool AppFrameworkTests::testAppLaunching() {
 }
 
 bool AppFrameworkTests::testAppStateManagement() {
-    Logger::info("AppFrameworkTests", "Testing app state management");
+    LOG_INFO_TAG("AppFrameworkTests", "Testing app state management");
     
     AppManager& manager = AppManager::getInstance();
     bool passed = true;
@@ -230,7 +229,7 @@ bool AppFrameworkTests::testAppStateManagement() {
 }
 
 bool AppFrameworkTests::testMemoryManagement() {
-    Logger::info("AppFrameworkTests", "Testing memory management");
+    LOG_INFO_TAG("AppFrameworkTests", "Testing memory management");
     
     AppManager& manager = AppManager::getInstance();
     bool passed = true;
@@ -266,7 +265,7 @@ bool AppFrameworkTests::testMemoryManagement() {
 }
 
 bool AppFrameworkTests::testInterAppCommunication() {
-    Logger::info("AppFrameworkTests", "Testing inter-app communication");
+    LOG_INFO_TAG("AppFrameworkTests", "Testing inter-app communication");
     
     AppManager& manager = AppManager::getInstance();
     bool passed = true;
@@ -305,7 +304,7 @@ bool AppFrameworkTests::testInterAppCommunication() {
 }
 
 bool AppFrameworkTests::testConfigurationManagement() {
-    Logger::info("AppFrameworkTests", "Testing configuration management");
+    LOG_INFO_TAG("AppFrameworkTests", "Testing configuration management");
     
     AppManager& manager = AppManager::getInstance();
     bool passed = true;
@@ -334,13 +333,29 @@ bool AppFrameworkTests::testConfigurationManagement() {
 }
 
 bool AppFrameworkTests::testMeshtasticApp() {
-    Logger::info("AppFrameworkTests", "Testing Meshtastic application");
+    LOG_INFO_TAG("AppFrameworkTests", "Testing Meshtastic application");
     
     // Test app info
     MeshtasticApp::AppInfo info = MeshtasticApp::getAppInfo();
     bool passed = (info.name == "Meshtastic");
     logTestResult("Meshtastic app info", passed);
     
+    // Node table: lookup, eviction of the least recently heard node, and expiry
+    MeshNodeTable table;
+    bool tablePassed = table.begin(4);
+    for (uint32_t i = 0; tablePassed && i < 6; i++) {
+        MeshtasticApp::MeshNode node = {};
+        node.nodeId = 0x1000 + i;
+        node.lastSeen = 1000 + i * 100;
+        tablePassed &= table.upsert(node) != nullptr;
+    }
+    tablePassed = tablePassed && table.size() == 4 && table.getEvictionCount() == 2 &&
+                  !table.find(0x1000) && table.find(0x1005) && table.oldest()->nodeId == 0x1002;
+    tablePassed = tablePassed && table.touch(0x1002, 2000) && table.oldest()->nodeId == 0x1003;
+    tablePassed = tablePassed && table.expire(1900, 450) == 2 && table.size() == 2 && table.find(0x1005);
+    logTestResult("Meshtastic node table", tablePassed);
+    passed &= tablePassed;
+    
     // TODO: Add more specific Meshtastic tests when implementation is complete
     
     logTestResult("Meshtastic application", passed);
@@ -348,7 +363,7 @@ bool AppFrameworkTests::testMeshtasticApp() {
 }
 
 bool AppFrameworkTests::testFileManagerApp() {
-    Logger::info("AppFrameworkTests", "Testing File Manager application");
+    LOG_INFO_TAG("AppFrameworkTests", "Testing File Manager application");
     
     // Test app info
     FileManagerApp::AppInfo info = FileManagerApp::getAppInfo();
@@ -362,7 +377,7 @@ bool AppFrameworkTests::testFileManagerApp() {
 }
 
 bool AppFrameworkTests::testSettingsApp() {
-    Logger::info("AppFrameworkTests", "Testing Settings application");
+    LOG_INFO_TAG("AppFrameworkTests", "Testing Settings application");
     
     // Test app info
     SettingsApp::AppInfo info = SettingsApp::getAppInfo();
@@ -376,7 +391,7 @@ bool AppFrameworkTests::testSettingsApp() {
 }
 
 bool AppFrameworkTests::testMultipleAppsRunning() {
-    Logger::info("AppFrameworkTests", "Testing multiple apps running");
+    LOG_INFO_TAG("AppFrameworkTests", "Testing multiple apps running");
     
     AppManager& manager = AppManager::getInstance();
     bool passed = true;
@@ -404,7 +419,7 @@ bool AppFrameworkTests::testMultipleAppsRunning() {
 }
 
 bool AppFrameworkTests::testAppSwitching() {
-    Logger::info("AppFrameworkTests", "Testing app switching");
+    LOG_INFO_TAG("AppFrameworkTests", "Testing app switching");
     
     AppManager& manager = AppManager::getInstance();
     bool passed = true;
@@ -438,7 +453,7 @@ bool AppFrameworkTests::testAppSwitching() {
 }
 
 bool AppFrameworkTests::testSystemResourceManagement() {
-    Logger::info("AppFrameworkTests", "Testing system resource management");
+    LOG_INFO_TAG("AppFrameworkTests", "Testing system resource management");
     
     AppManager& manager = AppManager::getInstance();
     bool passed = true;
@@ -459,7 +474,7 @@ bool AppFrameworkTests::testSystemResourceManagement() {
 }
 
 bool AppFrameworkTests::testErrorHandling() {
-    Logger::info("AppFrameworkTests", "Testing error handling");
+    LOG_INFO_TAG("AppFrameworkTests", "Testing error handling");
     
     AppManager& manager = AppManager::getInstance();
     bool passed = true;
@@ -480,7 +495,7 @@ bool AppFrameworkTests::testErrorHandling() {
 }
 
 bool AppFrameworkTests::testMemoryUsage() {
-    Logger::info("AppFrameworkTests", "Testing memory usage");
+    LOG_INFO_TAG("AppFrameworkTests", "Testing memory usage");
     
     bool passed = validateMemoryUsage(1024 * 1024); // 1MB limit
     logTestResult("Memory usage", passed);
@@ -489,7 +504,7 @@ bool AppFrameworkTests::testMemoryUsage() {
 }
 
 bool AppFrameworkTests::testStartupTime() {
-    Logger::info("AppFrameworkTests", "Testing startup time");
+    LOG_INFO_TAG("AppFrameworkTests", "Testing startup time");
     
     uint32_t startTime = millis();
     
@@ -512,7 +527,7 @@ bool AppFrameworkTests::testStartupTime() {
 }
 
 bool AppFrameworkTests::testResponseTime() {
-    Logger::info("AppFrameworkTests", "Testing response time");
+    LOG_INFO_TAG("AppFrameworkTests", "Testing response time");
     
     // Test app manager update cycle
     uint32_t startTime = millis();
@@ -531,9 +546,9 @@ bool AppFrameworkTests::testResponseTime() {
 
 void AppFrameworkTests::logTestResult(const String& testName, bool passed) {
     if (passed) {
-        Logger::info("AppFrameworkTests", "✓ " + testName + " PASSED");
+        LOG_INFO_TAG("AppFrameworkTests", "✓ %s PASSED", testName.c_str());
     } else {
-        Logger::error("AppFrameworkTests", "✗ " + testName + " FAILED");
+        LOG_ERROR_TAG("AppFrameworkTests", "✗ %s FAILED", testName.c_str());
     }
 }
 
@@ -0,0 +1,620 @@
+/**
+ * @file test_benchmark.cpp
+ * @brief On-device benchmark and soak test suite
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ */
+
+#include "test_benchmark.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#include <algorithm>
+#include <stdarg.h>
+#include "lvgl.h"
+#include "core/hal/board_profile.h"
+#include "core/display/eink_manager.h"
+#include "core/display/eink_convert.h"
+#include "core/communication/communication_manager.h"
+#include "core/communication/lora_manager.h"
+#include "core/communication/cellular_manager.h"
+#include "core/communication/message_bus.h"
+#include "core/system/scheduler.h"
+#include "core/utils/trace.h"
+#include "core/utils/logger.h"
+#include "services/ota_manager.h"
+
+using namespace TDeckOS::Communication;
+
+// Bench packets: ping from the device under test, echo from its peer
+struct BenchPing {
+    char magic[4];
+    uint32_t run;
+    uint32_t seq;
+    uint32_t sentUs;
+};
+
+static const char BENCH_PING_MAGIC[4] = {'T', 'D', 'B', 'P'};
+static const char BENCH_ECHO_MAGIC[4] = {'T', 'D', 'B', 'E'};
+static constexpr uint32_t BENCH_BUS_TOPIC = busTopic("bench/bus");
+
+// ===== INTERNAL STATE =====
+static bench_writer_t writer = nullptr;
+static void* writer_ctx = nullptr;
+static CommunicationManager* comm = nullptr;
+static TaskHandle_t bench_task_handle = nullptr;
+static portMUX_TYPE bench_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t samples[BENCH_MAX_SAMPLES];
+
+// LVGL frames, rendered by bench_ui_hook() on the UI task
+static volatile uint16_t ui_frames_wanted = 0;
+static volatile uint16_t ui_frames_done = 0;
+static uint32_t ui_samples[BENCH_MAX_SAMPLES];
+static lv_obj_t* ui_label = nullptr;
+
+// LoRa loopback; the handlers run on the LoRa and bus tasks
+static uint32_t lora_run = 0;
+static volatile uint32_t lora_tx_done = 0;
+static volatile uint32_t lora_tx_failed = 0;
+static volatile uint32_t lora_echo_bytes = 0;
+static volatile uint16_t lora_rtt_count = 0;
+static uint32_t lora_rtt[BENCH_MAX_SAMPLES];
+
+static volatile uint32_t bus_delivered = 0;
+
+// ===== OUTPUT =====
+
+static void serial_writer(const char* line, void* ctx) {
+    (void) ctx;
+    Serial.println(line);
+}
+
+static void bench_emit(const char* format, ...) {
+    char line[BENCH_LINE_SIZE];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    bench_writer_t out = writer ? writer : serial_writer;
+    out(line, writer_ctx);
+}
+
+static void emit_samples(const char* name, const char* unit, uint32_t* values, uint16_t count) {
+    if (count == 0) {
+        bench_emit("{\"type\":\"result\",\"name\":\"%s\",\"skipped\":\"no samples\"}", name);
+        return;
+    }
+
+    std::sort(values, values + count);
+    uint64_t sum = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        sum += values[i];
+    }
+
+    bench_emit("{\"type\":\"result\",\"name\":\"%s\",\"unit\":\"%s\",\"n\":%u,\"mean\":%lu,"
+               "\"min\":%lu,\"p50\":%lu,\"p90\":%lu,\"p99\":%lu,\"max\":%lu}",
+               name, unit, count, (uint32_t)(sum / count), values[0], values[count / 2],
+               values[(count * 9) / 10], values[(count * 99) / 100], values[count - 1]);
+}
+
+static void emit_value(const char* name, const char* unit, float value) {
+    bench_emit("{\"type\":\"result\",\"name\":\"%s\",\"unit\":\"%s\",\"value\":%.2f}", name, unit, value);
+}
+
+static void emit_skip(const char* name, const char* reason) {
+    bench_emit("{\"type\":\"result\",\"name\":\"%s\",\"skipped\":\"%s\"}", name, reason);
+}
+
+// Samples a trace site recorded since the snapshot; percentiles are bucket upper bounds
+static void emit_trace_delta(const char* name, trace_site_t site, const trace_hist_t& before) {
+    trace_hist_t after;
+    trace_get_histogram(site, &after);
+
+    trace_hist_t delta = {};
+    delta.count = after.count - before.count;
+    delta.sum_us = after.sum_us - before.sum_us;
+    for (int i = 0; i < TRACE_HIST_BUCKETS; i++) {
+        delta.buckets[i] = after.buckets[i] - before.buckets[i];
+    }
+
+    if (delta.count == 0) {
+        emit_skip(name, "no samples");
+        return;
+    }
+    bench_emit("{\"type\":\"result\",\"name\":\"%s\",\"unit\":\"us\",\"n\":%lu,\"mean\":%lu,"
+               "\"p50\":%lu,\"p99\":%lu,\"source\":\"trace\"}",
+               name, delta.count, (uint32_t)(delta.sum_us / delta.count),
+               trace_hist_percentile(&delta, 50), trace_hist_percentile(&delta, 99));
+}
+
+static inline uint32_t now_us(void) {
+    return (uint32_t)esp_timer_get_time();
+}
+
+// Poll a counter until it reaches a target or the timeout passes
+static bool wait_for(volatile uint32_t* counter, uint32_t target, uint32_t timeout_ms) {
+    uint32_t start = millis();
+    while (*counter < target) {
+        if (millis() - start > timeout_ms) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(20));
+    }
+    return true;
+}
+
+// ===== E-INK =====
+
+static void bench_eink_convert(void) {
+    const uint16_t width = EINK_WIDTH;
+    const uint16_t height = EINK_HEIGHT;
+    const lv_area_t full = {0, 0, (lv_coord_t)(width - 1), (lv_coord_t)(height - 1)};
+    const lv_area_t band = {0, 96, (lv_coord_t)(width - 1), 127};
+
+    uint8_t* src = (uint8_t*)ps_malloc((size_t)width * height);
+    uint8_t* fb = (uint8_t*)ps_malloc(EINK_BUFFER_SIZE);
+    if (!src || !fb) {
+        free(src);
+        free(fb);
+        emit_skip("eink_convert_full", "out of memory");
+        return;
+    }
+    for (uint32_t i = 0; i < (uint32_t)width * height; i++) {
+        src[i] = (uint8_t)(((i * 7) >> 3) & 0x01);
+    }
+
+    const struct {
+        const char* name;
+        const lv_area_t* area;
+    } cases[] = {
+        {"eink_convert_full", &full},
+        {"eink_convert_band", &band},
+    };
+
+    for (const auto& bench : cases) {
+        for (uint16_t i = 0; i < BENCH_ITERATIONS; i++) {
+            uint32_t start = now_us();
+            eink_convert_area(reinterpret_cast<const lv_color_t*>(src), fb, width, height, bench.area);
+            samples[i] = now_us() - start;
+        }
+        emit_samples(bench.name, "us", samples, BENCH_ITERATIONS);
+    }
+
+    free(src);
+    free(fb);
+}
+
+static void bench_lvgl_frames(void) {
+    trace_hist_t flush_before;
+    trace_get_histogram(TRACE_LVGL_FLUSH, &flush_before);
+
+    ui_frames_done = 0;
+    ui_frames_wanted = BENCH_ITERATIONS;
+
+    uint32_t start = millis();
+    while (ui_frames_done < BENCH_ITERATIONS && millis() - start < BENCH_ITERATIONS * 1000UL) {
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+    uint16_t frames = ui_frames_done;
+    ui_frames_wanted = 0;
+
+    emit_samples("lvgl_frame", "us", ui_samples, frames);
+    emit_trace_delta("lvgl_flush", TRACE_LVGL_FLUSH, flush_before);
+}
+
+static bool wait_for_refresh(EinkRefreshMode mode) {
+    uint32_t before = eink_manager.getRenderedFrameCount();
+    eink_manager.requestMaintenance(mode);
+
+    uint32_t start = millis();
+    while (eink_manager.getRenderedFrameCount() == before) {
+        if (millis() - start > BENCH_REFRESH_TIMEOUT_MS) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(20));
+    }
+    return true;
+}
+
+// Partial refreshes come from the LVGL frames; the other modes are requested.
+// A clear or deep clean is followed by a full refresh that redraws the UI.
+static void bench_eink_refresh(void) {
+    static const char* const names[] = {
+        "eink_refresh_partial", "eink_refresh_full", "eink_refresh_clear", "eink_refresh_deep_clean"
+    };
+    trace_hist_t before[4];
+    for (int mode = 0; mode < 4; mode++) {
+        trace_get_histogram((trace_site_t)(TRACE_EINK_PARTIAL + mode), &before[mode]);
+    }
+
+    bench_lvgl_frames();
+
+    // Held-back partial regions flush within the adaptive interval
+    vTaskDelay(pdMS_TO_TICKS(eink_manager.getAdaptiveInterval() + 500));
+
+    for (int i = 0; i < 3; i++) {
+        wait_for_refresh(EINK_REFRESH_FULL);
+    }
+    for (int i = 0; i < 2; i++) {
+        wait_for_refresh(EINK_REFRESH_CLEAR);
+    }
+    wait_for_refresh(EINK_REFRESH_DEEP_CLEAN);
+
+    for (int mode = 0; mode < 4; mode++) {
+        emit_trace_delta(names[mode], (trace_site_t)(TRACE_EINK_PARTIAL + mode), before[mode]);
+    }
+}
+
+// ===== LORA =====
+
+static void on_lora_tx(bool success, int errorCode) {
+    (void) errorCode;
+    if (!success) {
+        lora_tx_failed = lora_tx_failed + 1;
+    }
+    lora_tx_done = lora_tx_done + 1;
+}
+
+// Echo other devices' pings and time the echoes of our own
+static void on_lora_packet(const BusMessage& message, void* context) {
+    (void) context;
+    if (message.length < sizeof(BenchPing)) {
+        return;
+    }
+
+    BenchPing ping;
+    memcpy(&ping, message.data, sizeof(ping));
+
+    if (memcmp(ping.magic, BENCH_PING_MAGIC, 4) == 0 && ping.run != lora_run) {
+        uint8_t echo[LORA_RX_SLOT_SIZE];
+        size_t length = message.length < sizeof(echo) ? message.length : sizeof(echo);
+        memcpy(echo, message.data, length);
+        memcpy(echo, BENCH_ECHO_MAGIC, 4);
+        comm->getLoRaManager()->transmit(echo, length, nullptr, LoRaTxPriority::URGENT);
+    } else if (memcmp(ping.magic, BENCH_ECHO_MAGIC, 4) == 0 && ping.run == lora_run) {
+        uint32_t rtt = now_us() - ping.sentUs;
+        portENTER_CRITICAL(&bench_lock);
+        if (lora_rtt_count < BENCH_MAX_SAMPLES) {
+            lora_rtt[lora_rtt_count] = rtt;
+            lora_rtt_count = lora_rtt_count + 1;
+        }
+        lora_echo_bytes = lora_echo_bytes + message.length;
+        portEXIT_CRITICAL(&bench_lock);
+    }
+}
+
+static void bench_lora(void) {
+    LoRaManager* lora = comm ? comm->getLoRaManager() : nullptr;
+    if (!lora || !lora->isInitialized()) {
+        emit_skip("lora_tx_throughput", "radio unavailable");
+        return;
+    }
+
+    trace_hist_t airtime_before, rx_before;
+    trace_get_histogram(TRACE_LORA_TX_AIRTIME, &airtime_before);
+    trace_get_histogram(TRACE_LORA_RX_LATENCY, &rx_before);
+    uint32_t deferrals_before = lora->getStats().dutyCycleDeferrals;
+
+    lora_tx_done = 0;
+    lora_tx_failed = 0;
+    lora_echo_bytes = 0;
+    lora_rtt_count = 0;
+
+    uint8_t payload[BENCH_LORA_PAYLOAD];
+    for (size_t i = 0; i < sizeof(payload); i++) {
+        payload[i] = (uint8_t)i;
+    }
+
+    // One packet at a time, so each ping's timestamp is taken as it goes out
+    uint32_t start = millis();
+    uint32_t queued = 0;
+    for (uint32_t seq = 0; seq < BENCH_LORA_PACKETS; seq++) {
+        BenchPing ping;
+        memcpy(ping.magic, BENCH_PING_MAGIC, 4);
+        ping.run = lora_run;
+        ping.seq = seq;
+        ping.sentUs = now_us();
+        memcpy(payload, &ping, sizeof(ping));
+
+        if (!lora->transmit(payload, sizeof(payload), on_lora_tx, LoRaTxPriority::NORMAL)) {
+            break;
+        }
+        queued++;
+        if (!wait_for(&lora_tx_done, queued, BENCH_LORA_ECHO_TIMEOUT_MS)) {
+            break;
+        }
+    }
+    uint32_t tx_ms = millis() - start;
+
+    // Echoes of the last pings are still on their way back
+    uint32_t wait_start = millis();
+    while (lora_rtt_count < queued && millis() - wait_start < BENCH_LORA_ECHO_TIMEOUT_MS) {
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+    uint32_t window_ms = millis() - start;
+
+    uint32_t sent = lora_tx_done - lora_tx_failed;
+    emit_value("lora_tx_throughput", "bps", tx_ms ? sent * sizeof(payload) * 8000.0f / tx_ms : 0.0f);
+    emit_value("lora_tx_failures", "count", (float)lora_tx_failed);
+    emit_value("lora_duty_cycle_deferrals", "count", (float)(lora->getStats().dutyCycleDeferrals - deferrals_before));
+    emit_trace_delta("lora_tx_airtime", TRACE_LORA_TX_AIRTIME, airtime_before);
+
+    if (lora_rtt_count == 0) {
+        emit_skip("lora_loopback_rtt", "no echo peer");
+        return;
+    }
+    uint16_t count = lora_rtt_count;
+    memcpy(samples, lora_rtt, count * sizeof(uint32_t));
+    emit_samples("lora_loopback_rtt", "us", samples, count);
+    emit_value("lora_rx_throughput", "bps", window_ms ? lora_echo_bytes * 8000.0f / window_ms : 0.0f);
+    emit_trace_delta("lora_rx_latency", TRACE_LORA_RX_LATENCY, rx_before);
+}
+
+// ===== CELLULAR =====
+
+static void bench_at_rtt(void) {
+    CellularManager* cellular = comm ? comm->getCellularManager() : nullptr;
+    if (!cellular || !cellular->isPoweredOn()) {
+        emit_skip("at_rtt", "modem off");
+        return;
+    }
+
+    uint16_t count = 0;
+    uint32_t failures = 0;
+    for (uint16_t i = 0; i < BENCH_AT_ITERATIONS; i++) {
+        String response;
+        uint32_t start = now_us();
+        if (cellular->sendATCommand("AT", response, 1000)) {
+            samples[count++] = now_us() - start;
+        } else {
+            failures++;
+        }
+    }
+    emit_samples("at_rtt", "us", samples, count);
+    emit_value("at_failures", "count", (float)failures);
+}
+
+// ===== MESSAGE BUS =====
+
+static void on_bus_message(const BusMessage& message, void* context) {
+    (void) message;
+    (void) context;
+    bus_delivered = bus_delivered + 1;
+}
+
+// Publish rate of the internal pub/sub path every transport feeds. Sourced
+// from BLUETOOTH so the radios' traffic counters are left alone.
+static void bench_bus(void) {
+    MessageBus& bus = MessageBus::getInstance();
+    int subscription = bus.subscribe(BENCH_BUS_TOPIC, on_bus_message);
+    if (subscription < 0) {
+        emit_skip("bus_publish_rate", "no subscription slot");
+        return;
+    }
+
+    uint8_t data[64];
+    memset(data, 0xA5, sizeof(data));
+    bus_delivered = 0;
+
+    uint32_t published = 0;
+    uint32_t start = now_us();
+    for (uint32_t i = 0; i < BENCH_BUS_MESSAGES; i++) {
+        if (bus.publish(BENCH_BUS_TOPIC, data, sizeof(data), CommInterface::BLUETOOTH)) {
+            published++;
+        } else {
+            // Queue full; let the bus task catch up
+            vTaskDelay(1);
+        }
+    }
+    uint32_t publish_us = now_us() - start;
+
+    wait_for(&bus_delivered, published, 2000);
+    uint32_t delivery_us = now_us() - start;
+    bus.unsubscribe(subscription);
+
+    emit_value("bus_publish_rate", "msg/s", publish_us ? published * 1e6f / publish_us : 0.0f);
+    emit_value("bus_delivery_rate", "msg/s", delivery_us ? bus_delivered * 1e6f / delivery_us : 0.0f);
+    emit_value("bus_drops", "count", (float)(BENCH_BUS_MESSAGES - published));
+}
+
+// ===== ALLOCATOR =====
+
+static void bench_alloc_caps(const char* name, uint32_t caps) {
+    static void* slots[64];
+    memset(slots, 0, sizeof(slots));
+
+    uint32_t seed = 0x2545F491;
+    uint32_t failures = 0;
+    uint32_t start = now_us();
+    for (uint32_t op = 0; op < BENCH_ALLOC_OPS; op++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+
+        void*& slot = slots[seed & 63];
+        if (slot) {
+            heap_caps_free(slot);
+            slot = nullptr;
+        } else {
+            slot = heap_caps_malloc(16 + (seed >> 8) % 2032, caps);
+            if (!slot) {
+                failures++;
+            }
+        }
+    }
+    uint32_t elapsed = now_us() - start;
+
+    for (void* slot : slots) {
+        heap_caps_free(slot);
+    }
+
+    emit_value(name, "ops/s", elapsed ? BENCH_ALLOC_OPS * 1e6f / elapsed : 0.0f);
+    if (failures) {
+        emit_value("alloc_failures", "count", (float)failures);
+    }
+}
+
+static void bench_alloc(void) {
+    bench_alloc_caps("alloc_internal_rate", MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    bench_alloc_caps("alloc_psram_rate", MALLOC_CAP_SPIRAM);
+}
+
+// ===== SOAK =====
+
+// 0 with everything in one block, approaching 100 as free memory splinters
+static uint32_t fragmentation_pct(uint32_t caps) {
+    size_t free_bytes = heap_caps_get_free_size(caps);
+    size_t largest = heap_caps_get_largest_free_block(caps);
+    return free_bytes ? 100 - (uint32_t)((uint64_t)largest * 100 / free_bytes) : 0;
+}
+
+void bench_soak_sample(void) {
+    const uint32_t internal = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+
+    trace_sample_tasks();
+    trace_task_stat_t tasks[TRACE_MAX_TASKS];
+    uint8_t task_count = trace_get_task_stats(tasks, TRACE_MAX_TASKS);
+    const trace_task_stat_t* tightest = nullptr;
+    for (uint8_t i = 0; i < task_count; i++) {
+        if (!tightest || tasks[i].stack_free < tightest->stack_free) {
+            tightest = &tasks[i];
+        }
+    }
+
+    bench_emit("{\"type\":\"soak\",\"uptime_s\":%lu,"
+               "\"internal_free\":%u,\"internal_min\":%u,\"internal_largest\":%u,\"internal_frag_pct\":%lu,"
+               "\"psram_free\":%u,\"psram_min\":%u,\"psram_largest\":%u,\"psram_frag_pct\":%lu,"
+               "\"cpu_pct\":%.1f,\"min_stack_task\":\"%s\",\"min_stack_free\":%lu}",
+               millis() / 1000,
+               heap_caps_get_free_size(internal), heap_caps_get_minimum_free_size(internal),
+               heap_caps_get_largest_free_block(internal), fragmentation_pct(internal),
+               heap_caps_get_free_size(MALLOC_CAP_SPIRAM), heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM),
+               heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM), fragmentation_pct(MALLOC_CAP_SPIRAM),
+               trace_get_cpu_usage(), tightest ? tightest->name : "", tightest ? tightest->stack_free : 0);
+}
+
+static void bench_soak(sched_source_t source) {
+    trace_hist_t before[TRACE_SITE_COUNT];
+    for (int site = 0; site < TRACE_SITE_COUNT; site++) {
+        trace_get_histogram((trace_site_t)site, &before[site]);
+    }
+
+    uint32_t start = millis();
+    const uint32_t duration_ms = BENCH_SOAK_HOURS * 3600000UL;
+    while (millis() - start < duration_ms) {
+        bench_soak_sample();
+        sched_set_deadline(source, BENCH_SOAK_INTERVAL_MS);
+        sched_wait();
+    }
+
+    // Latency of every instrumented path over the whole soak
+    bench_soak_sample();
+    for (int site = 0; site < TRACE_SITE_COUNT; site++) {
+        char name[48];
+        snprintf(name, sizeof(name), "soak_%s", trace_site_name((trace_site_t)site));
+        emit_trace_delta(name, (trace_site_t)site, before[site]);
+    }
+    bench_emit("{\"type\":\"soak_done\",\"hours\":%u}", BENCH_SOAK_HOURS);
+}
+
+// ===== PUBLIC API =====
+
+void bench_set_writer(bench_writer_t out, void* ctx) {
+    writer = out;
+    writer_ctx = ctx;
+}
+
+void bench_run_suite(void) {
+    // No light sleep while timing
+    sched_wake_lock();
+
+    bench_emit("{\"type\":\"run\",\"firmware\":\"%s\",\"build\":\"%s %s\",\"board\":\"%s\",\"revision\":%u,"
+               "\"cpu_mhz\":%lu,\"reset_reason\":%d}",
+               OtaManager::getRunningVersion(), __DATE__, __TIME__, TDeckOS::Board::Active::NAME,
+               TDeckOS::Board::Active::REVISION, ESP.getCpuFreqMHz(), (int)esp_reset_reason());
+
+    bench_eink_convert();
+    bench_eink_refresh();
+    bench_lora();
+    bench_at_rtt();
+    bench_bus();
+    bench_alloc();
+    bench_soak_sample();
+
+    bench_emit("{\"type\":\"suite_done\",\"uptime_ms\":%lu}", millis());
+    sched_wake_unlock();
+}
+
+static void bench_task(void* parameter) {
+    (void) parameter;
+    sched_source_t source = sched_register("bench", NULL);
+
+    sched_set_deadline(source, BENCH_START_DELAY_MS);
+    sched_wait();
+
+    bench_run_suite();
+    bench_soak(source);
+
+    bench_task_handle = nullptr;
+    vTaskDelete(NULL);
+}
+
+bool bench_start(CommunicationManager* manager) {
+    if (bench_task_handle) {
+        return true;
+    }
+    comm = manager;
+    lora_run = esp_random();
+
+    // Echo peers' pings for as long as the bench firmware runs
+    MessageBus::getInstance().subscribe(BUS_TOPIC_LORA_RX, on_lora_packet);
+
+    BaseType_t result = xTaskCreatePinnedToCore(
+        bench_task,
+        "bench",
+        BENCH_TASK_STACK_SIZE,
+        NULL,
+        BENCH_TASK_PRIORITY,
+        &bench_task_handle,
+        0
+    );
+    if (result != pdPASS) {
+        LOG_ERROR_TAG("Bench", "Failed to create bench task");
+        bench_task_handle = nullptr;
+        return false;
+    }
+
+    LOG_INFO_TAG("Bench", "Benchmark suite starts in %lu ms", (uint32_t)BENCH_START_DELAY_MS);
+    return true;
+}
+
+bool bench_ui_hook(void) {
+    if (ui_frames_done >= ui_frames_wanted) {
+        return false;
+    }
+
+    if (!ui_label) {
+        ui_label = lv_label_create(lv_layer_top());
+        lv_obj_align(ui_label, LV_ALIGN_BOTTOM_MID, 0, -4);
+    }
+
+    // A changed label forces a real render and flush of its area
+    char text[24];
+    snprintf(text, sizeof(text), "bench %u", ui_frames_done);
+    lv_label_set_text(ui_label, text);
+
+    uint32_t start = now_us();
+    lv_refr_now(NULL);
+    ui_samples[ui_frames_done] = now_us() - start;
+    ui_frames_done = ui_frames_done + 1;
+
+    if (ui_frames_done >= ui_frames_wanted) {
+        lv_obj_del(ui_label);
+        ui_label = nullptr;
+        return false;
+    }
+    return true;
+}
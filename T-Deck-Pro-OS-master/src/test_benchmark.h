@@ -0,0 +1,96 @@
+/**
+ * @file test_benchmark.h
+ * @brief On-device benchmark and soak test suite
+ * @author T-Deck-Pro OS Team
+ * @date 2025
+ *
+ * Built into the t-deck-pro-bench environment (BENCH_BUILD). After boot the
+ * bench task runs the suite once - e-ink conversion and refresh per mode,
+ * LVGL frame time, LoRa TX throughput and loopback latency, AT command
+ * round trip, message bus publish rate, allocator throughput - and then
+ * keeps sampling heap and latency statistics for BENCH_SOAK_HOURS.
+ *
+ * Every result is one JSON object per line, so runs can be captured from
+ * the serial monitor and compared across releases:
+ *
+ *   {"type":"result","name":"at_rtt","unit":"us","n":20,"mean":31250,...}
+ *
+ * LoRa loopback needs a second device running the bench firmware; each
+ * bench device echoes the other's ping packets.
+ */
+
+#ifndef TEST_BENCHMARK_H
+#define TEST_BENCHMARK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+namespace TDeckOS {
+namespace Communication {
+class CommunicationManager;
+}
+}
+
+// ===== CONFIGURATION =====
+#ifndef BENCH_START_DELAY_MS
+#define BENCH_START_DELAY_MS 15000          // Let boot, WiFi and the modem settle first
+#endif
+
+#ifndef BENCH_SOAK_HOURS
+#define BENCH_SOAK_HOURS 24
+#endif
+
+#ifndef BENCH_SOAK_INTERVAL_MS
+#define BENCH_SOAK_INTERVAL_MS 600000       // Soak sample every 10 minutes
+#endif
+
+#define BENCH_ITERATIONS 50                 // Conversion and LVGL frame samples
+#define BENCH_MAX_SAMPLES 256
+#define BENCH_REFRESH_TIMEOUT_MS 30000      // Deep clean takes several seconds
+#define BENCH_LORA_PACKETS 10
+#define BENCH_LORA_PAYLOAD 200
+#define BENCH_LORA_ECHO_TIMEOUT_MS 15000
+#define BENCH_AT_ITERATIONS 20
+#define BENCH_BUS_MESSAGES 500
+#define BENCH_ALLOC_OPS 10000
+#define BENCH_LINE_SIZE 384
+#define BENCH_TASK_STACK_SIZE 8192
+#define BENCH_TASK_PRIORITY 1
+
+/**
+ * @brief Output sink for result lines; line has no trailing newline
+ */
+typedef void (*bench_writer_t)(const char* line, void* ctx);
+
+/**
+ * @brief Replace the serial writer, e.g. to forward results to the server
+ */
+void bench_set_writer(bench_writer_t writer, void* ctx);
+
+/**
+ * @brief Start the bench task: the suite once, then the soak test
+ * @param comm Communication manager providing the radios
+ * @return false if the task could not be created
+ */
+bool bench_start(TDeckOS::Communication::CommunicationManager* comm);
+
+/**
+ * @brief Run every benchmark once on the calling task
+ */
+void bench_run_suite(void);
+
+/**
+ * @brief Emit one soak sample: uptime, heap and fragmentation, task stacks
+ */
+void bench_soak_sample(void);
+
+/**
+ * @brief LVGL work for the suite; call from the UI task every pass
+ *
+ * LVGL is not thread safe, so the bench task only requests frames and the
+ * UI task renders and times them here.
+ * @return true while frames are still wanted
+ */
+bool bench_ui_hook(void);
+
+#endif // TEST_BENCHMARK_H